@@ -174,8 +174,8 @@ auto EditorApp::EndFrame() -> void {
 }
 
 
-auto EditorApp::PrepareRender() -> void {
-  imgui_renderer_.ExtractDrawData();
+auto EditorApp::PrepareRender(UINT const frame_idx) -> void {
+  imgui_renderer_.ExtractDrawData(frame_idx);
 }
 
 
@@ -36,7 +36,7 @@ public:
   auto BeginFrame() -> void override;
   auto Update() -> void override;
   auto EndFrame() -> void override;
-  auto PrepareRender() -> void override;
+  auto PrepareRender(UINT frame_idx) -> void override;
   auto Render() -> void override;
 
   [[nodiscard]] auto GetImGuiIo() const noexcept -> ImGuiIO const&;
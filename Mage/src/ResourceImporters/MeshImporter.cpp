@@ -13,6 +13,7 @@
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 
+#include "animation_compression.hpp"
 #include "Serialization.hpp"
 #include "../FileIo.hpp"
 #include "../Resources/Mesh.hpp"
@@ -35,6 +36,33 @@ struct Node {
 
 
 namespace {
+// Error bounds of the animation key reduction.
+// Translations are in the units of the model, rotations are in radians.
+constexpr float max_anim_translation_error{0.001f};
+constexpr float max_anim_rotation_error{0.001f};
+constexpr float max_anim_scaling_error{0.001f};
+
+
+auto SerializeTrackKeys(std::span<float const> const timestamps,
+                        std::span<std::array<std::uint16_t, 3> const> const values,
+                        std::vector<std::byte>& bytes) -> void {
+  std::ranges::copy(as_bytes(timestamps), std::back_inserter(bytes));
+  std::ranges::copy(as_bytes(values), std::back_inserter(bytes));
+}
+
+
+auto SerializeTrack(Vector3Track const& track, std::vector<std::byte>& bytes) -> void {
+  SerializeTrackKeys(track.timestamps, track.values, bytes);
+  std::ranges::copy(as_bytes(std::span{track.range_min.GetData(), 3}), std::back_inserter(bytes));
+  std::ranges::copy(as_bytes(std::span{track.range_extent.GetData(), 3}), std::back_inserter(bytes));
+}
+
+
+auto SerializeTrack(QuaternionTrack const& track, std::vector<std::byte>& bytes) -> void {
+  SerializeTrackKeys(track.timestamps, track.values, bytes);
+}
+
+
 [[nodiscard]] auto Convert(aiVector3D const& ai_vec) noexcept -> Vector3 {
   return Vector3{ai_vec.x, ai_vec.y, ai_vec.z};
 }
@@ -297,7 +325,10 @@ auto MeshImporter::Import(std::filesystem::path const& src, std::vector<std::byt
   bones.reserve(bone_proc_info.size());
   std::ranges::transform(bone_proc_info, std::back_inserter(bones),
     [&skeleton_node_name_to_idx](BoneProcessingInfo const& bone_info) {
-      return Bone{bone_info.offset_matrix, skeleton_node_name_to_idx.at(bone_info.node_name)};
+      return Bone{
+        bone_info.offset_matrix, skeleton_node_name_to_idx.at(bone_info.node_name),
+        AABB{Vector3{std::numeric_limits<float>::max()}, Vector3{std::numeric_limits<float>::lowest()}}
+      };
     });
 
   // Store geometry data and create submeshes
@@ -319,6 +350,22 @@ auto MeshImporter::Import(std::filesystem::path const& src, std::vector<std::byt
     std::ranges::copy(bone_indices, std::back_inserter(mesh_data.bone_indices));
   }
 
+  // Bound the vertices of each bone in the space of the bone so that the bounds of skinned instances can be derived
+  // from the evaluated pose at runtime
+
+  for (std::size_t i{0}; i < mesh_data.positions.size(); i++) {
+    for (auto j{0}; j < 4; j++) {
+      if (mesh_data.bone_weights[i][j] == 0.0f) {
+        continue;
+      }
+
+      auto& bone{bones[mesh_data.bone_indices[i][j]]};
+      auto const bone_space_pos{Vector3{Vector4{mesh_data.positions[i], 1} * bone.offset_mtx}};
+      bone.bounds.min = Min(bone.bounds.min, bone_space_pos);
+      bone.bounds.max = Max(bone.bounds.max, bone_space_pos);
+    }
+  }
+
   // Transform indices to 16-bit if possible
 
   if (auto const& indices32{std::get<std::vector<std::uint32_t>>(mesh_data.indices)}; std::ranges::all_of(indices32,
@@ -424,7 +471,9 @@ auto MeshImporter::Import(std::filesystem::path const& src, std::vector<std::byt
           };
         });
 
-      node_anims.emplace_back(std::move(position_keys), std::move(rotation_keys), std::move(scaling_keys),
+      // Reduce and quantize the keys, the raw keys are not kept
+      node_anims.emplace_back(CompressTrack(position_keys, max_anim_translation_error),
+        CompressTrack(rotation_keys, max_anim_rotation_error), CompressTrack(scaling_keys, max_anim_scaling_error),
         skeleton_node_name_to_idx[channel->mNodeName.C_Str()]);
     }
 
@@ -497,22 +546,16 @@ auto MeshImporter::Import(std::filesystem::path const& src, std::vector<std::byt
     SerializeToBinary(ticks_per_second, bytes);
     SerializeToBinary(node_anims.size(), bytes);
 
-    for (auto const& [position_keys, rotation_keys, scaling_keys, node_idx] : node_anims) {
+    for (auto const& [position_track, rotation_track, scaling_track, node_idx] : node_anims) {
       SerializeToBinary(node_idx, bytes);
 
-      SerializeToBinary(position_keys.size(), bytes);
-      SerializeToBinary(rotation_keys.size(), bytes);
-      SerializeToBinary(scaling_keys.size(), bytes);
-
-      auto const pos_key_bytes{as_bytes(std::span{position_keys})};
-      auto const rot_key_bytes{as_bytes(std::span{rotation_keys})};
-      auto const scale_key_bytes{as_bytes(std::span{scaling_keys})};
-
-      bytes.reserve(pos_key_bytes.size() + rot_key_bytes.size() + scale_key_bytes.size());
+      SerializeToBinary(position_track.timestamps.size(), bytes);
+      SerializeToBinary(rotation_track.timestamps.size(), bytes);
+      SerializeToBinary(scaling_track.timestamps.size(), bytes);
 
-      std::ranges::copy(pos_key_bytes, std::back_inserter(bytes));
-      std::ranges::copy(rot_key_bytes, std::back_inserter(bytes));
-      std::ranges::copy(scale_key_bytes, std::back_inserter(bytes));
+      SerializeTrack(position_track, bytes);
+      SerializeTrack(rotation_track, bytes);
+      SerializeTrack(scaling_track, bytes);
     }
   }
 
@@ -531,9 +574,11 @@ auto MeshImporter::Import(std::filesystem::path const& src, std::vector<std::byt
 
   // Bones
 
-  for (auto const& [offset_matrix, node_idx] : bones) {
+  for (auto const& [offset_matrix, node_idx, bounds] : bones) {
     std::ranges::copy(as_bytes(std::span{offset_matrix.GetData(), 16}), std::back_inserter(bytes));
     SerializeToBinary(node_idx, bytes);
+    std::ranges::copy(as_bytes(std::span{bounds.min.GetData(), 3}), std::back_inserter(bytes));
+    std::ranges::copy(as_bytes(std::span{bounds.max.GetData(), 3}), std::back_inserter(bytes));
   }
 
   categ = ExternalResourceCategory::Mesh;
@@ -159,6 +159,33 @@ auto SceneViewWindow::Draw(EditorApp& context) -> void {
 
     ImGui::Image(cam_.GetRenderTarget()->GetColorTex().get(), contentRegionSize);
 
+    // Select the entity whose static mesh bounds are hit first by the ray under the cursor
+    if (ImGui::IsItemClicked(ImGuiMouseButton_Left) && !ImGuizmo::IsOver() && !cam_moving_) {
+      auto const image_pos{ImGui::GetItemRectMin()};
+      auto const mouse_pos{ImGui::GetMousePos()};
+      auto const ndc_x{(mouse_pos.x - image_pos.x) / contentRegionSize.x * 2 - 1};
+      auto const ndc_y{1 - (mouse_pos.y - image_pos.y) / contentRegionSize.y * 2};
+
+      auto const inv_view_proj_mtx{
+        (cam_.CalculateViewMatrix() * cam_.CalculateProjectionMatrix(contentRegionSize.x / contentRegionSize.y)).
+        Inverse()
+      };
+
+      // The cursor is unprojected onto the near and far planes, which works for orthographic cameras as well
+      auto near_point{Vector4{ndc_x, ndc_y, 0, 1} * inv_view_proj_mtx};
+      near_point /= near_point[3];
+
+      auto far_point{Vector4{ndc_x, ndc_y, 1, 1} * inv_view_proj_mtx};
+      far_point /= far_point[3];
+
+      Ray const ray_ws{Vector3{near_point}, Normalized(Vector3{far_point} - Vector3{near_point})};
+
+      // Clicking empty space keeps the current selection
+      if (auto const hit_component{App::Instance().GetSceneRenderer().Raycast(ray_ws)}) {
+        context.SetSelectedObject(hit_component->GetEntity().Get());
+      }
+    }
+
     auto const aspect{ImGui::GetWindowWidth() / ImGui::GetWindowHeight()};
     auto const camViewMtx{cam_.CalculateViewMatrix()};
     auto const camProjMtx{cam_.CalculateProjectionMatrix(aspect)};
@@ -156,13 +156,20 @@ auto SettingsWindow::Draw() -> void {
       App::Instance().GetSceneRenderer().SetShadowCascadeCount(cascadeCount);
     }
 
-    auto const cascadeSplits{App::Instance().GetSceneRenderer().GetNormalizedShadowCascadeSplits()};
-    auto const splitCount{std::ssize(cascadeSplits)};
+    if (bool automaticCascadeSplits{App::Instance().GetSceneRenderer().IsUsingAutomaticShadowCascadeSplits()};
+      ImGui::Checkbox("Automatic Shadow Cascade Splits", &automaticCascadeSplits)) {
+      App::Instance().GetSceneRenderer().SetUseAutomaticShadowCascadeSplits(automaticCascadeSplits);
+    }
+
+    if (!App::Instance().GetSceneRenderer().IsUsingAutomaticShadowCascadeSplits()) {
+      auto const cascadeSplits{App::Instance().GetSceneRenderer().GetNormalizedShadowCascadeSplits()};
+      auto const splitCount{std::ssize(cascadeSplits)};
 
-    for (int i = 0; i < splitCount; i++) {
-      if (float cascadeSplit{cascadeSplits[i] * 100.0f}; ImGui::SliderFloat(
-        std::format("Split {} (percent)", i + 1).data(), &cascadeSplit, 0, 100, "%.3f", ImGuiSliderFlags_NoInput)) {
-        App::Instance().GetSceneRenderer().SetNormalizedShadowCascadeSplit(i, cascadeSplit / 100.0f);
+      for (int i = 0; i < splitCount; i++) {
+        if (float cascadeSplit{cascadeSplits[i] * 100.0f}; ImGui::SliderFloat(
+          std::format("Split {} (percent)", i + 1).data(), &cascadeSplit, 0, 100, "%.3f", ImGuiSliderFlags_NoInput)) {
+          App::Instance().GetSceneRenderer().SetNormalizedShadowCascadeSplit(i, cascadeSplit / 100.0f);
+        }
       }
     }
 
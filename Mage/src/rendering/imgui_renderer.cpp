@@ -73,7 +73,7 @@ auto ImGuiRenderer::UpdateFonts() -> void {
   }, D3D12_HEAP_TYPE_DEFAULT, nullptr);
 
 
-  render_manager_->UpdateTexture(*fonts_tex_, 0, std::array{
+  render_manager_->UpdateTexture(fonts_tex_, 0, std::array{
     D3D12_SUBRESOURCE_DATA{
       fonts_tex_pixel_data, static_cast<LONG_PTR>(fonts_tex_width) * 4,
       static_cast<LONG_PTR>(fonts_tex_height) * static_cast<LONG_PTR>(fonts_tex_width) * 4
@@ -84,9 +84,9 @@ auto ImGuiRenderer::UpdateFonts() -> void {
 }
 
 
-auto ImGuiRenderer::ExtractDrawData() -> void {
+auto ImGuiRenderer::ExtractDrawData(UINT const frame_idx) -> void {
   auto const& src_draw_data{*ImGui::GetDrawData()};
-  auto& dst_draw_data{draw_data_[render_manager_->GetCurrentFrameIndex()]};
+  auto& dst_draw_data{draw_data_[frame_idx]};
 
   dst_draw_data.Valid = src_draw_data.Valid;
   dst_draw_data.CmdListsCount = src_draw_data.CmdListsCount;
@@ -17,7 +17,8 @@ public:
 
   auto UpdateFonts() -> void;
 
-  auto ExtractDrawData() -> void;
+  // The frame index is that of the frame the data is rendered in
+  auto ExtractDrawData(UINT frame_idx) -> void;
   auto Render() -> void;
 
 private:
@@ -0,0 +1,136 @@
+#include "test.hpp"
+
+#include "animation_compression.hpp"
+#include "animation_sampler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+
+namespace sorcery::tests {
+namespace {
+// The bounds the mesh importer compresses with
+constexpr float kMaxTranslationError{0.001f};
+constexpr float kMaxRotationError{0.001f};
+constexpr float kMaxScalingError{0.001f};
+
+
+struct Clip {
+  std::vector<PositionKey> pos_keys;
+  std::vector<RotationKey> rot_keys;
+  std::vector<ScalingKey> scaling_keys;
+};
+
+
+// 300 keys at 30 fps per track: smooth motion, constant scale, and rotations with noise and flipped signs
+auto CreateClips(int const count) -> std::vector<Clip> {
+  std::mt19937 rng{3};
+  std::uniform_real_distribution dist{-1.0f, 1.0f};
+  std::vector<Clip> clips;
+
+  for (auto clip_idx{0}; clip_idx < count; clip_idx++) {
+    auto& clip{clips.emplace_back()};
+    auto const amplitude{Vector3{dist(rng) * 3, dist(rng) * 3, dist(rng)}};
+    auto const frequency{1 + dist(rng) * 0.8f};
+    auto const axis{Normalized(Vector3{amplitude[0], amplitude[1], amplitude[2] + 0.1f})};
+
+    for (auto i{0}; i < 300; i++) {
+      auto const time{static_cast<float>(i) / 30};
+      clip.pos_keys.emplace_back(time, Vector3{
+        amplitude[0] * std::sin(frequency * time), amplitude[1] * std::cos(0.5f * frequency * time),
+        amplitude[2] * time
+      });
+      clip.scaling_keys.emplace_back(time, Vector3{1});
+
+      auto const noise{clip_idx % 3 == 0 ? dist(rng) * 0.01f : 0.0f};
+      auto rot{Quaternion::FromAxisAngle(axis, 90 * std::sin(frequency * time) + noise)};
+
+      // Both signs encode the same rotation, compression has to cope with either
+      if (i % 7 == 3) {
+        rot = Quaternion{-rot.w, -rot.x, -rot.y, -rot.z};
+      }
+
+      clip.rot_keys.emplace_back(time, rot);
+    }
+  }
+
+  return clips;
+}
+
+
+auto CalculateMaxError(std::vector<AnimationKey<Vector3>> const& keys, Vector3Track const& track) -> float {
+  unsigned cursor{0};
+  auto max_error{0.0f};
+
+  for (auto const& key : keys) {
+    max_error = std::max(max_error, Distance(AnimationSampler::SampleTrack(track, key.timestamp, cursor), key.value));
+  }
+
+  return max_error;
+}
+
+
+// Angle between the original and the sampled rotations in radians
+auto CalculateMaxError(std::vector<RotationKey> const& keys, QuaternionTrack const& track) -> float {
+  unsigned cursor{0};
+  auto max_error{0.0f};
+
+  for (auto const& key : keys) {
+    auto const sampled{AnimationSampler::SampleTrack(track, key.timestamp, cursor).Normalized()};
+    auto const original{key.value.Normalized()};
+    auto const dot{
+      std::abs(sampled.w * original.w + sampled.x * original.x + sampled.y * original.y + sampled.z * original.z)
+    };
+    max_error = std::max(max_error, 2 * std::acos(std::min(dot, 1.0f)));
+  }
+
+  return max_error;
+}
+}
+
+
+SORCERY_TEST(AnimationCompressionStaysWithinTheErrorBoundsAndShrinksClips5To10Times) {
+  auto max_translation_error{0.0f};
+  auto max_rotation_error{0.0f};
+  auto max_scaling_error{0.0f};
+  std::size_t raw_size{0};
+  std::size_t compressed_size{0};
+
+  for (auto const& [pos_keys, rot_keys, scaling_keys] : CreateClips(200)) {
+    auto const pos_track{CompressTrack(pos_keys, kMaxTranslationError)};
+    auto const rot_track{CompressTrack(rot_keys, kMaxRotationError)};
+    auto const scaling_track{CompressTrack(scaling_keys, kMaxScalingError)};
+
+    max_translation_error = std::max(max_translation_error, CalculateMaxError(pos_keys, pos_track));
+    max_rotation_error = std::max(max_rotation_error, CalculateMaxError(rot_keys, rot_track));
+    max_scaling_error = std::max(max_scaling_error, CalculateMaxError(scaling_keys, scaling_track));
+
+    raw_size += pos_keys.size() * sizeof(PositionKey) + rot_keys.size() * sizeof(RotationKey) + scaling_keys.size() *
+      sizeof(ScalingKey);
+    compressed_size += CalculateTrackSize(pos_track) + CalculateTrackSize(rot_track) + CalculateTrackSize(
+      scaling_track);
+  }
+
+  SORCERY_CHECK(max_translation_error <= kMaxTranslationError);
+  SORCERY_CHECK(max_rotation_error <= kMaxRotationError);
+  SORCERY_CHECK(max_scaling_error <= kMaxScalingError);
+
+  auto const ratio{static_cast<double>(raw_size) / static_cast<double>(compressed_size)};
+  SORCERY_CHECK(ratio >= 5 && ratio <= 10);
+}
+
+
+SORCERY_TEST(AnimationCompressionReducesConstantTracksToASingleKey) {
+  std::vector<PositionKey> keys;
+
+  for (auto i{0}; i < 100; i++) {
+    keys.emplace_back(static_cast<float>(i), Vector3{1, 2, 3 + (i % 2 == 0 ? 0.0001f : -0.0001f)});
+  }
+
+  auto const track{CompressTrack(keys, kMaxTranslationError)};
+  SORCERY_CHECK(track.timestamps.size() == 1);
+  SORCERY_CHECK(CalculateMaxError(keys, track) <= kMaxTranslationError);
+}
+}
@@ -0,0 +1,167 @@
+#include "test.hpp"
+
+#include "rendering/animation_lod_scheduler.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+
+namespace sorcery::tests {
+namespace {
+using rendering::AnimationLod;
+using rendering::AnimationLodScheduler;
+
+
+constexpr float kFovVertDeg{60.0f};
+constexpr std::array kLods{AnimationLod{0.25f, 1, 0}, AnimationLod{0.08f, 2, 1}, AnimationLod{0, 4, 2}};
+
+
+// Looks down +Z from the position, the way the scene renderer sets up the views of perspective cameras
+auto CreatePerspectiveView(Vector3 const& position) -> AnimationLodScheduler::View {
+  return AnimationLodScheduler::View{
+    Frustum{
+      Matrix4::LookTo(position, Vector3::Forward(), Vector3::Up()) *
+      Matrix4::PerspectiveFov(ToRadians(kFovVertDeg), 1.0f, 0.1f, 1000.0f)
+    },
+    position, 0.5f / std::tan(ToRadians(kFovVertDeg / 2.0f)), true
+  };
+}
+
+
+auto CreateCube(Vector3 const& center, float const half_extent) -> AABB {
+  return AABB{center - Vector3{half_extent}, center + Vector3{half_extent}};
+}
+
+
+auto IsNear(std::optional<float> const value, float const expected) -> bool {
+  return value && std::abs(*value - expected) < 1e-4f;
+}
+
+
+auto CreateInstance(std::uint64_t const last_update_frame, unsigned const update_interval, float const screen_height,
+                    bool const evaluated = true) -> AnimationLodScheduler::Instance {
+  return AnimationLodScheduler::Instance{last_update_frame, update_interval, screen_height, evaluated, true};
+}
+}
+
+
+SORCERY_TEST(AnimationLodSchedulerCalculatesTheScreenHeightOfTheBounds) {
+  std::array const views{CreatePerspectiveView(Vector3::Zero())};
+  auto const scale{views[0].screen_height_scale};
+
+  // The diameter over the distance to the center, scaled to the viewport height
+  auto const cube{CreateCube(Vector3{0, 0, 10}, 1)};
+  SORCERY_CHECK(IsNear(AnimationLodScheduler::CalculateScreenHeight(cube, views), std::sqrt(12.0f) * scale / 10.0f));
+
+  // Behind the camera
+  SORCERY_CHECK(!AnimationLodScheduler::CalculateScreenHeight(CreateCube(Vector3{0, 0, -10}, 1), views));
+
+  // The closest view counts
+  std::array const two_views{CreatePerspectiveView(Vector3{0, 0, -90}), CreatePerspectiveView(Vector3{0, 0, 5})};
+  SORCERY_CHECK(IsNear(AnimationLodScheduler::CalculateScreenHeight(cube, two_views), std::sqrt(12.0f) * scale /
+                                                                                      5.0f));
+
+  // Orthographic views don't depend on the distance
+  std::array const ortho_views{
+    AnimationLodScheduler::View{views[0].frustum_ws, Vector3::Zero(), 1.0f / 20.0f, false}
+  };
+  SORCERY_CHECK(IsNear(AnimationLodScheduler::CalculateScreenHeight(cube, ortho_views), std::sqrt(12.0f) / 20.0f));
+  SORCERY_CHECK(IsNear(AnimationLodScheduler::CalculateScreenHeight(CreateCube(Vector3{0, 0, 100}, 1), ortho_views),
+    std::sqrt(12.0f) / 20.0f));
+}
+
+
+SORCERY_TEST(AnimationLodSchedulerSelectsTheLodFromTheScreenHeight) {
+  std::array const views{CreatePerspectiveView(Vector3::Zero())};
+
+  auto const select_at_distance{
+    [&views](float const distance) -> AnimationLod const& {
+      auto const screen_height{
+        AnimationLodScheduler::CalculateScreenHeight(CreateCube(Vector3{0, 0, distance}, 0.5f), views)
+      };
+      return AnimationLodScheduler::SelectLod(kLods, screen_height.value_or(0.0f));
+    }
+  };
+
+  // The screen height of a unit cube is about 1.5 over the distance
+  SORCERY_CHECK(&select_at_distance(2) == &kLods[0]);
+  SORCERY_CHECK(&select_at_distance(10) == &kLods[1]);
+  SORCERY_CHECK(&select_at_distance(100) == &kLods[2]);
+
+  // The minimum is inclusive
+  SORCERY_CHECK(&AnimationLodScheduler::SelectLod(kLods, 0.25f) == &kLods[0]);
+  SORCERY_CHECK(&AnimationLodScheduler::SelectLod(kLods, 0.08f) == &kLods[1]);
+
+  // The last level is used below every minimum
+  std::array const lods{AnimationLod{0.5f, 1, 0}, AnimationLod{0.3f, 3, 1}};
+  SORCERY_CHECK(&AnimationLodScheduler::SelectLod(lods, 0.1f) == &lods[1]);
+}
+
+
+SORCERY_TEST(AnimationLodSchedulerUpdatesOncePerIntervalAndInterpolatesBetween) {
+  // Updated at frame 10 with an interval of 4
+  SORCERY_CHECK(!AnimationLodScheduler::IsUpdateDue(true, false, 10, 4, 11));
+  SORCERY_CHECK(!AnimationLodScheduler::IsUpdateDue(true, false, 10, 4, 13));
+  SORCERY_CHECK(AnimationLodScheduler::IsUpdateDue(true, false, 10, 4, 14));
+  SORCERY_CHECK(AnimationLodScheduler::IsUpdateDue(true, false, 10, 4, 20));
+
+  // Paused instances hold their pose unless they have none
+  SORCERY_CHECK(!AnimationLodScheduler::IsUpdateDue(true, true, 10, 4, 20));
+  SORCERY_CHECK(AnimationLodScheduler::IsUpdateDue(false, true, 10, 4, 11));
+
+  // The last update is fully shown at the frame before the next one
+  SORCERY_CHECK(IsNear(AnimationLodScheduler::CalculateHistoryBlend(10, 4, 10), 0.25f));
+  SORCERY_CHECK(IsNear(AnimationLodScheduler::CalculateHistoryBlend(10, 4, 11), 0.5f));
+  SORCERY_CHECK(IsNear(AnimationLodScheduler::CalculateHistoryBlend(10, 4, 12), 0.75f));
+  SORCERY_CHECK(IsNear(AnimationLodScheduler::CalculateHistoryBlend(10, 4, 13), 1.0f));
+  SORCERY_CHECK(IsNear(AnimationLodScheduler::CalculateHistoryBlend(10, 4, 30), 1.0f));
+  SORCERY_CHECK(IsNear(AnimationLodScheduler::CalculateHistoryBlend(10, 1, 10), 1.0f));
+}
+
+
+SORCERY_TEST(AnimationLodSchedulerDefersTheLeastOverdueUpdatesOverTheBudget) {
+  AnimationLodScheduler scheduler;
+  constexpr std::uint64_t frame_count{100};
+
+  std::vector instances{
+    CreateInstance(96, 4, 0.1f), // 1 interval overdue
+    CreateInstance(92, 4, 0.1f), // 2 intervals overdue
+    CreateInstance(99, 1, 0.1f), // 1 interval overdue, but smaller on screen than the first
+    CreateInstance(0, 1, 0.0f, false), // Has no pose
+    CreateInstance(97, 1, 0.5f), // 3 intervals overdue
+    CreateInstance(98, 1, 0.9f) // 2 intervals overdue, larger on screen than the second
+  };
+  instances[2].screen_height = 0.05f;
+
+  scheduler.ApplyBudget(instances, 4, frame_count);
+
+  // The instance without a pose takes one of the updates
+  SORCERY_CHECK(instances[3].update);
+  SORCERY_CHECK(instances[4].update);
+  SORCERY_CHECK(instances[5].update);
+  SORCERY_CHECK(instances[1].update);
+  SORCERY_CHECK(!instances[0].update);
+  SORCERY_CHECK(!instances[2].update);
+
+  // Between equally overdue updates the larger one on screen goes first
+  scheduler.ApplyBudget(instances, 3, frame_count);
+  SORCERY_CHECK(instances[5].update);
+  SORCERY_CHECK(!instances[1].update);
+
+  // Updates that are not due are not counted
+  std::vector within_budget{CreateInstance(96, 4, 0.1f), CreateInstance(92, 4, 0.1f), CreateInstance(99, 1, 0.1f)};
+  within_budget[0].update = false;
+  scheduler.ApplyBudget(within_budget, 2, frame_count);
+  SORCERY_CHECK(within_budget[1].update && within_budget[2].update);
+
+  // Instances without a pose are updated even over the budget
+  std::vector over_budget{CreateInstance(0, 1, 0.0f, false), CreateInstance(0, 1, 0.0f, false), CreateInstance(50, 1,
+    0.5f)};
+  scheduler.ApplyBudget(over_budget, 1, frame_count);
+  SORCERY_CHECK(over_budget[0].update && over_budget[1].update);
+  SORCERY_CHECK(!over_budget[2].update);
+}
+}
@@ -0,0 +1,193 @@
+#include "test.hpp"
+
+#include "animation_compression.hpp"
+#include "animation_sampler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+
+namespace sorcery::tests {
+namespace {
+constexpr int kKeyCount{1000};
+
+
+// Uneven key spacing and curved values, so compression keeps most keys and the cursor has something to skip
+auto CreatePositionKeys() -> std::vector<PositionKey> {
+  std::vector<PositionKey> keys;
+  auto time{0.0f};
+
+  for (auto i{0}; i < kKeyCount; i++) {
+    time += i % 3 == 0 ? 0.5f : 1.25f;
+    keys.emplace_back(time, Vector3{std::sin(time * 0.1f) * 10.0f, time * 0.01f, 0});
+  }
+
+  return keys;
+}
+
+
+auto CreateRotationKeys() -> std::vector<RotationKey> {
+  std::vector<RotationKey> keys;
+
+  for (auto i{0}; i < kKeyCount; i++) {
+    auto const time{static_cast<float>(i)};
+    keys.emplace_back(time, Quaternion::FromAxisAngle(Vector3::Up(), std::sin(time * 0.05f) * 90.0f));
+  }
+
+  return keys;
+}
+
+
+auto ReferenceSample(std::vector<PositionKey> const& keys, float const time) -> Vector3 {
+  if (time <= keys.front().timestamp) {
+    return keys.front().value;
+  }
+
+  for (std::size_t i{1}; i < keys.size(); i++) {
+    if (time <= keys[i].timestamp) {
+      auto const& from{keys[i - 1]};
+      auto const& to{keys[i]};
+      return Lerp(from.value, to.value, (time - from.timestamp) / (to.timestamp - from.timestamp));
+    }
+  }
+
+  return keys.back().value;
+}
+}
+
+
+SORCERY_TEST(AnimationSamplerInterpolatesForwardPlayback) {
+  auto const keys{CreatePositionKeys()};
+  auto const track{CompressTrack(keys, 0.001f)};
+  unsigned cursor{0};
+  auto max_error{0.0f};
+
+  for (auto time{-1.0f}; time < keys.back().timestamp + 5; time += 0.37f) {
+    max_error = std::max(max_error, Distance(AnimationSampler::SampleTrack(track, time, cursor),
+      ReferenceSample(keys, time)));
+  }
+
+  // Compression error on top of the quantization error
+  SORCERY_CHECK(max_error < 0.0025f);
+}
+
+
+SORCERY_TEST(AnimationSamplerResultDoesNotDependOnTheCursor) {
+  auto const track{CompressTrack(CreatePositionKeys(), 0)};
+  auto const key_count{static_cast<unsigned>(track.timestamps.size())};
+
+  std::mt19937 rng{11};
+  std::uniform_real_distribution time_dist{-5.0f, track.timestamps.back() + 5};
+  std::uniform_int_distribution<unsigned> cursor_dist{0, key_count + 10};
+  auto mismatch_count{0};
+
+  // Random seeks in both directions, starting from valid, stale and out of range cursors
+  for (auto i{0}; i < 10000; i++) {
+    auto const time{time_dist(rng)};
+    unsigned fresh_cursor{0};
+    unsigned stale_cursor{cursor_dist(rng)};
+
+    auto const expected{AnimationSampler::SampleTrack(track, time, fresh_cursor)};
+    auto const sampled{AnimationSampler::SampleTrack(track, time, stale_cursor)};
+
+    if (sampled != expected || stale_cursor != fresh_cursor) {
+      mismatch_count += 1;
+    }
+  }
+
+  SORCERY_CHECK(mismatch_count == 0);
+}
+
+
+SORCERY_TEST(AnimationSamplerCursorTracksTheLastKeyNotAfterTheTime) {
+  auto const track{CompressTrack(CreatePositionKeys(), 0)};
+  auto const& timestamps{track.timestamps};
+  unsigned cursor{0};
+
+  (void)AnimationSampler::SampleTrack(track, timestamps[10] + 0.01f, cursor);
+  SORCERY_CHECK(cursor == 10);
+
+  (void)AnimationSampler::SampleTrack(track, timestamps[500], cursor);
+  SORCERY_CHECK(cursor == 500);
+
+  // Looping back to the start
+  (void)AnimationSampler::SampleTrack(track, timestamps[3] + 0.01f, cursor);
+  SORCERY_CHECK(cursor == 3);
+
+  (void)AnimationSampler::SampleTrack(track, timestamps.back() + 100, cursor);
+  SORCERY_CHECK(cursor == timestamps.size() - 1);
+
+  (void)AnimationSampler::SampleTrack(track, -100, cursor);
+  SORCERY_CHECK(cursor == 0);
+}
+
+
+SORCERY_TEST(AnimationSamplerClampsOutsideTheKeys) {
+  auto const track{CompressTrack(CreatePositionKeys(), 0)};
+  unsigned cursor{0};
+
+  SORCERY_CHECK(AnimationSampler::SampleTrack(track, -10, cursor) == DecompressKey(track, 0));
+  SORCERY_CHECK(AnimationSampler::SampleTrack(track, track.timestamps.back() + 10, cursor) ==
+    DecompressKey(track, track.timestamps.size() - 1));
+
+  std::vector const single_key{PositionKey{2, Vector3{1, 2, 3}}};
+  auto const single_key_track{CompressTrack(single_key, 0)};
+  cursor = 0;
+
+  SORCERY_CHECK(single_key_track.timestamps.size() == 1);
+  SORCERY_CHECK(Distance(AnimationSampler::SampleTrack(single_key_track, 0, cursor), Vector3{1, 2, 3}) < 1e-4f);
+  SORCERY_CHECK(Distance(AnimationSampler::SampleTrack(single_key_track, 5, cursor), Vector3{1, 2, 3}) < 1e-4f);
+}
+
+
+SORCERY_TEST(AnimationSamplerSlerpsRotations) {
+  auto const keys{CreateRotationKeys()};
+  auto const track{CompressTrack(keys, 0)};
+  unsigned cursor{0};
+
+  for (auto i{0}; i + 1 < kKeyCount; i += 7) {
+    auto const time{static_cast<float>(i) + 0.5f};
+    auto const expected{Slerp(keys[i].value, keys[i + 1].value, 0.5f)};
+    auto const sampled{AnimationSampler::SampleTrack(track, time, cursor)};
+
+    // Same rotation up to the sign of the quaternion
+    SORCERY_CHECK(std::abs(Dot(Vector4{sampled.x, sampled.y, sampled.z, sampled.w},
+      Vector4{expected.x, expected.y, expected.z, expected.w})) > 0.9999f);
+  }
+}
+
+
+SORCERY_TEST(AnimationSamplerOnlyWritesAnimatedNodesWithinTheNodeCount) {
+  auto const keys{CreatePositionKeys()};
+
+  Animation animation{"Test", keys.back().timestamp, 1, {}};
+  animation.node_anims.emplace_back(CompressTrack(keys, 0), QuaternionTrack{}, Vector3Track{}, 1);
+  animation.node_anims.emplace_back(CompressTrack(keys, 0), QuaternionTrack{}, Vector3Track{}, 2);
+
+  // Components the sampler doesn't write keep this value
+  constexpr auto untouched{7.0f};
+
+  LocalPose pose;
+  pose.Resize(3);
+
+  for (auto* const arr : {
+         &pose.pos_x, &pose.pos_y, &pose.pos_z, &pose.rot_x, &pose.rot_y, &pose.rot_z, &pose.rot_w, &pose.scale_x,
+         &pose.scale_y, &pose.scale_z
+       }) {
+    std::ranges::fill(*arr, untouched);
+  }
+
+  AnimationSampler sampler;
+  sampler.Sample(animation, keys[100].timestamp, 2, pose);
+
+  // Node 0 has no animation and node 2 is outside of the node count
+  SORCERY_CHECK(pose.pos_x[0] == untouched && pose.pos_y[0] == untouched && pose.pos_z[0] == untouched);
+  SORCERY_CHECK(pose.pos_x[2] == untouched && pose.pos_y[2] == untouched && pose.pos_z[2] == untouched);
+  SORCERY_CHECK(Distance(Vector3{pose.pos_x[1], pose.pos_y[1], pose.pos_z[1]}, keys[100].value) < 0.001f);
+
+  // Tracks without keys leave their components alone
+  SORCERY_CHECK(pose.rot_w[1] == untouched && pose.scale_x[1] == untouched);
+}
+}
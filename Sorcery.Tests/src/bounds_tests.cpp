@@ -0,0 +1,87 @@
+#include "test.hpp"
+
+#include "Bounds.hpp"
+
+
+namespace sorcery::tests {
+namespace {
+// Looks down +Z from the origin, with a near plane at 0.1 and a far plane at 100
+auto CreateFrustum() -> Frustum {
+  return Frustum{
+    Matrix4::LookTo(Vector3::Zero(), Vector3::Forward(), Vector3::Up()) *
+    Matrix4::PerspectiveFov(ToRadians(60.0f), 2.0f, 0.1f, 100.0f)
+  };
+}
+
+
+auto CreateCube(Vector3 const& center, float const half_extent) -> AABB {
+  return AABB{center - Vector3{half_extent}, center + Vector3{half_extent}};
+}
+}
+
+
+SORCERY_TEST(FrustumIntersectsBoxesOutsideWhoseSweepEntersIt) {
+  auto const frustum{CreateFrustum()};
+
+  // Behind the camera, swept through the near plane
+  auto const behind{CreateCube(Vector3{0, 0, -10}, 1)};
+  SORCERY_CHECK(!frustum.Intersects(behind));
+  SORCERY_CHECK(frustum.Intersects(behind, Vector3{0, 0, 20}));
+
+  // Beside the frustum, swept sideways into it
+  auto const beside{CreateCube(Vector3{50, 0, 10}, 1)};
+  SORCERY_CHECK(!frustum.Intersects(beside));
+  SORCERY_CHECK(frustum.Intersects(beside, Vector3{-50, 0, 0}));
+
+  // Only the far end of the sweep is inside
+  SORCERY_CHECK(frustum.Intersects(beside, Vector3{-50, 0, 30}));
+}
+
+
+SORCERY_TEST(FrustumDoesNotIntersectBoxesSweptAwayFromIt) {
+  auto const frustum{CreateFrustum()};
+
+  auto const behind{CreateCube(Vector3{0, 0, -10}, 1)};
+  SORCERY_CHECK(!frustum.Intersects(behind, Vector3{0, 0, -20}));
+
+  auto const beside{CreateCube(Vector3{50, 0, 10}, 1)};
+  SORCERY_CHECK(!frustum.Intersects(beside, Vector3{50, 0, 0}));
+
+  // Too short to reach the frustum
+  SORCERY_CHECK(!frustum.Intersects(behind, Vector3{0, 0, 5}));
+}
+
+
+SORCERY_TEST(FrustumSweptByZeroMatchesThePlainIntersection) {
+  auto const frustum{CreateFrustum()};
+
+  auto mismatch_count{0};
+  auto intersection_count{0};
+  auto box_count{0};
+
+  // A grid of boxes inside, outside and across every plane of the frustum
+  for (auto x{-120}; x <= 120; x += 15) {
+    for (auto y{-120}; y <= 120; y += 15) {
+      for (auto z{-30}; z <= 130; z += 10) {
+        auto const box{CreateCube(Vector3{static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)}, 4)};
+        auto const intersects{frustum.Intersects(box)};
+
+        if (intersects != frustum.Intersects(box, Vector3{0})) {
+          mismatch_count += 1;
+        }
+
+        if (intersects) {
+          intersection_count += 1;
+        }
+
+        box_count += 1;
+      }
+    }
+  }
+
+  SORCERY_CHECK(mismatch_count == 0);
+  // Both outcomes are covered
+  SORCERY_CHECK(intersection_count > 0);
+  SORCERY_CHECK(intersection_count < box_count);
+}
+}
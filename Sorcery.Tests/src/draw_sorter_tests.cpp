@@ -0,0 +1,223 @@
+#include "test.hpp"
+
+#include "rendering/draw_sorter.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <vector>
+
+
+namespace sorcery::tests {
+namespace {
+using rendering::DrawSorter;
+
+
+struct TestDraw {
+  unsigned mtl_buf_idx;
+  unsigned mesh_idx;
+  unsigned submesh_idx;
+  float depth;
+};
+
+
+auto Sort(DrawSorter& sorter, std::span<std::uint64_t const> const keys) -> std::vector<unsigned> {
+  sorter.Clear();
+
+  for (unsigned i{0}; i < keys.size(); i++) {
+    sorter.Add(keys[i], i);
+  }
+
+  std::vector<unsigned> instance_indices(keys.size());
+  sorter.Sort(instance_indices);
+  return instance_indices;
+}
+
+
+// Returns whether the keys of the sorted instances never decrease and equal keys keep their instance order
+auto IsStablySorted(std::span<std::uint64_t const> const keys, std::span<unsigned const> const instance_indices) ->
+  bool {
+  for (std::size_t i{1}; i < instance_indices.size(); i++) {
+    auto const prev_key{keys[instance_indices[i - 1]]};
+    auto const key{keys[instance_indices[i]]};
+
+    if (prev_key > key || (prev_key == key && instance_indices[i - 1] > instance_indices[i])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+}
+
+
+SORCERY_TEST(DrawSorterKeysOrderNegativeDepthsBeforePositiveOnes) {
+  // The sign flip has to order the bits of negative depths in reverse
+  constexpr std::array kDepths{-1000.0f, -2.5f, -1.0f, -0.25f, 0.0f, 0.25f, 1.0f, 2.5f, 1000.0f};
+
+  auto increasing_count{0};
+
+  for (std::size_t i{1}; i < kDepths.size(); i++) {
+    if (DrawSorter::MakeKey(0, 0, 0, kDepths[i - 1]) < DrawSorter::MakeKey(0, 0, 0, kDepths[i])) {
+      increasing_count += 1;
+    }
+  }
+
+  SORCERY_CHECK(increasing_count == static_cast<int>(kDepths.size()) - 1);
+}
+
+
+SORCERY_TEST(DrawSorterKeysOrderByMaterialMeshSubmeshThenDepth) {
+  // Each field outweighs everything after it
+  SORCERY_CHECK(DrawSorter::MakeKey(1, 0, 0, -1000.0f) > DrawSorter::MakeKey(0, 0xFFFF, 0xFFF, 1000.0f));
+  SORCERY_CHECK(DrawSorter::MakeKey(0, 1, 0, -1000.0f) > DrawSorter::MakeKey(0, 0, 0xFFF, 1000.0f));
+  SORCERY_CHECK(DrawSorter::MakeKey(0, 0, 1, -1000.0f) > DrawSorter::MakeKey(0, 0, 0, 1000.0f));
+
+  // Indices are truncated to their fields instead of spilling into the next one
+  SORCERY_CHECK(DrawSorter::MakeKey(0, 0, 0x1000, 1.0f) == DrawSorter::MakeKey(0, 0, 0, 1.0f));
+  SORCERY_CHECK(DrawSorter::MakeKey(0, 0x10000, 0, 1.0f) == DrawSorter::MakeKey(0, 0, 0, 1.0f));
+}
+
+
+SORCERY_TEST(DrawSorterSortsByKey) {
+  std::mt19937 rng{42}; // NOLINT(cert-msc51-cpp)
+  std::uniform_int_distribution<unsigned> idx_dist{0, 3};
+  std::uniform_real_distribution depth_dist{-50.0f, 50.0f};
+
+  std::vector<TestDraw> draws;
+
+  for (auto i{0}; i < 1000; i++) {
+    draws.emplace_back(idx_dist(rng), idx_dist(rng), idx_dist(rng), depth_dist(rng));
+  }
+
+  std::vector<std::uint64_t> keys;
+  std::ranges::transform(draws, std::back_inserter(keys), [](TestDraw const& draw) {
+    return DrawSorter::MakeKey(draw.mtl_buf_idx, draw.mesh_idx, draw.submesh_idx, draw.depth);
+  });
+
+  DrawSorter sorter;
+  auto const instance_indices{Sort(sorter, keys)};
+  SORCERY_CHECK(IsStablySorted(keys, instance_indices));
+
+  // Within runs of the same state the draws go front to back, including across zero
+  auto depth_order_violation_count{0};
+
+  for (std::size_t i{1}; i < instance_indices.size(); i++) {
+    auto const& prev{draws[instance_indices[i - 1]]};
+    auto const& draw{draws[instance_indices[i]]};
+
+    if (prev.mtl_buf_idx == draw.mtl_buf_idx && prev.mesh_idx == draw.mesh_idx &&
+        prev.submesh_idx == draw.submesh_idx && prev.depth > draw.depth) {
+      depth_order_violation_count += 1;
+    }
+  }
+
+  SORCERY_CHECK(depth_order_violation_count == 0);
+}
+
+
+SORCERY_TEST(DrawSorterKeepsTheOrderOfDrawsWithEqualKeys) {
+  // Two keys differing in several digits, so that the passes move the draws around
+  auto const front_key{DrawSorter::MakeKey(3, 7, 1, -4.0f)};
+  auto const back_key{DrawSorter::MakeKey(5, 2, 9, 12.0f)};
+
+  std::vector<std::uint64_t> keys;
+
+  for (auto i{0}; i < 300; i++) {
+    keys.emplace_back(i % 3 == 0 ? back_key : front_key);
+  }
+
+  DrawSorter sorter;
+  auto const instance_indices{Sort(sorter, keys)};
+  SORCERY_CHECK(IsStablySorted(keys, instance_indices));
+  SORCERY_CHECK(keys[instance_indices.front()] == front_key);
+  SORCERY_CHECK(keys[instance_indices.back()] == back_key);
+}
+
+
+SORCERY_TEST(DrawSorterSortsWhenDigitPassesAreSkipped) {
+  DrawSorter sorter;
+
+  // Only the lowest digit differs, so a single pass runs and the result is in the scratch buffer
+  std::vector<std::uint64_t> const low_keys{0x105, 0x1FF, 0x100, 0x1FF, 0x180, 0x101};
+  auto const low_sorted{Sort(sorter, low_keys)};
+  SORCERY_CHECK(IsStablySorted(low_keys, low_sorted));
+
+  // Only the highest digit differs
+  std::vector<std::uint64_t> const high_keys{0x0500000000000042, 0x0100000000000042, 0xFF00000000000042, 0x42};
+  auto const high_sorted{Sort(sorter, high_keys)};
+  SORCERY_CHECK(IsStablySorted(high_keys, high_sorted));
+
+  // The lowest and the highest digits differ, so two passes run and the result is back in the draws
+  std::vector<std::uint64_t> const mixed_keys{
+    0x0200000000000001, 0x0100000000000003, 0x0200000000000000, 0x0100000000000001, 0x0100000000000003
+  };
+  auto const mixed_sorted{Sort(sorter, mixed_keys)};
+  SORCERY_CHECK(IsStablySorted(mixed_keys, mixed_sorted));
+
+  // Every digit is equal, so no pass runs at all
+  std::vector<std::uint64_t> const equal_keys(5, 0x1234);
+  auto const equal_sorted{Sort(sorter, equal_keys)};
+  SORCERY_CHECK(IsStablySorted(equal_keys, equal_sorted));
+
+  auto const empty_sorted{Sort(sorter, {})};
+  SORCERY_CHECK(empty_sorted.empty());
+}
+
+
+SORCERY_TEST(DrawSorterBatchesMergeRunsOfTheSameMeshSubmeshAndMaterial) {
+  // Two materials, two meshes and two submeshes each, in every combination, at different depths
+  std::vector<TestDraw> draws;
+
+  for (auto i{0}; i < 64; i++) {
+    draws.emplace_back(static_cast<unsigned>(i % 2), static_cast<unsigned>(i / 2 % 2), static_cast<unsigned>(i / 4 % 2),
+      static_cast<float>(32 - i));
+  }
+
+  std::vector<std::uint64_t> keys;
+  std::ranges::transform(draws, std::back_inserter(keys), [](TestDraw const& draw) {
+    return DrawSorter::MakeKey(draw.mtl_buf_idx, draw.mesh_idx, draw.submesh_idx, draw.depth);
+  });
+
+  DrawSorter sorter;
+  auto const instance_indices{Sort(sorter, keys)};
+
+  auto const can_merge{
+    [&draws](unsigned const first_idx, unsigned const idx) {
+      auto const& first{draws[first_idx]};
+      auto const& draw{draws[idx]};
+      return first.mtl_buf_idx == draw.mtl_buf_idx && first.mesh_idx == draw.mesh_idx &&
+             first.submesh_idx == draw.submesh_idx;
+    }
+  };
+
+  std::size_t batch_count{0};
+  std::size_t next_first{0};
+  auto mixed_batch_count{0};
+
+  DrawSorter::ForEachBatch(instance_indices, can_merge,
+    [&](std::size_t const first, std::size_t const count) {
+      // The batches cover the indices in order without gaps
+      if (first != next_first) {
+        mixed_batch_count += 1;
+      }
+
+      for (auto i{first}; i < first + count; i++) {
+        if (!can_merge(instance_indices[first], instance_indices[i])) {
+          mixed_batch_count += 1;
+        }
+      }
+
+      next_first = first + count;
+      batch_count += 1;
+    });
+
+  // One batch per combination
+  SORCERY_CHECK(batch_count == 8);
+  SORCERY_CHECK(next_first == instance_indices.size());
+  SORCERY_CHECK(mixed_batch_count == 0);
+}
+}
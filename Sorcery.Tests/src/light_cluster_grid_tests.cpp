@@ -0,0 +1,161 @@
+#include "test.hpp"
+
+#include "rendering/light_cluster_grid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+
+namespace sorcery::tests {
+namespace {
+using rendering::LightClusterGrid;
+
+
+constexpr float kNearPlane{0.1f};
+constexpr float kFarPlane{200.0f};
+
+
+auto CreateProjMatrix() -> Matrix4 {
+  Matrix4 const reverse_depth_mtx{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, -1, 0, 0, 0, 1, 1};
+  return Matrix4::PerspectiveFov(ToRadians(60.0f), 16.0f / 9.0f, kNearPlane, kFarPlane) * reverse_depth_mtx;
+}
+
+
+auto CreateViewMatrix() -> Matrix4 {
+  return Matrix4::LookTo(Vector3{1, 2, 3}, Vector3{0.3f, -0.1f, 1}, Vector3::Up());
+}
+
+
+// Scatters point and spot lights in front of the camera, with a directional light among them
+auto CreateLights(int const count, unsigned const seed) -> std::vector<LightClusterGrid::Light> {
+  std::mt19937 rng{seed};
+  std::uniform_real_distribution<float> pos_dist{-60, 60};
+  std::uniform_real_distribution<float> depth_dist{0, 150};
+  std::uniform_real_distribution<float> range_dist{0.5f, 8};
+  std::uniform_real_distribution<float> angle_dist{0.1f, 1.5f};
+  std::uniform_real_distribution<float> dir_dist{-1, 1};
+
+  std::vector<LightClusterGrid::Light> lights;
+  lights.reserve(static_cast<std::size_t>(count));
+
+  for (auto i{0}; i < count; i++) {
+    auto type{i % 7 == 0 ? LightClusterGrid::LightType::Spot : LightClusterGrid::LightType::Point};
+
+    if (i == 3) {
+      type = LightClusterGrid::LightType::Directional;
+    }
+
+    auto const pos{Vector3{pos_dist(rng), pos_dist(rng) / 4, depth_dist(rng)}};
+    auto const dir{Normalized(Vector3{dir_dist(rng), dir_dist(rng), dir_dist(rng)})};
+    lights.emplace_back(type, pos, dir, range_dist(rng), angle_dist(rng));
+  }
+
+  return lights;
+}
+
+
+auto AffectsPoint(LightClusterGrid::Light const& light, Vector3 const& point_ws) -> bool {
+  if (light.type == LightClusterGrid::LightType::Directional) {
+    return true;
+  }
+
+  auto const to_point{point_ws - light.position_ws};
+  auto const dist{Length(to_point)};
+
+  if (dist > light.range) {
+    return false;
+  }
+
+  return light.type != LightClusterGrid::LightType::Spot ||
+         Dot(to_point / dist, light.direction_ws) >= std::cos(light.half_angle_rad);
+}
+}
+
+
+SORCERY_TEST(LightClusterGridListsEveryLightAffectingASampledPoint) {
+  JobSystem job_system;
+  auto const view_mtx{CreateViewMatrix()};
+  auto const proj_mtx{CreateProjMatrix()};
+  auto const inv_view_proj_mtx{(view_mtx * proj_mtx).Inverse()};
+  auto const lights{CreateLights(1000, 42)};
+
+  LightClusterGrid grid;
+  grid.Build(view_mtx, proj_mtx, kNearPlane, kFarPlane, lights, job_system);
+
+  auto const clusters{grid.GetClusters()};
+  auto const light_indices{grid.GetLightIndices()};
+  auto const& global_cluster{clusters[LIGHT_CLUSTER_GLOBAL_IDX]};
+  auto const global_lights{light_indices.subspan(global_cluster.firstLightIdx, global_cluster.lightCount)};
+
+  std::mt19937 rng{7};
+  std::uniform_real_distribution<float> unit_dist{0, 1};
+  auto miss_count{0};
+
+  for (auto i{0}; i < 5000; i++) {
+    Vector2 const uv{unit_dist(rng), unit_dist(rng)};
+    auto const point_hs{Vector4{uv[0] * 2 - 1, 1 - uv[1] * 2, unit_dist(rng), 1} * inv_view_proj_mtx};
+    auto const point_ws{Vector3{point_hs} / point_hs[3]};
+    auto const view_z{(Vector4{point_ws, 1} * view_mtx)[2]};
+
+    if (view_z < kNearPlane || view_z > kFarPlane) {
+      continue;
+    }
+
+    auto const& cluster{clusters[static_cast<std::size_t>(grid.CalculateClusterIndex(uv, view_z))]};
+    auto const cluster_lights{light_indices.subspan(cluster.firstLightIdx, cluster.lightCount)};
+
+    for (unsigned light_idx{0}; light_idx < static_cast<unsigned>(lights.size()); light_idx++) {
+      if (!AffectsPoint(lights[light_idx], point_ws)) {
+        continue;
+      }
+
+      auto const found{
+        lights[light_idx].type == LightClusterGrid::LightType::Directional
+          ? std::ranges::find(global_lights, light_idx) != global_lights.end()
+          : std::ranges::binary_search(cluster_lights, light_idx)
+      };
+
+      if (!found) {
+        miss_count += 1;
+      }
+    }
+  }
+
+  SORCERY_CHECK(miss_count == 0);
+}
+
+
+SORCERY_TEST(LightClusterGridBuildIsDeterministic) {
+  JobSystem job_system;
+  auto const lights{CreateLights(2000, 3)};
+
+  LightClusterGrid grid;
+  grid.Build(CreateViewMatrix(), CreateProjMatrix(), kNearPlane, kFarPlane, lights, job_system);
+  std::vector const first_indices(grid.GetLightIndices().begin(), grid.GetLightIndices().end());
+
+  grid.Build(CreateViewMatrix(), CreateProjMatrix(), kNearPlane, kFarPlane, lights, job_system);
+  SORCERY_CHECK(std::ranges::equal(first_indices, grid.GetLightIndices()));
+}
+
+
+SORCERY_BENCHMARK(LightClusterGridBuild) {
+  JobSystem job_system;
+
+  for (auto const light_count : {1000, 5000, 10000}) {
+    auto const lights{CreateLights(light_count, 42)};
+    LightClusterGrid grid;
+
+    auto const ms{
+      MeasureMilliseconds(20, [&] {
+        grid.Build(CreateViewMatrix(), CreateProjMatrix(), kNearPlane, kFarPlane, lights, job_system);
+      })
+    };
+
+    std::cout << "  " << light_count << " lights: " << ms << " ms per build, " << grid.GetLightIndices().size() <<
+      " light indices\n";
+  }
+}
+}
@@ -0,0 +1,112 @@
+#include "test.hpp"
+
+#include "rendering/linear_ring_allocator.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+
+namespace sorcery::tests {
+namespace {
+using rendering::LinearRingAllocator;
+
+
+constexpr std::uint64_t kRegionSize{4096};
+constexpr unsigned kRegionCount{3};
+constexpr std::uint64_t kAlignment{256};
+}
+
+
+SORCERY_TEST(LinearRingAllocatorHandsOutAlignedRangesOfTheCurrentRegion) {
+  LinearRingAllocator allocator{kRegionSize, kRegionCount, kAlignment};
+  allocator.BeginRegion(1);
+
+  SORCERY_CHECK(allocator.Allocate(288) == std::optional<std::uint64_t>{kRegionSize});
+  SORCERY_CHECK(allocator.Allocate(1) == std::optional<std::uint64_t>{kRegionSize + 512});
+  SORCERY_CHECK(allocator.Allocate(0) == std::optional<std::uint64_t>{kRegionSize + 768});
+  SORCERY_CHECK(allocator.GetAllocatedSize() == 1024);
+
+  // Larger than what is left, and larger than a whole region
+  SORCERY_CHECK(!allocator.Allocate(kRegionSize - 768));
+  SORCERY_CHECK(!allocator.Allocate(kRegionSize + 1));
+  SORCERY_CHECK(allocator.GetAllocatedSize() == kRegionSize);
+}
+
+
+SORCERY_TEST(LinearRingAllocatorReusesARegionWhenItBeginsAgain) {
+  LinearRingAllocator allocator{kRegionSize, kRegionCount, kAlignment};
+
+  for (unsigned frame{0}; frame < kRegionCount * 3; frame++) {
+    auto const region_idx{frame % kRegionCount};
+    allocator.BeginRegion(region_idx);
+    SORCERY_CHECK(allocator.GetAllocatedSize() == 0);
+
+    // Filling the region exactly
+    for (std::uint64_t i{0}; i < kRegionSize / kAlignment; i++) {
+      SORCERY_CHECK(allocator.Allocate(kAlignment) == std::optional{region_idx * kRegionSize + i * kAlignment});
+    }
+
+    SORCERY_CHECK(!allocator.Allocate(1));
+  }
+}
+
+
+SORCERY_TEST(LinearRingAllocatorConcurrentAllocationsNeverOverlap) {
+  LinearRingAllocator allocator{kRegionSize * 16, kRegionCount, kAlignment};
+  allocator.BeginRegion(2);
+
+  std::mutex mutex;
+  std::vector<std::uint64_t> offsets;
+  std::vector<std::thread> threads;
+
+  // More is requested than the region holds, so some threads see it full
+  for (auto i{0}; i < 8; i++) {
+    threads.emplace_back([&allocator, &mutex, &offsets] {
+      for (auto j{0}; j < 100; j++) {
+        if (auto const offset{allocator.Allocate(200)}) {
+          std::scoped_lock const lock{mutex};
+          offsets.emplace_back(*offset);
+        }
+      }
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  constexpr auto allocation_count{kRegionSize * 16 / kAlignment};
+  std::ranges::sort(offsets);
+
+  SORCERY_CHECK(offsets.size() == allocation_count);
+  SORCERY_CHECK(std::ranges::adjacent_find(offsets) == offsets.end());
+  SORCERY_CHECK(offsets.front() == 2 * kRegionSize * 16);
+  SORCERY_CHECK(offsets.back() == 2 * kRegionSize * 16 + (allocation_count - 1) * kAlignment);
+  SORCERY_CHECK(allocator.GetAllocatedSize() == kRegionSize * 16);
+}
+
+
+SORCERY_TEST(LinearRingAllocatorRejectsInvalidLayouts) {
+  auto const throws{
+    [](std::uint64_t const region_size, unsigned const region_count, std::uint64_t const alignment) {
+      try {
+        LinearRingAllocator const allocator{region_size, region_count, alignment};
+        return false;
+      } catch (std::runtime_error const&) {
+        return true;
+      }
+    }
+  };
+
+  SORCERY_CHECK(throws(1000, 1, 256));
+  SORCERY_CHECK(throws(4096, 1, 100));
+  SORCERY_CHECK(throws(0, 1, 256));
+  SORCERY_CHECK(throws(4096, 0, 256));
+  SORCERY_CHECK(!throws(256, 1, 256));
+}
+}
@@ -0,0 +1,17 @@
+#include "test.hpp"
+
+#include <string_view>
+
+
+// Pass --bench to run the benchmarks as well
+auto main(int const argc, char** const argv) -> int {
+  auto run_benchmarks{false};
+
+  for (auto i{1}; i < argc; i++) {
+    if (std::string_view{argv[i]} == "--bench") {
+      run_benchmarks = true;
+    }
+  }
+
+  return sorcery::tests::RunTests(run_benchmarks) == 0 ? 0 : 1;
+}
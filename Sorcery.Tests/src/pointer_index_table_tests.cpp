@@ -0,0 +1,111 @@
+#include "test.hpp"
+
+#include "rendering/pointer_index_table.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+
+namespace sorcery::tests {
+namespace {
+using rendering::PointerIndexTable;
+
+
+constexpr unsigned kObjectCount{1000};
+
+
+auto IsResult(std::pair<unsigned, bool> const result, unsigned const index, bool const inserted) -> bool {
+  return result.first == index && result.second == inserted;
+}
+}
+
+
+SORCERY_TEST(PointerIndexTableReturnsTheStoredIndexForDuplicates) {
+  // Only the addresses are used as keys
+  std::vector<int> const objects(kObjectCount);
+  PointerIndexTable<int> table;
+
+  SORCERY_CHECK(IsResult(table.FindOrInsert(&objects[0], 0), 0, true));
+  SORCERY_CHECK(IsResult(table.FindOrInsert(&objects[1], 1), 1, true));
+  SORCERY_CHECK(IsResult(table.FindOrInsert(&objects[0], 2), 0, false));
+  SORCERY_CHECK(table.Find(&objects[0]) == std::optional{0u});
+  SORCERY_CHECK(table.Find(&objects[1]) == std::optional{1u});
+  SORCERY_CHECK(!table.Find(&objects[2]));
+}
+
+
+SORCERY_TEST(PointerIndexTableFindsNothingAfterClear) {
+  std::vector<int> const objects(kObjectCount);
+  PointerIndexTable<int> table;
+  SORCERY_CHECK(!table.Find(&objects[0]));
+
+  for (unsigned i{0}; i < 10; i++) {
+    static_cast<void>(table.FindOrInsert(&objects[i], i));
+  }
+
+  table.Clear();
+
+  for (unsigned i{0}; i < 10; i++) {
+    SORCERY_CHECK(!table.Find(&objects[i]));
+  }
+
+  // The cleared slots are reused with the new indices
+  SORCERY_CHECK(IsResult(table.FindOrInsert(&objects[3], 7), 7, true));
+  SORCERY_CHECK(table.Find(&objects[3]) == std::optional{7u});
+}
+
+
+SORCERY_TEST(PointerIndexTableKeepsItsEntriesWhenGrowing) {
+  std::vector<int> const objects(kObjectCount);
+  PointerIndexTable<int> table;
+
+  // Adjacent addresses, so the hash has to spread them
+  for (unsigned i{0}; i < kObjectCount; i++) {
+    SORCERY_CHECK(table.FindOrInsert(&objects[i], i * 3).second);
+  }
+
+  auto found_count{0u};
+
+  for (unsigned i{0}; i < kObjectCount; i++) {
+    if (table.Find(&objects[i]) == std::optional{i * 3}) {
+      found_count += 1;
+    }
+  }
+
+  SORCERY_CHECK(found_count == kObjectCount);
+  SORCERY_CHECK(!table.Find(objects.data() + kObjectCount));
+}
+
+
+SORCERY_TEST(PointerIndexTableInvalidatesOldSlotsWhenTheGenerationWrapsAround) {
+  std::vector<int> const objects(kObjectCount);
+  PointerIndexTable<int, std::uint8_t> table;
+
+  for (unsigned i{0}; i < 20; i++) {
+    static_cast<void>(table.FindOrInsert(&objects[i], i));
+  }
+
+  // Stored at generation 1, which the counter would reach again after 256 clears if it simply wrapped around
+  for (auto i{0}; i < 256; i++) {
+    table.Clear();
+  }
+
+  auto found_count{0};
+
+  for (unsigned i{0}; i < 20; i++) {
+    if (table.Find(&objects[i])) {
+      found_count += 1;
+    }
+  }
+
+  SORCERY_CHECK(found_count == 0);
+
+  // Still works after the wrap
+  SORCERY_CHECK(IsResult(table.FindOrInsert(&objects[5], 50), 50, true));
+  SORCERY_CHECK(IsResult(table.FindOrInsert(&objects[5], 60), 50, false));
+  table.Clear();
+  SORCERY_CHECK(!table.Find(&objects[5]));
+}
+}
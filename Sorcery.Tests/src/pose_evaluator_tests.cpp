@@ -0,0 +1,343 @@
+#include "test.hpp"
+
+#include "animation_compression.hpp"
+#include "pose_evaluator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <span>
+#include <vector>
+
+
+namespace sorcery::tests {
+namespace {
+struct Rig {
+  std::vector<SkeletonNode> skeleton;
+  std::vector<Bone> bones;
+  LocalPose bind_pose;
+};
+
+
+auto CreateRandomRotation(std::mt19937& rng) -> Quaternion {
+  std::uniform_real_distribution dist{-1.0f, 1.0f};
+  return Quaternion{dist(rng), dist(rng), dist(rng), dist(rng)}.Normalized();
+}
+
+
+// A random hierarchy with one bone per node, parents always precede their children
+auto CreateRig(int const bone_count, std::mt19937& rng) -> Rig {
+  std::uniform_real_distribution dist{-1.0f, 1.0f};
+  Rig rig;
+
+  for (auto i{0}; i < bone_count; i++) {
+    auto& node{rig.skeleton.emplace_back()};
+    node.transform = Matrix4::Scale(Vector3{1.5f, 1, 0.5f}) * static_cast<Matrix4>(CreateRandomRotation(rng)) *
+                     Matrix4::Translate(Vector3{dist(rng), dist(rng), dist(rng)});
+
+    if (i > 0) {
+      node.parent_idx = static_cast<std::uint32_t>(rng() % static_cast<unsigned>(i));
+    }
+
+    rig.bones.emplace_back(Matrix4::Translate(Vector3{dist(rng), 0, 0}), static_cast<std::uint32_t>(i),
+      AABB{Vector3{-0.2f}, Vector3{0.3f}});
+  }
+
+  rig.bind_pose = CalculateBindPose(rig.skeleton);
+  return rig;
+}
+
+
+// Animates every node but the first three with 30 keys
+auto CreateAnimation(int const node_count, std::mt19937& rng) -> Animation {
+  std::uniform_real_distribution dist{-1.0f, 1.0f};
+  Animation animation{"Test", 10, 1, {}};
+
+  for (auto node_idx{3}; node_idx < node_count; node_idx++) {
+    std::vector<PositionKey> pos_keys;
+    std::vector<RotationKey> rot_keys;
+    std::vector<ScalingKey> scaling_keys;
+
+    for (auto i{0}; i < 30; i++) {
+      auto const time{static_cast<float>(i) * 0.33f};
+      pos_keys.emplace_back(time, Vector3{dist(rng), dist(rng), dist(rng)});
+      rot_keys.emplace_back(time, CreateRandomRotation(rng));
+      scaling_keys.emplace_back(time, Vector3{1 + dist(rng) * 0.5f, 1, 1 + dist(rng) * 0.2f});
+    }
+
+    animation.node_anims.emplace_back(CompressTrack(pos_keys, 0.0001f), CompressTrack(rot_keys, 0.0001f),
+      CompressTrack(scaling_keys, 0.0001f), static_cast<std::uint32_t>(node_idx));
+  }
+
+  return animation;
+}
+
+
+// Samples the clip node by node with the scalar math library and walks the hierarchy
+auto CalculateReferencePalette(Rig const& rig, Animation const& animation, float const time) -> std::vector<Matrix4> {
+  auto const& bind{rig.bind_pose};
+  std::vector<Matrix4> node_transforms;
+
+  for (std::size_t i{0}; i < rig.skeleton.size(); i++) {
+    node_transforms.emplace_back(Matrix4::Scale(Vector3{bind.scale_x[i], bind.scale_y[i], bind.scale_z[i]}) *
+                                 static_cast<Matrix4>(Quaternion{bind.rot_w[i], bind.rot_x[i], bind.rot_y[i],
+                                   bind.rot_z[i]}) *
+                                 Matrix4::Translate(Vector3{bind.pos_x[i], bind.pos_y[i], bind.pos_z[i]}));
+  }
+
+  for (auto const& [pos_track, rot_track, scaling_track, node_idx] : animation.node_anims) {
+    unsigned pos_cursor{0};
+    unsigned rot_cursor{0};
+    unsigned scaling_cursor{0};
+    node_transforms[node_idx] = Matrix4::Scale(AnimationSampler::SampleTrack(scaling_track, time, scaling_cursor)) *
+                                static_cast<Matrix4>(AnimationSampler::SampleTrack(rot_track, time, rot_cursor)) *
+                                Matrix4::Translate(AnimationSampler::SampleTrack(pos_track, time, pos_cursor));
+  }
+
+  for (std::size_t i{0}; i < rig.skeleton.size(); i++) {
+    if (auto const parent_idx{rig.skeleton[i].parent_idx}) {
+      node_transforms[i] = node_transforms[i] * node_transforms[*parent_idx];
+    }
+  }
+
+  std::vector<Matrix4> palette;
+
+  for (auto const& bone : rig.bones) {
+    palette.emplace_back(bone.offset_mtx * node_transforms[bone.skeleton_node_idx]);
+  }
+
+  return palette;
+}
+
+
+auto CalculateMaxDifference(std::span<Matrix4 const> const left, std::span<Matrix4 const> const right) -> float {
+  auto max_diff{0.0f};
+
+  for (std::size_t i{0}; i < left.size(); i++) {
+    for (auto row{0}; row < 4; row++) {
+      for (auto col{0}; col < 4; col++) {
+        max_diff = std::max(max_diff, std::abs(left[i][row][col] - right[i][row][col]));
+      }
+    }
+  }
+
+  return max_diff;
+}
+
+
+auto CreateInstance(Rig const& rig, std::span<PoseEvaluator::Layer const> const layers,
+                    std::span<Matrix4> const palette, AABB* const bounds) -> PoseEvaluator::Instance {
+  return PoseEvaluator::Instance{
+    layers, rig.skeleton, &rig.bind_pose, rig.bones, 0, {}, true, 1, palette, bounds, {}, {}
+  };
+}
+}
+
+
+SORCERY_TEST(PoseEvaluatorMatchesTheScalarReference) {
+  std::mt19937 rng{1};
+  auto const rig{CreateRig(100, rng)};
+  auto const animation{CreateAnimation(100, rng)};
+
+  AnimationSampler sampler;
+  std::vector const layers{PoseEvaluator::Layer{&animation, 1.7f, 1, AnimationBlendMode::Override, {}, &sampler}};
+  std::vector<Matrix4> palette(rig.bones.size());
+  auto const instance{CreateInstance(rig, layers, palette, nullptr)};
+
+  JobSystem job_system;
+  PoseEvaluator evaluator;
+  evaluator.Evaluate(std::span{&instance, 1}, job_system);
+
+  SORCERY_CHECK(CalculateMaxDifference(palette, CalculateReferencePalette(rig, animation, 1.7f)) < 1e-3f);
+}
+
+
+SORCERY_TEST(PoseEvaluatorAdditiveLayerAtItsFirstKeyChangesNothing) {
+  std::mt19937 rng{2};
+  auto const rig{CreateRig(60, rng)};
+  auto const base_animation{CreateAnimation(60, rng)};
+  auto const additive_animation{CreateAnimation(60, rng)};
+
+  std::vector<AnimationSampler> samplers(3);
+  std::vector const base_layers{
+    PoseEvaluator::Layer{&base_animation, 1.7f, 1, AnimationBlendMode::Override, {}, &samplers[0]}
+  };
+  std::vector const layered_layers{
+    PoseEvaluator::Layer{&base_animation, 1.7f, 1, AnimationBlendMode::Override, {}, &samplers[1]},
+    PoseEvaluator::Layer{&additive_animation, 0, 0.8f, AnimationBlendMode::Additive, {}, &samplers[2]}
+  };
+
+  std::vector<Matrix4> base_palette(rig.bones.size());
+  std::vector<Matrix4> layered_palette(rig.bones.size());
+  std::vector const instances{
+    CreateInstance(rig, base_layers, base_palette, nullptr),
+    CreateInstance(rig, layered_layers, layered_palette, nullptr)
+  };
+
+  JobSystem job_system;
+  PoseEvaluator evaluator;
+  evaluator.Evaluate(instances, job_system);
+
+  SORCERY_CHECK(CalculateMaxDifference(base_palette, layered_palette) < 1e-4f);
+}
+
+
+SORCERY_TEST(PoseEvaluatorJobsProduceTheSamePalettesAsASingleInstance) {
+  constexpr auto instance_count{64};
+  constexpr auto bone_count{40};
+
+  std::mt19937 rng{3};
+  auto const rig{CreateRig(bone_count, rng)};
+  auto const animation{CreateAnimation(bone_count, rng)};
+
+  std::vector<AnimationSampler> samplers(instance_count + 1);
+  std::vector<PoseEvaluator::Layer> layers;
+  std::vector<Matrix4> palettes(instance_count * bone_count);
+  std::vector<AABB> bounds(instance_count);
+  std::vector<PoseEvaluator::Instance> instances;
+
+  for (auto i{0}; i < instance_count; i++) {
+    layers.emplace_back(&animation, static_cast<float>(i) * 0.1f, 1.0f, AnimationBlendMode::Override,
+      std::span<float const>{}, &samplers[i]);
+  }
+
+  for (auto i{0}; i < instance_count; i++) {
+    instances.emplace_back(CreateInstance(rig, std::span{layers}.subspan(i, 1),
+      std::span{palettes}.subspan(i * bone_count, bone_count), &bounds[i]));
+  }
+
+  JobSystem job_system;
+  PoseEvaluator evaluator;
+  evaluator.Evaluate(instances, job_system);
+
+  auto mismatch_count{0};
+
+  for (auto i{0}; i < instance_count; i++) {
+    auto const single_layer{
+      PoseEvaluator::Layer{&animation, layers[i].time, 1, AnimationBlendMode::Override, {}, &samplers.back()}
+    };
+    std::vector<Matrix4> palette(bone_count);
+    AABB single_bounds{};
+    auto const instance{CreateInstance(rig, std::span{&single_layer, 1}, palette, &single_bounds)};
+    evaluator.Evaluate(std::span{&instance, 1}, job_system);
+
+    if (CalculateMaxDifference(palette, std::span{palettes}.subspan(i * bone_count, bone_count)) != 0 ||
+        single_bounds.min != bounds[i].min || single_bounds.max != bounds[i].max) {
+      mismatch_count += 1;
+    }
+  }
+
+  SORCERY_CHECK(mismatch_count == 0);
+}
+
+
+SORCERY_TEST(PoseEvaluatorSubmeshBoundsOnlyCoverTheBonesOfTheSubmesh) {
+  std::mt19937 rng{5};
+  auto const rig{CreateRig(30, rng)};
+  auto const animation{CreateAnimation(30, rng)};
+
+  std::vector<std::vector<std::uint32_t>> submesh_bones{{4}, {10, 20}, {}};
+
+  for (std::uint32_t i{0}; i < 30; i++) {
+    submesh_bones.back().emplace_back(i);
+  }
+
+  AnimationSampler sampler;
+  std::vector const layers{PoseEvaluator::Layer{&animation, 2.3f, 1, AnimationBlendMode::Override, {}, &sampler}};
+  std::vector<Matrix4> palette(rig.bones.size());
+  AABB bounds{};
+  std::vector<AABB> submesh_bounds(submesh_bones.size());
+
+  auto instance{CreateInstance(rig, layers, palette, &bounds)};
+  instance.submesh_bones = submesh_bones;
+  instance.submesh_bounds = submesh_bounds;
+
+  JobSystem job_system;
+  PoseEvaluator evaluator;
+  evaluator.Evaluate(std::span{&instance, 1}, job_system);
+
+  // Bounds of the single bones, evaluated the same way
+  std::vector<std::vector<std::uint32_t>> single_bones{{4}, {10}, {20}};
+  std::vector<AABB> single_bounds(single_bones.size());
+  instance.submesh_bones = single_bones;
+  instance.submesh_bounds = single_bounds;
+  evaluator.Evaluate(std::span{&instance, 1}, job_system);
+
+  auto const is_inside{
+    [](AABB const& inner, AABB const& outer) {
+      return inner.min[0] >= outer.min[0] && inner.min[1] >= outer.min[1] && inner.min[2] >= outer.min[2] &&
+             inner.max[0] <= outer.max[0] && inner.max[1] <= outer.max[1] && inner.max[2] <= outer.max[2];
+    }
+  };
+
+  SORCERY_CHECK(submesh_bounds[0].min == single_bounds[0].min && submesh_bounds[0].max == single_bounds[0].max);
+
+  auto const two_bones_bounds{AABB::Union(single_bounds[1], single_bounds[2])};
+  SORCERY_CHECK(submesh_bounds[1].min == two_bones_bounds.min && submesh_bounds[1].max == two_bones_bounds.max);
+
+  // A submesh weighted to every bone gets the bounds of the whole instance
+  SORCERY_CHECK(submesh_bounds[2].min == bounds.min && submesh_bounds[2].max == bounds.max);
+  SORCERY_CHECK(is_inside(submesh_bounds[0], bounds) && is_inside(submesh_bounds[1], bounds));
+  SORCERY_CHECK(Distance(submesh_bounds[0].min, submesh_bounds[0].max) < Distance(bounds.min, bounds.max));
+}
+
+
+SORCERY_BENCHMARK(PoseEvaluatorEvaluate1000InstancesOf100Bones) {
+  constexpr auto instance_count{1000};
+  constexpr auto bone_count{100};
+
+  std::mt19937 rng{4};
+  auto const rig{CreateRig(bone_count, rng)};
+  auto const base_animation{CreateAnimation(bone_count, rng)};
+  auto const blended_animation{CreateAnimation(bone_count, rng)};
+  std::vector<float> const node_mask(bone_count, 0.5f);
+
+  std::vector<AnimationSampler> samplers(instance_count * 2);
+  std::vector<PoseEvaluator::Layer> layers;
+  std::vector<Matrix4> palettes(instance_count * bone_count);
+  std::vector<AABB> bounds(instance_count);
+  std::vector<PoseEvaluator::Instance> instances;
+
+  for (auto i{0}; i < instance_count; i++) {
+    auto const time{static_cast<float>(i % 97) * 0.1f};
+    layers.emplace_back(&base_animation, time, 1.0f, AnimationBlendMode::Override, std::span<float const>{},
+      &samplers[i * 2]);
+    layers.emplace_back(&blended_animation, time, 0.3f, AnimationBlendMode::Override, node_mask,
+      &samplers[i * 2 + 1]);
+  }
+
+  for (auto i{0}; i < instance_count; i++) {
+    instances.emplace_back(CreateInstance(rig, std::span{layers}.subspan(i * 2, 2),
+      std::span{palettes}.subspan(i * bone_count, bone_count), &bounds[i]));
+  }
+
+  JobSystem job_system;
+  PoseEvaluator evaluator;
+
+  // Only the first layer of every instance
+  for (auto& instance : instances) {
+    instance.layers = instance.layers.first(1);
+  }
+
+  auto const single_layer_ms{
+    MeasureMilliseconds(20, [&] {
+      evaluator.Evaluate(instances, job_system);
+    })
+  };
+
+  for (auto i{0}; i < instance_count; i++) {
+    instances[i].layers = std::span{layers}.subspan(i * 2, 2);
+  }
+
+  auto const two_layer_ms{
+    MeasureMilliseconds(20, [&] {
+      evaluator.Evaluate(instances, job_system);
+    })
+  };
+
+  std::cout << "  " << instance_count << " instances of " << bone_count << " bones: " << single_layer_ms <<
+    " ms with one layer, " << two_layer_ms << " ms with two blended layers\n";
+}
+}
@@ -0,0 +1,207 @@
+#include "test.hpp"
+
+#include "rendering/shadow_atlas_allocator.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+
+namespace sorcery::tests {
+namespace {
+using rendering::ShadowAtlasAllocator;
+
+
+constexpr std::uint32_t kAtlasSize{4096};
+constexpr std::uint32_t kMinTileSize{128};
+constexpr std::uint32_t kMaxTileSize{2048};
+
+
+auto Overlap(ShadowAtlasAllocator::Tile const& lhs, ShadowAtlasAllocator::Tile const& rhs) -> bool {
+  return lhs.offset_x < rhs.offset_x + rhs.size && rhs.offset_x < lhs.offset_x + lhs.size &&
+         lhs.offset_y < rhs.offset_y + rhs.size && rhs.offset_y < lhs.offset_y + lhs.size;
+}
+
+
+// Returns the number of tiles that overlap an earlier one, leave the atlas or have an invalid size
+auto CountInvalidTiles(std::vector<std::optional<ShadowAtlasAllocator::Tile>> const& tiles) -> int {
+  auto invalid_count{0};
+
+  for (std::size_t i{0}; i < tiles.size(); i++) {
+    if (!tiles[i]) {
+      continue;
+    }
+
+    auto const& tile{*tiles[i]};
+    auto valid{
+      tile.size >= kMinTileSize && tile.size <= kMaxTileSize && (tile.size & (tile.size - 1)) == 0 &&
+      tile.offset_x % tile.size == 0 && tile.offset_y % tile.size == 0 && tile.offset_x + tile.size <= kAtlasSize &&
+      tile.offset_y + tile.size <= kAtlasSize
+    };
+
+    for (std::size_t j{0}; j < i; j++) {
+      if (tiles[j] && Overlap(tile, *tiles[j])) {
+        valid = false;
+      }
+    }
+
+    if (!valid) {
+      invalid_count += 1;
+    }
+  }
+
+  return invalid_count;
+}
+
+
+auto CountUnplaced(std::vector<std::optional<ShadowAtlasAllocator::Tile>> const& tiles) -> std::ptrdiff_t {
+  return std::ranges::count_if(tiles, [](std::optional<ShadowAtlasAllocator::Tile> const& tile) {
+    return !tile;
+  });
+}
+
+
+auto AreSameTiles(std::vector<std::optional<ShadowAtlasAllocator::Tile>> const& lhs,
+                  std::vector<std::optional<ShadowAtlasAllocator::Tile>> const& rhs) -> bool {
+  return std::ranges::equal(lhs, rhs, [](std::optional<ShadowAtlasAllocator::Tile> const& left,
+                                         std::optional<ShadowAtlasAllocator::Tile> const& right) {
+    return left && right
+             ? left->offset_x == right->offset_x && left->offset_y == right->offset_y && left->size == right->size
+             : !left && !right;
+  });
+}
+}
+
+
+SORCERY_TEST(ShadowAtlasAllocatorTilesNeverOverlapOrLeaveTheAtlas) {
+  ShadowAtlasAllocator allocator{kAtlasSize, kMinTileSize, kMaxTileSize};
+  std::mt19937 rng{5};
+  std::uniform_real_distribution dist{0.0f, 1.0f};
+
+  std::vector<ShadowAtlasAllocator::Request> requests;
+
+  for (std::uint64_t i{0}; i < 40; i++) {
+    requests.emplace_back(i, dist(rng) * dist(rng) * 0.5f);
+  }
+
+  std::vector<std::optional<ShadowAtlasAllocator::Tile>> tiles;
+  auto invalid_count{0};
+  auto unplaced_count{0};
+
+  // Drifting importances, then a burst of new shadow maps that overflows the atlas, then most of them going away
+  for (auto frame{0}; frame < 200; frame++) {
+    for (auto& request : requests) {
+      request.importance = std::max(0.0f, request.importance * (1 + 0.05f * (dist(rng) - 0.5f)));
+    }
+
+    if (frame == 100) {
+      for (std::uint64_t i{40}; i < 1200; i++) {
+        requests.emplace_back(i, dist(rng) * 0.3f);
+      }
+    }
+
+    if (frame == 150) {
+      requests.resize(30);
+    }
+
+    allocator.Allocate(requests, tiles);
+    invalid_count += CountInvalidTiles(tiles);
+
+    // Only an overflowing atlas can leave shadow maps without a tile
+    if (requests.size() <= (kAtlasSize / kMinTileSize) * (kAtlasSize / kMinTileSize)) {
+      unplaced_count += static_cast<int>(CountUnplaced(tiles));
+    }
+  }
+
+  SORCERY_CHECK(invalid_count == 0);
+  SORCERY_CHECK(unplaced_count == 0);
+}
+
+
+SORCERY_TEST(ShadowAtlasAllocatorKeepsTheTilesOfStableShadowMaps) {
+  ShadowAtlasAllocator allocator{kAtlasSize, kMinTileSize, kMaxTileSize};
+  std::vector<ShadowAtlasAllocator::Request> requests;
+
+  for (std::uint64_t i{0}; i < 30; i++) {
+    requests.emplace_back(i * 7 + 3, 0.5f / static_cast<float>(i + 1));
+  }
+
+  std::vector<std::optional<ShadowAtlasAllocator::Tile>> first_tiles;
+  allocator.Allocate(requests, first_tiles);
+
+  // Small changes in importance and order stay within the hysteresis
+  for (auto& request : requests) {
+    request.importance *= 1.02f;
+  }
+
+  std::ranges::reverse(requests);
+  std::ranges::reverse(first_tiles);
+
+  std::vector<std::optional<ShadowAtlasAllocator::Tile>> second_tiles;
+  allocator.Allocate(requests, second_tiles);
+
+  SORCERY_CHECK(CountUnplaced(second_tiles) == 0);
+  SORCERY_CHECK(AreSameTiles(first_tiles, second_tiles));
+}
+
+
+SORCERY_TEST(ShadowAtlasAllocatorShrinksAndDropsTheLeastImportantFirst) {
+  ShadowAtlasAllocator allocator{kAtlasSize, kMinTileSize, kMaxTileSize};
+  std::vector<ShadowAtlasAllocator::Request> requests;
+
+  // All of them ask for the largest tile, which only 4 would get
+  for (std::uint64_t i{0}; i < 20; i++) {
+    requests.emplace_back(i, 2.0f - static_cast<float>(i) * 0.01f);
+  }
+
+  std::vector<std::optional<ShadowAtlasAllocator::Tile>> tiles;
+  allocator.Allocate(requests, tiles);
+
+  SORCERY_CHECK(CountUnplaced(tiles) == 0);
+  SORCERY_CHECK(CountInvalidTiles(tiles) == 0);
+
+  for (std::size_t i{1}; i < tiles.size(); i++) {
+    SORCERY_CHECK(tiles[i - 1] && tiles[i] && tiles[i - 1]->size >= tiles[i]->size);
+  }
+
+  // More shadow maps than the atlas holds at the smallest tile size
+  constexpr auto capacity{(kAtlasSize / kMinTileSize) * (kAtlasSize / kMinTileSize)};
+  requests.clear();
+
+  for (std::uint64_t i{0}; i < capacity + 100; i++) {
+    requests.emplace_back(i, 1.0f - static_cast<float>(i) * 0.0001f);
+  }
+
+  ShadowAtlasAllocator full_allocator{kAtlasSize, kMinTileSize, kMaxTileSize};
+  full_allocator.Allocate(requests, tiles);
+
+  SORCERY_CHECK(CountInvalidTiles(tiles) == 0);
+  SORCERY_CHECK(std::ranges::all_of(tiles.begin(), tiles.begin() + capacity,
+    [](std::optional<ShadowAtlasAllocator::Tile> const& tile) { return tile.has_value(); }));
+  SORCERY_CHECK(CountUnplaced(tiles) == 100);
+}
+
+
+SORCERY_TEST(ShadowAtlasAllocatorRejectsInvalidSizes) {
+  auto const throws{
+    [](std::uint32_t const atlas_size, std::uint32_t const min_tile_size, std::uint32_t const max_tile_size) {
+      try {
+        ShadowAtlasAllocator const allocator{atlas_size, min_tile_size, max_tile_size};
+        return false;
+      } catch (std::runtime_error const&) {
+        return true;
+      }
+    }
+  };
+
+  SORCERY_CHECK(throws(4000, 128, 2048));
+  SORCERY_CHECK(throws(4096, 100, 2048));
+  SORCERY_CHECK(throws(4096, 4096, 2048));
+  SORCERY_CHECK(throws(2048, 128, 4096));
+  SORCERY_CHECK(!throws(4096, 128, 4096));
+}
+}
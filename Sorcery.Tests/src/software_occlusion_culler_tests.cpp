@@ -0,0 +1,110 @@
+#include "test.hpp"
+
+#include "rendering/software_occlusion_culler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <string>
+
+
+namespace sorcery::tests {
+namespace {
+auto CreateViewProjMatrix() -> Matrix4 {
+  // Flips the depth range the same way the renderer does, as the culler expects reversed depth
+  Matrix4 const reverse_depth_mtx{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, -1, 0, 0, 0, 1, 1};
+  return Matrix4::LookTo(Vector3::Zero(), Vector3::Forward(), Vector3::Up()) *
+         Matrix4::PerspectiveFov(ToRadians(60.0f), 2.0f, 0.1f, 100.0f) * reverse_depth_mtx;
+}
+
+
+// A 4x4 quad facing the camera at a depth of 5
+constexpr std::array kQuadPositions{Vector3{-2, -2, 0}, Vector3{2, -2, 0}, Vector3{2, 2, 0}, Vector3{-2, 2, 0}};
+constexpr std::array<std::uint32_t, 6> kQuadIndices{0, 1, 2, 0, 2, 3};
+
+
+auto CreateQuadOccluder() -> rendering::SoftwareOcclusionCuller::Occluder {
+  return {Matrix4::Translate(Vector3{0, 0, 5}), kQuadPositions, kQuadIndices};
+}
+
+
+auto CreateCube(Vector3 const& center, float const half_extent) -> AABB {
+  return AABB{center - Vector3{half_extent}, center + Vector3{half_extent}};
+}
+}
+
+
+SORCERY_TEST(SoftwareOcclusionCullerHidesBoundsBehindOccluders) {
+  JobSystem job_system;
+  rendering::SoftwareOcclusionCuller culler{250, 120};
+  auto const occluder{CreateQuadOccluder()};
+  culler.Render(CreateViewProjMatrix(), std::span{&occluder, 1}, job_system);
+
+  SORCERY_CHECK(!culler.IsVisible(CreateCube(Vector3{0, 0, 10}, 0.5f)));
+  SORCERY_CHECK(!culler.IsVisible(CreateCube(Vector3{0, 0, 20}, 2.0f)));
+  SORCERY_CHECK(culler.IsVisible(CreateCube(Vector3{0, 0, 3}, 0.5f)));
+  SORCERY_CHECK(culler.IsVisible(CreateCube(Vector3{6, 0, 10}, 0.5f)));
+  SORCERY_CHECK(culler.IsVisible(CreateCube(Vector3{4.2f, 0, 10}, 0.5f)));
+  SORCERY_CHECK(culler.IsVisible(CreateCube(Vector3{0, 0, 5}, 0.5f)));
+}
+
+
+SORCERY_TEST(SoftwareOcclusionCullerKeepsEverythingWithoutOccluders) {
+  JobSystem job_system;
+  rendering::SoftwareOcclusionCuller culler{250, 120};
+  culler.Render(CreateViewProjMatrix(), {}, job_system);
+
+  SORCERY_CHECK(culler.IsVisible(CreateCube(Vector3{0, 0, 10}, 0.5f)));
+  SORCERY_CHECK(std::ranges::all_of(culler.GetDepthBuffer(), [](float const depth) {
+    return depth == 0;
+  }));
+}
+
+
+SORCERY_TEST(SoftwareOcclusionCullerDumpsTheRasterizedDepth) {
+  JobSystem job_system;
+  rendering::SoftwareOcclusionCuller culler{250, 120};
+  auto const occluder{CreateQuadOccluder()};
+  culler.Render(CreateViewProjMatrix(), std::span{&occluder, 1}, job_system);
+
+  // The quad covers the center of the screen and nothing else
+  auto const width{culler.GetWidth()};
+  auto const height{culler.GetHeight()};
+  auto const depths{culler.GetDepthBuffer()};
+
+  SORCERY_CHECK(width % 32 == 0 && width >= 250);
+  SORCERY_CHECK(height % 16 == 0 && height >= 120);
+  SORCERY_CHECK(depths[static_cast<std::size_t>(height / 2 * width + width / 2)] > 0);
+  SORCERY_CHECK(depths[0] == 0);
+  SORCERY_CHECK(depths[static_cast<std::size_t>(width * height - 1)] == 0);
+
+  auto const path{std::filesystem::temp_directory_path() / "sorcery_occlusion_depth.pgm"};
+  SORCERY_CHECK(culler.DumpDepthBuffer(path));
+
+  std::ifstream in{path, std::ios::binary};
+  std::string magic;
+  int dumped_width{0};
+  int dumped_height{0};
+  int max_value{0};
+  in >> magic >> dumped_width >> dumped_height >> max_value;
+  in.get();
+
+  SORCERY_CHECK(magic == "P5");
+  SORCERY_CHECK(dumped_width == width && dumped_height == height && max_value == 255);
+
+  std::string pixels(static_cast<std::size_t>(width * height), '\0');
+  in.read(pixels.data(), std::ssize(pixels));
+  SORCERY_CHECK(in.gcount() == std::ssize(pixels));
+  SORCERY_CHECK(std::ranges::count_if(pixels, [](char const pixel) {
+    return pixel != 0;
+  }) == std::ranges::count_if(depths, [](float const depth) {
+    return static_cast<std::uint8_t>(std::clamp(depth, 0.0f, 1.0f) * 255.0f) != 0;
+  }));
+
+  in.close();
+  std::filesystem::remove(path);
+}
+}
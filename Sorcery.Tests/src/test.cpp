@@ -0,0 +1,69 @@
+#include "test.hpp"
+
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+namespace sorcery::tests {
+namespace {
+struct TestRecord {
+  std::string_view name;
+  TestKind kind;
+  TestFunc func;
+};
+
+
+// Tests register themselves during static initialization, so the list is created on first use
+auto GetTests() -> std::vector<TestRecord>& {
+  static std::vector<TestRecord> tests;
+  return tests;
+}
+
+
+int g_failure_count{0};
+}
+
+
+auto RegisterTest(std::string_view const name, TestKind const kind, TestFunc const func) -> bool {
+  GetTests().emplace_back(name, kind, func);
+  return true;
+}
+
+
+auto ReportFailure(std::string_view const expression, std::string_view const file, int const line) -> void {
+  std::cerr << "  " << file << '(' << line << "): check failed: " << expression << '\n';
+  g_failure_count += 1;
+}
+
+
+auto RunTests(bool const run_benchmarks) -> int {
+  auto failed_test_count{0};
+
+  for (auto const& [name, kind, func] : GetTests()) {
+    if (kind == TestKind::Benchmark && !run_benchmarks) {
+      continue;
+    }
+
+    std::cout << name << '\n';
+
+    auto const prev_failure_count{g_failure_count};
+
+    try {
+      func();
+    } catch (std::exception const& ex) {
+      std::cerr << "  threw: " << ex.what() << '\n';
+      g_failure_count += 1;
+    }
+
+    if (g_failure_count != prev_failure_count) {
+      failed_test_count += 1;
+    }
+  }
+
+  std::cout << (failed_test_count == 0 ? "All tests passed." : std::to_string(failed_test_count) + " tests failed.")
+    << '\n';
+  return failed_test_count;
+}
+}
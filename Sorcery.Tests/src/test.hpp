@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chrono>
+#include <string_view>
+
+
+namespace sorcery::tests {
+using TestFunc = void(*)();
+
+
+enum class TestKind {
+  Test,
+  Benchmark // Only run when asked for, as they take long and only print measurements
+};
+
+
+auto RegisterTest(std::string_view name, TestKind kind, TestFunc func) -> bool;
+auto ReportFailure(std::string_view expression, std::string_view file, int line) -> void;
+// Runs the registered tests, and the benchmarks too if requested. Returns the number of failed tests.
+[[nodiscard]] auto RunTests(bool run_benchmarks) -> int;
+
+
+// Returns the average duration of a call in milliseconds
+template<typename Func>
+[[nodiscard]] auto MeasureMilliseconds(int const repetition_count, Func&& func) -> double {
+  auto const begin{std::chrono::steady_clock::now()};
+
+  for (auto i{0}; i < repetition_count; i++) {
+    func();
+  }
+
+  auto const end{std::chrono::steady_clock::now()};
+  return std::chrono::duration<double, std::milli>{end - begin}.count() / repetition_count;
+}
+}
+
+
+#define SORCERY_DETAIL_REGISTER(name, kind) \
+  static auto name() -> void; \
+  [[maybe_unused]] static bool const name##_registered{::sorcery::tests::RegisterTest(#name, kind, &name)}; \
+  static auto name() -> void
+
+#define SORCERY_TEST(name) SORCERY_DETAIL_REGISTER(name, ::sorcery::tests::TestKind::Test)
+#define SORCERY_BENCHMARK(name) SORCERY_DETAIL_REGISTER(name, ::sorcery::tests::TestKind::Benchmark)
+
+// Records the failure and continues the test
+#define SORCERY_CHECK(expression) \
+  do { \
+    if (!(expression)) { \
+      ::sorcery::tests::ReportFailure(#expression, __FILE__, __LINE__); \
+    } \
+  } while (false)
@@ -0,0 +1,217 @@
+#include "test.hpp"
+
+#include "rendering/upload_scheduler.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+
+namespace sorcery::tests {
+namespace {
+using rendering::UploadScheduler;
+
+
+constexpr std::uint64_t kCapacity{1024};
+
+
+auto Write(UploadScheduler& scheduler, std::shared_ptr<void const> const& dst, std::uint64_t const dst_offset,
+           std::uint64_t const size, std::byte const value) -> void {
+  std::vector const data(size, value);
+  scheduler.ScheduleBufferWrite(dst, dst_offset, data);
+}
+
+
+auto IsCopy(UploadScheduler::BufferCopy const& copy, std::shared_ptr<void const> const& dst,
+            std::uint64_t const dst_offset, std::uint64_t const size) -> bool {
+  return copy.dst == dst && copy.dst_offset == dst_offset && copy.size == size;
+}
+
+
+// Returns whether the coalesced data of the copy holds the values in runs of the passed lengths
+auto HoldsRuns(UploadScheduler::BufferCopy const& copy, std::vector<std::byte> const& data,
+               std::vector<std::pair<std::uint64_t, std::byte>> const& runs) -> bool {
+  auto offset{copy.src_offset};
+
+  for (auto const& [length, value] : runs) {
+    for (std::uint64_t i{0}; i < length; i++) {
+      if (data[offset++] != value) {
+        return false;
+      }
+    }
+  }
+
+  return offset == copy.src_offset + copy.size;
+}
+
+
+auto CreateTextureCopy(std::shared_ptr<void const> const& dst, std::uint32_t const subresource,
+                       std::uint64_t const src_offset) -> UploadScheduler::TextureCopy {
+  return UploadScheduler::TextureCopy{
+    dst, subresource, src_offset, UploadScheduler::TextureFootprint{28, 4, 4, 1, 256}
+  };
+}
+}
+
+
+SORCERY_TEST(UploadSchedulerAllocatesAlignedStagingAndWrapsAroundTheRing) {
+  UploadScheduler scheduler{kCapacity};
+
+  SORCERY_CHECK(scheduler.AllocateStaging(256, 256) == std::optional<std::uint64_t>{0});
+  SORCERY_CHECK(scheduler.AllocateStaging(100, 1) == std::optional<std::uint64_t>{256});
+  SORCERY_CHECK(scheduler.AllocateStaging(300, 256) == std::optional<std::uint64_t>{512});
+  SORCERY_CHECK(!scheduler.AllocateStaging(kCapacity + 1, 1));
+  scheduler.EndBatch(1);
+
+  // Only fits after the end of the ring, where the first batch still holds the memory
+  SORCERY_CHECK(!scheduler.AllocateStaging(300, 1));
+  SORCERY_CHECK(scheduler.AllocateStaging(200, 1) == std::optional<std::uint64_t>{812});
+  scheduler.EndBatch(2);
+  SORCERY_CHECK(scheduler.GetOldestBatch() == std::optional<std::uint64_t>{1});
+
+  scheduler.ReleaseBatches(1);
+  SORCERY_CHECK(scheduler.GetOldestBatch() == std::optional<std::uint64_t>{2});
+  SORCERY_CHECK(scheduler.AllocateStaging(800, 1) == std::optional<std::uint64_t>{0});
+  SORCERY_CHECK(!scheduler.AllocateStaging(13, 1));
+  scheduler.EndBatch(3);
+
+  // An empty ring restarts from its beginning, so the whole capacity fits again
+  scheduler.ReleaseBatches(3);
+  SORCERY_CHECK(!scheduler.GetOldestBatch());
+  SORCERY_CHECK(scheduler.AllocateStaging(kCapacity, 256) == std::optional<std::uint64_t>{0});
+}
+
+
+SORCERY_TEST(UploadSchedulerMergesInterleavedWritesToTheSameDestination) {
+  UploadScheduler scheduler{kCapacity};
+  auto const a{std::make_shared<int>()};
+  auto const b{std::make_shared<int>()};
+
+  // A/B/A, with the second write of A before the first one in the buffer
+  Write(scheduler, a, 64, 32, std::byte{1});
+  Write(scheduler, b, 0, 16, std::byte{2});
+  Write(scheduler, a, 32, 32, std::byte{3});
+  // Not adjacent to anything written to B
+  Write(scheduler, b, 100, 8, std::byte{4});
+
+  scheduler.CoalesceWrites();
+  auto const copies{scheduler.GetCoalescedBufferCopies()};
+  SORCERY_CHECK(copies.size() == 3);
+
+  std::vector<std::byte> data(scheduler.GetCoalescedBufferDataSize());
+  scheduler.WriteCoalescedBufferData(data);
+  SORCERY_CHECK(data.size() == 32 + 32 + 16 + 8);
+
+  for (auto const& copy : copies) {
+    if (copy.dst == a) {
+      SORCERY_CHECK(IsCopy(copy, a, 32, 64));
+      SORCERY_CHECK(HoldsRuns(copy, data, {{32, std::byte{3}}, {32, std::byte{1}}}));
+    } else if (copy.dst_offset == 0) {
+      SORCERY_CHECK(IsCopy(copy, b, 0, 16));
+      SORCERY_CHECK(HoldsRuns(copy, data, {{16, std::byte{2}}}));
+    } else {
+      SORCERY_CHECK(IsCopy(copy, b, 100, 8));
+      SORCERY_CHECK(HoldsRuns(copy, data, {{8, std::byte{4}}}));
+    }
+  }
+}
+
+
+SORCERY_TEST(UploadSchedulerLetsLaterWritesWinWhereTheyOverlap) {
+  UploadScheduler scheduler{kCapacity};
+  auto const buf{std::make_shared<int>()};
+
+  Write(scheduler, buf, 0, 64, std::byte{1});
+  Write(scheduler, buf, 16, 16, std::byte{2});
+  // Overlaps both earlier writes and extends past them
+  Write(scheduler, buf, 24, 48, std::byte{3});
+  // Completely overwritten by the next one
+  Write(scheduler, buf, 200, 8, std::byte{4});
+  Write(scheduler, buf, 192, 32, std::byte{5});
+
+  scheduler.CoalesceWrites();
+  auto const copies{scheduler.GetCoalescedBufferCopies()};
+  SORCERY_CHECK(copies.size() == 2);
+
+  std::vector<std::byte> data(scheduler.GetCoalescedBufferDataSize());
+  scheduler.WriteCoalescedBufferData(data);
+
+  auto const& first{copies[0].dst_offset == 0 ? copies[0] : copies[1]};
+  auto const& second{copies[0].dst_offset == 0 ? copies[1] : copies[0]};
+  SORCERY_CHECK(IsCopy(first, buf, 0, 72));
+  SORCERY_CHECK(HoldsRuns(first, data, {{16, std::byte{1}}, {8, std::byte{2}}, {48, std::byte{3}}}));
+  SORCERY_CHECK(IsCopy(second, buf, 192, 32));
+  SORCERY_CHECK(HoldsRuns(second, data, {{32, std::byte{5}}}));
+}
+
+
+SORCERY_TEST(UploadSchedulerKeepsOnlyTheLastCopyToASubresource) {
+  UploadScheduler scheduler{kCapacity};
+  auto const tex{std::make_shared<int>()};
+  auto const other_tex{std::make_shared<int>()};
+
+  scheduler.ScheduleTextureCopy(CreateTextureCopy(tex, 0, 0));
+  scheduler.ScheduleTextureCopy(CreateTextureCopy(tex, 1, 512));
+  scheduler.ScheduleTextureCopy(CreateTextureCopy(other_tex, 0, 1024));
+  scheduler.ScheduleTextureCopy(CreateTextureCopy(tex, 0, 1536));
+
+  scheduler.CoalesceWrites();
+  auto const copies{scheduler.GetCoalescedTextureCopies()};
+  SORCERY_CHECK(copies.size() == 3);
+
+  for (auto const& copy : copies) {
+    if (copy.dst == tex && copy.dst_subresource_index == 0) {
+      SORCERY_CHECK(copy.src_offset == 1536);
+    }
+  }
+}
+
+
+SORCERY_TEST(UploadSchedulerReleasesTheDestinationsWhenTheBatchEnds) {
+  UploadScheduler scheduler{kCapacity};
+  auto buf{std::make_shared<int>()};
+  auto tex{std::make_shared<int>()};
+  std::weak_ptr<void const> const weak_buf{buf};
+  std::weak_ptr<void const> const weak_tex{tex};
+
+  Write(scheduler, buf, 0, 16, std::byte{1});
+  Write(scheduler, buf, 32, 16, std::byte{1});
+  scheduler.ScheduleTextureCopy(CreateTextureCopy(tex, 0, 0));
+  scheduler.ScheduleTextureCopy(CreateTextureCopy(tex, 0, 512));
+
+  // Released by their owners before the batch is submitted
+  buf.reset();
+  tex.reset();
+  SORCERY_CHECK(!weak_buf.expired() && !weak_tex.expired());
+
+  scheduler.CoalesceWrites();
+  SORCERY_CHECK(!weak_buf.expired() && !weak_tex.expired());
+  SORCERY_CHECK(scheduler.HasScheduledWrites());
+
+  scheduler.EndBatch(1);
+  SORCERY_CHECK(weak_buf.expired() && weak_tex.expired());
+  SORCERY_CHECK(!scheduler.HasScheduledWrites());
+  SORCERY_CHECK(scheduler.GetScheduledBufferWriteSize() == 0);
+}
+
+
+SORCERY_TEST(UploadSchedulerRejectsZeroCapacity) {
+  auto const throws{
+    [](std::uint64_t const capacity) {
+      try {
+        UploadScheduler const scheduler{capacity};
+        return false;
+      } catch (std::runtime_error const&) {
+        return true;
+      }
+    }
+  };
+
+  SORCERY_CHECK(throws(0));
+  SORCERY_CHECK(!throws(kCapacity));
+}
+}
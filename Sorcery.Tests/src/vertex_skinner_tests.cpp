@@ -0,0 +1,107 @@
+#include "test.hpp"
+
+#include "vertex_skinner.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+
+namespace sorcery::tests {
+namespace {
+struct SkinningData {
+  std::vector<Matrix4> bone_palette;
+  std::vector<Vector3> positions;
+  std::vector<Vector3> normals;
+  std::vector<Vector3> tangents;
+  std::vector<Vector4> bone_weights;
+  std::vector<Vector<std::uint32_t, 4>> bone_indices;
+};
+
+
+// Random palette with non-uniform scale, and vertices weighted to two or three bones
+auto CreateSkinningData(int const vertex_count, unsigned const bone_count, unsigned const seed) -> SkinningData {
+  std::mt19937 rng{seed};
+  std::uniform_real_distribution dist{-1.0f, 1.0f};
+  SkinningData data;
+
+  for (unsigned i{0}; i < bone_count; i++) {
+    auto const rot{Quaternion{dist(rng), dist(rng), dist(rng), dist(rng)}.Normalized()};
+    data.bone_palette.emplace_back(Matrix4::Scale(Vector3{1 + dist(rng) * 0.3f, 1, 1}) * static_cast<Matrix4>(rot) *
+                                   Matrix4::Translate(Vector3{dist(rng), dist(rng), dist(rng)}));
+  }
+
+  for (auto i{0}; i < vertex_count; i++) {
+    data.positions.emplace_back(Vector3{dist(rng), dist(rng), dist(rng)} * 3);
+    data.normals.emplace_back(Normalized(Vector3{dist(rng), dist(rng), dist(rng)}));
+    data.tangents.emplace_back(Normalized(Vector3{dist(rng), dist(rng), dist(rng)}));
+
+    auto const weight0{std::abs(dist(rng))};
+    auto const weight1{std::abs(dist(rng))};
+    auto const weight2{i % 3 == 0 ? 0 : std::abs(dist(rng))};
+    auto const weight_sum{weight0 + weight1 + weight2};
+    data.bone_weights.emplace_back(weight0 / weight_sum, weight1 / weight_sum, weight2 / weight_sum, 0);
+
+    auto& indices{data.bone_indices.emplace_back()};
+
+    for (auto j{0}; j < 4; j++) {
+      indices[j] = rng() % bone_count;
+    }
+  }
+
+  return data;
+}
+
+
+auto AreBitwiseEqual(std::vector<Vector3> const& left, std::vector<Vector3> const& right) -> bool {
+  return left.size() == right.size() && std::memcmp(left.data(), right.data(), left.size() * sizeof(Vector3)) == 0;
+}
+}
+
+
+SORCERY_TEST(VertexSkinnerMatchesTheScalarReferenceBitForBit) {
+  // Not a multiple of the batch size, and large enough to be split into jobs
+  constexpr auto vertex_count{100003};
+  auto const data{CreateSkinningData(vertex_count, 60, 3)};
+  VertexSkinner::Input const input{
+    data.positions, data.normals, data.tangents, data.bone_weights, data.bone_indices, data.bone_palette
+  };
+
+  std::vector<Vector3> positions(vertex_count);
+  std::vector<Vector3> normals(vertex_count);
+  std::vector<Vector3> tangents(vertex_count);
+  std::vector<Vector3> ref_positions(vertex_count);
+  std::vector<Vector3> ref_normals(vertex_count);
+  std::vector<Vector3> ref_tangents(vertex_count);
+
+  JobSystem job_system;
+  VertexSkinner skinner;
+  skinner.Skin(input, VertexSkinner::Output{positions, normals, tangents}, job_system);
+  VertexSkinner::SkinRangeReference(input, VertexSkinner::Output{ref_positions, ref_normals, ref_tangents}, 0,
+    vertex_count);
+
+  SORCERY_CHECK(AreBitwiseEqual(positions, ref_positions));
+  SORCERY_CHECK(AreBitwiseEqual(normals, ref_normals));
+  SORCERY_CHECK(AreBitwiseEqual(tangents, ref_tangents));
+}
+
+
+SORCERY_TEST(VertexSkinnerSkinsPositionsOnlyAndUnalignedRanges) {
+  constexpr auto vertex_count{1001};
+  auto const data{CreateSkinningData(vertex_count, 17, 8)};
+  VertexSkinner::Input const input{data.positions, {}, {}, data.bone_weights, data.bone_indices, data.bone_palette};
+
+  std::vector<Vector3> positions(vertex_count);
+  std::vector<Vector3> ref_positions(vertex_count);
+
+  // Ranges starting and ending in the middle of a batch
+  VertexSkinner::SkinRange(input, VertexSkinner::Output{positions, {}, {}}, 0, 3);
+  VertexSkinner::SkinRange(input, VertexSkinner::Output{positions, {}, {}}, 3, 510);
+  VertexSkinner::SkinRange(input, VertexSkinner::Output{positions, {}, {}}, 513, vertex_count - 513);
+  VertexSkinner::SkinRangeReference(input, VertexSkinner::Output{ref_positions, {}, {}}, 0, vertex_count);
+
+  SORCERY_CHECK(AreBitwiseEqual(positions, ref_positions));
+}
+}
@@ -21,6 +21,11 @@ auto AABB::FromVertices(std::span<Vector3 const> const vertices) noexcept -> AAB
 }
 
 
+auto AABB::Union(AABB const& lhs, AABB const& rhs) noexcept -> AABB {
+  return AABB{.min = Min(lhs.min, rhs.min), .max = Max(lhs.max, rhs.max)};
+}
+
+
 auto AABB::CalculateVertices() const noexcept -> std::array<Vector3, 8> {
   return std::array{
     min,
@@ -49,6 +54,38 @@ auto AABB::Transform(Matrix4 const& mtx) const noexcept -> AABB {
 }
 
 
+auto AABB::CalculateSurfaceArea() const noexcept -> float {
+  auto const extent{max - min};
+  return 2 * (extent[0] * extent[1] + extent[1] * extent[2] + extent[2] * extent[0]);
+}
+
+
+auto AABB::Intersects(Ray const& ray) const noexcept -> std::optional<float> {
+  auto t_min{0.0f};
+  auto t_max{std::numeric_limits<float>::max()};
+
+  for (auto i{0}; i < 3; i++) {
+    auto const inv_dir{1.0f / ray.direction[i]};
+    auto t0{(min[i] - ray.origin[i]) * inv_dir};
+    auto t1{(max[i] - ray.origin[i]) * inv_dir};
+
+    if (inv_dir < 0) {
+      std::swap(t0, t1);
+    }
+
+    // Written so that NaNs resulting from 0 * inf keep the previous values
+    t_min = t0 > t_min ? t0 : t_min;
+    t_max = t1 < t_max ? t1 : t_max;
+
+    if (t_max < t_min) {
+      return std::nullopt;
+    }
+  }
+
+  return t_min;
+}
+
+
 auto Plane::Normalize() noexcept -> void {
   auto const normalLength{std::sqrt(std::pow(a, 2.0f) + std::pow(b, 2.0f) + std::pow(c, 2.0f))};
   a /= normalLength;
@@ -155,4 +192,42 @@ auto Frustum::Intersects(AABB const& aabb) const noexcept -> bool {
     return intersects;
   }
 }
+
+
+auto Frustum::Intersects(AABB const& aabb, Vector3 const& extrusion) const noexcept -> bool {
+  for (auto const& plane : mPlanes) {
+    // The vertex furthest along the normal direction is the last to leave the positive half space
+    Vector3 const max_vertex{
+      plane.a >= 0 ? aabb.max[0] : aabb.min[0], plane.b >= 0 ? aabb.max[1] : aabb.min[1],
+      plane.c >= 0 ? aabb.max[2] : aabb.min[2]
+    };
+
+    // The swept volume is the convex hull of the box at the two ends of the extrusion
+    auto const distance{plane.DistanceToPoint(max_vertex)};
+    auto const extruded_distance{distance + plane.a * extrusion[0] + plane.b * extrusion[1] + plane.c * extrusion[2]};
+
+    if (std::max(distance, extruded_distance) < 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+auto Frustum::Contains(AABB const& aabb) const noexcept -> bool {
+  for (auto const& plane : mPlanes) {
+    // The vertex furthest along the negative normal direction is the first to leave the positive half space
+    Vector3 const min_vertex{
+      plane.a >= 0 ? aabb.min[0] : aabb.max[0], plane.b >= 0 ? aabb.min[1] : aabb.max[1],
+      plane.c >= 0 ? aabb.min[2] : aabb.max[2]
+    };
+
+    if (plane.DistanceToPoint(min_vertex) < 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
 }
@@ -1,8 +1,10 @@
 #pragma once
 
+#include "Core.hpp"
 #include "Math.hpp"
 
 #include <array>
+#include <optional>
 #include <span>
 
 
@@ -13,13 +15,23 @@ struct BoundingSphere {
 };
 
 
+struct Ray {
+  Vector3 origin;
+  Vector3 direction;
+};
+
+
 struct AABB {
   Vector3 min;
   Vector3 max;
 
   [[nodiscard]] static auto FromVertices(std::span<Vector3 const> vertices) noexcept -> AABB;
+  [[nodiscard]] static auto Union(AABB const& lhs, AABB const& rhs) noexcept -> AABB;
   [[nodiscard]] auto CalculateVertices() const noexcept -> std::array<Vector3, 8>;
   [[nodiscard]] auto Transform(Matrix4 const& mtx) const noexcept -> AABB;
+  [[nodiscard]] auto CalculateSurfaceArea() const noexcept -> float;
+  // Returns the distance along the ray at which it enters the box, or 0 if the origin is inside
+  [[nodiscard]] auto Intersects(Ray const& ray) const noexcept -> std::optional<float>;
 };
 
 
@@ -38,9 +50,13 @@ class Frustum {
   std::array<Plane, 6> mPlanes{};
 
 public:
-  explicit Frustum(Matrix4 const& mtx);
-
-  [[nodiscard]] auto Intersects(BoundingSphere const& boundingSphere) const noexcept -> bool;
-  [[nodiscard]] auto Intersects(AABB const& aabb) const noexcept -> bool;
+  LEOPPHAPI explicit Frustum(Matrix4 const& mtx);
+
+  [[nodiscard]] LEOPPHAPI auto Intersects(BoundingSphere const& boundingSphere) const noexcept -> bool;
+  [[nodiscard]] LEOPPHAPI auto Intersects(AABB const& aabb) const noexcept -> bool;
+  // True if the volume the AABB sweeps while moving along the extrusion vector intersects the frustum
+  [[nodiscard]] LEOPPHAPI auto Intersects(AABB const& aabb, Vector3 const& extrusion) const noexcept -> bool;
+  // True if the AABB is fully inside the frustum
+  [[nodiscard]] LEOPPHAPI auto Contains(AABB const& aabb) const noexcept -> bool;
 };
 }
@@ -55,6 +55,48 @@ std::vector<std::uint32_t> const kCubeIndices{
   15, 3, 6, 6, 18, 15
 };
 }
+
+
+// Reads the keys of an animation track and advances the bytes past them
+[[nodiscard]] auto DeserializeTrackKeys(std::span<std::byte const>& bytes, std::uint64_t const key_count,
+                                        std::vector<float>& timestamps,
+                                        std::vector<std::array<std::uint16_t, 3>>& values) -> bool {
+  if (bytes.size() < key_count * (sizeof(float) + sizeof(std::array<std::uint16_t, 3>))) {
+    return false;
+  }
+
+  timestamps.resize(key_count);
+  std::memcpy(timestamps.data(), bytes.data(), key_count * sizeof(float));
+  bytes = bytes.subspan(key_count * sizeof(float));
+
+  values.resize(key_count);
+  std::memcpy(values.data(), bytes.data(), key_count * sizeof(std::array<std::uint16_t, 3>));
+  bytes = bytes.subspan(key_count * sizeof(std::array<std::uint16_t, 3>));
+
+  return true;
+}
+
+
+[[nodiscard]] auto DeserializeTrack(std::span<std::byte const>& bytes, std::uint64_t const key_count,
+                                    Vector3Track& track) -> bool {
+  if (!DeserializeTrackKeys(bytes, key_count, track.timestamps, track.values) || bytes.size() < 2 * sizeof(Vector3)) {
+    return false;
+  }
+
+  std::memcpy(track.range_min.GetData(), bytes.data(), sizeof(Vector3));
+  bytes = bytes.subspan(sizeof(Vector3));
+
+  std::memcpy(track.range_extent.GetData(), bytes.data(), sizeof(Vector3));
+  bytes = bytes.subspan(sizeof(Vector3));
+
+  return true;
+}
+
+
+[[nodiscard]] auto DeserializeTrack(std::span<std::byte const>& bytes, std::uint64_t const key_count,
+                                    QuaternionTrack& track) -> bool {
+  return DeserializeTrackKeys(bytes, key_count, track.timestamps, track.values);
+}
 }
 
 
@@ -369,21 +411,13 @@ auto ResourceManager::LoadMesh(std::span<std::byte const> const bytes) -> MaybeN
 
       curBytes = curBytes.subspan(sizeof scale_key_count);
 
-      meshData.animations[i].node_anims[j].position_keys.resize(pos_key_count);
-      std::memcpy(meshData.animations[i].node_anims[j].position_keys.data(), curBytes.data(),
-        pos_key_count * sizeof(PositionKey));
-      curBytes = curBytes.subspan(pos_key_count * sizeof(PositionKey));
-
-
-      meshData.animations[i].node_anims[j].rotation_keys.resize(rot_key_count);
-      std::memcpy(meshData.animations[i].node_anims[j].rotation_keys.data(), curBytes.data(),
-        rot_key_count * sizeof(RotationKey));
-      curBytes = curBytes.subspan(rot_key_count * sizeof(RotationKey));
+      auto& node_anim{meshData.animations[i].node_anims[j]};
 
-      meshData.animations[i].node_anims[j].scaling_keys.resize(scale_key_count);
-      std::memcpy(meshData.animations[i].node_anims[j].scaling_keys.data(), curBytes.data(),
-        scale_key_count * sizeof(ScalingKey));
-      curBytes = curBytes.subspan(scale_key_count * sizeof(ScalingKey));
+      if (!DeserializeTrack(curBytes, pos_key_count, node_anim.position_track) ||
+          !DeserializeTrack(curBytes, rot_key_count, node_anim.rotation_track) ||
+          !DeserializeTrack(curBytes, scale_key_count, node_anim.scaling_track)) {
+        return nullptr;
+      }
     }
   }
 
@@ -577,7 +611,8 @@ auto ResourceManager::CreateDefaultResources() -> void {
     cube_mesh_->SetIndices(kCubeIndices);
     cube_mesh_->SetMaterialSlots(std::array{Mesh::MaterialSlotInfo{"Material"}});
     cube_mesh_->SetSubMeshes(std::array{Mesh::SubMeshInfo{0, 0, static_cast<int>(kCubeIndices.size()), 0, AABB{}}});
-    if (!cube_mesh_->ValidateAndUpdate(false)) {
+    // Kept in CPU memory so that it can be used as an occluder
+    if (!cube_mesh_->ValidateAndUpdate(true)) {
       throw std::runtime_error{"Failed to validate and update default cube mesh."};
     }
     default_resources_.emplace_back(cube_mesh_.get());
@@ -600,7 +635,8 @@ auto ResourceManager::CreateDefaultResources() -> void {
     plane_mesh_->SetIndices(kQuadIndices);
     plane_mesh_->SetMaterialSlots(std::array{Mesh::MaterialSlotInfo{"Material"}});
     plane_mesh_->SetSubMeshes(std::array{Mesh::SubMeshInfo{0, 0, static_cast<int>(kQuadIndices.size()), 0, AABB{}}});
-    if (!plane_mesh_->ValidateAndUpdate(false)) {
+    // Kept in CPU memory so that it can be used as an occluder
+    if (!plane_mesh_->ValidateAndUpdate(true)) {
       throw std::runtime_error{"Failed to validate and update default plane mesh."};
     }
     default_resources_.emplace_back(plane_mesh_.get());
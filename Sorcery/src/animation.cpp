@@ -0,0 +1,77 @@
+#include "animation.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+
+namespace sorcery {
+auto LocalPose::Resize(std::size_t const new_size) -> void {
+  size = new_size;
+  auto const padded_size{(new_size + batch_size - 1) / batch_size * batch_size};
+
+  // Only the padding has to be reset, the rest is written by the owner
+  for (auto* const arr : {&pos_x, &pos_y, &pos_z, &rot_x, &rot_y, &rot_z}) {
+    arr->resize(padded_size);
+    std::fill(std::begin(*arr) + static_cast<std::ptrdiff_t>(new_size), std::end(*arr), 0.0f);
+  }
+
+  for (auto* const arr : {&rot_w, &scale_x, &scale_y, &scale_z}) {
+    arr->resize(padded_size);
+    std::fill(std::begin(*arr) + static_cast<std::ptrdiff_t>(new_size), std::end(*arr), 1.0f);
+  }
+}
+
+
+auto CalculateBindPose(std::span<SkeletonNode const> const skeleton) -> LocalPose {
+  LocalPose pose;
+  pose.Resize(skeleton.size());
+
+  for (std::size_t i{0}; i < skeleton.size(); i++) {
+    auto const& mtx{skeleton[i].transform};
+
+    // Row vectors, so the translation is in the last row and the scaled axes are the first three rows
+    Vector3 const scale{Length(Vector3{mtx[0]}), Length(Vector3{mtx[1]}), Length(Vector3{mtx[2]})};
+
+    float m[3][3];
+
+    for (auto row{0}; row < 3; row++) {
+      for (auto col{0}; col < 3; col++) {
+        m[row][col] = scale[row] > 0 ? mtx[row][col] / scale[row] : 0;
+      }
+    }
+
+    // Pick the largest of the diagonal based expressions for numerical stability
+    Quaternion rot;
+
+    if (auto const trace{m[0][0] + m[1][1] + m[2][2]}; trace > 0) {
+      auto const s{std::sqrt(trace + 1) * 2};
+      rot = Quaternion{s / 4, (m[1][2] - m[2][1]) / s, (m[2][0] - m[0][2]) / s, (m[0][1] - m[1][0]) / s};
+    } else if (m[0][0] > m[1][1] && m[0][0] > m[2][2]) {
+      auto const s{std::sqrt(1 + m[0][0] - m[1][1] - m[2][2]) * 2};
+      rot = Quaternion{(m[1][2] - m[2][1]) / s, s / 4, (m[0][1] + m[1][0]) / s, (m[2][0] + m[0][2]) / s};
+    } else if (m[1][1] > m[2][2]) {
+      auto const s{std::sqrt(1 + m[1][1] - m[0][0] - m[2][2]) * 2};
+      rot = Quaternion{(m[2][0] - m[0][2]) / s, (m[0][1] + m[1][0]) / s, s / 4, (m[1][2] + m[2][1]) / s};
+    } else {
+      auto const s{std::sqrt(1 + m[2][2] - m[0][0] - m[1][1]) * 2};
+      rot = Quaternion{(m[0][1] - m[1][0]) / s, (m[2][0] + m[0][2]) / s, (m[1][2] + m[2][1]) / s, s / 4};
+    }
+
+    rot.Normalize();
+
+    pose.pos_x[i] = mtx[3][0];
+    pose.pos_y[i] = mtx[3][1];
+    pose.pos_z[i] = mtx[3][2];
+    pose.rot_x[i] = rot.x;
+    pose.rot_y[i] = rot.y;
+    pose.rot_z[i] = rot.z;
+    pose.rot_w[i] = rot.w;
+    pose.scale_x[i] = scale[0];
+    pose.scale_y[i] = scale[1];
+    pose.scale_z[i] = scale[2];
+  }
+
+  return pose;
+}
+}
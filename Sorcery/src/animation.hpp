@@ -0,0 +1,125 @@
+#pragma once
+
+#include "Bounds.hpp"
+#include "Core.hpp"
+#include "Math.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+
+namespace sorcery {
+struct SkeletonNode {
+  std::string name;
+  Matrix4 transform;
+  std::optional<std::uint32_t> parent_idx;
+};
+
+
+struct Bone {
+  Matrix4 offset_mtx;
+  std::uint32_t skeleton_node_idx;
+  // Of the vertices weighted to the bone, in the space of the bone. Min is greater than max if there are none.
+  AABB bounds;
+};
+
+
+template<typename T>
+struct AnimationKey {
+  float timestamp;
+  T value;
+};
+
+
+using PositionKey = AnimationKey<Vector3>;
+using RotationKey = AnimationKey<Quaternion>;
+using ScalingKey = AnimationKey<Vector3>;
+
+
+// Translation or scaling keys.
+// The components are quantized to 16 bits within the bounding box of the values of the track.
+struct Vector3Track {
+  std::vector<float> timestamps;
+  std::vector<std::array<std::uint16_t, 3>> values;
+  Vector3 range_min;
+  Vector3 range_extent;
+};
+
+
+// Rotation keys in smallest three form, 48 bits per key.
+// The three smallest components are quantized to 15 bits each,
+// the index of the omitted largest component is stored in the top bits of the first two values.
+struct QuaternionTrack {
+  std::vector<float> timestamps;
+  std::vector<std::array<std::uint16_t, 3>> values;
+};
+
+
+struct NodeAnimation {
+  Vector3Track position_track;
+  QuaternionTrack rotation_track;
+  Vector3Track scaling_track;
+  std::uint32_t node_idx;
+};
+
+
+struct Animation {
+  std::string name;
+  float duration;
+  float ticks_per_second;
+  std::vector<NodeAnimation> node_anims;
+};
+
+
+// Translation, rotation and scale of the nodes of a skeleton in structure of arrays layout.
+// The arrays are padded with identity transforms to a multiple of batch_size elements,
+// so that they can always be processed in full SIMD batches.
+struct LocalPose {
+  constexpr static std::size_t batch_size{8};
+
+  std::vector<float> pos_x;
+  std::vector<float> pos_y;
+  std::vector<float> pos_z;
+  std::vector<float> rot_x;
+  std::vector<float> rot_y;
+  std::vector<float> rot_z;
+  std::vector<float> rot_w;
+  std::vector<float> scale_x;
+  std::vector<float> scale_y;
+  std::vector<float> scale_z;
+
+  // Number of elements without the padding
+  std::size_t size{0};
+
+  LEOPPHAPI auto Resize(std::size_t new_size) -> void;
+};
+
+
+enum class AnimationBlendMode : std::uint8_t {
+  Override = 0,
+  Additive = 1
+};
+
+
+// A clip sampled at a point of time and blended onto the pose accumulated from the previous layers.
+// Override layers interpolate towards the clip, additive layers add the difference of the clip from its first keys.
+// Only the nodes animated by the clip are affected.
+struct AnimationLayer {
+  std::shared_ptr<Animation const> animation;
+  float time; // In ticks
+  float weight;
+  AnimationBlendMode blend_mode;
+  // Per skeleton node weights multiplied with the layer weight, null affects all nodes fully
+  std::shared_ptr<std::vector<float> const> node_mask;
+};
+
+
+// Decomposes the node transforms into translation, rotation and scale. Shear is lost.
+[[nodiscard]] LEOPPHAPI auto CalculateBindPose(std::span<SkeletonNode const> skeleton) -> LocalPose;
+}
@@ -0,0 +1,246 @@
+#include "animation_compression.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+namespace sorcery {
+namespace {
+constexpr float max_quantized_u16{65535};
+constexpr float max_quantized_u15{32767};
+// None of the three smallest components of a unit quaternion can be larger than 1 / sqrt(2)
+constexpr float smallest_three_bound{0.70710678f};
+// Bounds the cost of reducing long tracks, the compression ratio is limited by the error bound well before this
+constexpr std::size_t max_dropped_key_run{256};
+
+
+[[nodiscard]] auto QuantizeVector3(Vector3 const& value, Vector3 const& range_min,
+                                   Vector3 const& range_extent) noexcept -> std::array<std::uint16_t, 3> {
+  std::array<std::uint16_t, 3> ret{};
+
+  for (auto i{0}; i < 3; i++) {
+    if (range_extent[i] > 0) {
+      ret[i] = static_cast<std::uint16_t>(std::lround(
+        std::clamp((value[i] - range_min[i]) / range_extent[i], 0.0f, 1.0f) * max_quantized_u16));
+    }
+  }
+
+  return ret;
+}
+
+
+[[nodiscard]] auto DequantizeVector3(std::array<std::uint16_t, 3> const& value, Vector3 const& range_min,
+                                     Vector3 const& range_extent) noexcept -> Vector3 {
+  return Vector3{
+    range_min[0] + static_cast<float>(value[0]) / max_quantized_u16 * range_extent[0],
+    range_min[1] + static_cast<float>(value[1]) / max_quantized_u16 * range_extent[1],
+    range_min[2] + static_cast<float>(value[2]) / max_quantized_u16 * range_extent[2]
+  };
+}
+
+
+[[nodiscard]] auto QuantizeQuaternion(Quaternion const& value) noexcept -> std::array<std::uint16_t, 3> {
+  auto const normalized{value.Normalized()};
+  std::array const components{normalized.x, normalized.y, normalized.z, normalized.w};
+
+  auto largest_idx{0};
+
+  for (auto i{1}; i < 4; i++) {
+    if (std::abs(components[i]) > std::abs(components[largest_idx])) {
+      largest_idx = i;
+    }
+  }
+
+  // q and -q are the same rotation, flipping the sign makes the omitted component positive
+  auto const sign{components[largest_idx] < 0 ? -1.0f : 1.0f};
+
+  std::array<std::uint16_t, 3> ret{};
+
+  for (auto i{0}, j{0}; i < 4; i++) {
+    if (i != largest_idx) {
+      ret[j++] = static_cast<std::uint16_t>(std::lround(
+        std::clamp(sign * components[i] / smallest_three_bound * 0.5f + 0.5f, 0.0f, 1.0f) * max_quantized_u15));
+    }
+  }
+
+  ret[0] |= static_cast<std::uint16_t>((largest_idx & 1) << 15);
+  ret[1] |= static_cast<std::uint16_t>((largest_idx >> 1) << 15);
+
+  return ret;
+}
+
+
+[[nodiscard]] auto DequantizeQuaternion(std::array<std::uint16_t, 3> const& value) noexcept -> Quaternion {
+  auto const largest_idx{value[0] >> 15 | value[1] >> 15 << 1};
+
+  std::array<float, 4> components{};
+  auto smallest_three_norm_sq{0.0f};
+
+  for (auto i{0}, j{0}; i < 4; i++) {
+    if (i != largest_idx) {
+      components[i] = (static_cast<float>(value[j++] & 0x7FFF) / max_quantized_u15 * 2 - 1) * smallest_three_bound;
+      smallest_three_norm_sq += components[i] * components[i];
+    }
+  }
+
+  components[largest_idx] = std::sqrt(std::max(1 - smallest_three_norm_sq, 0.0f));
+
+  return Quaternion{components[3], components[0], components[1], components[2]};
+}
+
+
+[[nodiscard]] auto CalculateRotationAngle(Quaternion const& from, Quaternion const& to) noexcept -> float {
+  auto const from_normalized{from.Normalized()};
+  auto const to_normalized{to.Normalized()};
+  auto const cos_half_angle{
+    std::abs(from_normalized.w * to_normalized.w + from_normalized.x * to_normalized.x +
+             from_normalized.y * to_normalized.y + from_normalized.z * to_normalized.z)
+  };
+  return 2 * std::acos(std::min(cos_half_angle, 1.0f));
+}
+
+
+// Returns the indices of the keys that have to be kept so that interpolating the decoded values of the kept keys
+// stays within the error at the timestamps of every dropped key.
+// The sampler interpolates the same way, so the error bound holds at runtime, not just for the quantization.
+template<typename T>
+[[nodiscard]] auto SelectKeys(std::span<AnimationKey<T> const> const keys, std::span<T const> const decoded_values,
+                              float const max_error, auto const& interpolate,
+                              auto const& measure_error) -> std::vector<std::size_t> {
+  if (keys.empty()) {
+    return {};
+  }
+
+  std::vector<std::size_t> kept_indices{0};
+
+  if (std::ranges::all_of(keys, [&decoded_values, max_error, &measure_error](AnimationKey<T> const& key) {
+    return measure_error(decoded_values[0], key.value) <= max_error;
+  })) {
+    return kept_indices;
+  }
+
+  auto const can_drop_between{
+    [&keys, &decoded_values, max_error, &interpolate, &measure_error](std::size_t const from, std::size_t const to) {
+      auto const duration{keys[to].timestamp - keys[from].timestamp};
+
+      for (auto i{from + 1}; i < to; i++) {
+        auto const amount{duration > 0 ? (keys[i].timestamp - keys[from].timestamp) / duration : 0.0f};
+
+        if (measure_error(interpolate(decoded_values[from], decoded_values[to], amount), keys[i].value) > max_error) {
+          return false;
+        }
+      }
+
+      return true;
+    }
+  };
+
+  // Greedily extend the interpolated segment from the last kept key as far as the error allows
+  std::size_t anchor_idx{0};
+
+  for (std::size_t end_idx{2}; end_idx < keys.size(); end_idx++) {
+    if (end_idx - anchor_idx > max_dropped_key_run || !can_drop_between(anchor_idx, end_idx)) {
+      anchor_idx = end_idx - 1;
+      kept_indices.emplace_back(anchor_idx);
+    }
+  }
+
+  if (keys.size() > 1) {
+    kept_indices.emplace_back(keys.size() - 1);
+  }
+
+  return kept_indices;
+}
+}
+
+
+auto CompressTrack(std::span<AnimationKey<Vector3> const> const keys, float const max_error) -> Vector3Track {
+  Vector3Track track{{}, {}, Vector3{0}, Vector3{0}};
+
+  if (keys.empty()) {
+    return track;
+  }
+
+  auto range_max{keys[0].value};
+  track.range_min = keys[0].value;
+
+  for (auto const& key : keys) {
+    track.range_min = Min(track.range_min, key.value);
+    range_max = Max(range_max, key.value);
+  }
+
+  track.range_extent = range_max - track.range_min;
+
+  std::vector<std::array<std::uint16_t, 3>> quantized_values;
+  std::vector<Vector3> decoded_values;
+  quantized_values.reserve(keys.size());
+  decoded_values.reserve(keys.size());
+
+  for (auto const& key : keys) {
+    quantized_values.emplace_back(QuantizeVector3(key.value, track.range_min, track.range_extent));
+    decoded_values.emplace_back(DequantizeVector3(quantized_values.back(), track.range_min, track.range_extent));
+  }
+
+  for (auto const key_idx : SelectKeys(keys, std::span<Vector3 const>{decoded_values}, max_error,
+         [](Vector3 const& from, Vector3 const& to, float const amount) {
+           return Lerp(from, to, amount);
+         }, [](Vector3 const& reconstructed, Vector3 const& original) {
+           return Distance(reconstructed, original);
+         })) {
+    track.timestamps.emplace_back(keys[key_idx].timestamp);
+    track.values.emplace_back(quantized_values[key_idx]);
+  }
+
+  return track;
+}
+
+
+auto CompressTrack(std::span<AnimationKey<Quaternion> const> const keys,
+                   float const max_angle_error) -> QuaternionTrack {
+  QuaternionTrack track;
+
+  std::vector<std::array<std::uint16_t, 3>> quantized_values;
+  std::vector<Quaternion> decoded_values;
+  quantized_values.reserve(keys.size());
+  decoded_values.reserve(keys.size());
+
+  for (auto const& key : keys) {
+    quantized_values.emplace_back(QuantizeQuaternion(key.value));
+    decoded_values.emplace_back(DequantizeQuaternion(quantized_values.back()));
+  }
+
+  for (auto const key_idx : SelectKeys(keys, std::span<Quaternion const>{decoded_values}, max_angle_error,
+         [](Quaternion const& from, Quaternion const& to, float const amount) {
+           return Slerp(from, to, amount);
+         }, [](Quaternion const& reconstructed, Quaternion const& original) {
+           return CalculateRotationAngle(reconstructed, original);
+         })) {
+    track.timestamps.emplace_back(keys[key_idx].timestamp);
+    track.values.emplace_back(quantized_values[key_idx]);
+  }
+
+  return track;
+}
+
+
+auto DecompressKey(Vector3Track const& track, std::size_t const key_idx) noexcept -> Vector3 {
+  return DequantizeVector3(track.values[key_idx], track.range_min, track.range_extent);
+}
+
+
+auto DecompressKey(QuaternionTrack const& track, std::size_t const key_idx) noexcept -> Quaternion {
+  return DequantizeQuaternion(track.values[key_idx]);
+}
+
+
+auto CalculateTrackSize(Vector3Track const& track) noexcept -> std::size_t {
+  return track.timestamps.size() * sizeof(float) + track.values.size() * sizeof(std::array<std::uint16_t, 3>) +
+         sizeof(Vector3) * 2;
+}
+
+
+auto CalculateTrackSize(QuaternionTrack const& track) noexcept -> std::size_t {
+  return track.timestamps.size() * sizeof(float) + track.values.size() * sizeof(std::array<std::uint16_t, 3>);
+}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "animation.hpp"
+#include "Core.hpp"
+#include "Math.hpp"
+
+#include <cstddef>
+#include <span>
+
+
+namespace sorcery {
+// Quantizes the keys and drops the ones that interpolating the remaining quantized keys reproduces within the error.
+// Tracks whose values all stay within the error of the first key are reduced to a single key.
+// The keys must be sorted by their timestamps.
+[[nodiscard]] LEOPPHAPI auto CompressTrack(std::span<AnimationKey<Vector3> const> keys,
+                                           float max_error) -> Vector3Track;
+// The error is the angle between the original and reconstructed rotations in radians
+[[nodiscard]] LEOPPHAPI auto CompressTrack(std::span<AnimationKey<Quaternion> const> keys,
+                                           float max_angle_error) -> QuaternionTrack;
+
+[[nodiscard]] LEOPPHAPI auto DecompressKey(Vector3Track const& track, std::size_t key_idx) noexcept -> Vector3;
+[[nodiscard]] LEOPPHAPI auto DecompressKey(QuaternionTrack const& track, std::size_t key_idx) noexcept -> Quaternion;
+
+// Size of the key data of a track in bytes
+[[nodiscard]] LEOPPHAPI auto CalculateTrackSize(Vector3Track const& track) noexcept -> std::size_t;
+[[nodiscard]] LEOPPHAPI auto CalculateTrackSize(QuaternionTrack const& track) noexcept -> std::size_t;
+}
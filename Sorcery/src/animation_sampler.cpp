@@ -0,0 +1,138 @@
+#include "animation_sampler.hpp"
+
+#include "animation_compression.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+
+namespace sorcery {
+auto AnimationSampler::Sample(Animation const& animation, float const time, std::size_t const node_count,
+                              LocalPose& pose) -> void {
+  // Cursors of another clip are meaningless, searching from the start is always correct
+  if (animation_ != &animation || cursors_.size() != animation.node_anims.size()) {
+    animation_ = &animation;
+    cursors_.assign(animation.node_anims.size(), NodeCursors{0, 0, 0});
+  }
+
+  for (std::size_t i{0}; i < animation.node_anims.size(); i++) {
+    auto const& [pos_track, rot_track, scaling_track, node_idx]{animation.node_anims[i]};
+
+    if (node_idx >= std::min(node_count, pose.size)) {
+      continue;
+    }
+
+    auto& [pos_cursor, rot_cursor, scaling_cursor]{cursors_[i]};
+
+    if (!pos_track.timestamps.empty()) {
+      auto const pos{SampleTrack(pos_track, time, pos_cursor)};
+      pose.pos_x[node_idx] = pos[0];
+      pose.pos_y[node_idx] = pos[1];
+      pose.pos_z[node_idx] = pos[2];
+    }
+
+    if (!rot_track.timestamps.empty()) {
+      auto const rot{SampleTrack(rot_track, time, rot_cursor)};
+      pose.rot_x[node_idx] = rot.x;
+      pose.rot_y[node_idx] = rot.y;
+      pose.rot_z[node_idx] = rot.z;
+      pose.rot_w[node_idx] = rot.w;
+    }
+
+    if (!scaling_track.timestamps.empty()) {
+      auto const scale{SampleTrack(scaling_track, time, scaling_cursor)};
+      pose.scale_x[node_idx] = scale[0];
+      pose.scale_y[node_idx] = scale[1];
+      pose.scale_z[node_idx] = scale[2];
+    }
+  }
+}
+
+
+auto AnimationSampler::SampleFirstKeys(Animation const& animation, std::size_t const node_count,
+                                       LocalPose& pose) -> void {
+  for (auto const& [pos_track, rot_track, scaling_track, node_idx] : animation.node_anims) {
+    if (node_idx >= std::min(node_count, pose.size)) {
+      continue;
+    }
+
+    if (!pos_track.timestamps.empty()) {
+      auto const pos{DecompressKey(pos_track, 0)};
+      pose.pos_x[node_idx] = pos[0];
+      pose.pos_y[node_idx] = pos[1];
+      pose.pos_z[node_idx] = pos[2];
+    }
+
+    if (!rot_track.timestamps.empty()) {
+      auto const rot{DecompressKey(rot_track, 0)};
+      pose.rot_x[node_idx] = rot.x;
+      pose.rot_y[node_idx] = rot.y;
+      pose.rot_z[node_idx] = rot.z;
+      pose.rot_w[node_idx] = rot.w;
+    }
+
+    if (!scaling_track.timestamps.empty()) {
+      auto const scale{DecompressKey(scaling_track, 0)};
+      pose.scale_x[node_idx] = scale[0];
+      pose.scale_y[node_idx] = scale[1];
+      pose.scale_z[node_idx] = scale[2];
+    }
+  }
+}
+
+
+auto AnimationSampler::SampleTrack(Vector3Track const& track, float const time, unsigned& cursor) noexcept -> Vector3 {
+  cursor = FindKey(track.timestamps, time, cursor);
+
+  if (cursor + 1 >= track.timestamps.size() || time <= track.timestamps[cursor]) {
+    return DecompressKey(track, cursor);
+  }
+
+  auto const from_time{track.timestamps[cursor]};
+  auto const to_time{track.timestamps[cursor + 1]};
+  return Lerp(DecompressKey(track, cursor), DecompressKey(track, cursor + 1),
+    (time - from_time) / (to_time - from_time));
+}
+
+
+auto AnimationSampler::SampleTrack(QuaternionTrack const& track, float const time,
+                                   unsigned& cursor) noexcept -> Quaternion {
+  cursor = FindKey(track.timestamps, time, cursor);
+
+  if (cursor + 1 >= track.timestamps.size() || time <= track.timestamps[cursor]) {
+    return DecompressKey(track, cursor);
+  }
+
+  auto const from_time{track.timestamps[cursor]};
+  auto const to_time{track.timestamps[cursor + 1]};
+  return Slerp(DecompressKey(track, cursor), DecompressKey(track, cursor + 1),
+    (time - from_time) / (to_time - from_time));
+}
+
+
+auto AnimationSampler::FindKey(std::span<float const> const timestamps, float const time,
+                               unsigned cursor) noexcept -> unsigned {
+  auto const key_count{static_cast<unsigned>(timestamps.size())};
+
+  // Times before the first key clamp to it
+  if (key_count <= 1 || time <= timestamps[0]) {
+    return 0;
+  }
+
+  // During forward playback the time usually stays within a few keys after the cursor.
+  // The search stops at the last key whose successor is after the time, the last key itself clamps.
+  if (cursor < key_count && timestamps[cursor] <= time) {
+    for (unsigned step{0}; step < max_linear_steps_; step++) {
+      if (cursor + 1 >= key_count || timestamps[cursor + 1] > time) {
+        return cursor;
+      }
+
+      cursor += 1;
+    }
+  }
+
+  // Seeking, for example when the clip loops back to its start
+  auto const next_key{std::ranges::upper_bound(timestamps, time)};
+  return static_cast<unsigned>(std::distance(std::begin(timestamps), next_key)) - 1;
+}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "animation.hpp"
+#include "Core.hpp"
+#include "Math.hpp"
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+
+namespace sorcery {
+// Samples the node animations of a clip.
+// Keeps a key cursor per track so that forward playback finds the surrounding keys in amortized constant time,
+// seeking backwards or far ahead falls back to binary search.
+// Has no dependency on the graphics device, so it can be used headless.
+class AnimationSampler {
+public:
+  // The elements of the pose correspond to the nodes of the skeleton.
+  // Only the components of the nodes before the node count that the clip has keys for are written.
+  LEOPPHAPI auto Sample(Animation const& animation, float time, std::size_t node_count, LocalPose& pose) -> void;
+  // Writes the first keys of the clip the same way, additive layers are relative to them
+  LEOPPHAPI static auto SampleFirstKeys(Animation const& animation, std::size_t node_count, LocalPose& pose) -> void;
+
+  // Returns the value of the track at the time, clamped to the first and last keys outside of their range.
+  // Only the two keys surrounding the time are decompressed.
+  // The cursor is used as a starting point for the search and is updated to the last key not after the time.
+  [[nodiscard]] LEOPPHAPI static auto SampleTrack(Vector3Track const& track, float time,
+                                                  unsigned& cursor) noexcept -> Vector3;
+  [[nodiscard]] LEOPPHAPI static auto SampleTrack(QuaternionTrack const& track, float time,
+                                                  unsigned& cursor) noexcept -> Quaternion;
+
+private:
+  struct NodeCursors {
+    unsigned pos;
+    unsigned rot;
+    unsigned scaling;
+  };
+
+
+  [[nodiscard]] static auto FindKey(std::span<float const> timestamps, float time, unsigned cursor) noexcept ->
+    unsigned;
+
+  // Forward playback rarely skips more keys than this, longer jumps use binary search
+  constexpr static unsigned max_linear_steps_{4};
+
+  Animation const* animation_{nullptr};
+  std::vector<NodeCursors> cursors_;
+};
+}
@@ -0,0 +1,163 @@
+#include "animation_state_machine.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+
+namespace sorcery {
+auto AnimationStateMachine::AddState(State state) -> std::size_t {
+  states_.emplace_back(std::move(state));
+  return states_.size() - 1;
+}
+
+
+auto AnimationStateMachine::AddTransition(Transition transition) -> void {
+  transitions_.emplace_back(std::move(transition));
+}
+
+
+auto AnimationStateMachine::Clear() noexcept -> void {
+  states_.clear();
+  transitions_.clear();
+  Stop();
+}
+
+
+auto AnimationStateMachine::SetState(std::size_t const state_idx) noexcept -> void {
+  current_ = state_idx < states_.size() ? std::make_optional(Playback{state_idx, 0}) : std::nullopt;
+  previous_.reset();
+}
+
+
+auto AnimationStateMachine::CrossFade(std::size_t const state_idx, float const fade_duration) noexcept -> void {
+  if (!current_ || fade_duration <= 0) {
+    SetState(state_idx);
+    return;
+  }
+
+  if (state_idx >= states_.size()) {
+    return;
+  }
+
+  // Interrupting a cross-fade continues from the state that was fading in
+  previous_ = current_;
+  current_ = Playback{state_idx, 0};
+  fade_elapsed_time_ = 0;
+  fade_duration_ = fade_duration;
+}
+
+
+auto AnimationStateMachine::Stop() noexcept -> void {
+  current_.reset();
+  previous_.reset();
+}
+
+
+auto AnimationStateMachine::SetTrigger(std::string_view const trigger) noexcept -> void {
+  if (!current_) {
+    return;
+  }
+
+  if (auto const it{
+    std::ranges::find_if(transitions_, [this, trigger](Transition const& transition) {
+      return transition.from_state_idx == current_->state_idx && !transition.trigger.empty() &&
+             transition.trigger == trigger;
+    })
+  }; it != std::end(transitions_)) {
+    CrossFade(it->to_state_idx, it->fade_duration);
+  }
+}
+
+
+auto AnimationStateMachine::Update(float const delta_time) noexcept -> void {
+  if (!current_) {
+    return;
+  }
+
+  current_->elapsed_time += delta_time;
+
+  if (previous_) {
+    previous_->elapsed_time += delta_time;
+    fade_elapsed_time_ += delta_time;
+
+    if (fade_elapsed_time_ >= fade_duration_) {
+      previous_.reset();
+    }
+  }
+
+  // At most one transition fires per update so that chains of zero length states cannot loop forever
+  auto const progress{CalculateProgress(*current_)};
+
+  for (auto const& [from_state_idx, to_state_idx, fade_duration, exit_time, trigger] : transitions_) {
+    if (from_state_idx == current_->state_idx && exit_time && progress >= *exit_time) {
+      CrossFade(to_state_idx, fade_duration);
+      break;
+    }
+  }
+}
+
+
+auto AnimationStateMachine::GetStates() const noexcept -> std::span<State const> {
+  return states_;
+}
+
+
+auto AnimationStateMachine::GetCurrentStateIdx() const noexcept -> std::optional<std::size_t> {
+  return current_ ? std::make_optional(current_->state_idx) : std::nullopt;
+}
+
+
+auto AnimationStateMachine::GetCurrentTime() const noexcept -> float {
+  return current_ ? CalculateSampleTime(*current_) : 0;
+}
+
+
+auto AnimationStateMachine::ExtractLayers(float const weight, AnimationBlendMode const blend_mode,
+                                          std::shared_ptr<std::vector<float> const> const& node_mask,
+                                          std::vector<AnimationLayer>& out) const -> void {
+  if (!current_ || !states_[current_->state_idx].animation) {
+    return;
+  }
+
+  auto fade_in_weight{1.0f};
+
+  if (previous_ && states_[previous_->state_idx].animation) {
+    fade_in_weight = std::clamp(fade_elapsed_time_ / fade_duration_, 0.0f, 1.0f);
+
+    // Override layers interpolate the incoming clip over the outgoing one, additive ones have to sum to the weight
+    out.emplace_back(states_[previous_->state_idx].animation, CalculateSampleTime(*previous_),
+      blend_mode == AnimationBlendMode::Additive ? weight * (1 - fade_in_weight) : weight, blend_mode, node_mask);
+  }
+
+  out.emplace_back(states_[current_->state_idx].animation, CalculateSampleTime(*current_), weight * fade_in_weight,
+    blend_mode, node_mask);
+}
+
+
+auto AnimationStateMachine::CalculateTicks(Playback const& playback) const noexcept -> float {
+  auto const& [animation, speed, loop]{states_[playback.state_idx]};
+  auto const ticks_per_second{
+    animation && animation->ticks_per_second != 0 ? animation->ticks_per_second : default_ticks_per_second_
+  };
+  return playback.elapsed_time * speed * ticks_per_second;
+}
+
+
+auto AnimationStateMachine::CalculateSampleTime(Playback const& playback) const noexcept -> float {
+  auto const& [animation, speed, loop]{states_[playback.state_idx]};
+
+  if (!animation || animation->duration <= 0) {
+    return 0;
+  }
+
+  auto const ticks{CalculateTicks(playback)};
+  return loop ? std::fmod(ticks, animation->duration) : std::min(ticks, animation->duration);
+}
+
+
+auto AnimationStateMachine::CalculateProgress(Playback const& playback) const noexcept -> float {
+  auto const& animation{states_[playback.state_idx].animation};
+  return animation && animation->duration > 0 ? CalculateTicks(playback) / animation->duration : 0;
+}
+}
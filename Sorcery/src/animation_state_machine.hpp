@@ -0,0 +1,84 @@
+#pragma once
+
+#include "animation.hpp"
+#include "Core.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace sorcery {
+// Plays the clip of its current state and cross-fades between states on transitions.
+// Has no dependency on the graphics device, so it can be used headless.
+class AnimationStateMachine {
+public:
+  struct State {
+    std::shared_ptr<Animation const> animation;
+    float speed{1};
+    bool loop{true};
+  };
+
+
+  struct Transition {
+    std::size_t from_state_idx;
+    std::size_t to_state_idx;
+    float fade_duration; // In seconds
+    // Fires once the playback of the source state reaches this many times its clip duration, or never if empty
+    std::optional<float> exit_time;
+    // Fires when the trigger is set while the source state is playing, or never if empty
+    std::string trigger;
+  };
+
+
+  LEOPPHAPI auto AddState(State state) -> std::size_t;
+  LEOPPHAPI auto AddTransition(Transition transition) -> void;
+  LEOPPHAPI auto Clear() noexcept -> void;
+
+  // Restarts the state immediately, cancelling any cross-fade
+  LEOPPHAPI auto SetState(std::size_t state_idx) noexcept -> void;
+  LEOPPHAPI auto CrossFade(std::size_t state_idx, float fade_duration) noexcept -> void;
+  LEOPPHAPI auto Stop() noexcept -> void;
+  // Fires the first transition from the current state that has the trigger
+  LEOPPHAPI auto SetTrigger(std::string_view trigger) noexcept -> void;
+
+  LEOPPHAPI auto Update(float delta_time) noexcept -> void;
+
+  [[nodiscard]] LEOPPHAPI auto GetStates() const noexcept -> std::span<State const>;
+  [[nodiscard]] LEOPPHAPI auto GetCurrentStateIdx() const noexcept -> std::optional<std::size_t>;
+  // Sample time of the current state in ticks
+  [[nodiscard]] LEOPPHAPI auto GetCurrentTime() const noexcept -> float;
+
+  // Appends the layers of the state being faded out, if any, and the current state.
+  // The passed weight, blend mode and mask are those of the layer the state machine drives.
+  LEOPPHAPI auto ExtractLayers(float weight, AnimationBlendMode blend_mode,
+                               std::shared_ptr<std::vector<float> const> const& node_mask,
+                               std::vector<AnimationLayer>& out) const -> void;
+
+private:
+  struct Playback {
+    std::size_t state_idx;
+    float elapsed_time; // In seconds
+  };
+
+
+  [[nodiscard]] auto CalculateTicks(Playback const& playback) const noexcept -> float;
+  [[nodiscard]] auto CalculateSampleTime(Playback const& playback) const noexcept -> float;
+  // Clip durations elapsed since the state started, not wrapped for looping states
+  [[nodiscard]] auto CalculateProgress(Playback const& playback) const noexcept -> float;
+
+  // Ticks per second of clips that do not specify it
+  constexpr static float default_ticks_per_second_{25};
+
+  std::vector<State> states_;
+  std::vector<Transition> transitions_;
+  std::optional<Playback> current_;
+  std::optional<Playback> previous_; // Being faded out
+  float fade_elapsed_time_{0};
+  float fade_duration_{0};
+};
+}
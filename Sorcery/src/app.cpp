@@ -4,12 +4,14 @@
 #include "Platform.hpp"
 #include "Timing.hpp"
 
+#include <algorithm>
 #include <charconv>
 #include <stdexcept>
 
 
 namespace sorcery {
 App::App(std::span<std::string_view const> const args) :
+  headless_{std::ranges::find(args, std::string_view{"-headless"}) != std::ranges::end(args)},
   job_system_{
     [args] {
       unsigned thread_count{0};
@@ -29,18 +31,22 @@ App::App(std::span<std::string_view const> const args) :
   },
   graphics_device_{
 #ifndef NDEBUG
-    true
+    true,
 #else
-    false
+    false,
 #endif
+    headless_
   },
+  window_{headless_ ? nullptr : std::make_unique<Window>()},
   swap_chain_{
-    graphics_device_.CreateSwapChain(graphics::SwapChainDesc{
-      0, 0, 2, DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_USAGE_RENDER_TARGET_OUTPUT, DXGI_SCALING_STRETCH
-    }, static_cast<HWND>(window_.GetNativeHandle()))
+    headless_
+      ? nullptr
+      : graphics_device_.CreateSwapChain(graphics::SwapChainDesc{
+        0, 0, 2, DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_USAGE_RENDER_TARGET_OUTPUT, DXGI_SCALING_STRETCH
+      }, static_cast<HWND>(window_->GetNativeHandle()))
   },
   render_manager_{graphics_device_},
-  scene_renderer_{window_, graphics_device_, render_manager_},
+  scene_renderer_{ObserverPtr<Window>{window_.get()}, graphics_device_, render_manager_},
   resource_manager_{job_system_} {
   if (instance_) {
     throw std::logic_error{"App already exists!"};
@@ -48,11 +54,23 @@ App::App(std::span<std::string_view const> const args) :
 
   instance_.Reset(this);
 
+  for (auto const arg : args) {
+    if (arg.starts_with("-pipeline-depth=")) {
+      auto const depth_sv{arg.substr(16)};
+      if (UINT depth; std::from_chars(depth_sv.data(), depth_sv.data() + depth_sv.size(), depth).ec == std::errc{}) {
+        SetPipelineDepth(depth);
+        break;
+      }
+    }
+  }
+
   resource_manager_.CreateDefaultResources();
 
-  window_.OnWindowSize.add_listener([this](Extent2D<unsigned>) {
-    window_resized_ = true;
-  });
+  if (window_) {
+    window_->OnWindowSize.add_listener([this](Extent2D<unsigned>) {
+      window_resized_ = true;
+    });
+  }
 
   timing::OnApplicationStart();
 }
@@ -70,11 +88,19 @@ auto App::GetGraphicsDevice() -> graphics::GraphicsDevice& {
 
 
 auto App::GetWindow() -> Window& {
-  return window_;
+  if (!window_) {
+    throw std::logic_error{"Headless apps have no window."};
+  }
+
+  return *window_;
 }
 
 
 auto App::GetSwapChain() -> graphics::SwapChain& {
+  if (!swap_chain_) {
+    throw std::logic_error{"Headless apps have no swap chain."};
+  }
+
   return *swap_chain_;
 }
 
@@ -99,6 +125,21 @@ auto App::GetResourceManager() -> ResourceManager& {
 }
 
 
+auto App::IsHeadless() const noexcept -> bool {
+  return headless_;
+}
+
+
+auto App::GetPipelineDepth() const noexcept -> UINT {
+  return pipeline_depth_;
+}
+
+
+auto App::SetPipelineDepth(UINT const depth) noexcept -> void {
+  pipeline_depth_ = std::clamp(depth, 1u, rendering::RenderManager::GetMaxFramesInFlight());
+}
+
+
 auto App::Run() -> void {
   while (!IsQuitSignaled()) {
     ProcessEvents();
@@ -112,27 +153,31 @@ auto App::Run() -> void {
 
     EndFrame();
 
-    if (render_job_) {
-      job_system_.Wait(render_job_);
+    // The scene renderer extracts into the next packet of its ring, so this overlaps rendering the previous frames
+    scene_renderer_.ExtractCurrentState();
+
+    auto const frame_idx{static_cast<UINT>(frame_count_ % render_jobs_.size())};
+
+    // Render jobs complete in frame order, so this also waits for the frames before N - depth
+    if (frame_count_ >= pipeline_depth_) {
+      job_system_.Wait(render_jobs_[(frame_count_ - pipeline_depth_) % render_jobs_.size()]);
     }
 
     if (window_resized_) {
+      WaitRenderJob();
       graphics_device_.WaitIdle();
       graphics_device_.ResizeSwapChain(*swap_chain_, 0, 0);
       window_resized_ = false;
     }
 
-    scene_renderer_.ExtractCurrentState();
-    PrepareRender();
+    PrepareRender(frame_idx);
 
-    render_job_ = job_system_.CreateJob([this] {
-      scene_renderer_.Render();
-      Render();
-      graphics_device_.Present(*swap_chain_);
-      render_manager_.EndFrame();
+    render_jobs_[frame_idx] = job_system_.CreateJob([this] {
+      RenderFrame();
     });
 
-    job_system_.Run(render_job_);
+    SubmitRenderJob(render_jobs_[frame_idx]);
+    frame_count_ += 1;
 
     timing::OnFrameEnd();
   }
@@ -149,9 +194,58 @@ auto App::Instance() -> App& {
 
 
 auto App::WaitRenderJob() -> void {
-  if (render_job_) {
-    job_system_.Wait(render_job_);
+  // The job of the latest frame completes last
+  if (frame_count_ > 0) {
+    job_system_.Wait(render_jobs_[(frame_count_ - 1) % render_jobs_.size()]);
+  }
+}
+
+
+auto App::RenderFrame() -> void {
+  if (headless_) {
+    scene_renderer_.DiscardFrame();
+  } else {
+    scene_renderer_.Render();
+    Render();
+    graphics_device_.Present(*swap_chain_);
+  }
+
+  render_manager_.EndFrame();
+
+  ObserverPtr<Job> next_job;
+
+  {
+    std::scoped_lock const lock{render_job_mutex_};
+
+    if (queued_render_jobs_.empty()) {
+      render_job_running_ = false;
+    } else {
+      next_job = queued_render_jobs_.front();
+      queued_render_jobs_.pop_front();
+    }
   }
+
+  if (next_job) {
+    job_system_.Run(next_job);
+  }
+}
+
+
+auto App::SubmitRenderJob(ObserverPtr<Job> const job) -> void {
+  // Waiting for the previous frame inside the job could deadlock, because waiting executes other jobs, which could
+  // be the job of the next frame. The job of the previous frame starts the queued one instead when it is done.
+  {
+    std::scoped_lock const lock{render_job_mutex_};
+
+    if (render_job_running_) {
+      queued_render_jobs_.push_back(job);
+      return;
+    }
+
+    render_job_running_ = true;
+  }
+
+  job_system_.Run(job);
 }
 
 
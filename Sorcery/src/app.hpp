@@ -9,6 +9,10 @@
 #include "rendering/render_manager.hpp"
 #include "rendering/scene_renderer.hpp"
 
+#include <array>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <span>
 #include <string_view>
 
@@ -26,6 +30,7 @@ public:
   auto operator=(App&&) -> void = delete;
 
   [[nodiscard]] LEOPPHAPI auto GetGraphicsDevice() -> graphics::GraphicsDevice&;
+  // The window and the swap chain throw in headless apps
   [[nodiscard]] LEOPPHAPI auto GetWindow() -> Window&;
   [[nodiscard]] LEOPPHAPI auto GetSwapChain() -> graphics::SwapChain&;
   [[nodiscard]] LEOPPHAPI auto GetRenderManager() -> rendering::RenderManager&;
@@ -33,29 +38,54 @@ public:
   [[nodiscard]] LEOPPHAPI auto GetJobSystem() -> JobSystem&;
   [[nodiscard]] LEOPPHAPI auto GetResourceManager() -> ResourceManager&;
 
+  // Headless apps, started with -headless, run the frame pipeline but discard the frames instead of rendering them.
+  // They have no window or swap chain, and their graphics device uses the software adapter, so they run without a GPU.
+  [[nodiscard]] LEOPPHAPI auto IsHeadless() const noexcept -> bool;
+
+  // The number of frames whose rendering can still be in progress when the next frame is prepared.
+  // Set with -pipeline-depth=N, 1 by default, clamped to [1, RenderManager::GetMaxFramesInFlight()].
+  [[nodiscard]] LEOPPHAPI auto GetPipelineDepth() const noexcept -> UINT;
+  LEOPPHAPI auto SetPipelineDepth(UINT depth) noexcept -> void;
+
+  // Extracting a frame overlaps rendering the previous ones. After extracting frame N, the render job of frame
+  // N - depth is waited for. Render jobs run one after the other in frame order.
   LEOPPHAPI auto Run() -> void;
 
   [[nodiscard]] LEOPPHAPI static auto Instance() -> App&;
 
 protected:
+  // Waits for every render job that was started
   LEOPPHAPI auto WaitRenderJob() -> void;
 
   virtual auto BeginFrame() -> void {}
   virtual auto Update() -> void {}
   virtual auto EndFrame() -> void {}
-  virtual auto PrepareRender() -> void {}
+  // Called on the main thread, the frame index is that of the frame being prepared, which the render thread
+  // will have as its current frame index when calling Render
+  virtual auto PrepareRender([[maybe_unused]] UINT frame_idx) -> void {}
   virtual auto Render() -> void {}
 
 private:
+  auto RenderFrame() -> void;
+  auto SubmitRenderJob(ObserverPtr<Job> job) -> void;
+
+  bool headless_;
   JobSystem job_system_;
   graphics::GraphicsDevice graphics_device_;
-  Window window_;
+  std::unique_ptr<Window> window_;
   graphics::SharedDeviceChildHandle<graphics::SwapChain> swap_chain_;
   rendering::RenderManager render_manager_;
   rendering::SceneRenderer scene_renderer_;
   ResourceManager resource_manager_;
   bool window_resized_{false};
-  ObserverPtr<Job> render_job_;
+  UINT pipeline_depth_{1};
+  UINT64 frame_count_{0};
+  // Indexed by the frame index
+  std::array<ObserverPtr<Job>, rendering::RenderManager::GetMaxFramesInFlight()> render_jobs_{};
+  // Jobs of frames whose predecessor was still rendering when they were submitted
+  std::deque<ObserverPtr<Job>> queued_render_jobs_;
+  bool render_job_running_{false};
+  std::mutex render_job_mutex_;
 
 
   static ObserverPtr<App> instance_;
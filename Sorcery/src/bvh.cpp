@@ -0,0 +1,344 @@
+#include "bvh.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+
+namespace sorcery {
+namespace {
+AABB constexpr kEmptyAabb{
+  .min = Vector3{std::numeric_limits<float>::max()},
+  .max = Vector3{std::numeric_limits<float>::lowest()}
+};
+
+
+[[nodiscard]] auto CalculateCentroid(AABB const& aabb) noexcept -> Vector3 {
+  return (aabb.min + aabb.max) * 0.5f;
+}
+}
+
+
+auto Bvh::Build(std::span<AABB const> const prim_bounds) -> void {
+  Clear();
+
+  if (prim_bounds.empty()) {
+    return;
+  }
+
+  auto const prim_count{static_cast<unsigned>(prim_bounds.size())};
+
+  nodes_.resize(2 * prim_count - 1);
+  build_surface_areas_.resize(nodes_.size());
+  prim_indices_.resize(prim_count);
+
+  for (unsigned i{0}; i < prim_count; i++) {
+    prim_indices_[i] = i;
+  }
+
+  BuildSubtree(0, 0, prim_count, prim_bounds);
+}
+
+
+auto Bvh::Update(std::span<AABB const> const prim_bounds) -> void {
+  if (prim_bounds.size() != prim_indices_.size()) {
+    Build(prim_bounds);
+    return;
+  }
+
+  Refit(prim_bounds);
+
+  for (unsigned i{0}; i < static_cast<unsigned>(nodes_.size());) {
+    if (auto const& node{nodes_[i]}; node.prim_count > 1 && node.bounds.CalculateSurfaceArea() >
+                                     build_surface_areas_[i] * rebuild_surface_area_ratio_) {
+      auto const prim_count{node.prim_count};
+      BuildSubtree(i, node.first_prim_idx, prim_count, prim_bounds);
+      i += 2 * prim_count - 1;
+    } else {
+      // Continue with the first child, or the next subtree in case of leaves
+      i += 1;
+    }
+  }
+
+  // The rebuilt subtrees may have changed the bounds of their ancestors
+  Refit(prim_bounds);
+}
+
+
+auto Bvh::Refit(std::span<AABB const> const prim_bounds) -> void {
+  if (prim_bounds.size() != prim_indices_.size()) {
+    Build(prim_bounds);
+    return;
+  }
+
+  // Children always come after their parents, so a reverse sweep visits them first
+  for (auto i{std::ssize(nodes_) - 1}; i >= 0; i--) {
+    if (auto& node{nodes_[i]}; node.prim_count == 1) {
+      node.bounds = prim_bounds[prim_indices_[node.first_prim_idx]];
+    } else {
+      auto const& left_child{nodes_[i + 1]};
+      auto const& right_child{nodes_[i + 2 * left_child.prim_count]};
+      node.bounds = AABB::Union(left_child.bounds, right_child.bounds);
+    }
+  }
+}
+
+
+auto Bvh::Clear() noexcept -> void {
+  nodes_.clear();
+  prim_indices_.clear();
+  build_surface_areas_.clear();
+}
+
+
+auto Bvh::CullFrustum(Frustum const& frustum, std::pmr::vector<unsigned>& visible_prim_indices) const -> void {
+  for (unsigned i{0}; i < static_cast<unsigned>(nodes_.size());) {
+    auto const& node{nodes_[i]};
+    auto const subtree_node_count{2 * node.prim_count - 1};
+
+    if (!frustum.Intersects(node.bounds)) {
+      i += subtree_node_count;
+      continue;
+    }
+
+    if (node.prim_count == 1 || frustum.Contains(node.bounds)) {
+      visible_prim_indices.insert(visible_prim_indices.end(), prim_indices_.begin() + node.first_prim_idx,
+        prim_indices_.begin() + node.first_prim_idx + node.prim_count);
+      i += subtree_node_count;
+      continue;
+    }
+
+    i += 1;
+  }
+}
+
+
+auto Bvh::RaycastClosest(Ray const& ray) const -> std::optional<RaycastHit> {
+  std::optional<RaycastHit> closest_hit;
+
+  for (unsigned i{0}; i < static_cast<unsigned>(nodes_.size());) {
+    auto const& node{nodes_[i]};
+
+    if (auto const distance{node.bounds.Intersects(ray)}; !distance || (closest_hit && *distance >= closest_hit->
+                                                                          distance)) {
+      i += 2 * node.prim_count - 1;
+      continue;
+    } else if (node.prim_count == 1) {
+      closest_hit = RaycastHit{prim_indices_[node.first_prim_idx], *distance};
+    }
+
+    i += 1;
+  }
+
+  return closest_hit;
+}
+
+
+auto Bvh::GetPrimitiveCount() const noexcept -> unsigned {
+  return static_cast<unsigned>(prim_indices_.size());
+}
+
+
+auto Bvh::GetNodes() const noexcept -> std::span<Node const> {
+  return nodes_;
+}
+
+
+auto Bvh::Serialize() const -> YAML::Node {
+  YAML::Node ret;
+
+  YAML::Node prims_node;
+  prims_node.SetStyle(YAML::EmitterStyle::Flow);
+
+  for (auto const prim_idx : prim_indices_) {
+    prims_node.push_back(prim_idx);
+  }
+
+  ret["primitives"] = prims_node;
+
+  for (auto const& [bounds, first_prim_idx, prim_count] : nodes_) {
+    YAML::Node node_node;
+    node_node.SetStyle(YAML::EmitterStyle::Flow);
+    node_node.push_back(bounds.min);
+    node_node.push_back(bounds.max);
+    node_node.push_back(first_prim_idx);
+    node_node.push_back(prim_count);
+    ret["nodes"].push_back(node_node);
+  }
+
+  return ret;
+}
+
+
+auto Bvh::Deserialize(YAML::Node const& node) -> bool {
+  Clear();
+
+  try {
+    for (auto const& prim_node : node["primitives"]) {
+      prim_indices_.emplace_back(prim_node.as<unsigned>());
+    }
+
+    for (auto const& node_node : node["nodes"]) {
+      nodes_.emplace_back(AABB{node_node[0].as<Vector3>(), node_node[1].as<Vector3>()}, node_node[2].as<unsigned>(),
+        node_node[3].as<unsigned>());
+    }
+  } catch (...) {
+    Clear();
+    return false;
+  }
+
+  auto const prim_count{static_cast<unsigned>(prim_indices_.size())};
+
+  auto valid{prim_count == 0 ? nodes_.empty() : nodes_.size() == 2 * prim_count - 1};
+  valid = valid && std::ranges::all_of(prim_indices_, [prim_count](unsigned const prim_idx) {
+    return prim_idx < prim_count;
+  });
+
+  // Verify the depth-first layout so that traversal can't index out of bounds
+  for (std::size_t i{0}; valid && i < nodes_.size(); i++) {
+    auto const& node{nodes_[i]};
+    valid = node.prim_count > 0 && node.first_prim_idx + node.prim_count <= prim_count && i + 2 * node.prim_count - 1
+            <= nodes_.size();
+
+    if (valid && node.prim_count > 1) {
+      auto const& left_child{nodes_[i + 1]};
+      valid = left_child.first_prim_idx == node.first_prim_idx && left_child.prim_count < node.prim_count;
+
+      if (valid) {
+        auto const& right_child{nodes_[i + 2 * left_child.prim_count]};
+        valid = right_child.first_prim_idx == node.first_prim_idx + left_child.prim_count && left_child.prim_count +
+                right_child.prim_count == node.prim_count;
+      }
+    }
+  }
+
+  if (!valid) {
+    Clear();
+    return false;
+  }
+
+  build_surface_areas_.reserve(nodes_.size());
+  std::ranges::transform(nodes_, std::back_inserter(build_surface_areas_), [](Node const& bvh_node) {
+    return bvh_node.bounds.CalculateSurfaceArea();
+  });
+
+  return true;
+}
+
+
+auto Bvh::BuildSubtree(unsigned const node_idx, unsigned const first_prim_idx, unsigned const prim_count,
+                       std::span<AABB const> const prim_bounds) -> void {
+  struct BuildTask {
+    unsigned node_idx;
+    unsigned first_prim_idx;
+    unsigned prim_count;
+  };
+
+
+  struct Bin {
+    AABB bounds;
+    unsigned prim_count;
+  };
+
+
+  std::vector tasks{BuildTask{node_idx, first_prim_idx, prim_count}};
+
+  while (!tasks.empty()) {
+    auto const task{tasks.back()};
+    tasks.pop_back();
+
+    auto const prims{std::span{prim_indices_}.subspan(task.first_prim_idx, task.prim_count)};
+
+    auto bounds{kEmptyAabb};
+    auto centroid_bounds{kEmptyAabb};
+
+    for (auto const prim_idx : prims) {
+      bounds = AABB::Union(bounds, prim_bounds[prim_idx]);
+      auto const centroid{CalculateCentroid(prim_bounds[prim_idx])};
+      centroid_bounds = AABB::Union(centroid_bounds, AABB{centroid, centroid});
+    }
+
+    nodes_[task.node_idx] = Node{bounds, task.first_prim_idx, task.prim_count};
+    build_surface_areas_[task.node_idx] = bounds.CalculateSurfaceArea();
+
+    if (task.prim_count == 1) {
+      continue;
+    }
+
+    // Binned SAH split search over the primitive centroids
+
+    auto const calc_bin_idx{
+      [&centroid_bounds, &prim_bounds](unsigned const prim_idx, int const axis) {
+        auto const extent{centroid_bounds.max[axis] - centroid_bounds.min[axis]};
+        auto const rel_pos{(CalculateCentroid(prim_bounds[prim_idx])[axis] - centroid_bounds.min[axis]) / extent};
+        return std::clamp(static_cast<int>(rel_pos * sah_bin_count_), 0, sah_bin_count_ - 1);
+      }
+    };
+
+    auto best_cost{std::numeric_limits<float>::max()};
+    auto best_axis{-1};
+    auto best_last_left_bin_idx{0};
+
+    for (auto axis{0}; axis < 3; axis++) {
+      if (centroid_bounds.max[axis] <= centroid_bounds.min[axis]) {
+        continue;
+      }
+
+      std::array<Bin, sah_bin_count_> bins;
+      bins.fill(Bin{kEmptyAabb, 0});
+
+      for (auto const prim_idx : prims) {
+        auto& bin{bins[calc_bin_idx(prim_idx, axis)]};
+        bin.bounds = AABB::Union(bin.bounds, prim_bounds[prim_idx]);
+        bin.prim_count += 1;
+      }
+
+      // The first and last bins always contain the extremal centroids, so neither side of a split is ever empty
+
+      std::array<float, sah_bin_count_ - 1> left_costs{};
+      auto left_bounds{kEmptyAabb};
+      unsigned left_count{0};
+
+      for (auto i{0}; i < sah_bin_count_ - 1; i++) {
+        left_bounds = AABB::Union(left_bounds, bins[i].bounds);
+        left_count += bins[i].prim_count;
+        left_costs[i] = left_bounds.CalculateSurfaceArea() * static_cast<float>(left_count);
+      }
+
+      auto right_bounds{kEmptyAabb};
+      unsigned right_count{0};
+
+      for (auto i{sah_bin_count_ - 1}; i > 0; i--) {
+        right_bounds = AABB::Union(right_bounds, bins[i].bounds);
+        right_count += bins[i].prim_count;
+
+        if (auto const cost{left_costs[i - 1] + right_bounds.CalculateSurfaceArea() * static_cast<float>(right_count)};
+          cost < best_cost) {
+          best_cost = cost;
+          best_axis = axis;
+          best_last_left_bin_idx = i - 1;
+        }
+      }
+    }
+
+    unsigned left_prim_count;
+
+    if (best_axis < 0) {
+      // All centroids coincide, the split position is irrelevant
+      left_prim_count = task.prim_count / 2;
+    } else {
+      auto const right_begin{
+        std::partition(prims.begin(), prims.end(), [&calc_bin_idx, best_axis, best_last_left_bin_idx](
+        unsigned const prim_idx) {
+          return calc_bin_idx(prim_idx, best_axis) <= best_last_left_bin_idx;
+        })
+      };
+      left_prim_count = static_cast<unsigned>(right_begin - prims.begin());
+    }
+
+    tasks.emplace_back(task.node_idx + 1, task.first_prim_idx, left_prim_count);
+    tasks.emplace_back(task.node_idx + 2 * left_prim_count, task.first_prim_idx + left_prim_count,
+      task.prim_count - left_prim_count);
+  }
+}
+}
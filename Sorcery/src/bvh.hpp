@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Bounds.hpp"
+#include "Core.hpp"
+#include "Serialization.hpp"
+
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <vector>
+
+
+namespace sorcery {
+// Binary SAH bounding volume hierarchy over AABB primitives.
+// Every leaf holds exactly one primitive and the nodes are laid out in depth-first order,
+// so a subtree over n primitives always occupies exactly 2n - 1 consecutive nodes.
+// This allows stackless traversal and rebuilding subtrees in place.
+class Bvh {
+public:
+  struct Node {
+    AABB bounds;
+    unsigned first_prim_idx; // Index into the primitive index array
+    unsigned prim_count;     // Number of primitives in the subtree, 1 for leaves
+  };
+
+
+  struct RaycastHit {
+    unsigned prim_idx;
+    float distance;
+  };
+
+
+  // Builds the hierarchy from scratch over the passed primitive bounds
+  LEOPPHAPI auto Build(std::span<AABB const> prim_bounds) -> void;
+
+  // Refits the hierarchy to the new primitive bounds, then rebuilds all subtrees whose
+  // surface area grew too much compared to the time of their construction.
+  // The primitive count must match the one the hierarchy was built with.
+  LEOPPHAPI auto Update(std::span<AABB const> prim_bounds) -> void;
+
+  // Refits the bounds of all nodes to the new primitive bounds without changing the topology
+  LEOPPHAPI auto Refit(std::span<AABB const> prim_bounds) -> void;
+
+  LEOPPHAPI auto Clear() noexcept -> void;
+
+  // Appends the indices of the primitives intersecting the frustum.
+  // Nodes fully inside the frustum are accepted without testing their descendants.
+  LEOPPHAPI auto CullFrustum(Frustum const& frustum, std::pmr::vector<unsigned>& visible_prim_indices) const -> void;
+
+  // Returns the primitive whose bounds the ray enters first
+  [[nodiscard]] LEOPPHAPI auto RaycastClosest(Ray const& ray) const -> std::optional<RaycastHit>;
+
+  [[nodiscard]] LEOPPHAPI auto GetPrimitiveCount() const noexcept -> unsigned;
+  [[nodiscard]] LEOPPHAPI auto GetNodes() const noexcept -> std::span<Node const>;
+
+  [[nodiscard]] LEOPPHAPI auto Serialize() const -> YAML::Node;
+  // Returns false and leaves the hierarchy empty if the node is not a valid serialized hierarchy
+  LEOPPHAPI auto Deserialize(YAML::Node const& node) -> bool;
+
+private:
+  auto BuildSubtree(unsigned node_idx, unsigned first_prim_idx, unsigned prim_count,
+                    std::span<AABB const> prim_bounds) -> void;
+
+  constexpr static int sah_bin_count_{12};
+  // Subtrees whose surface area grows beyond this factor of their build-time surface area get rebuilt
+  constexpr static float rebuild_surface_area_ratio_{2.0f};
+
+  std::vector<Node> nodes_;
+  std::vector<unsigned> prim_indices_;
+  std::vector<float> build_surface_areas_;
+};
+}
@@ -0,0 +1,440 @@
+#include "pose_evaluator.hpp"
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <iterator>
+#include <optional>
+#include <thread>
+
+
+namespace sorcery {
+namespace {
+// Quaternions of 8 nodes, one component per register
+struct QuaternionBatch {
+  __m256 x;
+  __m256 y;
+  __m256 z;
+  __m256 w;
+};
+
+
+[[nodiscard]] auto LoadRotations(LocalPose const& pose, std::size_t const first_node_idx) noexcept -> QuaternionBatch {
+  return QuaternionBatch{
+    _mm256_loadu_ps(pose.rot_x.data() + first_node_idx), _mm256_loadu_ps(pose.rot_y.data() + first_node_idx),
+    _mm256_loadu_ps(pose.rot_z.data() + first_node_idx), _mm256_loadu_ps(pose.rot_w.data() + first_node_idx)
+  };
+}
+
+
+auto StoreRotations(QuaternionBatch const& rot, std::size_t const first_node_idx, LocalPose& pose) noexcept -> void {
+  _mm256_storeu_ps(pose.rot_x.data() + first_node_idx, rot.x);
+  _mm256_storeu_ps(pose.rot_y.data() + first_node_idx, rot.y);
+  _mm256_storeu_ps(pose.rot_z.data() + first_node_idx, rot.z);
+  _mm256_storeu_ps(pose.rot_w.data() + first_node_idx, rot.w);
+}
+
+
+[[nodiscard]] auto Dot(QuaternionBatch const& left, QuaternionBatch const& right) noexcept -> __m256 {
+  auto dot{_mm256_mul_ps(left.x, right.x)};
+  dot = _mm256_fmadd_ps(left.y, right.y, dot);
+  dot = _mm256_fmadd_ps(left.z, right.z, dot);
+  return _mm256_fmadd_ps(left.w, right.w, dot);
+}
+
+
+// Hamilton product
+[[nodiscard]] auto Multiply(QuaternionBatch const& left, QuaternionBatch const& right) noexcept -> QuaternionBatch {
+  auto x{_mm256_mul_ps(left.w, right.x)};
+  x = _mm256_fmadd_ps(left.x, right.w, x);
+  x = _mm256_fmadd_ps(left.y, right.z, x);
+  x = _mm256_fnmadd_ps(left.z, right.y, x);
+
+  auto y{_mm256_mul_ps(left.w, right.y)};
+  y = _mm256_fnmadd_ps(left.x, right.z, y);
+  y = _mm256_fmadd_ps(left.y, right.w, y);
+  y = _mm256_fmadd_ps(left.z, right.x, y);
+
+  auto z{_mm256_mul_ps(left.w, right.z)};
+  z = _mm256_fmadd_ps(left.x, right.y, z);
+  z = _mm256_fnmadd_ps(left.y, right.x, z);
+  z = _mm256_fmadd_ps(left.z, right.w, z);
+
+  auto w{_mm256_mul_ps(left.w, right.w)};
+  w = _mm256_fnmadd_ps(left.x, right.x, w);
+  w = _mm256_fnmadd_ps(left.y, right.y, w);
+  w = _mm256_fnmadd_ps(left.z, right.z, w);
+
+  return QuaternionBatch{x, y, z, w};
+}
+
+
+// Normalized linear interpolation along the shorter arc
+[[nodiscard]] auto Nlerp(QuaternionBatch const& from, QuaternionBatch to, __m256 const amount) noexcept ->
+  QuaternionBatch {
+  // Flipping the sign of the target where the quaternions are in opposite hemispheres
+  auto const sign{_mm256_and_ps(Dot(from, to), _mm256_set1_ps(-0.0f))};
+  to = QuaternionBatch{
+    _mm256_xor_ps(to.x, sign), _mm256_xor_ps(to.y, sign), _mm256_xor_ps(to.z, sign), _mm256_xor_ps(to.w, sign)
+  };
+
+  QuaternionBatch const ret{
+    _mm256_fmadd_ps(amount, _mm256_sub_ps(to.x, from.x), from.x),
+    _mm256_fmadd_ps(amount, _mm256_sub_ps(to.y, from.y), from.y),
+    _mm256_fmadd_ps(amount, _mm256_sub_ps(to.z, from.z), from.z),
+    _mm256_fmadd_ps(amount, _mm256_sub_ps(to.w, from.w), from.w)
+  };
+
+  auto const inv_norm{_mm256_div_ps(_mm256_set1_ps(1), _mm256_sqrt_ps(Dot(ret, ret)))};
+  return QuaternionBatch{
+    _mm256_mul_ps(ret.x, inv_norm), _mm256_mul_ps(ret.y, inv_norm), _mm256_mul_ps(ret.z, inv_norm),
+    _mm256_mul_ps(ret.w, inv_norm)
+  };
+}
+
+
+auto LerpComponent(std::vector<float> const& to, __m256 const amount, std::size_t const first_node_idx,
+                   std::vector<float>& from) noexcept -> void {
+  auto const from_value{_mm256_loadu_ps(from.data() + first_node_idx)};
+  auto const to_value{_mm256_loadu_ps(to.data() + first_node_idx)};
+  _mm256_storeu_ps(from.data() + first_node_idx,
+    _mm256_fmadd_ps(amount, _mm256_sub_ps(to_value, from_value), from_value));
+}
+}
+
+
+auto PoseEvaluator::Evaluate(std::span<Instance const> const instances, JobSystem& job_system) -> void {
+  auto const job_count{
+    std::min<std::size_t>((instances.size() + min_job_instance_count_ - 1) / min_job_instance_count_,
+      std::max(std::jthread::hardware_concurrency(), 1u))
+  };
+
+  // Workspaces are kept between calls so that their storage is reused
+  if (workspaces_.size() < job_count) {
+    workspaces_.resize(job_count);
+  }
+
+  if (job_count <= 1) {
+    for (auto const& instance : instances) {
+      EvaluateInstance(instance, workspaces_.front());
+    }
+
+    return;
+  }
+
+  jobs_.clear();
+
+  for (std::size_t i{0}; i < job_count; i++) {
+    jobs_.emplace_back(job_system.CreateJob([this, instances, i, job_count] {
+      for (auto j{i * instances.size() / job_count}; j < (i + 1) * instances.size() / job_count; j++) {
+        EvaluateInstance(instances[j], workspaces_[i]);
+      }
+    }));
+    job_system.Run(jobs_.back());
+  }
+
+  for (auto const job : jobs_) {
+    job_system.Wait(job);
+  }
+}
+
+
+auto PoseEvaluator::EvaluateInstance(Instance const& instance, Workspace& workspace) -> void {
+  if (instance.history.empty()) {
+    EvaluatePalette(instance, workspace, instance.palette);
+    return;
+  }
+
+  auto const bone_count{instance.bones.size()};
+  auto const prev_palette{instance.history.first(bone_count)};
+  auto const last_palette{instance.history.subspan(bone_count, bone_count)};
+
+  if (instance.update) {
+    // Instances updated at a reduced rate interpolate from the palette of the previous update
+    if (instance.history_blend < 1) {
+      std::ranges::copy(last_palette, std::begin(prev_palette));
+    }
+
+    EvaluatePalette(instance, workspace, last_palette);
+  }
+
+  InterpolatePalettes(prev_palette, last_palette, instance.history_blend, instance.palette);
+}
+
+
+auto PoseEvaluator::EvaluatePalette(Instance const& instance, Workspace& workspace,
+                                    std::span<Matrix4> const palette) -> void {
+  auto& [pose, layer_pose, reference_pose, node_weights, node_transforms, node_depths, bone_bounds]{workspace};
+
+  // Nodes that no layer animates keep their bind transforms
+  pose = *instance.bind_pose;
+
+  auto const sampled_node_count{
+    CalculateSampledNodeCount(instance.skeleton, instance.skipped_skeleton_level_count, node_depths)
+  };
+
+  for (auto const& layer : instance.layers) {
+    if (layer.weight <= 0) {
+      continue;
+    }
+
+    // A fully weighted override of all nodes needs no blending, the clip is sampled straight into the pose
+    if (layer.blend_mode == AnimationBlendMode::Override && layer.weight >= 1 && layer.node_mask.empty()) {
+      layer.sampler->Sample(*layer.animation, layer.time, sampled_node_count, pose);
+      continue;
+    }
+
+    CalculateNodeWeights(layer, pose, node_weights);
+
+    if (layer.blend_mode == AnimationBlendMode::Override) {
+      // Nodes that the clip does not animate are blended with themselves
+      layer_pose = pose;
+      layer.sampler->Sample(*layer.animation, layer.time, sampled_node_count, layer_pose);
+      BlendOverride(layer_pose, node_weights, pose);
+    } else {
+      // Nodes that the clip does not animate are the same in both poses, so their difference is the identity
+      layer_pose = *instance.bind_pose;
+      reference_pose = *instance.bind_pose;
+      layer.sampler->Sample(*layer.animation, layer.time, sampled_node_count, layer_pose);
+      AnimationSampler::SampleFirstKeys(*layer.animation, sampled_node_count, reference_pose);
+      BlendAdditive(layer_pose, reference_pose, node_weights, pose);
+    }
+  }
+
+  node_transforms.resize(instance.skeleton.size());
+  BuildLocalMatrices(pose, node_transforms);
+
+  for (std::size_t i{0}; i < node_transforms.size(); i++) {
+    if (auto const& parent_idx{instance.skeleton[i].parent_idx}) {
+      MultiplyMatrices(node_transforms[i], node_transforms[*parent_idx], node_transforms[i]);
+    }
+  }
+
+  bone_bounds.assign(instance.bones.size(), std::nullopt);
+  std::optional<AABB> bounds;
+
+  for (std::size_t i{0}; i < instance.bones.size(); i++) {
+    auto const& [offset_mtx, skeleton_node_idx, bind_bone_bounds]{instance.bones[i]};
+    MultiplyMatrices(offset_mtx, node_transforms[skeleton_node_idx], palette[i]);
+
+    // Skinned vertices are convex combinations of their transforms by the bones they are weighted to
+    if (bind_bone_bounds.min[0] <= bind_bone_bounds.max[0]) {
+      bone_bounds[i] = bind_bone_bounds.Transform(node_transforms[skeleton_node_idx]);
+      bounds = bounds ? AABB::Union(*bounds, *bone_bounds[i]) : *bone_bounds[i];
+    }
+  }
+
+  if (bounds && instance.bounds) {
+    *instance.bounds = *bounds;
+  }
+
+  for (std::size_t i{0}; i < instance.submesh_bounds.size() && i < instance.submesh_bones.size(); i++) {
+    std::optional<AABB> submesh_bounds;
+
+    for (auto const bone_idx : instance.submesh_bones[i]) {
+      if (bone_idx < bone_bounds.size() && bone_bounds[bone_idx]) {
+        submesh_bounds = submesh_bounds ? AABB::Union(*submesh_bounds, *bone_bounds[bone_idx]) : bone_bounds[bone_idx];
+      }
+    }
+
+    if (submesh_bounds) {
+      instance.submesh_bounds[i] = *submesh_bounds;
+    }
+  }
+}
+
+
+auto PoseEvaluator::CalculateSampledNodeCount(std::span<SkeletonNode const> const skeleton,
+                                              unsigned const skipped_level_count,
+                                              std::vector<unsigned>& node_depths) -> std::size_t {
+  if (skipped_level_count == 0) {
+    return skeleton.size();
+  }
+
+  node_depths.resize(skeleton.size());
+  unsigned max_depth{0};
+
+  for (std::size_t i{0}; i < skeleton.size(); i++) {
+    node_depths[i] = skeleton[i].parent_idx ? node_depths[*skeleton[i].parent_idx] + 1 : 0;
+    max_depth = std::max(max_depth, node_depths[i]);
+  }
+
+  // The root level is always sampled
+  auto const max_sampled_depth{max_depth > skipped_level_count ? max_depth - skipped_level_count : 0};
+
+  // Imported skeletons are in breadth first order, so the sampled levels form a prefix.
+  // For other orders this is a smaller prefix that still contains the parents of its nodes.
+  return static_cast<std::size_t>(std::distance(std::begin(node_depths),
+    std::ranges::find_if(node_depths, [max_sampled_depth](unsigned const depth) {
+      return depth > max_sampled_depth;
+    })));
+}
+
+
+auto PoseEvaluator::InterpolatePalettes(std::span<Matrix4 const> const from, std::span<Matrix4 const> const to,
+                                        float const amount, std::span<Matrix4> const palette) noexcept -> void {
+  if (amount >= 1) {
+    std::ranges::copy(to, std::begin(palette));
+    return;
+  }
+
+  // Linear interpolation of the matrices interpolates the skinned vertices linearly, which is close enough between
+  // updates that are a few frames apart
+  auto const amount_vec{_mm256_set1_ps(amount)};
+
+  for (std::size_t i{0}; i < palette.size(); i++) {
+    for (auto j{0}; j < 16; j += 8) {
+      auto const from_vec{_mm256_loadu_ps(from[i].GetData() + j)};
+      auto const to_vec{_mm256_loadu_ps(to[i].GetData() + j)};
+      _mm256_storeu_ps(palette[i].GetData() + j, _mm256_fmadd_ps(amount_vec, _mm256_sub_ps(to_vec, from_vec),
+        from_vec));
+    }
+  }
+}
+
+
+auto PoseEvaluator::CalculateNodeWeights(Layer const& layer, LocalPose const& pose,
+                                         std::vector<float>& node_weights) -> void {
+  // The padding gets no weight so that it stays the identity
+  node_weights.assign(pose.pos_x.size(), 0);
+
+  if (layer.node_mask.empty()) {
+    std::fill_n(std::begin(node_weights), pose.size, layer.weight);
+    return;
+  }
+
+  // Nodes past the end of the mask are not affected
+  for (std::size_t i{0}; i < std::min(pose.size, layer.node_mask.size()); i++) {
+    node_weights[i] = layer.weight * layer.node_mask[i];
+  }
+}
+
+
+auto PoseEvaluator::BlendOverride(LocalPose const& layer_pose, std::span<float const> const node_weights,
+                                  LocalPose& pose) noexcept -> void {
+  for (std::size_t batch_begin{0}; batch_begin < pose.pos_x.size(); batch_begin += LocalPose::batch_size) {
+    auto const weight{_mm256_loadu_ps(node_weights.data() + batch_begin)};
+
+    LerpComponent(layer_pose.pos_x, weight, batch_begin, pose.pos_x);
+    LerpComponent(layer_pose.pos_y, weight, batch_begin, pose.pos_y);
+    LerpComponent(layer_pose.pos_z, weight, batch_begin, pose.pos_z);
+    LerpComponent(layer_pose.scale_x, weight, batch_begin, pose.scale_x);
+    LerpComponent(layer_pose.scale_y, weight, batch_begin, pose.scale_y);
+    LerpComponent(layer_pose.scale_z, weight, batch_begin, pose.scale_z);
+
+    StoreRotations(Nlerp(LoadRotations(pose, batch_begin), LoadRotations(layer_pose, batch_begin), weight),
+      batch_begin, pose);
+  }
+}
+
+
+auto PoseEvaluator::BlendAdditive(LocalPose const& layer_pose, LocalPose const& reference_pose,
+                                  std::span<float const> const node_weights, LocalPose& pose) noexcept -> void {
+  auto const zero{_mm256_setzero_ps()};
+  auto const one{_mm256_set1_ps(1)};
+
+  for (std::size_t batch_begin{0}; batch_begin < pose.pos_x.size(); batch_begin += LocalPose::batch_size) {
+    auto const weight{_mm256_loadu_ps(node_weights.data() + batch_begin)};
+
+    // pos += weight * (layer - reference)
+    for (auto const member : {&LocalPose::pos_x, &LocalPose::pos_y, &LocalPose::pos_z}) {
+      auto const delta{
+        _mm256_sub_ps(_mm256_loadu_ps((layer_pose.*member).data() + batch_begin),
+          _mm256_loadu_ps((reference_pose.*member).data() + batch_begin))
+      };
+      auto* const dst{(pose.*member).data() + batch_begin};
+      _mm256_storeu_ps(dst, _mm256_fmadd_ps(weight, delta, _mm256_loadu_ps(dst)));
+    }
+
+    // scale *= lerp(1, layer / reference, weight), a zero reference scale contributes nothing
+    for (auto const member : {&LocalPose::scale_x, &LocalPose::scale_y, &LocalPose::scale_z}) {
+      auto const reference{_mm256_loadu_ps((reference_pose.*member).data() + batch_begin)};
+      auto const valid{_mm256_cmp_ps(reference, zero, _CMP_NEQ_OQ)};
+      auto const ratio{
+        _mm256_blendv_ps(one, _mm256_div_ps(_mm256_loadu_ps((layer_pose.*member).data() + batch_begin), reference),
+          valid)
+      };
+      auto* const dst{(pose.*member).data() + batch_begin};
+      _mm256_storeu_ps(dst, _mm256_mul_ps(_mm256_loadu_ps(dst), _mm256_fmadd_ps(weight, _mm256_sub_ps(ratio, one),
+        one)));
+    }
+
+    // rot = rot * nlerp(identity, conjugate(reference) * layer, weight)
+    auto reference_rot{LoadRotations(reference_pose, batch_begin)};
+    auto const sign_bit{_mm256_set1_ps(-0.0f)};
+    reference_rot.x = _mm256_xor_ps(reference_rot.x, sign_bit);
+    reference_rot.y = _mm256_xor_ps(reference_rot.y, sign_bit);
+    reference_rot.z = _mm256_xor_ps(reference_rot.z, sign_bit);
+
+    auto const delta_rot{Multiply(reference_rot, LoadRotations(layer_pose, batch_begin))};
+    auto const weighted_delta_rot{Nlerp(QuaternionBatch{zero, zero, zero, one}, delta_rot, weight)};
+    StoreRotations(Multiply(LoadRotations(pose, batch_begin), weighted_delta_rot), batch_begin, pose);
+  }
+}
+
+
+auto PoseEvaluator::BuildLocalMatrices(LocalPose const& pose, std::span<Matrix4> const node_transforms) noexcept ->
+  void {
+  auto const one{_mm256_set1_ps(1)};
+  auto const two{_mm256_set1_ps(2)};
+
+  for (std::size_t batch_begin{0}; batch_begin < node_transforms.size(); batch_begin += LocalPose::batch_size) {
+    auto const [x, y, z, w]{LoadRotations(pose, batch_begin)};
+
+    auto const xx{_mm256_mul_ps(x, x)};
+    auto const yy{_mm256_mul_ps(y, y)};
+    auto const zz{_mm256_mul_ps(z, z)};
+    auto const xy{_mm256_mul_ps(x, y)};
+    auto const xz{_mm256_mul_ps(x, z)};
+    auto const yz{_mm256_mul_ps(y, z)};
+    auto const xw{_mm256_mul_ps(x, w)};
+    auto const yw{_mm256_mul_ps(y, w)};
+    auto const zw{_mm256_mul_ps(z, w)};
+
+    auto const sx{_mm256_loadu_ps(pose.scale_x.data() + batch_begin)};
+    auto const sy{_mm256_loadu_ps(pose.scale_y.data() + batch_begin)};
+    auto const sz{_mm256_loadu_ps(pose.scale_z.data() + batch_begin)};
+
+    // Scale * Rotation, the rows of the rotation matrix are scaled by the matching scale component.
+    // The translation only ends up in the last row.
+    alignas(32) float rows[9][LocalPose::batch_size];
+    _mm256_store_ps(rows[0], _mm256_mul_ps(sx, _mm256_fnmadd_ps(two, _mm256_add_ps(yy, zz), one)));
+    _mm256_store_ps(rows[1], _mm256_mul_ps(sx, _mm256_mul_ps(two, _mm256_add_ps(xy, zw))));
+    _mm256_store_ps(rows[2], _mm256_mul_ps(sx, _mm256_mul_ps(two, _mm256_sub_ps(xz, yw))));
+    _mm256_store_ps(rows[3], _mm256_mul_ps(sy, _mm256_mul_ps(two, _mm256_sub_ps(xy, zw))));
+    _mm256_store_ps(rows[4], _mm256_mul_ps(sy, _mm256_fnmadd_ps(two, _mm256_add_ps(xx, zz), one)));
+    _mm256_store_ps(rows[5], _mm256_mul_ps(sy, _mm256_mul_ps(two, _mm256_add_ps(yz, xw))));
+    _mm256_store_ps(rows[6], _mm256_mul_ps(sz, _mm256_mul_ps(two, _mm256_add_ps(xz, yw))));
+    _mm256_store_ps(rows[7], _mm256_mul_ps(sz, _mm256_mul_ps(two, _mm256_sub_ps(yz, xw))));
+    _mm256_store_ps(rows[8], _mm256_mul_ps(sz, _mm256_fnmadd_ps(two, _mm256_add_ps(xx, yy), one)));
+
+    for (std::size_t lane{0}; lane < std::min(LocalPose::batch_size, node_transforms.size() - batch_begin); lane++) {
+      auto const node_idx{batch_begin + lane};
+      node_transforms[node_idx] = Matrix4{
+        rows[0][lane], rows[1][lane], rows[2][lane], 0,
+        rows[3][lane], rows[4][lane], rows[5][lane], 0,
+        rows[6][lane], rows[7][lane], rows[8][lane], 0,
+        pose.pos_x[node_idx], pose.pos_y[node_idx], pose.pos_z[node_idx], 1
+      };
+    }
+  }
+}
+
+
+auto PoseEvaluator::MultiplyMatrices(Matrix4 const& left, Matrix4 const& right, Matrix4& out) noexcept -> void {
+  auto const right_row0{_mm_loadu_ps(right[0].GetData())};
+  auto const right_row1{_mm_loadu_ps(right[1].GetData())};
+  auto const right_row2{_mm_loadu_ps(right[2].GetData())};
+  auto const right_row3{_mm_loadu_ps(right[3].GetData())};
+
+  // Each row of the result is the matching row of left transformed by right.
+  // A row of left is fully read before the same row of the result is written.
+  for (int i{0}; i < 4; i++) {
+    auto row{_mm_mul_ps(_mm_set1_ps(left[i][0]), right_row0)};
+    row = _mm_fmadd_ps(_mm_set1_ps(left[i][1]), right_row1, row);
+    row = _mm_fmadd_ps(_mm_set1_ps(left[i][2]), right_row2, row);
+    row = _mm_fmadd_ps(_mm_set1_ps(left[i][3]), right_row3, row);
+    _mm_storeu_ps(out[i].GetData(), row);
+  }
+}
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "animation.hpp"
+#include "animation_sampler.hpp"
+#include "Bounds.hpp"
+#include "Core.hpp"
+#include "job_system.hpp"
+#include "Math.hpp"
+#include "observer_ptr.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+
+namespace sorcery {
+// Evaluates the bone palettes of animated skeleton instances in parallel jobs.
+// The layers of an instance are sampled and blended in structure of arrays poses in AVX batches,
+// then the node transforms are accumulated through the hierarchy and combined with the bone offsets.
+// Has no dependency on the graphics device, so it can be used headless.
+class PoseEvaluator {
+public:
+  struct Layer {
+    Animation const* animation;
+    float time; // In ticks
+    float weight;
+    AnimationBlendMode blend_mode;
+    std::span<float const> node_mask; // Empty affects all nodes fully
+    AnimationSampler* sampler;
+  };
+
+
+  struct Instance {
+    std::span<Layer const> layers; // Blended in order onto the bind pose
+    std::span<SkeletonNode const> skeleton; // Parents must precede their children
+    LocalPose const* bind_pose;
+    std::span<Bone const> bones;
+    // The deepest levels of the skeleton keep their bind transforms instead of being sampled
+    unsigned skipped_skeleton_level_count;
+    // Either empty, or the palette evaluated before the last update followed by the palette of the last update.
+    // Kept by the owner across frames so that the instance can be updated at a reduced rate.
+    std::span<Matrix4> history;
+    // Instances with a history can skip sampling, then their palette is written from the history only
+    bool update;
+    // Amount of the last update blended over the one before it when writing the palette from the history
+    float history_blend;
+    // Receives one matrix per bone. It is only written sequentially, so it can point to write-combined memory.
+    std::span<Matrix4> palette;
+    // Receives the union of the bone bounds transformed by the pose, which contains all skinned vertices.
+    // Only written on updates, and left untouched if no bone has vertices.
+    AABB* bounds;
+    // Indices of the bones the vertices of each submesh are weighted to, or empty if only the bounds of the whole
+    // instance are needed
+    std::span<std::vector<std::uint32_t> const> submesh_bones;
+    // Receives the union of the bounds of the bones of each submesh, written like the bounds of the whole instance
+    std::span<AABB> submesh_bounds;
+  };
+
+
+  // Instances must not share samplers or palettes
+  LEOPPHAPI auto Evaluate(std::span<Instance const> instances, JobSystem& job_system) -> void;
+
+private:
+  // Pose buffers of a job, reused across instances and frames
+  struct Workspace {
+    LocalPose pose;
+    LocalPose layer_pose;
+    LocalPose reference_pose;
+    std::vector<float> node_weights;
+    std::vector<Matrix4> node_transforms;
+    std::vector<unsigned> node_depths;
+    std::vector<std::optional<AABB>> bone_bounds; // Transformed by the pose, empty for bones without vertices
+  };
+
+
+  static auto EvaluateInstance(Instance const& instance, Workspace& workspace) -> void;
+  static auto EvaluatePalette(Instance const& instance, Workspace& workspace, std::span<Matrix4> palette) -> void;
+  // Returns the number of leading skeleton nodes that are sampled, the rest keep their bind transforms
+  [[nodiscard]] static auto CalculateSampledNodeCount(std::span<SkeletonNode const> skeleton,
+                                                      unsigned skipped_level_count,
+                                                      std::vector<unsigned>& node_depths) -> std::size_t;
+  static auto InterpolatePalettes(std::span<Matrix4 const> from, std::span<Matrix4 const> to, float amount,
+                                  std::span<Matrix4> palette) noexcept -> void;
+  static auto CalculateNodeWeights(Layer const& layer, LocalPose const& pose,
+                                   std::vector<float>& node_weights) -> void;
+  // Interpolates the nodes of the pose towards the layer pose
+  static auto BlendOverride(LocalPose const& layer_pose, std::span<float const> node_weights,
+                            LocalPose& pose) noexcept -> void;
+  // Adds the difference of the layer pose from the reference pose to the nodes of the pose
+  static auto BlendAdditive(LocalPose const& layer_pose, LocalPose const& reference_pose,
+                            std::span<float const> node_weights, LocalPose& pose) noexcept -> void;
+  static auto BuildLocalMatrices(LocalPose const& pose, std::span<Matrix4> node_transforms) noexcept -> void;
+  // Row vector convention, out may be the same as left but not right
+  static auto MultiplyMatrices(Matrix4 const& left, Matrix4 const& right, Matrix4& out) noexcept -> void;
+
+  constexpr static std::size_t min_job_instance_count_{8};
+
+  std::vector<Workspace> workspaces_;
+  std::vector<ObserverPtr<Job>> jobs_;
+};
+}
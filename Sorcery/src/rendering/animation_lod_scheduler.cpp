@@ -0,0 +1,89 @@
+#include "animation_lod_scheduler.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+
+namespace sorcery::rendering {
+auto AnimationLodScheduler::CalculateScreenHeight(AABB const& bounds_ws,
+                                                  std::span<View const> const views) noexcept -> std::optional<float> {
+  auto const center{(bounds_ws.min + bounds_ws.max) / 2};
+  auto const diameter{Distance(bounds_ws.min, bounds_ws.max)};
+
+  std::optional<float> screen_height;
+
+  for (auto const& [frustum_ws, position, screen_height_scale, perspective] : views) {
+    if (frustum_ws.Intersects(bounds_ws)) {
+      screen_height = std::max(screen_height.value_or(0.0f), perspective
+                                                               ? diameter * screen_height_scale / std::max(
+                                                                   Distance(position, center), diameter / 2)
+                                                               : diameter * screen_height_scale);
+    }
+  }
+
+  return screen_height;
+}
+
+
+auto AnimationLodScheduler::SelectLod(std::span<AnimationLod const> const lods,
+                                      float const screen_height) noexcept -> AnimationLod const& {
+  return *std::ranges::find_if(std::begin(lods), std::prev(std::end(lods)),
+    [screen_height](AnimationLod const& candidate) {
+      return screen_height >= candidate.min_screen_height;
+    });
+}
+
+
+auto AnimationLodScheduler::IsUpdateDue(bool const evaluated, bool const paused, std::uint64_t const last_update_frame,
+                                        unsigned const update_interval,
+                                        std::uint64_t const frame_count) noexcept -> bool {
+  return !evaluated || (!paused && frame_count - last_update_frame >= update_interval);
+}
+
+
+auto AnimationLodScheduler::CalculateHistoryBlend(std::uint64_t const last_update_frame, unsigned const update_interval,
+                                                  std::uint64_t const frame_count) noexcept -> float {
+  return std::min(static_cast<float>(frame_count - last_update_frame + 1) / static_cast<float>(update_interval),
+    1.0f);
+}
+
+
+auto AnimationLodScheduler::ApplyBudget(std::span<Instance> const instances, unsigned const budget,
+                                        std::uint64_t const frame_count) -> void {
+  tmp_deferrable_indices_.clear();
+  unsigned required_update_count{0};
+
+  for (unsigned i{0}; i < static_cast<unsigned>(instances.size()); i++) {
+    if (auto const& instance{instances[i]}; instance.update) {
+      if (instance.evaluated) {
+        tmp_deferrable_indices_.emplace_back(i);
+      } else {
+        required_update_count += 1;
+      }
+    }
+  }
+
+  if (required_update_count + tmp_deferrable_indices_.size() <= budget) {
+    return;
+  }
+
+  auto const kept_count{budget > required_update_count ? budget - required_update_count : 0};
+
+  std::ranges::nth_element(tmp_deferrable_indices_, std::begin(tmp_deferrable_indices_) + kept_count,
+    [instances, frame_count](unsigned const lhs_idx, unsigned const rhs_idx) {
+      auto const& lhs{instances[lhs_idx]};
+      auto const& rhs{instances[rhs_idx]};
+      auto const lhs_overdue{
+        static_cast<float>(frame_count - lhs.last_update_frame) / static_cast<float>(lhs.update_interval)
+      };
+      auto const rhs_overdue{
+        static_cast<float>(frame_count - rhs.last_update_frame) / static_cast<float>(rhs.update_interval)
+      };
+      return lhs_overdue != rhs_overdue ? lhs_overdue > rhs_overdue : lhs.screen_height > rhs.screen_height;
+    });
+
+  for (auto const idx : std::span{tmp_deferrable_indices_}.subspan(kept_count)) {
+    instances[idx].update = false;
+  }
+}
+}
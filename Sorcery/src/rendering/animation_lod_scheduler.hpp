@@ -0,0 +1,72 @@
+#pragma once
+
+#include "../Bounds.hpp"
+#include "../Core.hpp"
+#include "../Math.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+
+namespace sorcery::rendering {
+// Detail of the animation of a skinned instance when it covers a part of the screen
+struct AnimationLod {
+  // Fraction of the viewport height the bounds have to cover in any camera for the level to be used
+  float min_screen_height;
+  // The pose is evaluated every this many frames and interpolated in between
+  unsigned update_interval;
+  // The deepest levels of the skeleton keep their bind transforms
+  unsigned skipped_skeleton_level_count;
+};
+
+
+// Selects the animation detail of skinned instances against the cameras and decides which poses are updated in a
+// frame, deferring the updates over the budget.
+// Has no dependency on the graphics device, so it can be used headless.
+class AnimationLodScheduler {
+public:
+  // Camera data needed to select the animation detail
+  struct View {
+    Frustum frustum_ws;
+    Vector3 position;
+    float screen_height_scale; // Maps diameter over distance, or just diameter for orthographic cameras, to height
+    bool perspective;
+  };
+
+
+  // Update state of a skinned instance in the current frame
+  struct Instance {
+    std::uint64_t last_update_frame;
+    unsigned update_interval; // Of the selected detail
+    float screen_height; // Largest fraction of a viewport height covered by the bounds
+    bool evaluated; // Instances without a pose are never deferred
+    bool update;
+  };
+
+
+  // Returns the largest fraction of a viewport height the bounds cover in the views they are visible in,
+  // or nullopt if they are outside of all of them
+  [[nodiscard]] LEOPPHAPI static auto CalculateScreenHeight(AABB const& bounds_ws,
+                                                            std::span<View const> views) noexcept ->
+    std::optional<float>;
+  // Returns the first level whose minimum screen height is reached, or the last one. There must be at least one level.
+  [[nodiscard]] LEOPPHAPI static auto SelectLod(std::span<AnimationLod const> lods,
+                                                float screen_height) noexcept -> AnimationLod const&;
+  // Paused instances keep their pose, unless they have none yet
+  [[nodiscard]] LEOPPHAPI static auto IsUpdateDue(bool evaluated, bool paused, std::uint64_t last_update_frame,
+                                                  unsigned update_interval, std::uint64_t frame_count) noexcept -> bool;
+  // Amount of the last update shown in the frame, the pose is interpolated from the update before it until this
+  // reaches 1 at the end of the interval
+  [[nodiscard]] LEOPPHAPI static auto CalculateHistoryBlend(std::uint64_t last_update_frame, unsigned update_interval,
+                                                            std::uint64_t frame_count) noexcept -> float;
+
+  // Clears the update flag of the instances over the budget. The ones most overdue relative to their interval and
+  // the ones largest on screen keep it. Instances without a pose count against the budget but are never deferred.
+  LEOPPHAPI auto ApplyBudget(std::span<Instance> instances, unsigned budget, std::uint64_t frame_count) -> void;
+
+private:
+  std::vector<unsigned> tmp_deferrable_indices_;
+};
+}
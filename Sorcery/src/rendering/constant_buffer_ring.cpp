@@ -0,0 +1,54 @@
+#include "constant_buffer_ring.hpp"
+
+#include "render_manager.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+
+namespace sorcery::rendering {
+ConstantBufferRing::ConstantBufferRing(graphics::GraphicsDevice* const device, UINT64 const frame_size) :
+  device_{device},
+  buffer_{
+    device->CreateBuffer(graphics::BufferDesc{
+      frame_size * RenderManager::GetMaxFramesInFlight(), 0, false, false, false
+    }, D3D12_HEAP_TYPE_UPLOAD)
+  },
+  mapped_{static_cast<std::byte*>(buffer_->Map())},
+  allocator_{frame_size, RenderManager::GetMaxFramesInFlight(), slot_size_} {
+  auto const buffer_size{frame_size * RenderManager::GetMaxFramesInFlight()};
+  cbvs_.reserve(buffer_size / slot_size_);
+
+  for (UINT64 offset{0}; offset < buffer_size; offset += slot_size_) {
+    // Views must not reach into the next region, as that might be in use by another frame
+    auto const region_end{(offset / frame_size + 1) * frame_size};
+    cbvs_.emplace_back(device->CreateConstantBufferView(*buffer_, offset,
+      static_cast<UINT>(std::min(max_view_size_, region_end - offset))));
+  }
+}
+
+
+ConstantBufferRing::~ConstantBufferRing() {
+  for (auto const cbv : cbvs_) {
+    device_->DestroyConstantBufferView(cbv);
+  }
+}
+
+
+auto ConstantBufferRing::BeginFrame(UINT const frame_idx) noexcept -> void {
+  allocator_.BeginRegion(frame_idx);
+}
+
+
+auto ConstantBufferRing::Allocate(void const* const data, UINT64 const size) -> UINT {
+  auto const offset{allocator_.Allocate(size)};
+
+  if (!offset) {
+    throw std::runtime_error{"Ran out of per-frame constant buffer memory."};
+  }
+
+  std::memcpy(mapped_ + *offset, data, size);
+  return cbvs_[*offset / slot_size_];
+}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "graphics.hpp"
+#include "linear_ring_allocator.hpp"
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+
+namespace sorcery::rendering {
+// Suballocates the constants of a frame from a single upload buffer that has a region for each frame in flight.
+// Every 256 byte slot of the buffer has a constant buffer view, so allocations are bound by the view of their first
+// slot. Upload heap memory is always readable by the GPU, so the views can be bound without barriers.
+class ConstantBufferRing {
+public:
+  ConstantBufferRing(graphics::GraphicsDevice* device, UINT64 frame_size);
+  ConstantBufferRing(ConstantBufferRing const&) = delete;
+  ConstantBufferRing(ConstantBufferRing&&) = delete;
+
+  ~ConstantBufferRing();
+
+  auto operator=(ConstantBufferRing const&) -> void = delete;
+  auto operator=(ConstantBufferRing&&) -> void = delete;
+
+  // Frees the allocations made during the previous use of the frame's region.
+  // Must not be called concurrently with Allocate.
+  auto BeginFrame(UINT frame_idx) noexcept -> void;
+
+  // Copies the value to the current frame's region and returns the index of the view that reads it.
+  // Thread safe.
+  template<typename T> requires std::is_trivially_copyable_v<T>
+  [[nodiscard]] auto Allocate(T const& val) -> UINT;
+
+private:
+  [[nodiscard]] auto Allocate(void const* data, UINT64 size) -> UINT;
+
+  constexpr static UINT64 slot_size_{256};
+  // Views of slots near the end of a region are shorter
+  constexpr static UINT64 max_view_size_{4096};
+
+  graphics::GraphicsDevice* device_;
+  graphics::SharedDeviceChildHandle<graphics::Buffer> buffer_;
+  std::byte* mapped_;
+  LinearRingAllocator allocator_;
+  std::vector<UINT> cbvs_;
+};
+
+
+template<typename T> requires std::is_trivially_copyable_v<T>
+auto ConstantBufferRing::Allocate(T const& val) -> UINT {
+  static_assert(sizeof(T) <= max_view_size_);
+  return Allocate(&val, sizeof(T));
+}
+}
@@ -25,4 +25,14 @@ auto DirectionalShadowMapArray::GetTex() const noexcept -> graphics::SharedDevic
 auto DirectionalShadowMapArray::GetSize() const noexcept -> UINT {
   return size_;
 }
+
+
+auto DirectionalShadowMapArray::UpdateCache(std::uint64_t const signature) noexcept -> bool {
+  if (cached_signature_ == signature) {
+    return true;
+  }
+
+  cached_signature_ = signature;
+  return false;
+}
 }
@@ -2,16 +2,24 @@
 
 #include "graphics.hpp"
 
+#include <cstdint>
+#include <optional>
+
 
 namespace sorcery::rendering {
 class DirectionalShadowMapArray {
   graphics::SharedDeviceChildHandle<graphics::Texture> tex_;
   UINT size_;
+  std::optional<std::uint64_t> cached_signature_;
 
 public:
   explicit DirectionalShadowMapArray(graphics::GraphicsDevice* device, DXGI_FORMAT depth_format, UINT size);
 
   [[nodiscard]] auto GetTex() const noexcept -> graphics::SharedDeviceChildHandle<graphics::Texture> const&;
   [[nodiscard]] auto GetSize() const noexcept -> UINT;
+
+  // Returns whether the array still holds the cascades last drawn with the same signature, so drawing can be skipped.
+  // Otherwise remembers the signature.
+  [[nodiscard]] auto UpdateCache(std::uint64_t signature) noexcept -> bool;
 };
 }
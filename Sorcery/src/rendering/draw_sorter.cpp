@@ -0,0 +1,82 @@
+#include "draw_sorter.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <utility>
+
+
+namespace sorcery::rendering {
+auto DrawSorter::MakeKey(unsigned const mtl_buf_idx, unsigned const mesh_idx, unsigned const submesh_idx,
+                         float const depth) noexcept -> std::uint64_t {
+  // Flipping the sign bit of positive floats and all bits of negative ones makes their bits order like their values
+  auto depth_bits{std::bit_cast<std::uint32_t>(depth)};
+  depth_bits ^= (depth_bits & 0x80000000u) != 0 ? 0xFFFFFFFFu : 0x80000000u;
+
+  return static_cast<std::uint64_t>(mtl_buf_idx & 0xFFFF) << 48 | static_cast<std::uint64_t>(mesh_idx & 0xFFFF) << 32 |
+         static_cast<std::uint64_t>(submesh_idx & 0xFFF) << 20 | depth_bits >> 12;
+}
+
+
+auto DrawSorter::Clear() noexcept -> void {
+  draws_.clear();
+}
+
+
+auto DrawSorter::Add(std::uint64_t const key, unsigned const instance_idx) -> void {
+  draws_.emplace_back(key, instance_idx);
+}
+
+
+auto DrawSorter::Sort(std::span<unsigned> const instance_indices) -> void {
+  assert(instance_indices.size() == draws_.size());
+
+  if (draws_.empty()) {
+    return;
+  }
+
+  // The histograms of all digits are counted in a single pass over the draws
+  std::array<std::array<std::uint32_t, digit_value_count_>, digit_count_> offsets{};
+
+  for (auto const& draw : draws_) {
+    for (unsigned i{0}; i < digit_count_; i++) {
+      offsets[i][ExtractDigit(draw.key, i)] += 1;
+    }
+  }
+
+  tmp_draws_.resize(draws_.size());
+
+  auto src{&draws_};
+  auto dst{&tmp_draws_};
+
+  for (unsigned i{0}; i < digit_count_; i++) {
+    // Every draw has the same digit, so the pass would not reorder anything.
+    // This skips the passes over the high bits of the index fields, which few scenes use.
+    if (offsets[i][ExtractDigit(draws_.front().key, i)] == draws_.size()) {
+      continue;
+    }
+
+    std::uint32_t offset{0};
+
+    for (auto& count : offsets[i]) {
+      offset += std::exchange(count, offset);
+    }
+
+    for (auto const& draw : *src) {
+      (*dst)[offsets[i][ExtractDigit(draw.key, i)]++] = draw;
+    }
+
+    std::swap(src, dst);
+  }
+
+  std::ranges::transform(*src, std::begin(instance_indices), [](Draw const& draw) {
+    return draw.instance_idx;
+  });
+}
+
+
+auto DrawSorter::ExtractDigit(std::uint64_t const key, unsigned const digit_idx) noexcept -> std::size_t {
+  return static_cast<std::size_t>(key >> digit_idx * digit_bit_count_ & (digit_value_count_ - 1));
+}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "../Core.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+
+namespace sorcery::rendering {
+// Orders the draws of a view by 64 bit keys with a least significant digit radix sort.
+// The keys put draws that can be merged into one instanced draw next to each other, and those front to back.
+// Has no dependency on the graphics device, so it can be used headless.
+class DrawSorter {
+public:
+  // From the most significant bits: 16 for the material buffer, 16 for the mesh, 12 for the submesh and 20 for the
+  // depth. Indices are truncated to their fields, which can only split runs that could be merged, as merging compares
+  // the draw state itself.
+  [[nodiscard]] LEOPPHAPI static auto MakeKey(unsigned mtl_buf_idx, unsigned mesh_idx, unsigned submesh_idx,
+                                              float depth) noexcept -> std::uint64_t;
+
+  LEOPPHAPI auto Clear() noexcept -> void;
+  LEOPPHAPI auto Add(std::uint64_t key, unsigned instance_idx) -> void;
+  // Writes the instance indices of the added draws in key order, one per draw.
+  // Draws with equal keys keep the order they were added in.
+  LEOPPHAPI auto Sort(std::span<unsigned> instance_indices) -> void;
+
+  // Splits the sorted instance indices into runs whose instances can be drawn with the first one of the run, and
+  // calls the function with the position and the length of each run.
+  // The predicate is called with the first instance of the run and the one to merge into it.
+  template<typename CanMerge, typename Func>
+  static auto ForEachBatch(std::span<unsigned const> instance_indices, CanMerge const& can_merge,
+                           Func const& func) -> void;
+
+private:
+  struct Draw {
+    std::uint64_t key;
+    unsigned instance_idx;
+  };
+
+
+  [[nodiscard]] static auto ExtractDigit(std::uint64_t key, unsigned digit_idx) noexcept -> std::size_t;
+
+  constexpr static unsigned digit_bit_count_{8};
+  constexpr static unsigned digit_count_{64 / digit_bit_count_};
+  constexpr static unsigned digit_value_count_{1u << digit_bit_count_};
+
+  std::vector<Draw> draws_;
+  std::vector<Draw> tmp_draws_;
+};
+
+
+template<typename CanMerge, typename Func>
+auto DrawSorter::ForEachBatch(std::span<unsigned const> const instance_indices, CanMerge const& can_merge,
+                              Func const& func) -> void {
+  std::size_t first{0};
+
+  while (first < instance_indices.size()) {
+    auto last{first + 1};
+
+    while (last < instance_indices.size() && can_merge(instance_indices[first], instance_indices[last])) {
+      last += 1;
+    }
+
+    func(first, last - first);
+    first = last;
+  }
+}
+}
@@ -183,7 +183,7 @@ auto RootSignatureCache::Get(std::uint8_t const num_params) -> ComPtr<ID3D12Root
 }
 
 
-GraphicsDevice::GraphicsDevice(bool const enable_debug) {
+GraphicsDevice::GraphicsDevice(bool const enable_debug, bool const use_software_adapter) {
   if (enable_debug) {
     ComPtr<ID3D12Debug6> debug;
     ThrowIfFailed(D3D12GetDebugInterface(IID_PPV_ARGS(&debug)), "Failed to get D3D12 debug interface.");
@@ -207,8 +207,14 @@ GraphicsDevice::GraphicsDevice(bool const enable_debug) {
   ThrowIfFailed(CreateDXGIFactory2(factory_create_flags, IID_PPV_ARGS(&factory_)), "Failed to create DXGI factory.");
 
   ComPtr<IDXGIAdapter4> adapter;
-  ThrowIfFailed(factory_->EnumAdapterByGpuPreference(0, DXGI_GPU_PREFERENCE_HIGH_PERFORMANCE, IID_PPV_ARGS(&adapter)),
-    "Failed to get high performance adapter.");
+
+  if (use_software_adapter) {
+    ThrowIfFailed(factory_->EnumWarpAdapter(IID_PPV_ARGS(&adapter)), "Failed to get software adapter.");
+  } else {
+    ThrowIfFailed(
+      factory_->EnumAdapterByGpuPreference(0, DXGI_GPU_PREFERENCE_HIGH_PERFORMANCE, IID_PPV_ARGS(&adapter)),
+      "Failed to get high performance adapter.");
+  }
 
   ThrowIfFailed(D3D12CreateDevice(adapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&device_)),
     "Failed to create D3D12 device.");
@@ -625,6 +631,17 @@ auto GraphicsDevice::CreateAliasingResources(std::span<BufferDesc const> const b
 }
 
 
+auto GraphicsDevice::CreateConstantBufferView(Buffer const& buffer, UINT64 const offset,
+                                              UINT const size) const -> UINT {
+  auto const cbv{res_desc_heap_->Allocate()};
+  D3D12_CONSTANT_BUFFER_VIEW_DESC const cbv_desc{
+    buffer.resource_->GetGPUVirtualAddress() + offset, static_cast<UINT>(RoundToNextMultiple(size, 256))
+  };
+  device_->CreateConstantBufferView(&cbv_desc, res_desc_heap_->GetDescriptorCpuHandle(cbv));
+  return cbv;
+}
+
+
 auto GraphicsDevice::DestroyBuffer(Buffer const* const buffer) const -> void {
   if (buffer) {
     res_desc_heap_->Release(buffer->cbv_);
@@ -673,6 +690,11 @@ auto GraphicsDevice::DestroySampler(UINT const sampler) const -> void {
 }
 
 
+auto GraphicsDevice::DestroyConstantBufferView(UINT const cbv) const -> void {
+  res_desc_heap_->Release(cbv);
+}
+
+
 auto GraphicsDevice::WaitFence(Fence const& fence, UINT64 const wait_value) const -> void {
   ThrowIfFailed(queue_->Wait(fence.fence_.Get(), wait_value), "Failed to wait fence from GPU queue.");
 }
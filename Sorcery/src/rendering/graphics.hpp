@@ -272,7 +272,8 @@ struct ExecuteBarrierCmdListRecord {
 
 class GraphicsDevice {
 public:
-  LEOPPHAPI explicit GraphicsDevice(bool enable_debug);
+  // The software adapter lets the device work on machines without a GPU
+  LEOPPHAPI GraphicsDevice(bool enable_debug, bool use_software_adapter);
   GraphicsDevice(GraphicsDevice const&) = delete;
   GraphicsDevice(GraphicsDevice&&) = delete;
 
@@ -298,6 +299,8 @@ public:
                                          D3D12_HEAP_TYPE heap_type,
                                          std::pmr::vector<SharedDeviceChildHandle<Buffer>>* buffers,
                                          std::pmr::vector<SharedDeviceChildHandle<Texture>>* textures) -> void;
+  // Views a range of the buffer starting at a multiple of 256 bytes. Must be destroyed before the buffer.
+  [[nodiscard]] LEOPPHAPI auto CreateConstantBufferView(Buffer const& buffer, UINT64 offset, UINT size) const -> UINT;
 
   LEOPPHAPI auto DestroyBuffer(Buffer const* buffer) const -> void;
   LEOPPHAPI auto DestroyTexture(Texture const* texture) const -> void;
@@ -306,6 +309,7 @@ public:
   LEOPPHAPI auto DestroyFence(Fence const* fence) const -> void;
   LEOPPHAPI auto DestroySwapChain(SwapChain const* swap_chain) const -> void;
   LEOPPHAPI auto DestroySampler(UINT sampler) const -> void;
+  LEOPPHAPI auto DestroyConstantBufferView(UINT cbv) const -> void;
 
   LEOPPHAPI auto WaitFence(Fence const& fence, UINT64 wait_value) const -> void;
   LEOPPHAPI auto SignalFence(Fence& fence) const -> void;
@@ -0,0 +1,303 @@
+#include "light_cluster_grid.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <numbers>
+
+
+namespace sorcery::rendering {
+auto LightClusterGrid::Build(Matrix4 const& view_mtx, Matrix4 const& proj_mtx, float const near_plane,
+                             float const far_plane, std::span<Light const> const lights,
+                             JobSystem& job_system) -> void {
+  proj_mtx_ = proj_mtx;
+  inv_proj_mtx_ = proj_mtx.Inverse();
+  near_plane_ = std::max(near_plane, min_near_plane_);
+  far_plane_ = std::max(far_plane, near_plane_ * 2);
+
+  auto const log_depth_ratio{std::log(far_plane_ / near_plane_)};
+  depth_slice_scale_ = static_cast<float>(LIGHT_CLUSTER_COUNT_Z) / log_depth_ratio;
+  depth_slice_bias_ = -static_cast<float>(LIGHT_CLUSTER_COUNT_Z) * std::log(near_plane_) / log_depth_ratio;
+
+  // Lights affecting every cluster go into the global list at the front of the index buffer
+
+  light_indices_.clear();
+  binned_lights_.clear();
+
+  for (unsigned light_idx{0}; light_idx < static_cast<unsigned>(lights.size()); light_idx++) {
+    auto const& light{lights[light_idx]};
+
+    if (light.type == LightType::Directional) {
+      light_indices_.emplace_back(light_idx);
+      continue;
+    }
+
+    BinnedLight binned_light{
+      .light_idx = light_idx, .type = light.type, .position_vs = Vector3{Vector4{light.position_ws, 1} * view_mtx},
+      .direction_vs = Normalized(Vector3{Vector4{light.direction_ws, 0} * view_mtx}), .range = light.range,
+      .angle_cos = std::cos(light.half_angle_rad), .angle_sin = std::sin(light.half_angle_rad)
+    };
+
+    // Bounding sphere of the lit volume, spot lights are bounded by the sphere around their cone
+
+    BoundingSphere bounds_vs{binned_light.position_vs, light.range};
+
+    if (light.type == LightType::Spot) {
+      if (light.half_angle_rad > std::numbers::pi_v<float> / 2) {
+        // The sphere around the position is the tightest bound
+      } else if (light.half_angle_rad > std::numbers::pi_v<float> / 4) {
+        bounds_vs.center = binned_light.position_vs + binned_light.direction_vs * light.range * binned_light.angle_cos;
+        bounds_vs.radius = light.range * binned_light.angle_sin;
+      } else {
+        bounds_vs.radius = light.range / (2 * binned_light.angle_cos);
+        bounds_vs.center = binned_light.position_vs + binned_light.direction_vs * bounds_vs.radius;
+      }
+    }
+
+    auto const bounds_min_z{bounds_vs.center[2] - bounds_vs.radius};
+    auto const bounds_max_z{bounds_vs.center[2] + bounds_vs.radius};
+
+    if (bounds_max_z < near_plane_ || bounds_min_z > far_plane_) {
+      continue;
+    }
+
+    binned_light.min_z = CalculateDepthSlice(bounds_min_z);
+    binned_light.max_z = CalculateDepthSlice(bounds_max_z);
+
+    binned_light.min_x = 0;
+    binned_light.max_x = LIGHT_CLUSTER_COUNT_X - 1;
+    binned_light.min_y = 0;
+    binned_light.max_y = LIGHT_CLUSTER_COUNT_Y - 1;
+
+    // If the bounds are in front of the near plane their projected box conservatively covers the screen footprint
+
+    if (bounds_min_z > near_plane_) {
+      AABB const sphere_aabb_vs{
+        bounds_vs.center - Vector3{bounds_vs.radius}, bounds_vs.center + Vector3{bounds_vs.radius}
+      };
+
+      Vector2 ndc_min{std::numeric_limits<float>::max()};
+      Vector2 ndc_max{std::numeric_limits<float>::lowest()};
+
+      for (auto const& vertex : sphere_aabb_vs.CalculateVertices()) {
+        auto const vertex_cs{Vector4{vertex, 1} * proj_mtx_};
+        Vector2 const vertex_ndc{vertex_cs[0] / vertex_cs[3], vertex_cs[1] / vertex_cs[3]};
+        ndc_min = Vector2{std::min(ndc_min[0], vertex_ndc[0]), std::min(ndc_min[1], vertex_ndc[1])};
+        ndc_max = Vector2{std::max(ndc_max[0], vertex_ndc[0]), std::max(ndc_max[1], vertex_ndc[1])};
+      }
+
+      if (ndc_max[0] < -1 || ndc_min[0] > 1 || ndc_max[1] < -1 || ndc_min[1] > 1) {
+        continue;
+      }
+
+      // NDC Y points up while cluster rows go downwards
+      binned_light.min_x = std::clamp(static_cast<int>((ndc_min[0] * 0.5f + 0.5f) * LIGHT_CLUSTER_COUNT_X), 0,
+        LIGHT_CLUSTER_COUNT_X - 1);
+      binned_light.max_x = std::clamp(static_cast<int>((ndc_max[0] * 0.5f + 0.5f) * LIGHT_CLUSTER_COUNT_X), 0,
+        LIGHT_CLUSTER_COUNT_X - 1);
+      binned_light.min_y = std::clamp(static_cast<int>((0.5f - ndc_max[1] * 0.5f) * LIGHT_CLUSTER_COUNT_Y), 0,
+        LIGHT_CLUSTER_COUNT_Y - 1);
+      binned_light.max_y = std::clamp(static_cast<int>((0.5f - ndc_min[1] * 0.5f) * LIGHT_CLUSTER_COUNT_Y), 0,
+        LIGHT_CLUSTER_COUNT_Y - 1);
+    }
+
+    binned_lights_.emplace_back(binned_light);
+  }
+
+  clusters_[LIGHT_CLUSTER_GLOBAL_IDX] = ShaderLightCluster{
+    .firstLightIdx = 0, .lightCount = static_cast<unsigned>(light_indices_.size())
+  };
+
+  // Every depth slice is binned by a separate job into its own list
+
+  std::array<ObserverPtr<Job>, LIGHT_CLUSTER_COUNT_Z> jobs;
+
+  for (auto i{0}; i < LIGHT_CLUSTER_COUNT_Z; i++) {
+    jobs[i] = job_system.CreateJob([this, i] {
+      BuildDepthSlice(i);
+    });
+    job_system.Run(jobs[i]);
+  }
+
+  for (auto const job : jobs) {
+    job_system.Wait(job);
+  }
+
+  // Concatenate the slice lists in order so that the result does not depend on job scheduling
+
+  for (auto i{0}; i < LIGHT_CLUSTER_COUNT_Z; i++) {
+    auto const base_idx{static_cast<unsigned>(light_indices_.size())};
+
+    for (auto j{0}; j < clusters_per_slice_; j++) {
+      clusters_[i * clusters_per_slice_ + j].firstLightIdx += base_idx;
+    }
+
+    std::ranges::copy(depth_slices_[i].light_indices, std::back_inserter(light_indices_));
+  }
+}
+
+
+auto LightClusterGrid::GetClusters() const noexcept -> std::span<ShaderLightCluster const> {
+  return clusters_;
+}
+
+
+auto LightClusterGrid::GetLightIndices() const noexcept -> std::span<unsigned const> {
+  return light_indices_;
+}
+
+
+auto LightClusterGrid::GetClusterBounds() const noexcept -> std::span<AABB const> {
+  return cluster_bounds_;
+}
+
+
+auto LightClusterGrid::GetDepthSliceScale() const noexcept -> float {
+  return depth_slice_scale_;
+}
+
+
+auto LightClusterGrid::GetDepthSliceBias() const noexcept -> float {
+  return depth_slice_bias_;
+}
+
+
+auto LightClusterGrid::CalculateClusterIndex(Vector2 const& screen_uv, float const view_z) const noexcept -> int {
+  auto const x{std::clamp(static_cast<int>(screen_uv[0] * LIGHT_CLUSTER_COUNT_X), 0, LIGHT_CLUSTER_COUNT_X - 1)};
+  auto const y{std::clamp(static_cast<int>(screen_uv[1] * LIGHT_CLUSTER_COUNT_Y), 0, LIGHT_CLUSTER_COUNT_Y - 1)};
+  return GetClusterIndex(x, y, CalculateDepthSlice(view_z));
+}
+
+
+auto LightClusterGrid::BuildDepthSlice(int const slice_idx) -> void {
+  auto const first_cluster_idx{GetClusterIndex(0, 0, slice_idx)};
+  auto const slice_near{CalculateSliceDepth(slice_idx)};
+  auto const slice_far{CalculateSliceDepth(slice_idx + 1)};
+
+  // Cluster bounds from the rays through the tile corners, works for both perspective and orthographic projections
+
+  for (auto y{0}; y < LIGHT_CLUSTER_COUNT_Y; y++) {
+    for (auto x{0}; x < LIGHT_CLUSTER_COUNT_X; x++) {
+      std::array<Vector3, 8> vertices;
+
+      for (auto i{0}; i < 4; i++) {
+        Vector2 const corner_ndc{
+          static_cast<float>(x + i % 2) / LIGHT_CLUSTER_COUNT_X * 2 - 1,
+          1 - static_cast<float>(y + i / 2) / LIGHT_CLUSTER_COUNT_Y * 2
+        };
+
+        auto const unproject{
+          [this, &corner_ndc](float const ndc_z) {
+            auto const pos{Vector4{corner_ndc, ndc_z, 1} * inv_proj_mtx_};
+            return Vector3{pos} / pos[3];
+          }
+        };
+
+        auto const ray_from{unproject(0)};
+        auto const ray_dir{unproject(1) - ray_from};
+
+        vertices[i * 2] = ray_from + ray_dir * ((slice_near - ray_from[2]) / ray_dir[2]);
+        vertices[i * 2 + 1] = ray_from + ray_dir * ((slice_far - ray_from[2]) / ray_dir[2]);
+      }
+
+      cluster_bounds_[GetClusterIndex(x, y, slice_idx)] = AABB::FromVertices(vertices);
+    }
+  }
+
+  auto& slice{depth_slices_[slice_idx]};
+  slice.cluster_lights.clear();
+
+  for (auto const& light : binned_lights_) {
+    if (slice_idx < light.min_z || slice_idx > light.max_z) {
+      continue;
+    }
+
+    for (auto y{light.min_y}; y <= light.max_y; y++) {
+      for (auto x{light.min_x}; x <= light.max_x; x++) {
+        if (auto const cluster_idx{GetClusterIndex(x, y, slice_idx)}; IntersectsCluster(light,
+          cluster_bounds_[cluster_idx])) {
+          slice.cluster_lights.emplace_back(static_cast<unsigned>(cluster_idx - first_cluster_idx), light.light_idx);
+        }
+      }
+    }
+  }
+
+  // Counting sort by cluster, lights were visited in order so every cluster list stays sorted
+
+  auto const slice_clusters{std::span{clusters_}.subspan(first_cluster_idx, clusters_per_slice_)};
+
+  for (auto& cluster : slice_clusters) {
+    cluster = ShaderLightCluster{.firstLightIdx = 0, .lightCount = 0};
+  }
+
+  for (auto const& cluster_light : slice.cluster_lights) {
+    slice_clusters[cluster_light.cluster_idx].lightCount += 1;
+  }
+
+  std::array<unsigned, clusters_per_slice_> write_indices;
+
+  for (unsigned i{0}, offset{0}; i < static_cast<unsigned>(clusters_per_slice_); i++) {
+    slice_clusters[i].firstLightIdx = offset;
+    write_indices[i] = offset;
+    offset += slice_clusters[i].lightCount;
+  }
+
+  slice.light_indices.resize(slice.cluster_lights.size());
+
+  for (auto const& cluster_light : slice.cluster_lights) {
+    slice.light_indices[write_indices[cluster_light.cluster_idx]++] = cluster_light.light_idx;
+  }
+}
+
+
+auto LightClusterGrid::CalculateDepthSlice(float const view_z) const noexcept -> int {
+  return std::clamp(
+    static_cast<int>(std::floor(std::log(std::max(view_z, min_near_plane_)) * depth_slice_scale_ + depth_slice_bias_)),
+    0, LIGHT_CLUSTER_COUNT_Z - 1);
+}
+
+
+auto LightClusterGrid::CalculateSliceDepth(int const slice_idx) const noexcept -> float {
+  return near_plane_ * std::pow(far_plane_ / near_plane_,
+    static_cast<float>(slice_idx) / static_cast<float>(LIGHT_CLUSTER_COUNT_Z));
+}
+
+
+auto LightClusterGrid::IntersectsCluster(BinnedLight const& light, AABB const& cluster_bounds) noexcept -> bool {
+  // Range sphere against the box
+
+  auto sqr_dist{0.0f};
+
+  for (auto i{0}; i < 3; i++) {
+    if (light.position_vs[i] < cluster_bounds.min[i]) {
+      sqr_dist += std::pow(cluster_bounds.min[i] - light.position_vs[i], 2.0f);
+    } else if (light.position_vs[i] > cluster_bounds.max[i]) {
+      sqr_dist += std::pow(light.position_vs[i] - cluster_bounds.max[i], 2.0f);
+    }
+  }
+
+  if (sqr_dist > light.range * light.range) {
+    return false;
+  }
+
+  if (light.type != LightType::Spot || light.angle_cos <= 0) {
+    return true;
+  }
+
+  // Cone against the bounding sphere of the box
+
+  auto const cluster_center{(cluster_bounds.min + cluster_bounds.max) * 0.5f};
+  auto const cluster_radius{Length(cluster_bounds.max - cluster_center)};
+  auto const to_cluster{cluster_center - light.position_vs};
+  auto const to_cluster_sqr_len{Dot(to_cluster, to_cluster)};
+  auto const axis_dist{Dot(to_cluster, light.direction_vs)};
+  auto const closest_dist{
+    light.angle_cos * std::sqrt(std::max(to_cluster_sqr_len - axis_dist * axis_dist, 0.0f)) - axis_dist * light.
+    angle_sin
+  };
+
+  return closest_dist <= cluster_radius && axis_dist >= -cluster_radius;
+}
+}
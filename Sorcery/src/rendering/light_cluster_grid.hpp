@@ -0,0 +1,114 @@
+#pragma once
+
+#include "../Bounds.hpp"
+#include "../Core.hpp"
+#include "../job_system.hpp"
+#include "../Math.hpp"
+#include "shaders/shader_interop.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+
+namespace sorcery::rendering {
+// Bins lights into the froxels of a view on the CPU and produces compact per-cluster light index lists.
+// The clusters form a LIGHT_CLUSTER_COUNT_X * LIGHT_CLUSTER_COUNT_Y screen grid that is sliced exponentially
+// along the view space depth between the near and far planes.
+// The cluster array has an extra element at LIGHT_CLUSTER_GLOBAL_IDX that lists the lights affecting every cluster.
+// Has no dependency on the graphics device, so it can be used headless.
+class LightClusterGrid {
+public:
+  enum class LightType : std::uint8_t {
+    Directional = 0,
+    Spot        = 1,
+    Point       = 2
+  };
+
+
+  struct Light {
+    LightType type;
+    Vector3 position_ws;
+    Vector3 direction_ws;
+    float range;
+    float half_angle_rad; // Only used for spot lights
+  };
+
+
+  // The light index lists refer to the position of the lights in the passed span.
+  // Depth slices are built by separate jobs.
+  LEOPPHAPI auto Build(Matrix4 const& view_mtx, Matrix4 const& proj_mtx, float near_plane, float far_plane,
+                       std::span<Light const> lights, JobSystem& job_system) -> void;
+
+  [[nodiscard]] LEOPPHAPI auto GetClusters() const noexcept -> std::span<ShaderLightCluster const>;
+  [[nodiscard]] LEOPPHAPI auto GetLightIndices() const noexcept -> std::span<unsigned const>;
+  // View space bounds of the clusters of the last Build
+  [[nodiscard]] LEOPPHAPI auto GetClusterBounds() const noexcept -> std::span<AABB const>;
+
+  // The shader calculates the depth slice as floor(log(view_z) * scale + bias)
+  [[nodiscard]] LEOPPHAPI auto GetDepthSliceScale() const noexcept -> float;
+  [[nodiscard]] LEOPPHAPI auto GetDepthSliceBias() const noexcept -> float;
+
+  // Screen UV has its origin in the top left corner, same as the shader
+  [[nodiscard]] LEOPPHAPI auto CalculateClusterIndex(Vector2 const& screen_uv, float view_z) const noexcept -> int;
+  [[nodiscard]] constexpr static auto GetClusterIndex(int x, int y, int z) noexcept -> int;
+
+private:
+  struct BinnedLight {
+    unsigned light_idx;
+    LightType type;
+    Vector3 position_vs;
+    Vector3 direction_vs;
+    float range;
+    float angle_cos;
+    float angle_sin;
+    int min_x;
+    int max_x;
+    int min_y;
+    int max_y;
+    int min_z;
+    int max_z;
+  };
+
+
+  struct ClusterLight {
+    unsigned cluster_idx; // Relative to the first cluster of the slice
+    unsigned light_idx;
+  };
+
+
+  struct DepthSlice {
+    std::vector<ClusterLight> cluster_lights;
+    std::vector<unsigned> light_indices;
+  };
+
+
+  auto BuildDepthSlice(int slice_idx) -> void;
+  [[nodiscard]] auto CalculateDepthSlice(float view_z) const noexcept -> int;
+  [[nodiscard]] auto CalculateSliceDepth(int slice_idx) const noexcept -> float;
+  [[nodiscard]] static auto IntersectsCluster(BinnedLight const& light, AABB const& cluster_bounds) noexcept -> bool;
+
+  constexpr static int clusters_per_slice_{LIGHT_CLUSTER_COUNT_X * LIGHT_CLUSTER_COUNT_Y};
+  constexpr static int cluster_count_{clusters_per_slice_ * LIGHT_CLUSTER_COUNT_Z};
+  // Keeps the logarithmic slicing defined for cameras whose near plane is at or behind the eye
+  constexpr static float min_near_plane_{0.01f};
+
+  Matrix4 proj_mtx_{Matrix4::Identity()};
+  Matrix4 inv_proj_mtx_{Matrix4::Identity()};
+  float near_plane_{min_near_plane_};
+  float far_plane_{1};
+  float depth_slice_scale_{0};
+  float depth_slice_bias_{0};
+
+  std::vector<BinnedLight> binned_lights_;
+  std::vector<DepthSlice> depth_slices_{LIGHT_CLUSTER_COUNT_Z};
+  std::vector<ShaderLightCluster> clusters_{cluster_count_ + 1};
+  std::vector<AABB> cluster_bounds_{cluster_count_};
+  std::vector<unsigned> light_indices_;
+};
+
+
+constexpr auto LightClusterGrid::GetClusterIndex(int const x, int const y, int const z) noexcept -> int {
+  return z * clusters_per_slice_ + y * LIGHT_CLUSTER_COUNT_X + x;
+}
+}
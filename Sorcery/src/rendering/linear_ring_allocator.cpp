@@ -0,0 +1,67 @@
+#include "linear_ring_allocator.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <stdexcept>
+
+
+namespace sorcery::rendering {
+LinearRingAllocator::LinearRingAllocator(std::uint64_t const region_size, unsigned const region_count,
+                                         std::uint64_t const alignment) :
+  region_size_{region_size},
+  region_count_{region_count},
+  alignment_{alignment} {
+  if (!std::has_single_bit(alignment)) {
+    throw std::runtime_error{"Linear ring allocator alignment must be a power of 2."};
+  }
+
+  if (region_size == 0 || region_size % alignment != 0 || region_count == 0) {
+    throw std::runtime_error{"Linear ring allocator regions must be nonempty multiples of the alignment."};
+  }
+}
+
+
+auto LinearRingAllocator::BeginRegion(unsigned const region_idx) noexcept -> void {
+  assert(region_idx < region_count_);
+  region_offset_ = region_idx * region_size_;
+  next_offset_.store(0, std::memory_order_relaxed);
+}
+
+
+auto LinearRingAllocator::Allocate(std::uint64_t const size) noexcept -> std::optional<std::uint64_t> {
+  // Rounding the size keeps every offset aligned, as the region starts are aligned
+  auto const aligned_size{(std::max<std::uint64_t>(size, 1) + alignment_ - 1) & ~(alignment_ - 1)};
+
+  if (aligned_size > region_size_) {
+    return std::nullopt;
+  }
+
+  if (auto const offset{next_offset_.fetch_add(aligned_size, std::memory_order_relaxed)};
+    offset <= region_size_ - aligned_size) {
+    return region_offset_ + offset;
+  }
+
+  return std::nullopt;
+}
+
+
+auto LinearRingAllocator::GetRegionSize() const noexcept -> std::uint64_t {
+  return region_size_;
+}
+
+
+auto LinearRingAllocator::GetRegionCount() const noexcept -> unsigned {
+  return region_count_;
+}
+
+
+auto LinearRingAllocator::GetAlignment() const noexcept -> std::uint64_t {
+  return alignment_;
+}
+
+
+auto LinearRingAllocator::GetAllocatedSize() const noexcept -> std::uint64_t {
+  return std::min(next_offset_.load(std::memory_order_relaxed), region_size_);
+}
+}
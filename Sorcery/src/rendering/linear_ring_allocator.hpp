@@ -0,0 +1,40 @@
+#pragma once
+
+#include "../Core.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+
+
+namespace sorcery::rendering {
+// Hands out aligned ranges of a memory block split into one region per frame in flight by bumping an offset.
+// A region is reused once its frame comes around again, which frees everything allocated from it at once.
+// Allocation is lock-free, so it can be called from parallel recording jobs.
+// Has no dependency on the graphics device, so it can be used headless.
+class LinearRingAllocator {
+public:
+  // The region size must be a multiple of the alignment, and the alignment must be a power of 2
+  LEOPPHAPI LinearRingAllocator(std::uint64_t region_size, unsigned region_count, std::uint64_t alignment);
+
+  // Frees the allocations made from the region and allocates from it afterward.
+  // Must not be called concurrently with Allocate.
+  LEOPPHAPI auto BeginRegion(unsigned region_idx) noexcept -> void;
+  // Returns the offset of the allocation from the start of the memory block, or nullopt if the region is full
+  [[nodiscard]] LEOPPHAPI auto Allocate(std::uint64_t size) noexcept -> std::optional<std::uint64_t>;
+
+  [[nodiscard]] LEOPPHAPI auto GetRegionSize() const noexcept -> std::uint64_t;
+  [[nodiscard]] LEOPPHAPI auto GetRegionCount() const noexcept -> unsigned;
+  [[nodiscard]] LEOPPHAPI auto GetAlignment() const noexcept -> std::uint64_t;
+  // Including the padding from the alignment
+  [[nodiscard]] LEOPPHAPI auto GetAllocatedSize() const noexcept -> std::uint64_t;
+
+private:
+  std::uint64_t region_size_;
+  unsigned region_count_;
+  std::uint64_t alignment_;
+  std::uint64_t region_offset_{0};
+  // Relative to the start of the current region. Failed allocations push it past the region size.
+  std::atomic<std::uint64_t> next_offset_{0};
+};
+}
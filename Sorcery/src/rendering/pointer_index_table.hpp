@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+
+namespace sorcery::rendering {
+// Open addressing hash table that maps object addresses to indices, used to deduplicate resources during extraction.
+// Clearing is constant time, the slots are invalidated by bumping a generation counter so they can be reused.
+// The type of the counter only needs changing to reach its wraparound quickly.
+template<typename T, typename Generation = unsigned>
+class PointerIndexTable {
+public:
+  auto Clear() noexcept -> void;
+
+  // Returns the index stored for the pointer, or stores the passed index if the pointer is not yet present.
+  // The second element is true if the index was stored by the call.
+  [[nodiscard]] auto FindOrInsert(T const* ptr, unsigned index) -> std::pair<unsigned, bool>;
+  [[nodiscard]] auto Find(T const* ptr) const noexcept -> std::optional<unsigned>;
+
+private:
+  struct Slot {
+    T const* key;
+    unsigned index;
+    Generation generation;
+  };
+
+
+  auto Grow() -> void;
+  [[nodiscard]] static auto Hash(T const* ptr) noexcept -> std::size_t;
+
+  constexpr static std::size_t min_capacity_{64};
+
+  std::vector<Slot> slots_;
+  std::size_t size_{0};
+  Generation generation_{1};
+};
+
+
+template<typename T, typename Generation>
+auto PointerIndexTable<T, Generation>::Clear() noexcept -> void {
+  size_ = 0;
+
+  // Slots left over from a previous lap of the counter would appear valid again
+  if (++generation_ == 0) {
+    for (auto& slot : slots_) {
+      slot.generation = 0;
+    }
+
+    generation_ = 1;
+  }
+}
+
+
+template<typename T, typename Generation>
+auto PointerIndexTable<T, Generation>::FindOrInsert(T const* const ptr,
+                                                    unsigned const index) -> std::pair<unsigned, bool> {
+  // Keep the load factor at or below one half
+  if ((size_ + 1) * 2 > slots_.size()) {
+    Grow();
+  }
+
+  auto const mask{slots_.size() - 1};
+
+  for (auto slot_idx{Hash(ptr) & mask};; slot_idx = (slot_idx + 1) & mask) {
+    auto& slot{slots_[slot_idx]};
+
+    if (slot.generation != generation_) {
+      slot = Slot{ptr, index, generation_};
+      size_ += 1;
+      return {index, true};
+    }
+
+    if (slot.key == ptr) {
+      return {slot.index, false};
+    }
+  }
+}
+
+
+template<typename T, typename Generation>
+auto PointerIndexTable<T, Generation>::Find(T const* const ptr) const noexcept -> std::optional<unsigned> {
+  if (slots_.empty()) {
+    return std::nullopt;
+  }
+
+  auto const mask{slots_.size() - 1};
+
+  // The load factor guarantees an empty slot, so the probe always terminates
+  for (auto slot_idx{Hash(ptr) & mask};; slot_idx = (slot_idx + 1) & mask) {
+    auto const& slot{slots_[slot_idx]};
+
+    if (slot.generation != generation_) {
+      return std::nullopt;
+    }
+
+    if (slot.key == ptr) {
+      return slot.index;
+    }
+  }
+}
+
+
+template<typename T, typename Generation>
+auto PointerIndexTable<T, Generation>::Grow() -> void {
+  auto const old_slots{std::exchange(slots_, std::vector<Slot>(std::max(slots_.size() * 2, min_capacity_)))};
+  auto const mask{slots_.size() - 1};
+
+  for (auto const& old_slot : old_slots) {
+    if (old_slot.generation != generation_) {
+      continue;
+    }
+
+    auto slot_idx{Hash(old_slot.key) & mask};
+
+    while (slots_[slot_idx].generation == generation_) {
+      slot_idx = (slot_idx + 1) & mask;
+    }
+
+    slots_[slot_idx] = old_slot;
+  }
+}
+
+
+template<typename T, typename Generation>
+auto PointerIndexTable<T, Generation>::Hash(T const* const ptr) noexcept -> std::size_t {
+  // Fibonacci hashing spreads the low entropy bits of aligned addresses over the whole word
+  auto const hash{std::bit_cast<std::uintptr_t>(ptr) * 11400714819323198485ull};
+  return static_cast<std::size_t>(hash ^ hash >> 32);
+}
+}
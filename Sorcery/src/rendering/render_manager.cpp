@@ -10,8 +10,12 @@ namespace sorcery::rendering {
 RenderManager::RenderManager(graphics::GraphicsDevice& device) :
   device_{&device},
   in_flight_frames_fence_{device_->CreateFence(0)},
-  upload_fence_{device_->CreateFence(0)} {
-  RecreateUploadBuffer(D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+  upload_buf_{
+    device_->CreateBuffer(graphics::BufferDesc{upload_ring_size_, 0, false, false, false}, D3D12_HEAP_TYPE_UPLOAD)
+  },
+  upload_fence_{device_->CreateFence(0)},
+  upload_ptr_{static_cast<std::byte*>(upload_buf_->Map())} {
+  upload_buf_->SetDebugName(L"Render Manager Upload Buffer");
 }
 
 
@@ -52,61 +56,74 @@ auto RenderManager::AcquireTemporaryRenderTarget(RenderTarget::Desc const& desc)
 }
 
 
-auto RenderManager::UpdateBuffer(graphics::Buffer const& buf, UINT const byte_offset,
-                                 std::span<std::byte const> const data) -> void {
-  if (buf.GetDesc().size - byte_offset < data.size()) {
+auto RenderManager::UpdateBuffer(graphics::SharedDeviceChildHandle<graphics::Buffer> const& buf,
+                                 UINT const byte_offset, std::span<std::byte const> const data) -> void {
+  if (buf->GetDesc().size - byte_offset < data.size()) {
     throw std::runtime_error{"Failed to update buffer: the provided data does not fit in the destination buffer."};
   }
 
+  if (data.empty()) {
+    return;
+  }
+
   std::scoped_lock const lck{upload_mutex_};
 
-  if (auto const upload_buf_size{upload_buf_->GetDesc().size};
-    upload_buf_size - upload_buf_current_offset_ < data.size()) {
-    WaitForAllUploads();
+  upload_counters_.write_count += 1;
+  upload_counters_.byte_count += data.size();
 
-    if (upload_buf_size < data.size()) {
-      RecreateUploadBuffer(data.size());
+  if (data.size() <= upload_scheduler_.GetCapacity()) {
+    // The coalesced data of a batch must fit in the staging ring
+    if (upload_scheduler_.GetScheduledBufferWriteSize() + data.size() > upload_scheduler_.GetCapacity()) {
+      SubmitUploads();
     }
+
+    upload_scheduler_.ScheduleBufferWrite(buf, byte_offset, data);
+    return;
   }
 
-  std::memcpy(upload_ptr_ + upload_buf_current_offset_, data.data(), data.size());
+  // Submitting the staged updates first keeps the order of the writes
+  SubmitUploads();
+
+  auto const dedicated_buf{CreateDedicatedUploadBuffer(data.size())};
+  std::memcpy(dedicated_buf->Map(), data.data(), data.size());
 
   auto& cmd{AcquireCommandList()};
   cmd.Begin(nullptr);
-  cmd.CopyBufferRegion(buf, byte_offset, *upload_buf_, upload_buf_current_offset_, data.size());
+  cmd.CopyBufferRegion(*buf, byte_offset, *dedicated_buf, 0, data.size());
   cmd.End();
 
   device_->ExecuteCommandLists(std::span{&cmd, 1});
-  device_->SignalFence(*upload_fence_);
-
-  upload_buf_current_offset_ += data.size();
+  upload_counters_.copy_count += 1;
 }
 
 
-auto RenderManager::UpdateTexture(graphics::Texture const& tex, UINT const subresource_offset,
+auto RenderManager::UpdateTexture(graphics::SharedDeviceChildHandle<graphics::Texture> const& tex,
+                                  UINT const subresource_offset,
                                   std::span<D3D12_SUBRESOURCE_DATA const> const data) -> void {
   UINT64 tex_size;
-  device_->GetCopyableFootprints(tex.GetDesc(), subresource_offset, static_cast<UINT>(data.size()), 0, nullptr, nullptr,
-    nullptr, &tex_size);
+  device_->GetCopyableFootprints(tex->GetDesc(), subresource_offset, static_cast<UINT>(data.size()), 0, nullptr,
+    nullptr, nullptr, &tex_size);
 
   std::scoped_lock const lck{upload_mutex_};
 
-  // We have to make sure to align the texture data in the buffer to 512 bytes (D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT).
-  // Buffers are always aligned to 64KB (D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT), so it is enough to align the offset.
+  upload_counters_.write_count += 1;
+  upload_counters_.byte_count += tex_size;
 
-  if (auto const preferred_offset = [this] {
-        auto const remainder{upload_buf_current_offset_ % D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT};
-        return remainder
-                 ? upload_buf_current_offset_ + (D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - remainder)
-                 : upload_buf_current_offset_;
-      }(), upload_buf_size{upload_buf_->GetDesc().size}; preferred_offset + tex_size <= upload_buf_size) {
-    upload_buf_current_offset_ = preferred_offset;
-  } else {
-    WaitForAllUploads();
+  graphics::SharedDeviceChildHandle<graphics::Buffer> dedicated_buf;
+  std::byte* staging_ptr;
+  UINT64 staging_offset;
 
-    if (tex_size > upload_buf_size) {
-      RecreateUploadBuffer(tex_size);
-    }
+  // Texture data must be aligned to 512 bytes (D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT) in the buffer.
+  // Buffers are always aligned to 64KB (D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT), so it is enough to align the offset.
+  if (tex_size <= upload_scheduler_.GetCapacity()) {
+    staging_ptr = upload_ptr_;
+    staging_offset = AllocateStaging(tex_size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+  } else {
+    // Submitting the staged updates first keeps the order of the writes
+    SubmitUploads();
+    dedicated_buf = CreateDedicatedUploadBuffer(tex_size);
+    staging_ptr = static_cast<std::byte*>(dedicated_buf->Map());
+    staging_offset = 0;
   }
 
   std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts;
@@ -118,30 +135,55 @@ auto RenderManager::UpdateTexture(graphics::Texture const& tex, UINT const subre
   std::vector<UINT64> row_sizes;
   row_sizes.resize(data.size());
 
-  device_->GetCopyableFootprints(tex.GetDesc(), subresource_offset, static_cast<UINT>(data.size()),
-    upload_buf_current_offset_, layouts.data(), row_counts.data(), row_sizes.data(), nullptr);
+  device_->GetCopyableFootprints(tex->GetDesc(), subresource_offset, static_cast<UINT>(data.size()), staging_offset,
+    layouts.data(), row_counts.data(), row_sizes.data(), nullptr);
 
   for (std::size_t i{0}; i < data.size(); i++) {
     D3D12_MEMCPY_DEST const dst{
-      upload_ptr_ + layouts[i].Offset, layouts[i].Footprint.RowPitch,
+      staging_ptr + layouts[i].Offset, layouts[i].Footprint.RowPitch,
       static_cast<std::size_t>(layouts[i].Footprint.RowPitch) * static_cast<std::size_t>(row_counts[i])
     };
     MemcpySubresource(&dst, &data[i], row_sizes[i], row_counts[i], layouts[i].Footprint.Depth);
   }
 
+  if (!dedicated_buf) {
+    for (UINT i{0}; i < static_cast<UINT>(data.size()); i++) {
+      auto const& footprint{layouts[i].Footprint};
+      upload_scheduler_.ScheduleTextureCopy(UploadScheduler::TextureCopy{
+        tex, subresource_offset + i, layouts[i].Offset,
+        UploadScheduler::TextureFootprint{
+          static_cast<std::uint32_t>(footprint.Format), footprint.Width, footprint.Height, footprint.Depth,
+          footprint.RowPitch
+        }
+      });
+    }
+
+    return;
+  }
+
   auto& cmd{AcquireCommandList()};
   cmd.Begin(nullptr);
 
   for (UINT i{0}; i < static_cast<UINT>(data.size()); i++) {
-    cmd.CopyTextureRegion(tex, subresource_offset + i, 0, 0, 0, *upload_buf_, layouts[i]);
+    cmd.CopyTextureRegion(*tex, subresource_offset + i, 0, 0, 0, *dedicated_buf, layouts[i]);
   }
 
   cmd.End();
 
   device_->ExecuteCommandLists(std::span{&cmd, 1});
-  device_->SignalFence(*upload_fence_);
+  upload_counters_.copy_count += data.size();
+}
+
 
-  upload_buf_current_offset_ += tex_size;
+auto RenderManager::FlushUploads() -> void {
+  std::scoped_lock const lck{upload_mutex_};
+  SubmitUploads();
+}
+
+
+auto RenderManager::GetUploadCounters() const -> UploadCounters {
+  std::scoped_lock const lck{upload_mutex_};
+  return prev_frame_upload_counters_;
 }
 
 
@@ -188,7 +230,7 @@ auto RenderManager::CreateReadOnlyTexture(
       static_cast<LONG_PTR>(subimg.slicePitch));
   }
 
-  UpdateTexture(*tex, 0, subresource_data);
+  UpdateTexture(tex, 0, subresource_data);
   return tex;
 }
 
@@ -206,6 +248,12 @@ auto RenderManager::KeepAliveWhileInUse(graphics::SharedDeviceChildHandle<graphi
 
 
 auto RenderManager::EndFrame() -> void {
+  {
+    std::scoped_lock const lck{upload_mutex_};
+    SubmitUploads();
+    prev_frame_upload_counters_ = std::exchange(upload_counters_, {});
+  }
+
   WaitForInFlightFrames();
   UpdateCounters();
   AgeTempRenderTargets();
@@ -215,6 +263,12 @@ auto RenderManager::EndFrame() -> void {
 }
 
 
+auto RenderManager::WaitForFrame(UINT64 const frame_count) const -> void {
+  // EndFrame signals the fence once per frame, starting from 1
+  in_flight_frames_fence_->Wait(frame_count + 1);
+}
+
+
 auto RenderManager::CreateCommandLists(UINT const count) -> void {
   cmd_lists_.reserve(cmd_lists_.size() + count);
 
@@ -261,16 +315,110 @@ auto RenderManager::ReleaseUnusedBuffers() -> void {
 }
 
 
-auto RenderManager::RecreateUploadBuffer(UINT64 const size) -> void {
-  upload_buf_ = device_->CreateBuffer(graphics::BufferDesc{size, 0, false, false, false}, D3D12_HEAP_TYPE_UPLOAD);
-  upload_buf_->SetDebugName(L"Render Manager Upload Buffer");
-  upload_ptr_ = static_cast<std::byte*>(upload_buf_->Map());
+auto RenderManager::AllocateStaging(UINT64 const size, UINT64 const alignment) -> UINT64 {
+  while (true) {
+    upload_scheduler_.ReleaseBatches(upload_fence_->GetCompletedValue());
+
+    if (auto const offset{upload_scheduler_.AllocateStaging(size, alignment)}) {
+      return *offset;
+    }
+
+    // The ring is full, so the staged updates are submitted and the oldest batch is waited on to free some room
+    if (upload_scheduler_.HasScheduledWrites()) {
+      SubmitUploads();
+    } else if (auto const oldest_batch{upload_scheduler_.GetOldestBatch()}) {
+      upload_fence_->Wait(*oldest_batch);
+    } else {
+      throw std::runtime_error{"Failed to allocate upload staging memory."};
+    }
+  }
+}
+
+
+auto RenderManager::AllocateStagingForSubmission(UINT64 const size) -> std::optional<UINT64> {
+  while (true) {
+    upload_scheduler_.ReleaseBatches(upload_fence_->GetCompletedValue());
+
+    if (auto const offset{upload_scheduler_.AllocateStaging(size, 1)}) {
+      return offset;
+    }
+
+    // Only earlier batches can be waited on, the rest of the ring is held by the batch being submitted
+    if (auto const oldest_batch{upload_scheduler_.GetOldestBatch()}) {
+      upload_fence_->Wait(*oldest_batch);
+    } else {
+      return std::nullopt;
+    }
+  }
 }
 
 
-auto RenderManager::WaitForAllUploads() -> void {
-  upload_buf_current_offset_ = 0;
-  upload_fence_->Wait(upload_fence_->GetNextValue() - 1);
+auto RenderManager::CreateDedicatedUploadBuffer(
+  UINT64 const size) -> graphics::SharedDeviceChildHandle<graphics::Buffer> {
+  auto buf{device_->CreateBuffer(graphics::BufferDesc{size, 0, false, false, false}, D3D12_HEAP_TYPE_UPLOAD)};
+  buf->SetDebugName(L"Render Manager Dedicated Upload Buffer");
+  // Frames in flight finish their work before the buffer is released, so this outlives the copies
+  KeepAliveWhileInUse(buf);
+  return buf;
+}
+
+
+auto RenderManager::SubmitUploads() -> void {
+  if (!upload_scheduler_.HasScheduledWrites()) {
+    return;
+  }
+
+  upload_scheduler_.CoalesceWrites();
+
+  auto const buf_copies{upload_scheduler_.GetCoalescedBufferCopies()};
+  auto const tex_copies{upload_scheduler_.GetCoalescedTextureCopies()};
+  auto const buf_data_size{upload_scheduler_.GetCoalescedBufferDataSize()};
+
+  graphics::SharedDeviceChildHandle<graphics::Buffer> buf_data_src{upload_buf_};
+  UINT64 buf_data_offset{0};
+
+  if (buf_data_size > 0) {
+    std::byte* buf_data_ptr;
+
+    if (auto const staging_offset{AllocateStagingForSubmission(buf_data_size)}) {
+      buf_data_offset = *staging_offset;
+      buf_data_ptr = upload_ptr_ + buf_data_offset;
+    } else {
+      buf_data_src = CreateDedicatedUploadBuffer(buf_data_size);
+      buf_data_ptr = static_cast<std::byte*>(buf_data_src->Map());
+    }
+
+    upload_scheduler_.WriteCoalescedBufferData(std::span{buf_data_ptr, buf_data_size});
+  }
+
+  auto& cmd{AcquireCommandList()};
+  cmd.Begin(nullptr);
+
+  for (auto const& copy : buf_copies) {
+    cmd.CopyBufferRegion(*static_cast<graphics::Buffer const*>(copy.dst.get()), copy.dst_offset, *buf_data_src,
+      buf_data_offset + copy.src_offset, copy.size);
+  }
+
+  for (auto const& copy : tex_copies) {
+    D3D12_PLACED_SUBRESOURCE_FOOTPRINT const src_footprint{
+      copy.src_offset, D3D12_SUBRESOURCE_FOOTPRINT{
+        static_cast<DXGI_FORMAT>(copy.src_footprint.format), copy.src_footprint.width, copy.src_footprint.height,
+        copy.src_footprint.depth, copy.src_footprint.row_pitch
+      }
+    };
+    cmd.CopyTextureRegion(*static_cast<graphics::Texture const*>(copy.dst.get()), copy.dst_subresource_index, 0, 0, 0,
+      *upload_buf_, src_footprint);
+  }
+
+  cmd.End();
+
+  device_->ExecuteCommandLists(std::span{&cmd, 1});
+
+  upload_counters_.copy_count += buf_copies.size() + tex_copies.size();
+
+  auto const batch_id{upload_fence_->GetNextValue()};
+  device_->SignalFence(*upload_fence_);
+  upload_scheduler_.EndBatch(batch_id);
 }
 
 
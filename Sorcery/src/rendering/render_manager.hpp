@@ -2,6 +2,7 @@
 
 #include "graphics.hpp"
 #include "render_target.hpp"
+#include "upload_scheduler.hpp"
 #include "../Core.hpp"
 #include "../Math.hpp"
 #include "../observer_ptr.hpp"
@@ -12,6 +13,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <mutex>
+#include <optional>
 #include <span>
 #include <variant>
 #include <vector>
@@ -20,6 +22,13 @@
 namespace sorcery::rendering {
 class RenderManager {
 public:
+  struct UploadCounters {
+    UINT64 write_count; // Calls to UpdateBuffer and UpdateTexture
+    UINT64 copy_count; // Copy commands after merging the writes
+    UINT64 byte_count;
+  };
+
+
   LEOPPHAPI explicit RenderManager(graphics::GraphicsDevice& device);
   RenderManager(RenderManager const&) = delete;
   RenderManager(RenderManager&&) = delete;
@@ -39,9 +48,17 @@ public:
   [[nodiscard]] LEOPPHAPI auto AcquireTemporaryRenderTarget(
     RenderTarget::Desc const& desc) -> std::shared_ptr<RenderTarget>;
 
-  LEOPPHAPI auto UpdateBuffer(graphics::Buffer const& buf, UINT byte_offset, std::span<std::byte const> data) -> void;
-  LEOPPHAPI auto UpdateTexture(graphics::Texture const& tex, UINT subresource_offset,
+  // Updates are staged and only submitted at the next call to FlushUploads.
+  // The destinations are kept alive until then.
+  LEOPPHAPI auto UpdateBuffer(graphics::SharedDeviceChildHandle<graphics::Buffer> const& buf, UINT byte_offset,
+                              std::span<std::byte const> data) -> void;
+  LEOPPHAPI auto UpdateTexture(graphics::SharedDeviceChildHandle<graphics::Texture> const& tex, UINT subresource_offset,
                                std::span<D3D12_SUBRESOURCE_DATA const> data) -> void;
+  // Submits the staged updates as a single command list.
+  // Work that reads the updated resources must be submitted after this. EndFrame also calls it.
+  LEOPPHAPI auto FlushUploads() -> void;
+  // Counted during the previous frame
+  [[nodiscard]] LEOPPHAPI auto GetUploadCounters() const -> UploadCounters;
 
   [[nodiscard]] LEOPPHAPI auto CreateReadOnlyTexture(
     DirectX::ScratchImage const& img) -> graphics::SharedDeviceChildHandle<graphics::Texture>;
@@ -51,6 +68,8 @@ public:
 
   // At the end of a frame this must be called!
   LEOPPHAPI auto EndFrame() -> void;
+  // Blocks until the GPU finished the frame with the passed frame count. The frame must have already ended.
+  LEOPPHAPI auto WaitForFrame(UINT64 frame_count) const -> void;
 
 private:
   struct TempRenderTargetRecord {
@@ -71,14 +90,20 @@ private:
   auto AgeKeepAliveBuffers() -> void;
   auto ReleaseOldTempRenderTargets() -> void;
   auto ReleaseUnusedBuffers() -> void;
-  auto RecreateUploadBuffer(UINT64 size) -> void;
-  auto WaitForAllUploads() -> void;
+  // These expect the upload mutex to be locked
+  [[nodiscard]] auto AllocateStaging(UINT64 size, UINT64 alignment) -> UINT64;
+  // Cannot submit to make room, so returns nullopt if the rest of the ring is held by the current batch
+  [[nodiscard]] auto AllocateStagingForSubmission(UINT64 size) -> std::optional<UINT64>;
+  // Uploads too large for the staging ring go through their own buffer instead
+  [[nodiscard]] auto CreateDedicatedUploadBuffer(UINT64 size) -> graphics::SharedDeviceChildHandle<graphics::Buffer>;
+  auto SubmitUploads() -> void;
   auto WaitForInFlightFrames() const -> void;
   auto UpdateCounters() -> void;
 
   static UINT constexpr max_tmp_rt_age_{10};
   static UINT constexpr max_gpu_queued_frames_{1};
   static UINT constexpr max_frames_in_flight_{max_gpu_queued_frames_ + 1};
+  static UINT64 constexpr upload_ring_size_{32 * 1024 * 1024};
 
   static_assert(
     max_tmp_rt_age_ > max_gpu_queued_frames_ &&
@@ -101,8 +126,11 @@ private:
   graphics::SharedDeviceChildHandle<graphics::Buffer> upload_buf_;
   graphics::SharedDeviceChildHandle<graphics::Fence> upload_fence_;
   std::byte* upload_ptr_{nullptr};
-  UINT64 upload_buf_current_offset_{0};
-  std::mutex upload_mutex_;
+  // Batches are identified by the upload fence values that signal their completion
+  UploadScheduler upload_scheduler_{upload_ring_size_};
+  UploadCounters upload_counters_{};
+  UploadCounters prev_frame_upload_counters_{};
+  mutable std::mutex upload_mutex_;
 
   std::vector<KeepAliveRecord> resources_to_keep_alive_;
   std::mutex keep_alive_resources_mutex_;
@@ -1,12 +1,19 @@
 #include "scene_renderer.hpp"
 
 #include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
 #include <cstring>
 #include <iterator>
 #include <random>
+#include <stdexcept>
+#include <thread>
+#include <utility>
 
 #include "ShadowCascadeBoundary.hpp"
 #include "../app.hpp"
+#include "../job_system.hpp"
 #include "../MemoryAllocation.hpp"
 #include "../ResourceManager.hpp"
 #include "../Window.hpp"
@@ -68,22 +75,90 @@ namespace {
     Matrix4::LookTo(origin, Vector3::Backward(), Vector3::Up()), // -Z
   };
 }
+
+
+// Returns the directions the views of MakeCubeFaceViewMatrices look in, in the same order
+[[nodiscard]] constexpr auto MakeCubeFaceDirections() noexcept {
+  return std::array{
+    Vector3::Right(), Vector3::Left(), Vector3::Up(), Vector3::Down(), Vector3::Forward(), Vector3::Backward()
+  };
+}
+
+
+// Order dependent mix of the value into the seed, only used to detect changes between frames
+[[nodiscard]] auto HashCombine(std::uint64_t const seed, std::uint64_t const value) noexcept -> std::uint64_t {
+  auto hash{seed + value + 0x9E3779B97F4A7C15ull};
+  hash = (hash ^ hash >> 30) * 0xBF58476D1CE4E5B9ull;
+  hash = (hash ^ hash >> 27) * 0x94D049BB133111EBull;
+  return hash ^ hash >> 31;
+}
+
+
+[[nodiscard]] auto HashCombine(std::uint64_t seed, Matrix4 const& mtx) noexcept -> std::uint64_t {
+  for (auto i{0}; i < 16; i += 2) {
+    seed = HashCombine(seed, std::bit_cast<std::uint64_t>(std::array{mtx.GetData()[i], mtx.GetData()[i + 1]}));
+  }
+
+  return seed;
+}
+
+
+[[nodiscard]] auto HashCombine(std::uint64_t const seed, void const* const ptr) noexcept -> std::uint64_t {
+  return HashCombine(seed, static_cast<std::uint64_t>(std::bit_cast<std::uintptr_t>(ptr)));
+}
+
+
+// Returns the nearest and farthest depth of the box along the view direction
+[[nodiscard]] auto CalculateViewDepthRange(Vector3 const& view_pos, Vector3 const& view_forward,
+                                           AABB const& bounds) noexcept -> std::pair<float, float> {
+  auto const center{(bounds.min + bounds.max) / 2.0f};
+  auto const half_extent{(bounds.max - bounds.min) / 2.0f};
+  auto const depth{Dot(center - view_pos, view_forward)};
+  auto const radius{
+    std::abs(view_forward[0]) * half_extent[0] + std::abs(view_forward[1]) * half_extent[1] +
+    std::abs(view_forward[2]) * half_extent[2]
+  };
+  return {depth - radius, depth + radius};
+}
 }
 
 
 auto SceneRenderer::CalculateCameraShadowCascadeBoundaries(CameraData const& cam_data,
-                                                           ShadowParams const& shadow_params) ->
-  ShadowCascadeBoundaries {
-  auto const cam_near{cam_data.near_plane};
-  auto const shadow_distance{std::min(cam_data.far_plane, shadow_params.distance)};
+                                                           ShadowParams const& shadow_params, float const receiver_near,
+                                                           float const receiver_far) -> ShadowCascadeBoundaries {
+  auto cam_near{cam_data.near_plane};
+  auto shadow_distance{std::min(cam_data.far_plane, shadow_params.distance)};
+
+  // Nothing has to be shadowed outside the receivers, so the cascades only cover their depth range
+  if (shadow_params.automatic_cascade_splits && receiver_near < receiver_far) {
+    cam_near = std::max(cam_near, receiver_near);
+    shadow_distance = std::max(std::min(shadow_distance, receiver_far), cam_near);
+  }
+
   auto const shadowed_frustum_depth{shadow_distance - cam_near};
 
+  // Logarithmic splits keep the texel density even across a deep range, but waste the far cascades on a shallow one,
+  // so the splits blend between logarithmic and uniform by the depth ratio
+  auto const log_weight{
+    cam_near > 0
+      ? std::clamp(std::log(shadow_distance / cam_near) / std::log(log_cascade_split_depth_ratio_), 0.0f, 1.0f)
+      : 0.0f
+  };
+
   ShadowCascadeBoundaries boundaries;
 
   boundaries[0].nearClip = cam_near;
 
   for (auto i = 0; i < shadow_params.cascade_count - 1; i++) {
-    boundaries[i + 1].nearClip = cam_near + shadow_params.normalized_cascade_splits[i] * shadowed_frustum_depth;
+    if (shadow_params.automatic_cascade_splits) {
+      auto const split_ratio{static_cast<float>(i + 1) / static_cast<float>(shadow_params.cascade_count)};
+      auto const log_split{cam_near * std::pow(shadow_distance / cam_near, split_ratio)};
+      auto const uniform_split{cam_near + split_ratio * shadowed_frustum_depth};
+      boundaries[i + 1].nearClip = log_weight > 0 ? std::lerp(uniform_split, log_split, log_weight) : uniform_split;
+    } else {
+      boundaries[i + 1].nearClip = cam_near + shadow_params.normalized_cascade_splits[i] * shadowed_frustum_depth;
+    }
+
     boundaries[i].farClip = boundaries[i + 1].nearClip * 1.005f;
   }
 
@@ -140,30 +215,46 @@ auto SceneRenderer::CullLights(Frustum const& frustum_ws, std::span<LightData co
 }
 
 
-auto SceneRenderer::CullStaticSubmeshInstances(Frustum const& frustum_ws, std::span<MeshData const> const meshes,
-                                               std::span<SubmeshData const> const submeshes,
+auto SceneRenderer::CullStaticSubmeshInstances(Frustum const& frustum_ws, Bvh const& static_submesh_instance_bvh,
                                                std::span<InstanceData const> const instances,
                                                std::pmr::vector<unsigned>& visible_static_submesh_instance_indices) ->
   void {
   visible_static_submesh_instance_indices.clear();
+  static_submesh_instance_bvh.CullFrustum(frustum_ws, visible_static_submesh_instance_indices);
 
-  for (unsigned i{0}; i < static_cast<unsigned>(instances.size()); i++) {
-    auto const& instance{instances[i]};
-    auto const& submesh{submeshes[instance.submesh_local_idx]};
-    auto const& mesh{meshes[submesh.mesh_local_idx]};
-
-    if (frustum_ws.Intersects(mesh.bounds.Transform(instance.local_to_world_mtx)) && frustum_ws.Intersects(
-          submesh.bounds.Transform(instance.local_to_world_mtx))) {
+  // The instances after the static ones are not part of the hierarchy
+  for (auto i{static_submesh_instance_bvh.GetPrimitiveCount()}; i < static_cast<unsigned>(instances.size()); i++) {
+    if (frustum_ws.Intersects(instances[i].bounds_ws)) {
       visible_static_submesh_instance_indices.emplace_back(i);
     }
   }
 }
 
 
-auto SceneRenderer::SetPerFrameConstants(ConstantBuffer<ShaderPerFrameConstants>& cb, int const rt_width,
-                                         int const rt_height, Vector3 const& ambient_light,
-                                         ShadowParams const& shadow_params) -> void {
-  cb.Update(ShaderPerFrameConstants{
+auto SceneRenderer::CullShadowCasters(CullView const& view, std::span<InstanceData const> const instances,
+                                      std::pmr::vector<unsigned>& visible_instance_indices) -> void {
+  std::erase_if(visible_instance_indices, [&view, &instances](unsigned const instance_idx) {
+    auto const& instance{instances[instance_idx]};
+    return !instance.casts_shadow ||
+           (view.receiver_frustum_ws && !view.receiver_frustum_ws->Intersects(instance.bounds_ws,
+              view.caster_extrusion));
+  });
+}
+
+
+auto SceneRenderer::CullOccludedInstances(SoftwareOcclusionCuller const& occlusion_culler,
+                                          std::span<InstanceData const> const instances,
+                                          std::pmr::vector<unsigned>& visible_instance_indices) -> void {
+  std::erase_if(visible_instance_indices, [&occlusion_culler, &instances](unsigned const instance_idx) {
+    auto const& instance{instances[instance_idx]};
+    return !instance.occluder && !occlusion_culler.IsVisible(instance.bounds_ws);
+  });
+}
+
+
+auto SceneRenderer::AllocatePerFrameConstants(int const rt_width, int const rt_height, Vector3 const& ambient_light,
+                                              ShadowParams const& shadow_params) const -> UINT {
+  return constant_buffer_ring_->Allocate(ShaderPerFrameConstants{
     .ambientLightColor = ambient_light, .shadowCascadeCount = shadow_params.cascade_count,
     .screenSize = Vector2{rt_width, rt_height}, .visualizeShadowCascades = shadow_params.visualize_cascades,
     .shadowFilteringMode = static_cast<int>(shadow_params.filtering_mode)
@@ -171,9 +262,9 @@ auto SceneRenderer::SetPerFrameConstants(ConstantBuffer<ShaderPerFrameConstants>
 }
 
 
-auto SceneRenderer::SetPerViewConstants(ConstantBuffer<ShaderPerViewConstants>& cb, Matrix4 const& view_mtx,
-                                        Matrix4 const& proj_mtx, ShadowCascadeBoundaries const& cascade_bounds,
-                                        Vector3 const& view_pos) -> void {
+auto SceneRenderer::AllocatePerViewConstants(Matrix4 const& view_mtx, Matrix4 const& proj_mtx,
+                                             ShadowCascadeBoundaries const& cascade_bounds,
+                                             Vector3 const& view_pos) const -> UINT {
   ShaderPerViewConstants data;
   data.viewMtx = view_mtx;
   data.projMtx = proj_mtx;
@@ -185,12 +276,7 @@ auto SceneRenderer::SetPerViewConstants(ConstantBuffer<ShaderPerViewConstants>&
     data.shadowCascadeSplitDistances[i] = cascade_bounds[i].farClip;
   }
 
-  cb.Update(data);
-}
-
-
-auto SceneRenderer::SetPerDrawConstants(ConstantBuffer<ShaderPerDrawConstants>& cb, Matrix4 const& model_mtx) -> void {
-  cb.Update(ShaderPerDrawConstants{.modelMtx = model_mtx, .invTranspModelMtx = model_mtx.Inverse().Transpose()});
+  return constant_buffer_ring_->Allocate(data);
 }
 
 
@@ -198,63 +284,77 @@ auto SceneRenderer::UpdatePunctualShadowAtlas(PunctualShadowAtlas& atlas,
                                               std::span<SceneRenderer::LightData const> const lights,
                                               std::span<unsigned const> visible_light_indices,
                                               SceneRenderer::CameraData const& cam_data,
-                                              Matrix4 const& cam_view_proj_mtx, float const shadow_distance) -> void {
-  struct LightCascadeIndex {
-    int lightIdxIdx;
-    int shadowIdx;
-  };
-
-  std::array lightIndexIndicesInCell{
-    std::vector<LightCascadeIndex>{}, std::vector<LightCascadeIndex>{},
-    std::vector<LightCascadeIndex>{}, std::vector<LightCascadeIndex>{}
-  };
-
+                                              Matrix4 const& cam_view_proj_mtx, float const shadow_distance,
+                                              std::span<InstanceData const> const instances,
+                                              std::span<unsigned const> const receiver_instance_indices,
+                                              std::vector<ShadowAtlas::ShadowMap>& shadow_maps) -> void {
   auto const& camPos{cam_data.position};
 
   auto const determineScreenCoverage{
-    [&camPos, &cam_view_proj_mtx](std::span<Vector3 const> const vertices) -> std::optional<int> {
-      std::optional<int> cellIdx;
-
+    [&camPos, &cam_view_proj_mtx](std::span<Vector3 const> const vertices) -> float {
       if (auto const [worldMin, worldMax]{AABB::FromVertices(vertices)};
         worldMin[0] <= camPos[0] && worldMin[1] <= camPos[1] && worldMin[2] <= camPos[2] && worldMax[0] >= camPos[0] &&
         worldMax[1] >= camPos[1] && worldMax[2] >= camPos[2]) {
-        cellIdx = 0;
-      } else {
-        Vector2 const bottomLeft{-1, -1};
-        Vector2 const topRight{1, 1};
-
-        Vector2 min{std::numeric_limits<float>::max()};
-        Vector2 max{std::numeric_limits<float>::lowest()};
-
-        for (auto& vertex : vertices) {
-          Vector4 vertex4{vertex, 1};
-          vertex4 *= cam_view_proj_mtx;
-          auto const projected{Vector2{vertex4} / vertex4[3]};
-          min = Clamp(Min(min, projected), bottomLeft, topRight);
-          max = Clamp(Max(max, projected), bottomLeft, topRight);
-        }
+        return 1;
+      }
 
-        auto const width{max[0] - min[0]};
-        auto const height{max[1] - min[1]};
+      Vector2 const bottomLeft{-1, -1};
+      Vector2 const topRight{1, 1};
 
-        auto const area{width * height};
-        auto const coverage{area / 4};
+      Vector2 min{std::numeric_limits<float>::max()};
+      Vector2 max{std::numeric_limits<float>::lowest()};
 
-        if (coverage >= 1) {
-          cellIdx = 0;
-        } else if (coverage >= 0.25f) {
-          cellIdx = 1;
-        } else if (coverage >= 0.0625f) {
-          cellIdx = 2;
-        } else if (coverage >= 0.015625f) {
-          cellIdx = 3;
-        }
+      for (auto& vertex : vertices) {
+        Vector4 vertex4{vertex, 1};
+        vertex4 *= cam_view_proj_mtx;
+        auto const projected{Vector2{vertex4} / vertex4[3]};
+        min = Clamp(Min(min, projected), bottomLeft, topRight);
+        max = Clamp(Max(max, projected), bottomLeft, topRight);
       }
 
-      return cellIdx;
+      auto const width{max[0] - min[0]};
+      auto const height{max[1] - min[1]};
+
+      auto const area{width * height};
+      return area / 4;
+    }
+  };
+
+  // Light components are at least pointer aligned, so the shadow map index fits in the low bits of their address
+  static_assert(alignof(LightComponent) >= 8 && MAX_PER_LIGHT_SHADOW_MAP_COUNT <= 8);
+
+  auto const makeShadowMapId{
+    [](LightComponent const* const light, int const shadowIdx) {
+      return static_cast<std::uint64_t>(std::bit_cast<std::uintptr_t>(light)) | static_cast<std::uint64_t>(shadowIdx);
+    }
+  };
+
+  auto const calculateShadowViewProjMtx{
+    [](LightData const& light, int const shadowIdx) -> Matrix4 {
+      if (light.type == LightComponent::Type::Spot) {
+        return Matrix4::LookTo(light.position, light.direction, Vector3::Up()) * Matrix4::PerspectiveFov(
+                 ToRadians(light.outer_angle), 1.f, light.range, light.shadow_near_plane);
+      }
+
+      return MakeCubeFaceViewMatrices(light.position)[shadowIdx] * TransformProjectionMatrixForRendering(
+               Matrix4::PerspectiveFov(ToRadians(90), 1, light.shadow_near_plane, light.range));
+    }
+  };
+
+  // Shadow maps that no receiver of the camera falls into are not rendered
+  auto const hasReceivers{
+    [this, &instances](Matrix4 const& shadowViewProjMtx) {
+      Frustum const shadowFrustumWS{shadowViewProjMtx};
+      return std::ranges::any_of(tmp_light_receiver_indices_,
+        [&instances, &shadowFrustumWS](unsigned const instanceIdx) {
+          return shadowFrustumWS.Intersects(instances[instanceIdx].bounds_ws);
+        });
     }
   };
 
+  tmp_punctual_shadow_candidates_.clear();
+  tmp_shadow_atlas_requests_.clear();
+
   for (auto i = 0; i < static_cast<int>(visible_light_indices.size()); i++) {
     if (auto const light{lights[visible_light_indices[i]]};
       light.casts_shadow && (light.type == LightComponent::Type::Spot || light.type == LightComponent::Type::Point)) {
@@ -267,6 +367,17 @@ auto SceneRenderer::UpdatePunctualShadowAtlas(PunctualShadowAtlas& atlas,
         continue;
       }
 
+      tmp_light_receiver_indices_.clear();
+      std::ranges::copy_if(receiver_instance_indices, std::back_inserter(tmp_light_receiver_indices_),
+        [&instances, &lightPos, lightRange](unsigned const instanceIdx) {
+          auto const& [boundsMin, boundsMax]{instances[instanceIdx].bounds_ws};
+          return Distance(Clamp(lightPos, boundsMin, boundsMax), lightPos) <= lightRange;
+        });
+
+      if (tmp_light_receiver_indices_.empty()) {
+        continue;
+      }
+
       if (light.type == LightComponent::Type::Spot) {
         auto lightVertices{CalculateSpotLightLocalVertices(light.range, light.outer_angle)};
 
@@ -274,11 +385,19 @@ auto SceneRenderer::UpdatePunctualShadowAtlas(PunctualShadowAtlas& atlas,
           vertex = Vector3{Vector4{vertex, 1} * modelMtxNoScale};
         }
 
-        if (auto const cellIdx{determineScreenCoverage(lightVertices)}) {
-          lightIndexIndicesInCell[*cellIdx].emplace_back(i, 0);
+        if (!hasReceivers(calculateShadowViewProjMtx(light, 0))) {
+          continue;
         }
+
+        tmp_punctual_shadow_candidates_.emplace_back(i, 0);
+        tmp_shadow_atlas_requests_.emplace_back(makeShadowMapId(light.component, 0),
+          determineScreenCoverage(lightVertices));
       } else if (light.type == LightComponent::Type::Point) {
         for (auto j = 0; j < 6; j++) {
+          if (!hasReceivers(calculateShadowViewProjMtx(light, j))) {
+            continue;
+          }
+
           std::array static const faceBoundsRotations{
             Quaternion::FromAxisAngle(Vector3::Up(), ToRadians(90)), // +X
             Quaternion::FromAxisAngle(Vector3::Up(), ToRadians(-90)), // -X
@@ -289,436 +408,991 @@ auto SceneRenderer::UpdatePunctualShadowAtlas(PunctualShadowAtlas& atlas,
           };
 
           std::array const shadowFrustumVertices{
-            faceBoundsRotations[i].Rotate(Vector3{lightRange, lightRange, lightRange}) + lightPos,
-            faceBoundsRotations[i].Rotate(Vector3{-lightRange, lightRange, lightRange}) + lightPos,
-            faceBoundsRotations[i].Rotate(Vector3{-lightRange, -lightRange, lightRange}) + lightPos,
-            faceBoundsRotations[i].Rotate(Vector3{lightRange, -lightRange, lightRange}) + lightPos, lightPos,
+            faceBoundsRotations[j].Rotate(Vector3{lightRange, lightRange, lightRange}) + lightPos,
+            faceBoundsRotations[j].Rotate(Vector3{-lightRange, lightRange, lightRange}) + lightPos,
+            faceBoundsRotations[j].Rotate(Vector3{-lightRange, -lightRange, lightRange}) + lightPos,
+            faceBoundsRotations[j].Rotate(Vector3{lightRange, -lightRange, lightRange}) + lightPos, lightPos,
           };
 
-          if (auto const cellIdx{determineScreenCoverage(shadowFrustumVertices)}) {
-            lightIndexIndicesInCell[*cellIdx].emplace_back(i, j);
-          }
+          tmp_punctual_shadow_candidates_.emplace_back(i, j);
+          tmp_shadow_atlas_requests_.emplace_back(makeShadowMapId(light.component, j),
+            determineScreenCoverage(shadowFrustumVertices));
         }
       }
     }
   }
 
-  for (auto i = 0; i < 4; i++) {
-    std::ranges::sort(lightIndexIndicesInCell[i],
-      [&visible_light_indices, &camPos, &lights](LightCascadeIndex const lhs, LightCascadeIndex const rhs) {
-        auto const leftLight{lights[visible_light_indices[lhs.lightIdxIdx]]};
-        auto const rightLight{lights[visible_light_indices[rhs.lightIdxIdx]]};
+  // Tiles are sized by the screen coverage and shrink gracefully when the atlas is full
+  atlas.GetAllocator().Allocate(tmp_shadow_atlas_requests_, tmp_shadow_atlas_tiles_);
 
-        auto const leftLightPos{leftLight.position};
-        auto const rightLightPos{rightLight.position};
+  shadow_maps.clear();
 
-        auto const leftDist{Distance(leftLightPos, camPos)};
-        auto const rightDist{Distance(camPos, rightLightPos)};
+  for (std::size_t i{0}; i < tmp_punctual_shadow_candidates_.size(); i++) {
+    if (!tmp_shadow_atlas_tiles_[i]) {
+      continue;
+    }
 
-        return leftDist > rightDist;
-      });
+    auto const [lightIdxIdx, shadowIdx]{tmp_punctual_shadow_candidates_[i]};
+    shadow_maps.emplace_back(calculateShadowViewProjMtx(lights[visible_light_indices[lightIdxIdx]], shadowIdx),
+      lightIdxIdx, shadowIdx, *tmp_shadow_atlas_tiles_[i]);
+  }
+}
 
-    for (auto j = 0; j < atlas.GetCell(i).GetElementCount(); j++) {
-      auto& subcell{atlas.GetCell(i).GetSubcell(j)};
-      subcell.reset();
 
-      if (lightIndexIndicesInCell[i].empty()) {
-        continue;
+auto SceneRenderer::CalculateDirectionalShadowMatrices(FramePacket const& frame_packet, LightData const& light,
+                                                       std::span<unsigned const> const receiver_instance_indices,
+                                                       AABB const& scene_bounds, CameraData const& cam_data,
+                                                       float const rt_aspect, int const cascade_count,
+                                                       ShadowCascadeBoundaries const& shadow_cascade_boundaries,
+                                                       std::array<Matrix4, MAX_CASCADE_COUNT>& shadow_view_matrices,
+                                                       std::array<Matrix4, MAX_CASCADE_COUNT>& shadow_proj_matrices)
+const -> void {
+  float const camNear{cam_data.near_plane};
+  float const camFar{cam_data.far_plane};
+
+  enum FrustumVertex : int {
+    FrustumVertex_NearTopRight    = 0,
+    FrustumVertex_NearTopLeft     = 1,
+    FrustumVertex_NearBottomLeft  = 2,
+    FrustumVertex_NearBottomRight = 3,
+    FrustumVertex_FarTopRight     = 4,
+    FrustumVertex_FarTopLeft      = 5,
+    FrustumVertex_FarBottomLeft   = 6,
+    FrustumVertex_FarBottomRight  = 7,
+  };
+
+  // Order of vertices is CCW from top right, near first
+  auto const frustumVertsWS{
+    [&cam_data, rt_aspect, camNear, camFar] {
+      std::array<Vector3, 8> ret;
+
+      Vector3 const nearWorldForward{cam_data.position + cam_data.forward * camNear};
+      Vector3 const farWorldForward{cam_data.position + cam_data.forward * camFar};
+
+      switch (cam_data.type) {
+        case Camera::Type::Perspective: {
+          float const tanHalfFov{std::tan(ToRadians(cam_data.fov_vert_deg / 2.0f))};
+          float const nearExtentY{camNear * tanHalfFov};
+          float const nearExtentX{nearExtentY * rt_aspect};
+          float const farExtentY{camFar * tanHalfFov};
+          float const farExtentX{farExtentY * rt_aspect};
+
+          ret[FrustumVertex_NearTopRight] = nearWorldForward + cam_data.right * nearExtentX + cam_data.up *
+                                            nearExtentY;
+          ret[FrustumVertex_NearTopLeft] = nearWorldForward - cam_data.right * nearExtentX + cam_data.up *
+                                           nearExtentY;
+          ret[FrustumVertex_NearBottomLeft] =
+            nearWorldForward - cam_data.right * nearExtentX - cam_data.up * nearExtentY;
+          ret[FrustumVertex_NearBottomRight] =
+            nearWorldForward + cam_data.right * nearExtentX - cam_data.up * nearExtentY;
+          ret[FrustumVertex_FarTopRight] = farWorldForward + cam_data.right * farExtentX + cam_data.up * farExtentY;
+          ret[FrustumVertex_FarTopLeft] = farWorldForward - cam_data.right * farExtentX + cam_data.up * farExtentY;
+          ret[FrustumVertex_FarBottomLeft] =
+            farWorldForward - cam_data.right * farExtentX - cam_data.up * farExtentY;
+          ret[FrustumVertex_FarBottomRight] =
+            farWorldForward + cam_data.right * farExtentX - cam_data.up * farExtentY;
+          break;
+        }
+        case Camera::Type::Orthographic: {
+          float const extentX{cam_data.size_vert / 2.0f};
+          float const extentY{extentX / rt_aspect};
+
+          ret[FrustumVertex_NearTopRight] = nearWorldForward + cam_data.right * extentX + cam_data.up * extentY;
+          ret[FrustumVertex_NearTopLeft] = nearWorldForward - cam_data.right * extentX + cam_data.up * extentY;
+          ret[FrustumVertex_NearBottomLeft] = nearWorldForward - cam_data.right * extentX - cam_data.up * extentY;
+          ret[FrustumVertex_NearBottomRight] = nearWorldForward + cam_data.right * extentX - cam_data.up * extentY;
+          ret[FrustumVertex_FarTopRight] = farWorldForward + cam_data.right * extentX + cam_data.up * extentY;
+          ret[FrustumVertex_FarTopLeft] = farWorldForward - cam_data.right * extentX + cam_data.up * extentY;
+          ret[FrustumVertex_FarBottomLeft] = farWorldForward - cam_data.right * extentX - cam_data.up * extentY;
+          ret[FrustumVertex_FarBottomRight] = farWorldForward + cam_data.right * extentX - cam_data.up * extentY;
+          break;
+        }
       }
 
-      auto const [lightIdxIdx, shadowIdx]{lightIndexIndicesInCell[i].back()};
-      auto const light{lights[visible_light_indices[lightIdxIdx]]};
-      lightIndexIndicesInCell[i].pop_back();
+      return ret;
+    }()
+  };
 
-      if (light.type == LightComponent::Type::Spot) {
-        auto const shadowViewMtx{Matrix4::LookTo(light.position, light.direction, Vector3::Up())};
-        auto const shadowProjMtx{
-          Matrix4::PerspectiveFov(ToRadians(light.outer_angle), 1.f, light.range, light.shadow_near_plane)
-        };
+  auto const frustumDepth{camFar - camNear};
 
-        subcell.emplace(shadowViewMtx * shadowProjMtx, lightIdxIdx, shadowIdx);
-      } else if (light.type == LightComponent::Type::Point) {
-        auto const lightPos{light.position};
+  // The light view only rotates, so the cascades are fitted as axis aligned boxes in light space
+  auto const lightViewMtx{Matrix4::LookTo(Vector3::Zero(), light.direction, Vector3::Up())};
+  auto const sceneBoundsLS{scene_bounds.Transform(lightViewMtx)};
 
-        auto const faceViewMatrices{MakeCubeFaceViewMatrices(lightPos)};
-        auto const shadowViewMtx{faceViewMatrices[shadowIdx]};
-        auto const shadowProjMtx{
-          TransformProjectionMatrixForRendering(Matrix4::PerspectiveFov(ToRadians(90), 1, light.shadow_near_plane,
-            light.range))
-        };
+  // Light space bounds of the receivers that overlap the depth range of each cascade
+  std::array<std::optional<AABB>, MAX_CASCADE_COUNT> receiverBoundsLS;
+
+  for (auto const instanceIdx : receiver_instance_indices) {
+    auto const& boundsWS{frame_packet.instance_data[instanceIdx].bounds_ws};
+    auto const [receiverNear, receiverFar]{CalculateViewDepthRange(cam_data.position, cam_data.forward, boundsWS)};
+    std::optional<AABB> boundsLS;
 
-        subcell.emplace(shadowViewMtx * shadowProjMtx, lightIdxIdx, shadowIdx);
+    for (auto cascadeIdx{0}; cascadeIdx < cascade_count; cascadeIdx++) {
+      if (receiverNear > shadow_cascade_boundaries[cascadeIdx].farClip ||
+          receiverFar < shadow_cascade_boundaries[cascadeIdx].nearClip) {
+        continue;
       }
-    }
 
-    if (i + 1 < 4) {
-      std::ranges::copy(lightIndexIndicesInCell[i], std::back_inserter(lightIndexIndicesInCell[i + 1]));
+      if (!boundsLS) {
+        boundsLS = boundsWS.Transform(lightViewMtx);
+      }
+
+      auto& cascadeReceiverBoundsLS{receiverBoundsLS[cascadeIdx]};
+      cascadeReceiverBoundsLS = cascadeReceiverBoundsLS ? AABB::Union(*cascadeReceiverBoundsLS, *boundsLS) : *boundsLS;
     }
   }
-}
-
 
-auto SceneRenderer::DrawDirectionalShadowMaps(FramePacket const& frame_packet,
-                                              std::span<unsigned const> const visible_light_indices,
-                                              CameraData const& cam_data, float rt_aspect, int const cascade_count,
-                                              ShadowCascadeBoundaries const& shadow_cascade_boundaries,
-                                              std::array<Matrix4, MAX_CASCADE_COUNT>& shadow_view_proj_matrices,
-                                              graphics::CommandList& cmd) -> void {
-  cmd.SetPipelineState(*shadow_pso_);
-  cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, samp_idx), samp_af16_wrap_.Get());
-  cmd.SetRenderTargets({}, dir_shadow_map_arr_->GetTex().get());
-  cmd.ClearDepthStencil(*dir_shadow_map_arr_->GetTex(), D3D12_CLEAR_FLAG_DEPTH, 0.0f, 0, {});
-
-  for (auto const lightIdx : visible_light_indices) {
-    if (auto const light{frame_packet.light_data[lightIdx]};
-      light.type == LightComponent::Type::Directional && light.casts_shadow) {
-      float const camNear{cam_data.near_plane};
-      float const camFar{cam_data.far_plane};
-
-      enum FrustumVertex : int {
-        FrustumVertex_NearTopRight    = 0,
-        FrustumVertex_NearTopLeft     = 1,
-        FrustumVertex_NearBottomLeft  = 2,
-        FrustumVertex_NearBottomRight = 3,
-        FrustumVertex_FarTopRight     = 4,
-        FrustumVertex_FarTopLeft      = 5,
-        FrustumVertex_FarBottomLeft   = 6,
-        FrustumVertex_FarBottomRight  = 7,
-      };
+  auto const shadowMapSize{static_cast<float>(dir_shadow_map_size_)};
 
-      // Order of vertices is CCW from top right, near first
-      auto const frustumVertsWS{
-        [&cam_data, rt_aspect, camNear, camFar] {
-          std::array<Vector3, 8> ret;
-
-          Vector3 const nearWorldForward{cam_data.position + cam_data.forward * camNear};
-          Vector3 const farWorldForward{cam_data.position + cam_data.forward * camFar};
-
-          switch (cam_data.type) {
-            case Camera::Type::Perspective: {
-              float const tanHalfFov{std::tan(ToRadians(cam_data.fov_vert_deg / 2.0f))};
-              float const nearExtentY{camNear * tanHalfFov};
-              float const nearExtentX{nearExtentY * rt_aspect};
-              float const farExtentY{camFar * tanHalfFov};
-              float const farExtentX{farExtentY * rt_aspect};
-
-              ret[FrustumVertex_NearTopRight] = nearWorldForward + cam_data.right * nearExtentX + cam_data.up *
-                                                nearExtentY;
-              ret[FrustumVertex_NearTopLeft] = nearWorldForward - cam_data.right * nearExtentX + cam_data.up *
-                                               nearExtentY;
-              ret[FrustumVertex_NearBottomLeft] =
-                nearWorldForward - cam_data.right * nearExtentX - cam_data.up * nearExtentY;
-              ret[FrustumVertex_NearBottomRight] =
-                nearWorldForward + cam_data.right * nearExtentX - cam_data.up * nearExtentY;
-              ret[FrustumVertex_FarTopRight] = farWorldForward + cam_data.right * farExtentX + cam_data.up * farExtentY;
-              ret[FrustumVertex_FarTopLeft] = farWorldForward - cam_data.right * farExtentX + cam_data.up * farExtentY;
-              ret[FrustumVertex_FarBottomLeft] =
-                farWorldForward - cam_data.right * farExtentX - cam_data.up * farExtentY;
-              ret[FrustumVertex_FarBottomRight] =
-                farWorldForward + cam_data.right * farExtentX - cam_data.up * farExtentY;
-              break;
-            }
-            case Camera::Type::Orthographic: {
-              float const extentX{cam_data.size_vert / 2.0f};
-              float const extentY{extentX / rt_aspect};
-
-              ret[FrustumVertex_NearTopRight] = nearWorldForward + cam_data.right * extentX + cam_data.up * extentY;
-              ret[FrustumVertex_NearTopLeft] = nearWorldForward - cam_data.right * extentX + cam_data.up * extentY;
-              ret[FrustumVertex_NearBottomLeft] = nearWorldForward - cam_data.right * extentX - cam_data.up * extentY;
-              ret[FrustumVertex_NearBottomRight] = nearWorldForward + cam_data.right * extentX - cam_data.up * extentY;
-              ret[FrustumVertex_FarTopRight] = farWorldForward + cam_data.right * extentX + cam_data.up * extentY;
-              ret[FrustumVertex_FarTopLeft] = farWorldForward - cam_data.right * extentX + cam_data.up * extentY;
-              ret[FrustumVertex_FarBottomLeft] = farWorldForward - cam_data.right * extentX - cam_data.up * extentY;
-              ret[FrustumVertex_FarBottomRight] = farWorldForward + cam_data.right * extentX - cam_data.up * extentY;
-              break;
-            }
-          }
+  for (auto cascadeIdx{0}; cascadeIdx < cascade_count; cascadeIdx++) {
+    // cascade vertices in light space
+    auto const cascadeVertsLS{
+      [&frustumVertsWS, &shadow_cascade_boundaries, &lightViewMtx, cascadeIdx, camNear, frustumDepth] {
+        auto const [cascadeNear, cascadeFar]{shadow_cascade_boundaries[cascadeIdx]};
 
-          return ret;
-        }()
-      };
+        float const cascadeNearNorm{(cascadeNear - camNear) / frustumDepth};
+        float const cascadeFarNorm{(cascadeFar - camNear) / frustumDepth};
 
-      auto const frustumDepth{camFar - camNear};
+        std::array<Vector3, 8> ret;
 
-      for (auto cascadeIdx{0}; cascadeIdx < cascade_count; cascadeIdx++) {
-        // cascade vertices in world space
-        auto const cascadeVertsWS{
-          [&frustumVertsWS, &shadow_cascade_boundaries, cascadeIdx, camNear, frustumDepth] {
-            auto const [cascadeNear, cascadeFar]{shadow_cascade_boundaries[cascadeIdx]};
+        for (auto j = 0; j < 4; j++) {
+          Vector3 const& from{frustumVertsWS[j]};
+          Vector3 const& to{frustumVertsWS[j + 4]};
 
-            float const cascadeNearNorm{(cascadeNear - camNear) / frustumDepth};
-            float const cascadeFarNorm{(cascadeFar - camNear) / frustumDepth};
+          ret[j] = Vector3{Vector4{Lerp(from, to, cascadeNearNorm), 1} * lightViewMtx};
+          ret[j + 4] = Vector3{Vector4{Lerp(from, to, cascadeFarNorm), 1} * lightViewMtx};
+        }
 
-            std::array<Vector3, 8> ret;
+        return ret;
+      }()
+    };
 
-            for (auto j = 0; j < 4; j++) {
-              Vector3 const& from{frustumVertsWS[j]};
-              Vector3 const& to{frustumVertsWS[j + 4]};
+    // Only the part of the split frustum that contains receivers has to be covered
+    auto fitBoundsLS{AABB::FromVertices(cascadeVertsLS)};
 
-              ret[j] = Lerp(from, to, cascadeNearNorm);
-              ret[j + 4] = Lerp(from, to, cascadeFarNorm);
-            }
+    if (auto const& cascadeReceiverBoundsLS{receiverBoundsLS[cascadeIdx]}) {
+      auto const intersectionMin{Max(fitBoundsLS.min, cascadeReceiverBoundsLS->min)};
+      auto const intersectionMax{Min(fitBoundsLS.max, cascadeReceiverBoundsLS->max)};
 
-            return ret;
-          }()
-        };
+      if (intersectionMin[0] < intersectionMax[0] && intersectionMin[1] < intersectionMax[1] &&
+          intersectionMin[2] <= intersectionMax[2]) {
+        fitBoundsLS = AABB{intersectionMin, intersectionMax};
+      }
+    }
 
-        Vector3 cascadeCenterWS{Vector3::Zero()};
+    // The size is rounded up to a few steps per doubling, so the texel size only changes when the fit changes a lot.
+    // The box is then moved in whole texels so that the texels do not slide over the scene as the camera moves.
+    // One extra texel leaves room for the snapping.
+    auto const fitSize{
+      std::max(fitBoundsLS.max[0] - fitBoundsLS.min[0], fitBoundsLS.max[1] - fitBoundsLS.min[1]) * shadowMapSize /
+      (shadowMapSize - 1)
+    };
+    auto const cascadeSize{
+      std::exp2(std::ceil(std::log2(fitSize) * cascade_size_steps_per_octave_) / cascade_size_steps_per_octave_)
+    };
+    auto const worldUnitsPerTexel{cascadeSize / shadowMapSize};
+    auto const left{std::floor(fitBoundsLS.min[0] / worldUnitsPerTexel) * worldUnitsPerTexel};
+    auto const bottom{std::floor(fitBoundsLS.min[1] / worldUnitsPerTexel) * worldUnitsPerTexel};
 
-        for (Vector3 const& cascadeVertWS : cascadeVertsWS) {
-          cascadeCenterWS += cascadeVertWS;
-        }
+    // Casters between the light and the receivers are included by extruding the box toward the light
+    auto const nearZ{std::min(sceneBoundsLS.min[2], fitBoundsLS.min[2]) - light.shadow_extension};
 
-        cascadeCenterWS /= 8.0f;
+    shadow_view_matrices[cascadeIdx] = lightViewMtx;
+    shadow_proj_matrices[cascadeIdx] = TransformProjectionMatrixForRendering(Matrix4::OrthographicOffCenter(left,
+      left + cascadeSize, bottom + cascadeSize, bottom, nearZ, fitBoundsLS.max[2]));
+  }
+}
 
-        auto sphereRadius{0.0f};
 
-        for (Vector3 const& cascadeVertWS : cascadeVertsWS) {
-          sphereRadius = std::max(sphereRadius, Distance(cascadeCenterWS, cascadeVertWS));
-        }
+auto SceneRenderer::PrepareCameraView(FramePacket const& frame_packet, CameraData const& cam_data,
+                                      CameraViewData& cam_view, std::vector<CullView>& cull_views) -> void {
+  auto const& target_rt_desc{frame_packet.render_targets[cam_data.rt_local_idx]->GetDesc()};
 
-        auto const shadowMapSize{dir_shadow_map_arr_->GetSize()};
-        auto const worldUnitsPerTexel{sphereRadius * 2.0f / static_cast<float>(shadowMapSize)};
-
-        Matrix4 shadowViewMtx{Matrix4::LookTo(Vector3::Zero(), light.direction, Vector3::Up())};
-        cascadeCenterWS = Vector3{Vector4{cascadeCenterWS, 1} * shadowViewMtx};
-        cascadeCenterWS /= worldUnitsPerTexel;
-        cascadeCenterWS[0] = std::floor(cascadeCenterWS[0]);
-        cascadeCenterWS[1] = std::floor(cascadeCenterWS[1]);
-        cascadeCenterWS *= worldUnitsPerTexel;
-        // shadowViewMtx is only rotation, transpose is its inverse
-        cascadeCenterWS = Vector3{Vector4{cascadeCenterWS, 1} * shadowViewMtx.Transpose()};
-
-        shadowViewMtx = Matrix4::LookTo(cascadeCenterWS, light.direction, Vector3::Up());
-        auto const shadowProjMtx{
-          TransformProjectionMatrixForRendering(Matrix4::OrthographicOffCenter(-sphereRadius, sphereRadius,
-            sphereRadius, -sphereRadius, -sphereRadius - light.shadow_extension, sphereRadius))
-        };
+  auto const target_rt_width{target_rt_desc.width};
+  auto const target_rt_height{target_rt_desc.height};
 
-        shadow_view_proj_matrices[cascadeIdx] = shadowViewMtx * shadowProjMtx;
+  cam_view.viewport = CD3DX12_VIEWPORT{
+    cam_data.viewport.left * static_cast<FLOAT>(target_rt_width),
+    cam_data.viewport.top * static_cast<float>(target_rt_height),
+    std::max(
+      cam_data.viewport.right * static_cast<float>(target_rt_width) - cam_data.viewport.left * static_cast<FLOAT>(
+        target_rt_width), 1.0f),
+    std::max(
+      cam_data.viewport.bottom * static_cast<float>(target_rt_height) - cam_data.viewport.top * static_cast<float>(
+        target_rt_height), 1.0f),
+  };
 
-        cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, rt_idx), cascadeIdx);
+  cam_view.scissor = CD3DX12_RECT{
+    static_cast<LONG>(cam_data.viewport.left * static_cast<FLOAT>(target_rt_width)),
+    static_cast<LONG>(cam_data.viewport.top * static_cast<FLOAT>(target_rt_height)),
+    std::max(static_cast<LONG>(cam_data.viewport.right * static_cast<FLOAT>(target_rt_width)), 1l),
+    std::max(static_cast<LONG>(cam_data.viewport.bottom * static_cast<FLOAT>(target_rt_height)), 1l),
+  };
 
-        D3D12_VIEWPORT const shadowViewport{
-          0, 0, static_cast<float>(shadowMapSize), static_cast<float>(shadowMapSize), 0, 1
-        };
+  auto const viewport_aspect{cam_view.viewport.Width / cam_view.viewport.Height};
 
-        D3D12_RECT const shadow_scissor{0, 0, static_cast<LONG>(shadowMapSize), static_cast<LONG>(shadowMapSize)};
+  cam_view.view_mtx = Camera::CalculateViewMatrix(cam_data.position, cam_data.right, cam_data.up, cam_data.forward);
+  cam_view.proj_mtx = TransformProjectionMatrixForRendering(Camera::CalculateProjectionMatrix(cam_data.type,
+    cam_data.fov_vert_deg, cam_data.size_vert, viewport_aspect, cam_data.near_plane, cam_data.far_plane));
+  cam_view.view_proj_mtx = cam_view.view_mtx * cam_view.proj_mtx;
 
-        cmd.SetViewports(std::array{shadowViewport});
-        cmd.SetScissorRects(std::array{shadow_scissor});
+  Frustum const cam_frust_ws{cam_view.view_proj_mtx};
 
-        auto& per_view_cb{AcquirePerViewConstantBuffer()};
-        SetPerViewConstants(per_view_cb, shadowViewMtx, shadowProjMtx, ShadowCascadeBoundaries{}, Vector3{});
-        cmd.SetConstantBuffer(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, per_view_cb_idx), *per_view_cb.GetBuffer());
+  cam_view.visible_light_indices.clear();
+  CullLights(cam_frust_ws, frame_packet.light_data, cam_view.visible_light_indices);
 
-        Frustum const shadow_frustum_ws{shadow_view_proj_matrices[cascadeIdx]};
+  cam_view.visible_list_idx = static_cast<unsigned>(cull_views.size());
+  cull_views.emplace_back(cam_frust_ws, nullptr, false, std::nullopt, Vector3{0}, cam_data.forward);
 
-        std::pmr::vector<unsigned> visible_static_submesh_instance_indices;
-        CullStaticSubmeshInstances(shadow_frustum_ws, frame_packet.mesh_data, frame_packet.submesh_data,
-          frame_packet.instance_data, visible_static_submesh_instance_indices);
+  // The first visible directional light that casts shadows gets the cascades, which are only fitted once the camera
+  // view is culled
 
-        for (auto const instance_idx : visible_static_submesh_instance_indices) {
-          auto const& instance{frame_packet.instance_data[instance_idx]};
-          auto const& submesh{frame_packet.submesh_data[instance.submesh_local_idx]};
-          auto const& mesh{frame_packet.mesh_data[submesh.mesh_local_idx]};
-          auto const& mtl_buf{frame_packet.buffers[submesh.mtl_buf_local_idx]};
+  auto const dir_shadow_light_idx_it{
+    std::ranges::find_if(cam_view.visible_light_indices, [&frame_packet](unsigned const light_idx) {
+      auto const& light{frame_packet.light_data[light_idx]};
+      return light.type == LightComponent::Type::Directional && light.casts_shadow;
+    })
+  };
 
-          auto& per_draw_cb{AcquirePerDrawConstantBuffer()};
-          SetPerDrawConstants(per_draw_cb, instance.local_to_world_mtx);
+  cam_view.has_dir_shadow = dir_shadow_light_idx_it != std::end(cam_view.visible_light_indices);
+  cam_view.dir_shadow_light_idx = cam_view.has_dir_shadow ? *dir_shadow_light_idx_it : 0;
 
-          cmd.SetShaderResource(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, pos_buf_idx),
-            *frame_packet.buffers[mesh.pos_buf_local_idx]);
-          cmd.SetShaderResource(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, uv_buf_idx),
-            *frame_packet.buffers[mesh.uv_buf_local_idx]);
-          cmd.SetConstantBuffer(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, mtl_idx), *mtl_buf);
-          cmd.SetConstantBuffer(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, per_draw_cb_idx),
-            *per_draw_cb.GetBuffer());
-          cmd.SetIndexBuffer(*frame_packet.buffers[mesh.idx_buf_local_idx], mesh.idx_format);
-          cmd.DrawIndexedInstanced(submesh.index_count, 1, submesh.first_index, submesh.base_vertex, 0);
-        }
-      }
+  // The punctual shadow maps are also only chosen once the receivers are known, but the lights bound their count
+  cam_view.max_shadow_view_count = cam_view.has_dir_shadow
+                                     ? static_cast<std::size_t>(frame_packet.shadow_params.cascade_count)
+                                     : 0;
 
-      break;
+  for (auto const light_idx : cam_view.visible_light_indices) {
+    if (auto const& light{frame_packet.light_data[light_idx]}; !light.casts_shadow) {
+      continue;
+    } else if (light.type == LightComponent::Type::Point) {
+      cam_view.max_shadow_view_count += 6;
+    } else if (light.type == LightComponent::Type::Spot) {
+      cam_view.max_shadow_view_count += 1;
     }
   }
 }
 
 
-auto SceneRenderer::DrawPunctualShadowMaps(PunctualShadowAtlas const& atlas,
-                                           SceneRenderer::FramePacket const& frame_packet,
-                                           graphics::CommandList& cmd) -> void {
-  cmd.SetPipelineState(*shadow_pso_);
-  cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, rt_idx), 0);
-  cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, samp_idx), samp_af16_wrap_.Get());
-  cmd.SetRenderTargets({}, atlas.GetTex().get());
-  cmd.ClearDepthStencil(*atlas.GetTex(), D3D12_CLEAR_FLAG_DEPTH, 0, 0, {});
-
-  auto const cell_size_norm{atlas.GetNormalizedElementSize()};
+auto SceneRenderer::PrepareShadowViews(FramePacket const& frame_packet, CameraData const& cam_data,
+                                       std::span<unsigned const> const cam_visible_instance_indices,
+                                       AABB const& scene_bounds, CameraViewData& cam_view,
+                                       std::vector<CullView>& cull_views) -> void {
+  // The visible instances are the receivers, their depth range bounds the shadowed part of the camera frustum
+  auto receiver_near{std::numeric_limits<float>::max()};
+  auto receiver_far{std::numeric_limits<float>::lowest()};
 
-  for (auto i = 0; i < atlas.GetElementCount(); i++) {
-    auto const& cell{atlas.GetCell(i)};
-    auto const cell_offset_norm{atlas.GetNormalizedElementOffset(i)};
-    auto const subcell_size{cell_size_norm * cell.GetNormalizedElementSize() * static_cast<float>(atlas.GetSize())};
+  for (auto const instance_idx : cam_visible_instance_indices) {
+    auto const [instance_near, instance_far]{
+      CalculateViewDepthRange(cam_data.position, cam_data.forward, frame_packet.instance_data[instance_idx].bounds_ws)
+    };
+    receiver_near = std::min(receiver_near, instance_near);
+    receiver_far = std::max(receiver_far, instance_far);
+  }
 
-    for (auto j = 0; j < cell.GetElementCount(); j++) {
-      if (auto const& subcell{cell.GetSubcell(j)}) {
-        auto const subcell_offset{
-          (cell_offset_norm + cell.GetNormalizedElementOffset(j) * cell_size_norm) * static_cast<float>(atlas.GetSize())
-        };
+  cam_view.shadow_cascade_boundaries = CalculateCameraShadowCascadeBoundaries(cam_data, frame_packet.shadow_params,
+    receiver_near, receiver_far);
 
-        D3D12_VIEWPORT const viewport{subcell_offset[0], subcell_offset[1], subcell_size, subcell_size, 0, 1};
-        D3D12_RECT const scissor{
-          static_cast<LONG>(subcell_offset[0]), static_cast<LONG>(subcell_offset[1]),
-          static_cast<LONG>(subcell_offset[0] + subcell_size), static_cast<LONG>(subcell_offset[1] + subcell_size)
-        };
+  auto const viewport_aspect{cam_view.viewport.Width / cam_view.viewport.Height};
 
-        cmd.SetViewports(std::span{&viewport, 1});
-        cmd.SetScissorRects(std::array{scissor});
+  // Directional shadow views
 
-        auto& per_view_cb{AcquirePerViewConstantBuffer()};
-        SetPerViewConstants(per_view_cb, Matrix4::Identity(), subcell->shadowViewProjMtx, ShadowCascadeBoundaries{},
-          Vector3{});
-        cmd.SetConstantBuffer(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, per_view_cb_idx), *per_view_cb.GetBuffer());
+  if (cam_view.has_dir_shadow) {
+    auto const& light{frame_packet.light_data[cam_view.dir_shadow_light_idx]};
 
-        Frustum const shadow_frustum_ws{subcell->shadowViewProjMtx};
+    CalculateDirectionalShadowMatrices(frame_packet, light, cam_visible_instance_indices, scene_bounds, cam_data,
+      viewport_aspect, frame_packet.shadow_params.cascade_count, cam_view.shadow_cascade_boundaries,
+      cam_view.shadow_view_matrices, cam_view.shadow_proj_matrices);
 
-        std::pmr::vector<unsigned> visible_static_submesh_instance_indices;
-        CullStaticSubmeshInstances(shadow_frustum_ws, frame_packet.mesh_data, frame_packet.submesh_data,
-          frame_packet.instance_data, visible_static_submesh_instance_indices);
+    // No shadow travels farther than the scene is large
+    auto const caster_extrusion{light.direction * Length(scene_bounds.max - scene_bounds.min)};
 
-        for (auto const instance_idx : visible_static_submesh_instance_indices) {
-          auto const& instance{frame_packet.instance_data[instance_idx]};
-          auto const& submesh{frame_packet.submesh_data[instance.submesh_local_idx]};
-          auto const& mesh{frame_packet.mesh_data[submesh.mesh_local_idx]};
-          auto const& mtl_buf{frame_packet.buffers[submesh.mtl_buf_local_idx]};
+    for (auto i{0}; i < frame_packet.shadow_params.cascade_count; i++) {
+      cam_view.shadow_view_proj_matrices[i] = cam_view.shadow_view_matrices[i] * cam_view.shadow_proj_matrices[i];
+      cam_view.cascade_visible_list_indices[i] = static_cast<unsigned>(cull_views.size());
 
-          auto& per_draw_cb{AcquirePerDrawConstantBuffer()};
-          SetPerDrawConstants(per_draw_cb, instance.local_to_world_mtx);
+      // The receivers of a cascade are in the slice of the camera frustum the cascade covers
+      auto const [cascade_near, cascade_far]{cam_view.shadow_cascade_boundaries[i]};
+      Frustum const receiver_frustum_ws{
+        cam_view.view_mtx * TransformProjectionMatrixForRendering(Camera::CalculateProjectionMatrix(cam_data.type,
+          cam_data.fov_vert_deg, cam_data.size_vert, viewport_aspect, cascade_near, cascade_far))
+      };
 
-          cmd.SetShaderResource(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, pos_buf_idx),
-            *frame_packet.buffers[mesh.pos_buf_local_idx]);
-          cmd.SetShaderResource(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, uv_buf_idx),
-            *frame_packet.buffers[mesh.uv_buf_local_idx]);
-          cmd.SetConstantBuffer(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, mtl_idx), *mtl_buf);
-          cmd.SetConstantBuffer(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, per_draw_cb_idx),
-            *per_draw_cb.GetBuffer());
-          cmd.SetIndexBuffer(*frame_packet.buffers[mesh.idx_buf_local_idx], mesh.idx_format);
-          cmd.DrawIndexedInstanced(submesh.index_count, 1, submesh.first_index, submesh.base_vertex, 0);
-        }
-      }
+      cull_views.emplace_back(Frustum{cam_view.shadow_view_proj_matrices[i]}, nullptr, true, receiver_frustum_ws,
+        caster_extrusion, light.direction);
     }
   }
-}
 
+  // Punctual shadow views
 
-auto SceneRenderer::ClearGizmoDrawQueue() noexcept -> void {
-  gizmo_colors_.clear();
-  line_gizmo_vertex_data_.clear();
+  UpdatePunctualShadowAtlas(*punctual_shadow_atlas_, frame_packet.light_data, cam_view.visible_light_indices, cam_data,
+    cam_view.view_proj_mtx, frame_packet.shadow_params.distance, frame_packet.instance_data,
+    cam_visible_instance_indices, cam_view.punctual_shadow_maps);
+
+  cam_view.punctual_shadow_map_visible_list_indices.clear();
+
+  for (auto const& shadow_map : cam_view.punctual_shadow_maps) {
+    auto const& light{frame_packet.light_data[cam_view.visible_light_indices[shadow_map.visible_light_idx_idx]]};
+    auto const draw_sort_dir{
+      light.type == LightComponent::Type::Spot ? light.direction : MakeCubeFaceDirections()[shadow_map.shadow_map_idx]
+    };
+
+    cam_view.punctual_shadow_map_visible_list_indices.emplace_back(static_cast<unsigned>(cull_views.size()));
+    cull_views.emplace_back(Frustum{shadow_map.shadow_view_proj_mtx}, nullptr, true, std::nullopt, Vector3{0},
+      draw_sort_dir);
+  }
 }
 
 
-auto SceneRenderer::RecreateSsaoSamples(int const sample_count) noexcept -> void {
-  ssao_samples_buffer_.Resize(sample_count);
-  auto const ssao_samples{ssao_samples_buffer_.GetData()};
+auto SceneRenderer::EvaluateSkinnedMeshPoses(FramePacket& frame_packet, std::span<Matrix4> const bone_palette) -> void {
+  auto const frame_count{render_manager_->GetCurrentFrameCount()};
 
-  std::uniform_real_distribution dist{0.0f, 1.0f};
-  std::default_random_engine gen; // NOLINT(cert-msc51-cpp)
+  // Cameras are only known here, so the animation detail is selected against them right before evaluation
 
-  for (auto i{0}; i < sample_count; i++) {
-    Vector3 sample{dist(gen) * 2 - 1, dist(gen) * 2 - 1, dist(gen)};
-    Normalize(sample);
-    sample *= dist(gen);
+  tmp_animation_lod_views_.clear();
 
-    auto scale{static_cast<float>(i) / static_cast<float>(sample_count)};
-    scale = std::lerp(0.1f, 1.0f, scale * scale);
-    sample *= scale;
+  for (auto const& cam_data : frame_packet.cam_data) {
+    auto const& rt_desc{frame_packet.render_targets[cam_data.rt_local_idx]->GetDesc()};
+    auto const viewport_width{
+      std::max((cam_data.viewport.right - cam_data.viewport.left) * static_cast<float>(rt_desc.width), 1.0f)
+    };
+    auto const viewport_height{
+      std::max((cam_data.viewport.bottom - cam_data.viewport.top) * static_cast<float>(rt_desc.height), 1.0f)
+    };
+    auto const view_proj_mtx{
+      Camera::CalculateViewMatrix(cam_data.position, cam_data.right, cam_data.up, cam_data.forward) *
+      TransformProjectionMatrixForRendering(Camera::CalculateProjectionMatrix(cam_data.type, cam_data.fov_vert_deg,
+        cam_data.size_vert, viewport_width / viewport_height, cam_data.near_plane, cam_data.far_plane))
+    };
+    auto const perspective{cam_data.type == Camera::Type::Perspective};
 
-    ssao_samples[i] = Vector4{sample, 0};
+    tmp_animation_lod_views_.emplace_back(AnimationLodScheduler::View{
+      Frustum{view_proj_mtx}, cam_data.position,
+      perspective ? 0.5f / std::tan(ToRadians(cam_data.fov_vert_deg / 2.0f)) : 1.0f / cam_data.size_vert, perspective
+    });
   }
-}
 
+  tmp_posed_skinned_meshes_.clear();
+  tmp_animation_lod_instances_.clear();
 
-auto SceneRenderer::RecreatePipelines() -> void {
-  CD3DX12_DEPTH_STENCIL_DESC1 const reverse_z_depth_stencil_write{
-    TRUE, D3D12_DEPTH_WRITE_MASK_ALL, D3D12_COMPARISON_FUNC_GREATER, FALSE, {}, {}, {}, {}, {}, {}, {}, {}, {}, {},
-    FALSE
-  };
+  for (unsigned i{0}; i < static_cast<unsigned>(frame_packet.skinned_mesh_data.size()); i++) {
+    auto const& skinned_mesh{frame_packet.skinned_mesh_data[i]};
 
-  CD3DX12_DEPTH_STENCIL_DESC1 const reverse_z_depth_stencil_read{
-    TRUE, D3D12_DEPTH_WRITE_MASK_ZERO, D3D12_COMPARISON_FUNC_GREATER_EQUAL, FALSE, {}, {}, {}, {}, {}, {}, {}, {}, {},
-    {}, FALSE
-  };
+    if (!skinned_mesh.bones || !skinned_mesh.bind_pose) {
+      continue;
+    }
 
-  CD3DX12_DEPTH_STENCIL_DESC1 const disabled_depth_stencil{
-    FALSE, D3D12_DEPTH_WRITE_MASK_ZERO, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, FALSE
-  };
+    // Map nodes are never moved, so the records can be referenced while the jobs run
+    auto& record{animated_instances_[skinned_mesh.component]};
+    record.last_used_frame = frame_count;
 
-  CD3DX12_RASTERIZER_DESC const shadow_rasterizer_desc{
-    D3D12_FILL_MODE_SOLID, D3D12_CULL_MODE_BACK, FALSE, -1, 0.f, -2.5f, TRUE, FALSE, FALSE, 0,
-    D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF
-  };
+    // The history is meaningless for another skeleton
+    if (auto const history_size{skinned_mesh.bones->size() * 2}; record.palette_history.size() != history_size) {
+      record.palette_history.resize(history_size);
+      record.evaluated = false;
+    }
 
-  DXGI_SAMPLE_DESC const msaa_sample_desc{static_cast<UINT>(msaa_mode_), 0};
-  CD3DX12_RT_FORMAT_ARRAY const render_target_format{D3D12_RT_FORMAT_ARRAY{{render_target_format_}, 1}};
-  CD3DX12_RT_FORMAT_ARRAY const color_format{D3D12_RT_FORMAT_ARRAY{{color_buffer_format_}, 1}};
-  CD3DX12_RT_FORMAT_ARRAY const ssao_format{D3D12_RT_FORMAT_ARRAY{{ssao_buffer_format_}, 1}};
+    if (auto const submesh_count{skinned_mesh.submesh_bones ? skinned_mesh.submesh_bones->size() : 0};
+      record.submesh_bounds.size() != submesh_count) {
+      record.submesh_bounds.resize(submesh_count);
+      record.prev_submesh_bounds.resize(submesh_count);
+      record.evaluated = false;
+    }
 
-  graphics::PipelineDesc const depth_normal_pso_desc{
-    .vs = CD3DX12_SHADER_BYTECODE{g_depth_normal_vs_bytes, ARRAYSIZE(g_depth_normal_vs_bytes)},
-    .ps = CD3DX12_SHADER_BYTECODE{g_depth_normal_ps_bytes, ARRAYSIZE(g_depth_normal_ps_bytes)},
-    .depth_stencil_state = reverse_z_depth_stencil_write, .ds_format = depth_format_,
-    .rt_formats = CD3DX12_RT_FORMAT_ARRAY{D3D12_RT_FORMAT_ARRAY{{normal_buffer_format_}, 1}},
-    .sample_desc = msaa_sample_desc
-  };
+    // Submeshes without weighted vertices keep the bounds of the whole mesh
+    if (!record.evaluated) {
+      record.bounds = frame_packet.mesh_data[skinned_mesh.mesh_data_local_idx].bounds;
+      record.prev_bounds = record.bounds;
+      std::ranges::fill(record.submesh_bounds, record.bounds);
+      std::ranges::fill(record.prev_submesh_bounds, record.bounds);
+    }
 
-  depth_normal_pso_ = device_->CreatePipelineState(depth_normal_pso_desc, sizeof(DepthNormalDrawParams) / 4);
+    // The bounds of the previous frames are close enough to select the detail with
+    std::optional<float> screen_height;
 
-  graphics::PipelineDesc const shadow_pso_desc_{
-    .vs = CD3DX12_SHADER_BYTECODE{g_depth_only_vs_bytes, ARRAYSIZE(g_depth_only_vs_bytes)},
-    .ps = CD3DX12_SHADER_BYTECODE{g_depth_only_ps_bytes, ARRAYSIZE(g_depth_only_ps_bytes)},
-    .depth_stencil_state = reverse_z_depth_stencil_write, .ds_format = depth_format_,
-    .rasterizer_state = shadow_rasterizer_desc
-  };
+    if (skinned_mesh.submesh_count > 0) {
+      screen_height = AnimationLodScheduler::CalculateScreenHeight(
+        AABB::Union(record.prev_bounds, record.bounds).Transform(
+          frame_packet.instance_data[skinned_mesh.first_submesh_local_idx].local_to_world_mtx),
+        tmp_animation_lod_views_);
+    }
 
-  shadow_pso_ = device_->CreatePipelineState(shadow_pso_desc_, sizeof(DepthOnlyDrawParams) / 4);
+    auto const& lod{AnimationLodScheduler::SelectLod(skinned_mesh.animation_lods, screen_height.value_or(0.0f))};
+    auto const update_interval{std::max(lod.update_interval, 1u)};
+    auto const paused{!screen_height && skinned_mesh.pausing_animation_when_culled};
 
-  graphics::PipelineDesc const depth_resolve_pso_desc{
-    .cs = CD3DX12_SHADER_BYTECODE{g_depth_resolve_cs_bytes, ARRAYSIZE(g_depth_resolve_cs_bytes)}
-  };
+    tmp_posed_skinned_meshes_.emplace_back(PosedSkinnedMesh{i, &record, lod.skipped_skeleton_level_count});
+    tmp_animation_lod_instances_.emplace_back(AnimationLodScheduler::Instance{
+      record.last_update_frame, update_interval, screen_height.value_or(0.0f), record.evaluated,
+      AnimationLodScheduler::IsUpdateDue(record.evaluated, paused, record.last_update_frame, update_interval,
+        frame_count)
+    });
+  }
 
-  depth_resolve_pso_ = device_->CreatePipelineState(depth_resolve_pso_desc, sizeof(DepthResolveDrawParams) / 4);
+  if (frame_packet.animation_update_budget > 0) {
+    animation_lod_scheduler_.ApplyBudget(tmp_animation_lod_instances_,
+      static_cast<unsigned>(frame_packet.animation_update_budget), frame_count);
+  }
 
-  graphics::PipelineDesc const line_gizmo_pso_desc{
-    .primitive_topology_type = D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE,
-    .vs = CD3DX12_SHADER_BYTECODE{g_gizmos_line_vs_bytes, ARRAYSIZE(g_gizmos_line_vs_bytes)},
-    .ps = CD3DX12_SHADER_BYTECODE{g_gizmos_ps_bytes, ARRAYSIZE(g_gizmos_ps_bytes)},
-    .depth_stencil_state = disabled_depth_stencil, .rt_formats = render_target_format
-  };
+  tmp_pose_layers_.clear();
+  tmp_pose_instances_.clear();
 
-  line_gizmo_pso_ = device_->CreatePipelineState(line_gizmo_pso_desc, sizeof(GizmoDrawParams) / 4);
+  // The layers of all instances are gathered first so that the instances can reference them by span
+  for (std::size_t i{0}; i < tmp_posed_skinned_meshes_.size(); i++) {
+    auto const& posed{tmp_posed_skinned_meshes_[i]};
+    auto const& skinned_mesh{frame_packet.skinned_mesh_data[posed.skinned_mesh_idx]};
+    auto& record{*posed.record};
+    record.samplers.resize(skinned_mesh.animation_layer_count);
 
-  graphics::PipelineDesc const object_pso_depth_write_desc{
-    .vs = CD3DX12_SHADER_BYTECODE{g_object_pbr_vs_bytes, ARRAYSIZE(g_object_pbr_vs_bytes)},
-    .ps = CD3DX12_SHADER_BYTECODE{g_object_pbr_ps_bytes, ARRAYSIZE(g_object_pbr_ps_bytes)},
-    .depth_stencil_state = reverse_z_depth_stencil_write, .ds_format = depth_format_, .rt_formats = color_format,
-    .sample_desc = msaa_sample_desc,
-  };
+    if (!tmp_animation_lod_instances_[i].update) {
+      continue;
+    }
 
-  object_pso_depth_write_ = device_->CreatePipelineState(object_pso_depth_write_desc, sizeof(ObjectDrawParams) / 4);
+    for (unsigned i{0}; i < skinned_mesh.animation_layer_count; i++) {
+      auto const& [animation, time, weight, blend_mode, node_mask]{
+        frame_packet.animation_layers[skinned_mesh.first_animation_layer_idx + i]
+      };
+      tmp_pose_layers_.emplace_back(PoseEvaluator::Layer{
+        animation.get(), time, weight, blend_mode,
+        node_mask ? std::span<float const>{*node_mask} : std::span<float const>{}, &record.samplers[i]
+      });
+    }
+  }
 
-  graphics::PipelineDesc const object_pso_depth_read_desc{
-    .vs = CD3DX12_SHADER_BYTECODE{g_object_pbr_vs_bytes, ARRAYSIZE(g_object_pbr_vs_bytes)},
-    .ps = CD3DX12_SHADER_BYTECODE{g_object_pbr_ps_bytes, ARRAYSIZE(g_object_pbr_ps_bytes)},
-    .depth_stencil_state = reverse_z_depth_stencil_read, .ds_format = depth_format_, .rt_formats = color_format,
-    .sample_desc = msaa_sample_desc,
-  };
+  std::size_t pose_layer_offset{0};
+
+  for (std::size_t i{0}; i < tmp_posed_skinned_meshes_.size(); i++) {
+    auto const& posed{tmp_posed_skinned_meshes_[i]};
+    auto const& lod_instance{tmp_animation_lod_instances_[i]};
+    auto const& skinned_mesh{frame_packet.skinned_mesh_data[posed.skinned_mesh_idx]};
+    auto& record{*posed.record};
+    auto const layer_count{lod_instance.update ? skinned_mesh.animation_layer_count : 0};
+
+    if (lod_instance.update) {
+      // The first update has nothing to interpolate from
+      record.update_interval = record.evaluated ? lod_instance.update_interval : 1;
+      record.last_update_frame = frame_count;
+      record.prev_bounds = record.bounds;
+      record.prev_submesh_bounds = record.submesh_bounds;
+    }
 
-  object_pso_depth_read_ = device_->CreatePipelineState(object_pso_depth_read_desc, sizeof(ObjectDrawParams) / 4);
+    tmp_pose_instances_.emplace_back(PoseEvaluator::Instance{
+      std::span<PoseEvaluator::Layer const>{tmp_pose_layers_}.subspan(pose_layer_offset, layer_count),
+      skinned_mesh.skeleton ? std::span<SkeletonNode const>{*skinned_mesh.skeleton} : std::span<SkeletonNode const>{},
+      skinned_mesh.bind_pose.get(), *skinned_mesh.bones, posed.skipped_skeleton_level_count, record.palette_history,
+      lod_instance.update, CalculateAnimationHistoryBlend(record, frame_count),
+      bone_palette.subspan(skinned_mesh.bone_palette_offset, skinned_mesh.bones->size()), &record.bounds,
+      skinned_mesh.submesh_bones
+        ? std::span<std::vector<std::uint32_t> const>{*skinned_mesh.submesh_bones}
+        : std::span<std::vector<std::uint32_t> const>{},
+      record.submesh_bounds
+    });
 
-  graphics::PipelineDesc const post_process_pso_desc{
-    .vs = CD3DX12_SHADER_BYTECODE{&g_post_process_vs_bytes, ARRAYSIZE(g_post_process_vs_bytes)},
-    .ps = CD3DX12_SHADER_BYTECODE{&g_post_process_ps_bytes, ARRAYSIZE(g_post_process_ps_bytes)},
+    pose_layer_offset += layer_count;
+  }
+
+  pose_evaluator_.Evaluate(tmp_pose_instances_, App::Instance().GetJobSystem());
+
+  // Posed instances are culled with the bounds of their pose like any other instance, including in shadow views.
+  // Each submesh gets the bounds of the bones its vertices are weighted to.
+  for (auto const& posed : tmp_posed_skinned_meshes_) {
+    auto const& skinned_mesh{frame_packet.skinned_mesh_data[posed.skinned_mesh_idx]};
+    auto& record{*posed.record};
+    record.evaluated = true;
+
+    // Interpolated palettes stay within the poses of the last two updates
+    auto const interpolated{CalculateAnimationHistoryBlend(record, frame_count) < 1};
+    auto& mesh_bounds{frame_packet.mesh_data[skinned_mesh.mesh_data_local_idx].bounds};
+    mesh_bounds = interpolated ? AABB::Union(record.prev_bounds, record.bounds) : record.bounds;
+
+    for (auto i{skinned_mesh.first_submesh_local_idx};
+         i < skinned_mesh.first_submesh_local_idx + skinned_mesh.submesh_count; i++) {
+      auto& submesh{frame_packet.submesh_data[i]};
+
+      if (submesh.idx_in_mesh < record.submesh_bounds.size()) {
+        submesh.bounds = interpolated
+                           ? AABB::Union(record.prev_submesh_bounds[submesh.idx_in_mesh],
+                             record.submesh_bounds[submesh.idx_in_mesh])
+                           : record.submesh_bounds[submesh.idx_in_mesh];
+      } else {
+        submesh.bounds = mesh_bounds;
+      }
+
+      auto& instance{frame_packet.instance_data[i]};
+      instance.bounds_ws = submesh.bounds.Transform(instance.local_to_world_mtx);
+    }
+  }
+}
+
+
+auto SceneRenderer::PublishBonePalettes() -> void {
+  // Swapped maps come back with older palettes, so stale entries are dropped and the others overwritten
+  std::erase_if(rendered_bone_palettes_, [this](auto const& palette) {
+    auto const it{animated_instances_.find(palette.first)};
+    return it == std::end(animated_instances_) || !it->second.evaluated;
+  });
+
+  for (auto const& [component, record] : animated_instances_) {
+    if (record.evaluated) {
+      // The palette of the last update follows the one before it
+      std::span<Matrix4 const> const history{record.palette_history};
+      auto const last_palette{history.subspan(history.size() / 2)};
+      rendered_bone_palettes_[component].assign(std::begin(last_palette), std::end(last_palette));
+    }
+  }
+
+  std::scoped_lock const lock{bone_palette_mutex_};
+  std::swap(rendered_bone_palettes_, published_bone_palettes_);
+  bone_palettes_published_ = true;
+}
+
+
+auto SceneRenderer::CalculateAnimationHistoryBlend(AnimatedInstanceRecord const& record,
+                                                   UINT64 const frame_count) noexcept -> float {
+  return AnimationLodScheduler::CalculateHistoryBlend(record.last_update_frame, record.update_interval, frame_count);
+}
+
+
+auto SceneRenderer::ReserveCullingMemory(FramePacket const& frame_packet, std::size_t const view_count) -> void {
+  // Every list gets room for all instances up front so that the jobs never reallocate
+  auto const required_byte_count{
+    view_count * (frame_packet.instance_data.size() * sizeof(unsigned) + alignof(std::max_align_t))
+  };
+
+  if (!culling_memory_ || required_byte_count > culling_memory_size_) {
+    culling_memory_size_ = std::bit_ceil(required_byte_count);
+    culling_memory_ = std::make_unique<LinearMemoryResource>(culling_memory_size_);
+  } else {
+    culling_memory_->Clear();
+  }
+}
+
+
+auto SceneRenderer::CullViews(FramePacket const& frame_packet, std::span<CullView const> const cull_views,
+                              std::vector<std::pmr::vector<unsigned>>& visible_lists) -> void {
+  auto const instance_count{frame_packet.instance_data.size()};
+  auto const first_view_idx{visible_lists.size()};
+
+  for (auto i{first_view_idx}; i < cull_views.size(); i++) {
+    visible_lists.emplace_back(culling_memory_.get()).reserve(instance_count);
+  }
+
+  if (draw_sorters_.size() < cull_views.size()) {
+    draw_sorters_.resize(cull_views.size());
+  }
+
+  auto& job_system{App::Instance().GetJobSystem()};
+
+  std::vector<ObserverPtr<Job>> jobs;
+  jobs.reserve(cull_views.size() - first_view_idx);
+
+  for (auto i{first_view_idx}; i < cull_views.size(); i++) {
+    jobs.emplace_back(job_system.CreateJob(
+      [&frame_packet, view = &cull_views[i], visible_list = &visible_lists[i], sorter = &draw_sorters_[i]] {
+        CullStaticSubmeshInstances(view->frustum_ws, frame_packet.static_submesh_instance_bvh,
+          frame_packet.instance_data, *visible_list);
+
+        if (view->shadow_casters_only) {
+          CullShadowCasters(*view, frame_packet.instance_data, *visible_list);
+        }
+
+        if (view->occlusion_culler) {
+          CullOccludedInstances(*view->occlusion_culler, frame_packet.instance_data, *visible_list);
+        }
+
+        SortDraws(frame_packet, view->draw_sort_dir, *sorter, *visible_list);
+      }));
+    job_system.Run(jobs.back());
+  }
+
+  for (auto const job : jobs) {
+    job_system.Wait(job);
+  }
+}
+
+
+auto SceneRenderer::SortDraws(FramePacket const& frame_packet, Vector3 const& sort_dir, DrawSorter& sorter,
+                              std::pmr::vector<unsigned>& visible_instance_indices) -> void {
+  sorter.Clear();
+
+  for (auto const instance_idx : visible_instance_indices) {
+    auto const& instance{frame_packet.instance_data[instance_idx]};
+    auto const& submesh{frame_packet.submesh_data[instance.submesh_local_idx]};
+    auto const& mesh{frame_packet.mesh_data[submesh.mesh_local_idx]};
+
+    auto const depth{Dot((instance.bounds_ws.min + instance.bounds_ws.max) * 0.5f, sort_dir)};
+
+    // Meshes are extracted per component, so the geometry is identified by its buffer instead.
+    // Skinned instances have their own position buffers, so they are never merged.
+    sorter.Add(DrawSorter::MakeKey(submesh.mtl_buf_local_idx, mesh.pos_buf_local_idx, submesh.idx_in_mesh, depth),
+      instance_idx);
+  }
+
+  sorter.Sort(visible_instance_indices);
+}
+
+
+auto SceneRenderer::UploadInstances(FramePacket const& frame_packet,
+                                    std::span<std::pmr::vector<unsigned> const> const visible_lists,
+                                    std::vector<UINT>& visible_list_offsets) -> void {
+  auto const frame_idx{frame_packet.frame_idx};
+
+  // Every instance is uploaded once no matter how many views draw it, the views only upload indices to it
+
+  auto& instance_buf{instance_buffers_[frame_idx]};
+  instance_buf.Resize(static_cast<UINT>(frame_packet.instance_data.size()));
+  std::ranges::transform(frame_packet.instance_data, std::begin(instance_buf.GetData()),
+    [](InstanceData const& instance) {
+      return ShaderInstanceData{
+        .modelMtx = instance.local_to_world_mtx,
+        .invTranspModelMtx = instance.local_to_world_mtx.Inverse().Transpose()
+      };
+    });
+
+  visible_list_offsets.clear();
+  UINT instance_idx_count{0};
+
+  for (auto const& visible_list : visible_lists) {
+    visible_list_offsets.emplace_back(instance_idx_count);
+    instance_idx_count += static_cast<UINT>(visible_list.size());
+  }
+
+  auto& instance_idx_buf{instance_idx_buffers_[frame_idx]};
+  instance_idx_buf.Resize(instance_idx_count);
+  auto const instance_indices{instance_idx_buf.GetData()};
+
+  for (std::size_t i{0}; i < visible_lists.size(); i++) {
+    std::ranges::copy(visible_lists[i], std::begin(instance_indices) + visible_list_offsets[i]);
+  }
+}
+
+
+auto SceneRenderer::CanDrawInstanced(FramePacket const& frame_packet, InstanceData const& lhs,
+                                     InstanceData const& rhs) noexcept -> bool {
+  auto const& lhs_submesh{frame_packet.submesh_data[lhs.submesh_local_idx]};
+  auto const& rhs_submesh{frame_packet.submesh_data[rhs.submesh_local_idx]};
+  auto const& lhs_mesh{frame_packet.mesh_data[lhs_submesh.mesh_local_idx]};
+  auto const& rhs_mesh{frame_packet.mesh_data[rhs_submesh.mesh_local_idx]};
+
+  return lhs_submesh.mtl_buf_local_idx == rhs_submesh.mtl_buf_local_idx &&
+         lhs_submesh.base_vertex == rhs_submesh.base_vertex && lhs_submesh.first_index == rhs_submesh.first_index &&
+         lhs_submesh.index_count == rhs_submesh.index_count &&
+         lhs_mesh.pos_buf_local_idx == rhs_mesh.pos_buf_local_idx &&
+         lhs_mesh.norm_buf_local_idx == rhs_mesh.norm_buf_local_idx &&
+         lhs_mesh.tan_buf_local_idx == rhs_mesh.tan_buf_local_idx &&
+         lhs_mesh.uv_buf_local_idx == rhs_mesh.uv_buf_local_idx &&
+         lhs_mesh.idx_buf_local_idx == rhs_mesh.idx_buf_local_idx;
+}
+
+
+template<typename Func>
+auto SceneRenderer::ForEachDrawBatch(FramePacket const& frame_packet,
+                                     std::span<unsigned const> const visible_instance_indices,
+                                     Func const& func) -> void {
+  DrawSorter::ForEachBatch(visible_instance_indices,
+    [&frame_packet](unsigned const first_instance_idx, unsigned const instance_idx) {
+      return CanDrawInstanced(frame_packet, frame_packet.instance_data[first_instance_idx],
+        frame_packet.instance_data[instance_idx]);
+    }, [&frame_packet, visible_instance_indices, &func](std::size_t const first, std::size_t const count) {
+      auto const& first_instance{frame_packet.instance_data[visible_instance_indices[first]]};
+      func(frame_packet.submesh_data[first_instance.submesh_local_idx], static_cast<UINT>(first),
+        static_cast<UINT>(count));
+    });
+}
+
+
+auto SceneRenderer::CalculateShadowViewSignature(FramePacket const& frame_packet, Matrix4 const& view_proj_mtx,
+                                                 std::span<unsigned const> const visible_instance_indices) noexcept ->
+  std::uint64_t {
+  // Skinned instances are drawn from the skinned vertex buffer of the frame, so they change the signature every frame.
+  // Meshes and materials can be updated in place, so their buffers are not enough to identify their contents.
+  auto signature{HashCombine(0, view_proj_mtx)};
+
+  for (auto const instance_idx : visible_instance_indices) {
+    auto const& instance{frame_packet.instance_data[instance_idx]};
+    auto const& submesh{frame_packet.submesh_data[instance.submesh_local_idx]};
+    auto const& mesh{frame_packet.mesh_data[submesh.mesh_local_idx]};
+
+    signature = HashCombine(signature, instance.local_to_world_mtx);
+    signature = HashCombine(signature, frame_packet.buffers[mesh.pos_buf_local_idx].get());
+    signature = HashCombine(signature, frame_packet.buffers[mesh.uv_buf_local_idx].get());
+    signature = HashCombine(signature, frame_packet.buffers[mesh.idx_buf_local_idx].get());
+    signature = HashCombine(signature, frame_packet.buffers[submesh.mtl_buf_local_idx].get());
+    signature = HashCombine(signature, static_cast<std::uint64_t>(submesh.index_count) << 32 | submesh.first_index);
+    signature = HashCombine(signature, static_cast<std::uint64_t>(submesh.base_vertex));
+    signature = HashCombine(signature, static_cast<std::uint64_t>(mesh.change_version) << 32 |
+                                       submesh.mtl_change_version);
+  }
+
+  return signature;
+}
+
+
+auto SceneRenderer::DrawShadowCasters(FramePacket const& frame_packet,
+                                      std::span<unsigned const> const visible_instance_indices,
+                                      UINT const first_instance_offset, graphics::CommandList& cmd) -> void {
+  ForEachDrawBatch(frame_packet, visible_instance_indices,
+    [&frame_packet, &cmd, first_instance_offset](SubmeshData const& submesh, UINT const first_instance,
+                                                 UINT const instance_count) {
+      auto const& mesh{frame_packet.mesh_data[submesh.mesh_local_idx]};
+
+      cmd.SetShaderResource(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, pos_buf_idx),
+        *frame_packet.buffers[mesh.pos_buf_local_idx]);
+      cmd.SetShaderResource(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, uv_buf_idx),
+        *frame_packet.buffers[mesh.uv_buf_local_idx]);
+      cmd.SetConstantBuffer(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, mtl_idx),
+        *frame_packet.buffers[submesh.mtl_buf_local_idx]);
+      cmd.SetIndexBuffer(*frame_packet.buffers[mesh.idx_buf_local_idx], mesh.idx_format);
+      cmd.DrawIndexedInstanced(submesh.index_count, instance_count, submesh.first_index, submesh.base_vertex,
+        first_instance_offset + first_instance);
+    });
+}
+
+
+auto SceneRenderer::GetDirectionalShadowMapArray(std::size_t const cam_idx) -> DirectionalShadowMapArray& {
+  if (dir_shadow_map_arrs_.size() <= cam_idx) {
+    dir_shadow_map_arrs_.resize(cam_idx + 1);
+  }
+
+  auto& shadow_map_arr{dir_shadow_map_arrs_[cam_idx]};
+
+  if (!shadow_map_arr) {
+    shadow_map_arr = std::make_unique<DirectionalShadowMapArray>(device_.Get(), depth_format_, dir_shadow_map_size_);
+    shadow_map_arr->GetTex()->SetDebugName(L"Directional Shadow Map Array");
+  }
+
+  return *shadow_map_arr;
+}
+
+
+auto SceneRenderer::DrawDirectionalShadowMaps(FramePacket const& frame_packet, CameraViewData const& cam_view,
+                                              std::span<std::pmr::vector<unsigned> const> const visible_lists,
+                                              std::span<UINT const> const visible_list_offsets,
+                                              DirectionalShadowMapArray& shadow_map_arr,
+                                              graphics::CommandList& cmd) -> void {
+  // Nothing samples the cascades without a shadow casting directional light
+  if (!cam_view.has_dir_shadow) {
+    return;
+  }
+
+  // The cascades are only drawn again if the light, the cascade fit or any caster in them changed
+  auto signature{static_cast<std::uint64_t>(frame_packet.shadow_params.cascade_count)};
+
+  for (auto cascade_idx{0}; cascade_idx < frame_packet.shadow_params.cascade_count; cascade_idx++) {
+    signature = HashCombine(signature, CalculateShadowViewSignature(frame_packet,
+      cam_view.shadow_view_proj_matrices[cascade_idx],
+      visible_lists[cam_view.cascade_visible_list_indices[cascade_idx]]));
+  }
+
+  if (shadow_map_arr.UpdateCache(signature)) {
+    return;
+  }
+
+  auto const frame_idx{frame_packet.frame_idx};
+
+  cmd.SetPipelineState(*shadow_pso_);
+  cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, samp_idx), samp_af16_wrap_.Get());
+  cmd.SetShaderResource(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, instance_buf_idx),
+    *instance_buffers_[frame_idx].GetBuffer());
+  cmd.SetShaderResource(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, instance_idx_buf_idx),
+    *instance_idx_buffers_[frame_idx].GetBuffer());
+  cmd.SetRenderTargets({}, shadow_map_arr.GetTex().get());
+  cmd.ClearDepthStencil(*shadow_map_arr.GetTex(), D3D12_CLEAR_FLAG_DEPTH, 0.0f, 0, {});
+
+  auto const shadow_map_size{shadow_map_arr.GetSize()};
+
+  D3D12_VIEWPORT const shadow_viewport{
+    0, 0, static_cast<float>(shadow_map_size), static_cast<float>(shadow_map_size), 0, 1
+  };
+
+  D3D12_RECT const shadow_scissor{0, 0, static_cast<LONG>(shadow_map_size), static_cast<LONG>(shadow_map_size)};
+
+  cmd.SetViewports(std::array{shadow_viewport});
+  cmd.SetScissorRects(std::array{shadow_scissor});
+
+  for (auto cascade_idx{0}; cascade_idx < frame_packet.shadow_params.cascade_count; cascade_idx++) {
+    cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, rt_idx), cascade_idx);
+
+    cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, per_view_cb_idx),
+      AllocatePerViewConstants(cam_view.shadow_view_matrices[cascade_idx], cam_view.shadow_proj_matrices[cascade_idx],
+        ShadowCascadeBoundaries{}, Vector3{}));
+
+    auto const visible_list_idx{cam_view.cascade_visible_list_indices[cascade_idx]};
+    DrawShadowCasters(frame_packet, visible_lists[visible_list_idx], visible_list_offsets[visible_list_idx], cmd);
+  }
+}
+
+
+auto SceneRenderer::DrawPunctualShadowMaps(PunctualShadowAtlas& atlas,
+                                           SceneRenderer::FramePacket const& frame_packet,
+                                           CameraViewData const& cam_view,
+                                           std::span<std::pmr::vector<unsigned> const> const visible_lists,
+                                           std::span<UINT const> const visible_list_offsets,
+                                           graphics::CommandList& cmd) -> void {
+  // Tiles that still hold what their shadow maps would draw are kept, only the rest are cleared and drawn
+  tmp_drawn_shadow_map_indices_.clear();
+  tmp_shadow_clear_rects_.clear();
+
+  for (std::size_t i{0}; i < cam_view.punctual_shadow_maps.size(); i++) {
+    auto const& shadow_map{cam_view.punctual_shadow_maps[i]};
+
+    if (atlas.UpdateTileCache(shadow_map.tile, CalculateShadowViewSignature(frame_packet,
+      shadow_map.shadow_view_proj_mtx, visible_lists[cam_view.punctual_shadow_map_visible_list_indices[i]]))) {
+      continue;
+    }
+
+    auto const& tile{shadow_map.tile};
+    tmp_drawn_shadow_map_indices_.emplace_back(i);
+    tmp_shadow_clear_rects_.emplace_back(static_cast<LONG>(tile.offset_x), static_cast<LONG>(tile.offset_y),
+      static_cast<LONG>(tile.offset_x + tile.size), static_cast<LONG>(tile.offset_y + tile.size));
+  }
+
+  if (tmp_drawn_shadow_map_indices_.empty()) {
+    return;
+  }
+
+  auto const frame_idx{frame_packet.frame_idx};
+
+  cmd.SetPipelineState(*shadow_pso_);
+  cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, rt_idx), 0);
+  cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, samp_idx), samp_af16_wrap_.Get());
+  cmd.SetShaderResource(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, instance_buf_idx),
+    *instance_buffers_[frame_idx].GetBuffer());
+  cmd.SetShaderResource(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, instance_idx_buf_idx),
+    *instance_idx_buffers_[frame_idx].GetBuffer());
+  cmd.SetRenderTargets({}, atlas.GetTex().get());
+  cmd.ClearDepthStencil(*atlas.GetTex(), D3D12_CLEAR_FLAG_DEPTH, 0, 0, tmp_shadow_clear_rects_);
+
+  for (std::size_t j{0}; j < tmp_drawn_shadow_map_indices_.size(); j++) {
+    auto const i{tmp_drawn_shadow_map_indices_[j]};
+    auto const& shadow_map{cam_view.punctual_shadow_maps[i]};
+    auto const& tile{shadow_map.tile};
+
+    D3D12_VIEWPORT const viewport{
+      static_cast<FLOAT>(tile.offset_x), static_cast<FLOAT>(tile.offset_y), static_cast<FLOAT>(tile.size),
+      static_cast<FLOAT>(tile.size), 0, 1
+    };
+
+    cmd.SetViewports(std::span{&viewport, 1});
+    cmd.SetScissorRects(std::span{&tmp_shadow_clear_rects_[j], 1});
+
+    cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(DepthOnlyDrawParams, per_view_cb_idx),
+      AllocatePerViewConstants(Matrix4::Identity(), shadow_map.shadow_view_proj_mtx, ShadowCascadeBoundaries{},
+        Vector3{}));
+
+    auto const visible_list_idx{cam_view.punctual_shadow_map_visible_list_indices[i]};
+    DrawShadowCasters(frame_packet, visible_lists[visible_list_idx], visible_list_offsets[visible_list_idx], cmd);
+  }
+}
+
+
+auto SceneRenderer::ClearGizmoDrawQueue() noexcept -> void {
+  gizmo_colors_.clear();
+  line_gizmo_vertex_data_.clear();
+}
+
+
+auto SceneRenderer::RecreateSsaoSamples(int const sample_count) noexcept -> void {
+  ssao_samples_buffer_.Resize(sample_count);
+  auto const ssao_samples{ssao_samples_buffer_.GetData()};
+
+  std::uniform_real_distribution dist{0.0f, 1.0f};
+  std::default_random_engine gen; // NOLINT(cert-msc51-cpp)
+
+  for (auto i{0}; i < sample_count; i++) {
+    Vector3 sample{dist(gen) * 2 - 1, dist(gen) * 2 - 1, dist(gen)};
+    Normalize(sample);
+    sample *= dist(gen);
+
+    auto scale{static_cast<float>(i) / static_cast<float>(sample_count)};
+    scale = std::lerp(0.1f, 1.0f, scale * scale);
+    sample *= scale;
+
+    ssao_samples[i] = Vector4{sample, 0};
+  }
+}
+
+
+auto SceneRenderer::RecreatePipelines() -> void {
+  CD3DX12_DEPTH_STENCIL_DESC1 const reverse_z_depth_stencil_write{
+    TRUE, D3D12_DEPTH_WRITE_MASK_ALL, D3D12_COMPARISON_FUNC_GREATER, FALSE, {}, {}, {}, {}, {}, {}, {}, {}, {}, {},
+    FALSE
+  };
+
+  CD3DX12_DEPTH_STENCIL_DESC1 const reverse_z_depth_stencil_read{
+    TRUE, D3D12_DEPTH_WRITE_MASK_ZERO, D3D12_COMPARISON_FUNC_GREATER_EQUAL, FALSE, {}, {}, {}, {}, {}, {}, {}, {}, {},
+    {}, FALSE
+  };
+
+  CD3DX12_DEPTH_STENCIL_DESC1 const disabled_depth_stencil{
+    FALSE, D3D12_DEPTH_WRITE_MASK_ZERO, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, FALSE
+  };
+
+  CD3DX12_RASTERIZER_DESC const shadow_rasterizer_desc{
+    D3D12_FILL_MODE_SOLID, D3D12_CULL_MODE_BACK, FALSE, -1, 0.f, -2.5f, TRUE, FALSE, FALSE, 0,
+    D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF
+  };
+
+  DXGI_SAMPLE_DESC const msaa_sample_desc{static_cast<UINT>(msaa_mode_), 0};
+  CD3DX12_RT_FORMAT_ARRAY const render_target_format{D3D12_RT_FORMAT_ARRAY{{render_target_format_}, 1}};
+  CD3DX12_RT_FORMAT_ARRAY const color_format{D3D12_RT_FORMAT_ARRAY{{color_buffer_format_}, 1}};
+  CD3DX12_RT_FORMAT_ARRAY const ssao_format{D3D12_RT_FORMAT_ARRAY{{ssao_buffer_format_}, 1}};
+
+  graphics::PipelineDesc const depth_normal_pso_desc{
+    .vs = CD3DX12_SHADER_BYTECODE{g_depth_normal_vs_bytes, ARRAYSIZE(g_depth_normal_vs_bytes)},
+    .ps = CD3DX12_SHADER_BYTECODE{g_depth_normal_ps_bytes, ARRAYSIZE(g_depth_normal_ps_bytes)},
+    .depth_stencil_state = reverse_z_depth_stencil_write, .ds_format = depth_format_,
+    .rt_formats = CD3DX12_RT_FORMAT_ARRAY{D3D12_RT_FORMAT_ARRAY{{normal_buffer_format_}, 1}},
+    .sample_desc = msaa_sample_desc
+  };
+
+  depth_normal_pso_ = device_->CreatePipelineState(depth_normal_pso_desc, sizeof(DepthNormalDrawParams) / 4);
+
+  graphics::PipelineDesc const shadow_pso_desc_{
+    .vs = CD3DX12_SHADER_BYTECODE{g_depth_only_vs_bytes, ARRAYSIZE(g_depth_only_vs_bytes)},
+    .ps = CD3DX12_SHADER_BYTECODE{g_depth_only_ps_bytes, ARRAYSIZE(g_depth_only_ps_bytes)},
+    .depth_stencil_state = reverse_z_depth_stencil_write, .ds_format = depth_format_,
+    .rasterizer_state = shadow_rasterizer_desc
+  };
+
+  shadow_pso_ = device_->CreatePipelineState(shadow_pso_desc_, sizeof(DepthOnlyDrawParams) / 4);
+
+  graphics::PipelineDesc const depth_resolve_pso_desc{
+    .cs = CD3DX12_SHADER_BYTECODE{g_depth_resolve_cs_bytes, ARRAYSIZE(g_depth_resolve_cs_bytes)}
+  };
+
+  depth_resolve_pso_ = device_->CreatePipelineState(depth_resolve_pso_desc, sizeof(DepthResolveDrawParams) / 4);
+
+  graphics::PipelineDesc const line_gizmo_pso_desc{
+    .primitive_topology_type = D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE,
+    .vs = CD3DX12_SHADER_BYTECODE{g_gizmos_line_vs_bytes, ARRAYSIZE(g_gizmos_line_vs_bytes)},
+    .ps = CD3DX12_SHADER_BYTECODE{g_gizmos_ps_bytes, ARRAYSIZE(g_gizmos_ps_bytes)},
+    .depth_stencil_state = disabled_depth_stencil, .rt_formats = render_target_format
+  };
+
+  line_gizmo_pso_ = device_->CreatePipelineState(line_gizmo_pso_desc, sizeof(GizmoDrawParams) / 4);
+
+  graphics::PipelineDesc const object_pso_depth_write_desc{
+    .vs = CD3DX12_SHADER_BYTECODE{g_object_pbr_vs_bytes, ARRAYSIZE(g_object_pbr_vs_bytes)},
+    .ps = CD3DX12_SHADER_BYTECODE{g_object_pbr_ps_bytes, ARRAYSIZE(g_object_pbr_ps_bytes)},
+    .depth_stencil_state = reverse_z_depth_stencil_write, .ds_format = depth_format_, .rt_formats = color_format,
+    .sample_desc = msaa_sample_desc,
+  };
+
+  object_pso_depth_write_ = device_->CreatePipelineState(object_pso_depth_write_desc, sizeof(ObjectDrawParams) / 4);
+
+  graphics::PipelineDesc const object_pso_depth_read_desc{
+    .vs = CD3DX12_SHADER_BYTECODE{g_object_pbr_vs_bytes, ARRAYSIZE(g_object_pbr_vs_bytes)},
+    .ps = CD3DX12_SHADER_BYTECODE{g_object_pbr_ps_bytes, ARRAYSIZE(g_object_pbr_ps_bytes)},
+    .depth_stencil_state = reverse_z_depth_stencil_read, .ds_format = depth_format_, .rt_formats = color_format,
+    .sample_desc = msaa_sample_desc,
+  };
+
+  object_pso_depth_read_ = device_->CreatePipelineState(object_pso_depth_read_desc, sizeof(ObjectDrawParams) / 4);
+
+  graphics::PipelineDesc const post_process_pso_desc{
+    .vs = CD3DX12_SHADER_BYTECODE{&g_post_process_vs_bytes, ARRAYSIZE(g_post_process_vs_bytes)},
+    .ps = CD3DX12_SHADER_BYTECODE{&g_post_process_ps_bytes, ARRAYSIZE(g_post_process_ps_bytes)},
     .depth_stencil_state = disabled_depth_stencil, .rt_formats = render_target_format,
   };
 
@@ -739,481 +1413,1136 @@ auto SceneRenderer::RecreatePipelines() -> void {
     .rt_formats = color_format, .sample_desc = msaa_sample_desc
   };
 
-  skybox_pso_ = device_->CreatePipelineState(skybox_pso_desc, sizeof(SkyboxDrawParams) / 4);
+  skybox_pso_ = device_->CreatePipelineState(skybox_pso_desc, sizeof(SkyboxDrawParams) / 4);
+
+  graphics::PipelineDesc const ssao_pso_desc{
+    .vs = CD3DX12_SHADER_BYTECODE{&g_ssao_vs_bytes, ARRAYSIZE(g_ssao_vs_bytes)},
+    .ps = CD3DX12_SHADER_BYTECODE{&g_ssao_main_ps_bytes, ARRAYSIZE(g_ssao_main_ps_bytes)},
+    .depth_stencil_state = disabled_depth_stencil, .rt_formats = ssao_format,
+  };
+
+  ssao_pso_ = device_->CreatePipelineState(ssao_pso_desc, sizeof(SsaoDrawParams) / 4);
+
+  graphics::PipelineDesc const ssao_blur_pso_desc{
+    .vs = CD3DX12_SHADER_BYTECODE{&g_ssao_vs_bytes, ARRAYSIZE(g_ssao_vs_bytes)},
+    .ps = CD3DX12_SHADER_BYTECODE{&g_ssao_blur_ps_bytes, ARRAYSIZE(g_ssao_blur_ps_bytes)},
+    .depth_stencil_state = disabled_depth_stencil, .rt_formats = ssao_format
+  };
+
+  ssao_blur_pso_ = device_->CreatePipelineState(ssao_blur_pso_desc, sizeof(SsaoBlurDrawParams) / 4);
+
+  graphics::PipelineDesc const vtx_skinning_pso_desc{
+    .cs = CD3DX12_SHADER_BYTECODE{g_vtx_skinning_cs_bytes, ARRAYSIZE(g_vtx_skinning_cs_bytes)}
+  };
+
+  vtx_skinning_pso_ = device_->CreatePipelineState(vtx_skinning_pso_desc, sizeof(VertexSkinningDrawParams) / 4);
+}
+
+
+auto SceneRenderer::OnWindowSize(Extent2D<std::uint32_t> const size) -> void {
+  if (size.width != 0 && size.height != 0) {
+    RenderTarget::Desc desc{main_rt_->GetDesc()};
+    desc.width = size.width;
+    desc.height = size.height;
+    main_rt_ = RenderTarget::New(*device_, desc);
+  }
+}
+
+
+SceneRenderer::SceneRenderer(ObserverPtr<Window> const window, graphics::GraphicsDevice& device,
+                             RenderManager& render_manager) :
+  render_manager_{&render_manager},
+  window_{window},
+  device_{&device} {
+  for (auto& buf : light_buffers_) {
+    buf = StructuredBuffer<ShaderLight>::New(*device_, *render_manager_, true);
+  }
+
+  for (auto& buf : light_cluster_buffers_) {
+    buf = StructuredBuffer<ShaderLightCluster>::New(*device_, *render_manager_, true);
+  }
+
+  for (auto& buf : bone_palette_buffers_) {
+    buf = StructuredBuffer<Matrix4>::New(*device_, *render_manager_, true);
+  }
+
+  for (auto& buf : light_index_buffers_) {
+    buf = StructuredBuffer<unsigned>::New(*device_, *render_manager_, true);
+  }
+
+  for (auto& buf : instance_buffers_) {
+    buf = StructuredBuffer<ShaderInstanceData>::New(*device_, *render_manager_, true);
+  }
+
+  for (auto& buf : instance_idx_buffers_) {
+    buf = StructuredBuffer<unsigned>::New(*device_, *render_manager_, true);
+  }
+
+  gizmo_color_buffer_ = StructuredBuffer<Vector4>::New(*device_, *render_manager_, true);
+
+  line_gizmo_vertex_data_buffer_ = StructuredBuffer<ShaderLineGizmoVertexData>::New(*device_, *render_manager_, true);
+
+  auto const main_rt_size{window_ ? window_->GetClientAreaSize() : Extent2D<int>{1, 1}};
+
+  main_rt_ = RenderTarget::New(*device_, RenderTarget::Desc{
+    static_cast<UINT>(main_rt_size.width), static_cast<UINT>(main_rt_size.height), DXGI_FORMAT_R8G8B8A8_UNORM,
+    std::nullopt, 1, L"Main RT", false
+  });
+
+  // Bound for cameras without a directional shadow, so it has to exist before any camera is rendered
+  static_cast<void>(GetDirectionalShadowMapArray(0));
+
+  punctual_shadow_atlas_ = std::make_unique<PunctualShadowAtlas>(device_.Get(), depth_format_, 4096);
+  punctual_shadow_atlas_->GetTex()->SetDebugName(L"Punctual Shadow Atlas");
+
+  RecreatePipelines();
+
+  constant_buffer_ring_ = std::make_unique<ConstantBufferRing>(device_.Get(), constant_buffer_ring_frame_size_);
+
+  samp_cmp_pcf_ge_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
+    D3D12_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+    D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0, 1, D3D12_COMPARISON_FUNC_GREATER_EQUAL, {},
+    0, 0
+  });
+
+  samp_cmp_pcf_le_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
+    D3D12_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+    D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0, 1, D3D12_COMPARISON_FUNC_LESS_EQUAL, {}, 0, 0
+  });
+
+  samp_cmp_point_ge_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
+    D3D12_FILTER_COMPARISON_MIN_MAG_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+    D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0, 1, D3D12_COMPARISON_FUNC_GREATER_EQUAL, {}, 0, 0
+  });
+
+  samp_cmp_point_le_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
+    D3D12_FILTER_COMPARISON_MIN_MAG_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+    D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0, 1, D3D12_COMPARISON_FUNC_LESS_EQUAL, {}, 0, 0
+  });
+
+  samp_af16_clamp_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
+    D3D12_FILTER_ANISOTROPIC, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+    D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0, 16, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
+  });
+
+  samp_af8_clamp_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
+    D3D12_FILTER_ANISOTROPIC, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+    D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0, 8, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
+  });
+
+  samp_af4_clamp_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
+    D3D12_FILTER_ANISOTROPIC, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+    D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0, 4, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
+  });
+
+  samp_af2_clamp_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
+    D3D12_FILTER_ANISOTROPIC, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+    D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0, 2, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
+  });
+
+  samp_tri_clamp_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
+    D3D12_FILTER_MIN_MAG_MIP_LINEAR, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+    D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0, 1, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
+  });
+
+  samp_bi_clamp_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
+    D3D12_FILTER_MIN_MAG_LINEAR_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+    D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0, 1, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
+  });
+
+  samp_point_clamp_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
+    D3D12_FILTER_MIN_MAG_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+    D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0, 1, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
+  });
+
+  samp_af16_wrap_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
+    D3D12_FILTER_ANISOTROPIC, D3D12_TEXTURE_ADDRESS_MODE_WRAP, D3D12_TEXTURE_ADDRESS_MODE_WRAP,
+    D3D12_TEXTURE_ADDRESS_MODE_WRAP, 0, 16, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
+  });
+
+  samp_af8_wrap_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
+    D3D12_FILTER_ANISOTROPIC, D3D12_TEXTURE_ADDRESS_MODE_WRAP, D3D12_TEXTURE_ADDRESS_MODE_WRAP,
+    D3D12_TEXTURE_ADDRESS_MODE_WRAP, 0, 8, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
+  });
+
+  samp_af4_wrap_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
+    D3D12_FILTER_ANISOTROPIC, D3D12_TEXTURE_ADDRESS_MODE_WRAP, D3D12_TEXTURE_ADDRESS_MODE_WRAP,
+    D3D12_TEXTURE_ADDRESS_MODE_WRAP, 0, 4, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
+  });
+
+  samp_af2_wrap_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
+    D3D12_FILTER_ANISOTROPIC, D3D12_TEXTURE_ADDRESS_MODE_WRAP, D3D12_TEXTURE_ADDRESS_MODE_WRAP,
+    D3D12_TEXTURE_ADDRESS_MODE_WRAP, 0, 2, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
+  });
+
+  samp_tri_wrap_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
+    D3D12_FILTER_MIN_MAG_MIP_LINEAR, D3D12_TEXTURE_ADDRESS_MODE_WRAP, D3D12_TEXTURE_ADDRESS_MODE_WRAP,
+    D3D12_TEXTURE_ADDRESS_MODE_WRAP, 0, 1, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
+  });
+
+  samp_bi_wrap_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
+    D3D12_FILTER_MIN_MAG_LINEAR_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_WRAP, D3D12_TEXTURE_ADDRESS_MODE_WRAP,
+    D3D12_TEXTURE_ADDRESS_MODE_WRAP, 0, 1, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
+  });
+
+  samp_point_wrap_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
+    D3D12_FILTER_MIN_MAG_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_WRAP, D3D12_TEXTURE_ADDRESS_MODE_WRAP,
+    D3D12_TEXTURE_ADDRESS_MODE_WRAP, 0, 1, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
+  });
+
+  if (window_) {
+    window_size_event_listener_ = window_->OnWindowSize.add_listener([this](Extent2D<unsigned> const size) {
+      OnWindowSize(size);
+    });
+  }
+
+  ssao_samples_buffer_ = StructuredBuffer<Vector4>::New(*device_, *render_manager_, true);
+  RecreateSsaoSamples(ssao_params_.sample_count);
+
+  ssao_noise_tex_ = device_->CreateTexture(graphics::TextureDesc{
+    graphics::TextureDimension::k2D, SSAO_NOISE_TEX_DIM, SSAO_NOISE_TEX_DIM, 1, 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1,
+    false, false, true, false
+  }, D3D12_HEAP_TYPE_DEFAULT, nullptr);
+  ssao_noise_tex_->SetDebugName(L"SSAO Noise");
+
+  std::vector<Vector4> ssao_noise;
+  std::uniform_real_distribution dist{0.0f, 1.0f};
+  std::default_random_engine gen; // NOLINT(cert-msc51-cpp)
+
+  for (auto i{0}; i < SSAO_NOISE_TEX_DIM * SSAO_NOISE_TEX_DIM; i++) {
+    ssao_noise.emplace_back(dist(gen) * 2 - 1, dist(gen) * 2 - 1, 0, 0);
+  }
+
+  render_manager_->UpdateTexture(ssao_noise_tex_, 0, std::array{
+    D3D12_SUBRESOURCE_DATA{
+      ssao_noise.data(), SSAO_NOISE_TEX_DIM * sizeof(Vector4), SSAO_NOISE_TEX_DIM * SSAO_NOISE_TEX_DIM * sizeof(Vector4)
+    }
+  });
+
+
+  white_tex_ = device_->CreateTexture(graphics::TextureDesc{
+    graphics::TextureDimension::k2D, 1, 1, 1, 1, DXGI_FORMAT_R8G8B8A8_UNORM, 1, false, false, true, false
+  }, D3D12_HEAP_TYPE_DEFAULT, nullptr);
+
+  std::array<std::uint8_t, 4> constexpr white_tex_data{255, 255, 255, 255};
+
+  render_manager_->UpdateTexture(white_tex_, 0, std::array{
+    D3D12_SUBRESOURCE_DATA{white_tex_data.data(), sizeof(white_tex_data), sizeof(white_tex_data)}
+  });
+
+  TransformComponent::SetChangeObserver(ObserverPtr<TransformChangeObserver>{this});
+}
+
+
+SceneRenderer::~SceneRenderer() {
+  TransformComponent::SetChangeObserver(nullptr);
+
+  if (window_) {
+    window_->OnWindowSize.remove_listener(window_size_event_listener_);
+  }
+}
+
+
+auto SceneRenderer::PrepareMeshExtractionJobs(std::size_t const comp_count,
+                                              std::vector<MeshExtractionJob>& jobs) -> void {
+  auto const job_count{
+    std::min<std::size_t>((comp_count + min_mesh_extraction_job_comp_count_ - 1) / min_mesh_extraction_job_comp_count_,
+      std::max(std::jthread::hardware_concurrency(), 1u))
+  };
+
+  // Existing jobs are kept so that their storage is reused
+  jobs.resize(job_count);
+
+  for (std::size_t i{0}; i < job_count; i++) {
+    auto const first_comp_idx{i * comp_count / job_count};
+    jobs[i].first_comp_idx = static_cast<unsigned>(first_comp_idx);
+    jobs[i].comp_count = static_cast<unsigned>((i + 1) * comp_count / job_count - first_comp_idx);
+    jobs[i].counts = {};
+  }
+}
+
+
+template<typename Func>
+auto SceneRenderer::RunMeshExtractionJobs(std::span<MeshExtractionJob> const jobs, Func const& func) -> void {
+  if (jobs.size() == 1) {
+    func(jobs.front());
+    return;
+  }
+
+  auto& job_system{App::Instance().GetJobSystem()};
+
+  tmp_extraction_jobs_.clear();
+
+  for (auto& job : jobs) {
+    tmp_extraction_jobs_.emplace_back(job_system.CreateJob([&func, &job] {
+      func(job);
+    }));
+    job_system.Run(tmp_extraction_jobs_.back());
+  }
+
+  for (auto const job : tmp_extraction_jobs_) {
+    job_system.Wait(job);
+  }
+}
+
+
+auto SceneRenderer::CalculateMeshExtractionOffsets(std::span<MeshExtractionJob> const jobs,
+                                                   MeshExtractionCounts const& base) -> MeshExtractionCounts {
+  auto totals{base};
+
+  for (auto& job : jobs) {
+    job.offsets = totals;
+
+    for (auto const member : {
+           &MeshExtractionCounts::mesh, &MeshExtractionCounts::submesh, &MeshExtractionCounts::occluder,
+           &MeshExtractionCounts::occluder_vertex, &MeshExtractionCounts::occluder_index,
+           &MeshExtractionCounts::skinned_mesh, &MeshExtractionCounts::bone, &MeshExtractionCounts::animation_layer
+         }) {
+      totals.*member += job.counts.*member;
+    }
+  }
+
+  return totals;
+}
+
+
+auto SceneRenderer::FindOrEmplaceBackJobBuffer(MeshExtractionJob& job,
+                                               graphics::SharedDeviceChildHandle<graphics::Buffer> const& buf) ->
+  unsigned {
+  auto const [idx, inserted]{job.buffer_indices.FindOrInsert(buf.get(), static_cast<unsigned>(job.buffers.size()))};
+
+  if (inserted) {
+    job.buffers.emplace_back(buf);
+  }
+
+  return idx;
+}
+
+
+auto SceneRenderer::FindOrEmplaceBackJobTexture(MeshExtractionJob& job,
+                                                graphics::SharedDeviceChildHandle<graphics::Texture> const& tex) ->
+  void {
+  if (job.texture_indices.FindOrInsert(tex.get(), static_cast<unsigned>(job.textures.size())).second) {
+    job.textures.emplace_back(tex);
+  }
+}
+
+
+auto SceneRenderer::ClearMeshExtractionJobResources(MeshExtractionJob& job) -> void {
+  job.buffers.clear();
+  job.textures.clear();
+  job.buffer_indices.Clear();
+  job.texture_indices.Clear();
+}
+
+
+auto SceneRenderer::RemapExtractedBufferIndices(MeshExtractionJob const& job, std::span<MeshData> const mesh_data,
+                                                std::span<SubmeshData> const submesh_data,
+                                                std::span<SkinnedMeshData> const skinned_mesh_data) -> void {
+  auto const& remap{job.buffer_remap};
+
+  for (auto& mesh : mesh_data.subspan(job.offsets.mesh, job.counts.mesh)) {
+    mesh.pos_buf_local_idx = remap[mesh.pos_buf_local_idx];
+    mesh.norm_buf_local_idx = remap[mesh.norm_buf_local_idx];
+    mesh.tan_buf_local_idx = remap[mesh.tan_buf_local_idx];
+    mesh.uv_buf_local_idx = remap[mesh.uv_buf_local_idx];
+    mesh.idx_buf_local_idx = remap[mesh.idx_buf_local_idx];
+  }
+
+  for (auto& submesh : submesh_data.subspan(job.offsets.submesh, job.counts.submesh)) {
+    submesh.mtl_buf_local_idx = remap[submesh.mtl_buf_local_idx];
+  }
+
+  if (skinned_mesh_data.empty()) {
+    return;
+  }
+
+  for (auto& skinned_mesh : skinned_mesh_data.subspan(job.offsets.skinned_mesh, job.counts.skinned_mesh)) {
+    skinned_mesh.original_vertex_buf_local_idx = remap[skinned_mesh.original_vertex_buf_local_idx];
+    skinned_mesh.original_normal_buf_local_idx = remap[skinned_mesh.original_normal_buf_local_idx];
+    skinned_mesh.original_tangent_buf_local_idx = remap[skinned_mesh.original_tangent_buf_local_idx];
+    skinned_mesh.bone_weight_buf_local_idx = remap[skinned_mesh.bone_weight_buf_local_idx];
+    skinned_mesh.bone_index_buf_local_idx = remap[skinned_mesh.bone_index_buf_local_idx];
+  }
+}
+
+
+auto SceneRenderer::CountMeshComponent(MeshComponentBase const& comp, MeshExtractionCounts& counts) -> void {
+  auto const mesh{comp.GetMesh()};
+
+  if (!mesh) {
+    return;
+  }
+
+  counts.mesh += 1;
+
+  for (auto const& submesh : mesh->GetSubMeshes()) {
+    if (comp.GetMaterials()[submesh.material_index]) {
+      counts.submesh += 1;
+    }
+  }
+}
+
+
+template<typename T>
+auto SceneRenderer::FindChangeVersion(std::unordered_map<T const*, std::uint32_t> const& versions,
+                                      T const* const resource) noexcept -> std::uint32_t {
+  auto const it{versions.find(resource)};
+  return it != std::end(versions) ? it->second : 0;
+}
 
-  graphics::PipelineDesc const ssao_pso_desc{
-    .vs = CD3DX12_SHADER_BYTECODE{&g_ssao_vs_bytes, ARRAYSIZE(g_ssao_vs_bytes)},
-    .ps = CD3DX12_SHADER_BYTECODE{&g_ssao_main_ps_bytes, ARRAYSIZE(g_ssao_main_ps_bytes)},
-    .depth_stencil_state = disabled_depth_stencil, .rt_formats = ssao_format,
-  };
 
-  ssao_pso_ = device_->CreatePipelineState(ssao_pso_desc, sizeof(SsaoDrawParams) / 4);
+template<typename Target>
+auto SceneRenderer::ExtractMeshComponent(MeshComponentBase const& comp, MeshExtractionJob& job,
+                                         MeshExtractionCounts& cursor, Target& target,
+                                         std::span<StaticSubmeshInstanceKey> const instance_keys) const -> void {
+  auto const mesh{comp.GetMesh()};
 
-  graphics::PipelineDesc const ssao_blur_pso_desc{
-    .vs = CD3DX12_SHADER_BYTECODE{&g_ssao_vs_bytes, ARRAYSIZE(g_ssao_vs_bytes)},
-    .ps = CD3DX12_SHADER_BYTECODE{&g_ssao_blur_ps_bytes, ARRAYSIZE(g_ssao_blur_ps_bytes)},
-    .depth_stencil_state = disabled_depth_stencil, .rt_formats = ssao_format
+  if (!mesh) {
+    return;
+  }
+
+  auto const& local_to_world_mtx{comp.GetEntity()->GetTransform().GetLocalToWorldMatrix()};
+
+  auto const pos_buf_local_idx{FindOrEmplaceBackJobBuffer(job, mesh->GetPositionBuffer())};
+  auto const norm_buf_local_idx{FindOrEmplaceBackJobBuffer(job, mesh->GetNormalBuffer())};
+  auto const tan_buf_local_idx{FindOrEmplaceBackJobBuffer(job, mesh->GetTangentBuffer())};
+  auto const uv_buf_local_idx{FindOrEmplaceBackJobBuffer(job, mesh->GetUvBuffer())};
+  auto const idx_buf_local_idx{FindOrEmplaceBackJobBuffer(job, mesh->GetIndexBuffer())};
+  auto const mesh_local_idx{cursor.mesh++};
+  target.mesh_data[mesh_local_idx] = MeshData{
+    pos_buf_local_idx, norm_buf_local_idx, tan_buf_local_idx, uv_buf_local_idx, idx_buf_local_idx,
+    static_cast<unsigned>(mesh->GetVertexCount()), mesh->GetBounds(),
+    mesh->GetIndexFormat(), FindChangeVersion(mesh_change_versions_, mesh)
   };
 
-  ssao_blur_pso_ = device_->CreatePipelineState(ssao_blur_pso_desc, sizeof(SsaoBlurDrawParams) / 4);
+  for (auto i{0}; i < mesh->GetSubmeshCount(); i++) {
+    auto const& submesh{mesh->GetSubMeshes()[i]};
+    auto const mtl{comp.GetMaterials()[submesh.material_index]};
 
-  graphics::PipelineDesc const vtx_skinning_pso_desc{
-    .cs = CD3DX12_SHADER_BYTECODE{g_vtx_skinning_cs_bytes, ARRAYSIZE(g_vtx_skinning_cs_bytes)}
-  };
+    if (!mtl) {
+      continue;
+    }
 
-  vtx_skinning_pso_ = device_->CreatePipelineState(vtx_skinning_pso_desc, sizeof(VertexSkinningDrawParams) / 4);
-}
+    auto const mtl_buf_local_idx{FindOrEmplaceBackJobBuffer(job, mtl->GetBuffer())};
+
+    for (auto const tex : {
+           mtl->GetAlbedoMap(), mtl->GetMetallicMap(), mtl->GetRoughnessMap(), mtl->GetAoMap(), mtl->GetNormalMap(),
+           mtl->GetOpacityMask()
+         }) {
+      if (tex) {
+        FindOrEmplaceBackJobTexture(job, tex->GetTex());
+      }
+    }
 
+    // Every extracted submesh has exactly one instance, so their indices match
+    auto const submesh_local_idx{cursor.submesh++};
 
-auto SceneRenderer::CreatePerViewConstantBuffers(UINT const count) -> void {
-  per_view_cbs_.reserve(per_view_cbs_.size() + count);
+    target.submesh_data[submesh_local_idx] = SubmeshData{
+      mesh_local_idx, static_cast<unsigned>(i), submesh.base_vertex, static_cast<UINT>(submesh.first_index),
+      static_cast<UINT>(submesh.index_count), mtl_buf_local_idx, submesh.bounds,
+      FindChangeVersion(material_change_versions_, mtl)
+    };
 
-  for (UINT i{0}; i < count; i++) {
-    auto& arr{per_view_cbs_.emplace_back()};
+    target.instance_data[submesh_local_idx] = InstanceData{
+      submesh_local_idx, local_to_world_mtx, submesh.bounds.Transform(local_to_world_mtx), comp.IsOccluder(),
+      mtl->IsCastingShadow()
+    };
 
-    for (UINT j{0}; j < RenderManager::GetMaxFramesInFlight(); j++) {
-      if (auto opt{ConstantBuffer<ShaderPerViewConstants>::New(*device_, true)}) {
-        arr[j] = std::move(*opt);
-      }
+    if (!instance_keys.empty()) {
+      instance_keys[submesh_local_idx] = StaticSubmeshInstanceKey{std::addressof(comp), i};
     }
   }
 }
 
 
-auto SceneRenderer::CreatePerDrawConstantBuffers(UINT const count) -> void {
-  per_draw_cbs_.reserve(per_draw_cbs_.size() + count);
+auto SceneRenderer::IsExtractingOccluder(MeshComponentBase const& comp) const -> bool {
+  auto const mesh{comp.GetMesh()};
+  return occlusion_culling_enabled_ && comp.IsOccluder() && mesh && mesh->HasCpuMemory();
+}
 
-  for (UINT i{0}; i < count; i++) {
-    auto& arr{per_draw_cbs_.emplace_back()};
 
-    for (UINT j{0}; j < RenderManager::GetMaxFramesInFlight(); j++) {
-      if (auto opt{ConstantBuffer<ShaderPerDrawConstants>::New(*device_, true)}) {
-        arr[j] = std::move(*opt);
-      }
-    }
+auto SceneRenderer::CountOccluder(MeshComponentBase const& comp, MeshExtractionCounts& counts) -> void {
+  auto const mesh{comp.GetMesh()};
+
+  counts.occluder += 1;
+  counts.occluder_vertex += static_cast<unsigned>(mesh->GetPositions().size());
+
+  for (auto const& submesh : mesh->GetSubMeshes()) {
+    counts.occluder_index += static_cast<unsigned>(submesh.index_count);
   }
 }
 
 
-auto SceneRenderer::AcquirePerViewConstantBuffer() -> ConstantBuffer<ShaderPerViewConstants>& {
-  if (next_per_view_cb_idx_ >= per_view_cbs_.size()) {
-    CreatePerViewConstantBuffers(1);
+auto SceneRenderer::ExtractOccluder(MeshComponentBase const& comp, MeshExtractionCounts& cursor,
+                                    StaticMeshMirror& mirror) -> unsigned {
+  // Occluder geometry is copied so that rendering never touches the CPU memory of the meshes
+
+  auto const mesh{comp.GetMesh()};
+  auto const positions{mesh->GetPositions()};
+  auto const first_vertex{cursor.occluder_vertex};
+  auto const first_index{cursor.occluder_index};
+
+  std::ranges::copy(positions, std::begin(mirror.occluder_vertices) + first_vertex);
+  cursor.occluder_vertex += static_cast<unsigned>(positions.size());
+
+  auto const indices16{mesh->GetIndices16()};
+  auto const indices32{mesh->GetIndices32()};
+  auto const is_16_bit{mesh->GetIndexFormat() == DXGI_FORMAT_R16_UINT};
+
+  for (auto const& submesh : mesh->GetSubMeshes()) {
+    for (auto i{submesh.first_index}; i < submesh.first_index + submesh.index_count; i++) {
+      mirror.occluder_indices[cursor.occluder_index++] =
+        static_cast<std::uint32_t>(submesh.base_vertex) + (is_16_bit ? indices16[i] : indices32[i]);
+    }
   }
 
-  return per_view_cbs_[next_per_view_cb_idx_++][render_manager_->GetCurrentFrameIndex()];
+  auto const occluder_idx{cursor.occluder++};
+  mirror.occluder_data[occluder_idx] = OccluderData{
+    comp.GetEntity()->GetTransform().GetLocalToWorldMatrix(), first_vertex, cursor.occluder_vertex - first_vertex,
+    first_index, cursor.occluder_index - first_index
+  };
+
+  return occluder_idx;
 }
 
 
-auto SceneRenderer::AcquirePerDrawConstantBuffer() -> ConstantBuffer<ShaderPerDrawConstants>& {
-  if (next_per_draw_cb_idx_ >= per_draw_cbs_.size()) {
-    CreatePerDrawConstantBuffers(1);
-  }
+auto SceneRenderer::ExtractSkinnedMeshComponent(SkinnedMeshComponent const& comp,
+                                                unsigned const first_submesh_local_idx, MeshExtractionJob& job,
+                                                MeshExtractionCounts& cursor, FramePacket& packet) const -> void {
+  auto const mesh{comp.GetMesh()};
+  // Extraction can run ahead of the render manager, but the packet is rendered in the frame matching its index
+  auto const frame_idx{packet.frame_idx};
+
+  auto const bone_weight_buf_local_idx{FindOrEmplaceBackJobBuffer(job, mesh->GetBoneWeightBuffer())};
+  auto const bone_index_buf_local_idx{FindOrEmplaceBackJobBuffer(job, mesh->GetBoneIndexBuffer())};
+  auto const skinned_pos_buf_local_idx{FindOrEmplaceBackJobBuffer(job, comp.GetSkinnedVertexBuffers()[frame_idx])};
+  auto const skinned_norm_buf_local_idx{FindOrEmplaceBackJobBuffer(job, comp.GetSkinnedNormalBuffers()[frame_idx])};
+  auto const skinned_tan_buf_local_idx{FindOrEmplaceBackJobBuffer(job, comp.GetSkinnedTangentBuffers()[frame_idx])};
+
+  // Switch the original and skinned buffer indices so that the renderer can treat the skinned mesh as static after
+  // the skinning is done
+
+  auto const mesh_local_idx{cursor.mesh - 1};
+  auto& mesh_data{packet.mesh_data[mesh_local_idx]};
+
+  auto const orig_pos_buf_local_idx{std::exchange(mesh_data.pos_buf_local_idx, skinned_pos_buf_local_idx)};
+  auto const orig_norm_buf_local_idx{std::exchange(mesh_data.norm_buf_local_idx, skinned_norm_buf_local_idx)};
+  auto const orig_tan_buf_local_idx{std::exchange(mesh_data.tan_buf_local_idx, skinned_tan_buf_local_idx)};
+
+  auto const bone_palette_offset{cursor.bone};
+  cursor.bone += static_cast<unsigned>(mesh->GetBones().size());
+
+  auto const animation_layers{comp.GetAnimationLayers()};
+  auto const first_animation_layer_idx{cursor.animation_layer};
+  std::ranges::copy(animation_layers, std::begin(packet.animation_layers) + first_animation_layer_idx);
+  cursor.animation_layer += static_cast<unsigned>(animation_layers.size());
 
-  return per_draw_cbs_[next_per_draw_cb_idx_++][render_manager_->GetCurrentFrameIndex()];
+  packet.skinned_mesh_data[cursor.skinned_mesh++] = SkinnedMeshData{
+    mesh_local_idx, orig_pos_buf_local_idx, orig_norm_buf_local_idx, orig_tan_buf_local_idx,
+    bone_weight_buf_local_idx, bone_index_buf_local_idx, first_submesh_local_idx,
+    cursor.submesh - first_submesh_local_idx, bone_palette_offset, first_animation_layer_idx,
+    static_cast<unsigned>(animation_layers.size()), comp.GetAnimationLods(), comp.IsPausingAnimationWhenCulled(),
+    mesh->GetSharedBindPose(), mesh->GetSharedSkeleton(), mesh->GetSharedBones(), mesh->GetSharedSubmeshBones(), &comp
+  };
 }
 
 
-auto SceneRenderer::OnWindowSize(Extent2D<std::uint32_t> const size) -> void {
-  if (size.width != 0 && size.height != 0) {
-    RenderTarget::Desc desc{main_rt_->GetDesc()};
-    desc.width = size.width;
-    desc.height = size.height;
-    main_rt_ = RenderTarget::New(*device_, desc);
-  }
+auto SceneRenderer::ExtractLightData(LightComponent const& light) -> LightData {
+  auto const& transform{light.GetEntity()->GetTransform()};
+  return LightData{
+    light.GetColor(), light.GetIntensity(), light.GetDirection(), transform.GetWorldPosition(), light.GetType(),
+    light.GetRange(), light.GetInnerAngle(), light.GetOuterAngle(), light.IsCastingShadow(),
+    light.GetShadowNearPlane(), light.GetShadowNormalBias(), light.GetShadowDepthBias(), light.GetShadowExtension(),
+    transform.CalculateLocalToWorldMatrixWithoutScale(), &light
+  };
 }
 
 
-SceneRenderer::SceneRenderer(Window& window, graphics::GraphicsDevice& device, RenderManager& render_manager) :
-  render_manager_{&render_manager},
-  window_{&window},
-  device_{&device} {
-  for (auto& buf : light_buffers_) {
-    buf = StructuredBuffer<ShaderLight>::New(*device_, *render_manager_, true);
-  }
+auto SceneRenderer::UpdateStaticMeshMirror(bool rebuild) -> void {
+  auto& mirror{static_mesh_mirror_};
+  auto patched{false};
 
-  gizmo_color_buffer_ = StructuredBuffer<Vector4>::New(*device_, *render_manager_, true);
+  if (!rebuild) {
+    auto& entry_indices{tmp_patched_static_mesh_entry_indices_};
+    entry_indices.clear();
 
-  line_gizmo_vertex_data_buffer_ = StructuredBuffer<ShaderLineGizmoVertexData>::New(*device_, *render_manager_, true);
+    for (auto const comp : tmp_changed_mesh_components_) {
+      // Skinned mesh components are extracted every frame, so they are not found here
+      if (auto const it{mirror.component_entry_indices.find(comp)}; it != std::end(mirror.component_entry_indices)) {
+        entry_indices.emplace_back(it->second);
+      }
+    }
 
-  main_rt_ = RenderTarget::New(*device_, RenderTarget::Desc{
-    static_cast<UINT>(window_->GetClientAreaSize().width), static_cast<UINT>(window_->GetClientAreaSize().height),
-    DXGI_FORMAT_R8G8B8A8_UNORM, std::nullopt, 1, L"Main RT", false
-  });
+    for (auto const mesh : tmp_changed_meshes_) {
+      auto const [indices_begin, indices_end]{mirror.mesh_entry_indices.equal_range(mesh)};
+      std::transform(indices_begin, indices_end, std::back_inserter(entry_indices), [](auto const& pair) {
+        return pair.second;
+      });
+    }
 
-  dir_shadow_map_arr_ = std::make_unique<DirectionalShadowMapArray>(device_.Get(), depth_format_, 4096);
-  dir_shadow_map_arr_->GetTex()->SetDebugName(L"Directional Shadow Map Array");
+    for (auto const mtl : tmp_changed_materials_) {
+      auto const [indices_begin, indices_end]{mirror.material_entry_indices.equal_range(mtl)};
+      std::transform(indices_begin, indices_end, std::back_inserter(entry_indices), [](auto const& pair) {
+        return pair.second;
+      });
+    }
 
-  punctual_shadow_atlas_ = std::make_unique<PunctualShadowAtlas>(device_.Get(), depth_format_, 4096);
-  punctual_shadow_atlas_->GetTex()->SetDebugName(L"Punctual Shadow Atlas");
+    std::ranges::sort(entry_indices);
+    auto const [unique_end, entry_indices_end]{std::ranges::unique(entry_indices)};
+    entry_indices.erase(unique_end, entry_indices_end);
 
-  RecreatePipelines();
+    for (auto const entry_idx : entry_indices) {
+      if (!PatchStaticMeshMirrorEntry(entry_idx)) {
+        rebuild = true;
+        break;
+      }
 
-  for (auto& cb : per_frame_cbs_) {
-    if (auto opt{ConstantBuffer<ShaderPerFrameConstants>::New(*device_, true)}) {
-      cb = std::move(*opt);
+      patched = true;
     }
   }
 
-  CreatePerViewConstantBuffers(1);
-  CreatePerDrawConstantBuffers(100);
+  auto instances_changed{rebuild || patched};
 
-  samp_cmp_pcf_ge_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
-    D3D12_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
-    D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0, 1, D3D12_COMPARISON_FUNC_GREATER_EQUAL, {},
-    0, 0
-  });
+  if (rebuild) {
+    auto& jobs{static_mesh_extraction_jobs_};
+    PrepareMeshExtractionJobs(static_mesh_components_.size(), jobs);
 
-  samp_cmp_pcf_le_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
-    D3D12_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
-    D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0, 1, D3D12_COMPARISON_FUNC_LESS_EQUAL, {}, 0, 0
-  });
+    RunMeshExtractionJobs(jobs, [this](MeshExtractionJob& job) {
+      for (auto i{job.first_comp_idx}; i < job.first_comp_idx + job.comp_count; i++) {
+        auto const comp{static_mesh_components_[i]};
+        CountMeshComponent(*comp, job.counts);
 
-  samp_cmp_point_ge_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
-    D3D12_FILTER_COMPARISON_MIN_MAG_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
-    D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0, 1, D3D12_COMPARISON_FUNC_GREATER_EQUAL, {}, 0, 0
-  });
+        if (IsExtractingOccluder(*comp)) {
+          CountOccluder(*comp, job.counts);
+        }
+      }
+    });
 
-  samp_cmp_point_le_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
-    D3D12_FILTER_COMPARISON_MIN_MAG_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
-    D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0, 1, D3D12_COMPARISON_FUNC_LESS_EQUAL, {}, 0, 0
-  });
+    auto const totals{CalculateMeshExtractionOffsets(jobs, {})};
 
-  samp_af16_clamp_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
-    D3D12_FILTER_ANISOTROPIC, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
-    D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0, 16, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
-  });
+    mirror.mesh_data.resize(totals.mesh);
+    mirror.submesh_data.resize(totals.submesh);
+    mirror.instance_data.resize(totals.submesh);
+    mirror.occluder_data.resize(totals.occluder);
+    mirror.occluder_vertices.resize(totals.occluder_vertex);
+    mirror.occluder_indices.resize(totals.occluder_index);
+    mirror.instance_keys.resize(totals.submesh);
+    tmp_static_mesh_entries_.resize(static_mesh_components_.size());
 
-  samp_af8_clamp_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
-    D3D12_FILTER_ANISOTROPIC, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
-    D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0, 8, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
-  });
+    RunMeshExtractionJobs(jobs, [this, &mirror](MeshExtractionJob& job) {
+      ClearMeshExtractionJobResources(job);
+      auto cursor{job.offsets};
 
-  samp_af4_clamp_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
-    D3D12_FILTER_ANISOTROPIC, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
-    D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0, 4, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
-  });
+      for (auto i{job.first_comp_idx}; i < job.first_comp_idx + job.comp_count; i++) {
+        auto const comp{static_mesh_components_[i]};
+        auto const first_mesh{cursor.mesh};
+        auto const first_instance{cursor.submesh};
 
-  samp_af2_clamp_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
-    D3D12_FILTER_ANISOTROPIC, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
-    D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0, 2, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
-  });
+        ExtractMeshComponent(*comp, job, cursor, mirror, std::span{mirror.instance_keys});
 
-  samp_tri_clamp_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
-    D3D12_FILTER_MIN_MAG_MIP_LINEAR, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
-    D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0, 1, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
-  });
+        tmp_static_mesh_entries_[i] = StaticMeshMirrorEntry{
+          comp, first_mesh, cursor.mesh - first_mesh, first_instance, cursor.submesh - first_instance,
+          IsExtractingOccluder(*comp) ? static_cast<int>(ExtractOccluder(*comp, cursor, mirror)) : -1
+        };
+      }
+    });
 
-  samp_bi_clamp_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
-    D3D12_FILTER_MIN_MAG_LINEAR_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
-    D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0, 1, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
-  });
+    // Merging in job order yields the same resource indices as a serial extraction would
 
-  samp_point_clamp_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
-    D3D12_FILTER_MIN_MAG_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
-    D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0, 1, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
-  });
+    mirror.buffers.clear();
+    mirror.textures.clear();
+    mirror.buffer_indices.Clear();
+    mirror.texture_indices.Clear();
 
-  samp_af16_wrap_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
-    D3D12_FILTER_ANISOTROPIC, D3D12_TEXTURE_ADDRESS_MODE_WRAP, D3D12_TEXTURE_ADDRESS_MODE_WRAP,
-    D3D12_TEXTURE_ADDRESS_MODE_WRAP, 0, 16, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
-  });
+    for (auto& job : jobs) {
+      job.buffer_remap.clear();
 
-  samp_af8_wrap_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
-    D3D12_FILTER_ANISOTROPIC, D3D12_TEXTURE_ADDRESS_MODE_WRAP, D3D12_TEXTURE_ADDRESS_MODE_WRAP,
-    D3D12_TEXTURE_ADDRESS_MODE_WRAP, 0, 8, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
-  });
+      for (auto const& buf : job.buffers) {
+        auto const [idx, inserted]{
+          mirror.buffer_indices.FindOrInsert(buf.get(), static_cast<unsigned>(mirror.buffers.size()))
+        };
 
-  samp_af4_wrap_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
-    D3D12_FILTER_ANISOTROPIC, D3D12_TEXTURE_ADDRESS_MODE_WRAP, D3D12_TEXTURE_ADDRESS_MODE_WRAP,
-    D3D12_TEXTURE_ADDRESS_MODE_WRAP, 0, 4, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
-  });
+        if (inserted) {
+          mirror.buffers.emplace_back(buf);
+        }
 
-  samp_af2_wrap_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
-    D3D12_FILTER_ANISOTROPIC, D3D12_TEXTURE_ADDRESS_MODE_WRAP, D3D12_TEXTURE_ADDRESS_MODE_WRAP,
-    D3D12_TEXTURE_ADDRESS_MODE_WRAP, 0, 2, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
-  });
+        job.buffer_remap.emplace_back(idx);
+      }
 
-  samp_tri_wrap_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
-    D3D12_FILTER_MIN_MAG_MIP_LINEAR, D3D12_TEXTURE_ADDRESS_MODE_WRAP, D3D12_TEXTURE_ADDRESS_MODE_WRAP,
-    D3D12_TEXTURE_ADDRESS_MODE_WRAP, 0, 1, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
-  });
+      for (auto const& tex : job.textures) {
+        if (mirror.texture_indices.FindOrInsert(tex.get(), static_cast<unsigned>(mirror.textures.size())).second) {
+          mirror.textures.emplace_back(tex);
+        }
+      }
+    }
 
-  samp_bi_wrap_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
-    D3D12_FILTER_MIN_MAG_LINEAR_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_WRAP, D3D12_TEXTURE_ADDRESS_MODE_WRAP,
-    D3D12_TEXTURE_ADDRESS_MODE_WRAP, 0, 1, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
-  });
+    RunMeshExtractionJobs(jobs, [&mirror](MeshExtractionJob& job) {
+      RemapExtractedBufferIndices(job, mirror.mesh_data, mirror.submesh_data, {});
+    });
 
-  samp_point_wrap_ = device_->CreateSampler(D3D12_SAMPLER_DESC{
-    D3D12_FILTER_MIN_MAG_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_WRAP, D3D12_TEXTURE_ADDRESS_MODE_WRAP,
-    D3D12_TEXTURE_ADDRESS_MODE_WRAP, 0, 1, D3D12_COMPARISON_FUNC_NEVER, {}, 0, std::numeric_limits<float>::max()
-  });
+    mirror.entries = tmp_static_mesh_entries_;
+    mirror.component_entry_indices.clear();
+    mirror.transform_entry_indices.clear();
+    mirror.mesh_entry_indices.clear();
+    mirror.material_entry_indices.clear();
+
+    for (unsigned entry_idx{0}; entry_idx < static_cast<unsigned>(mirror.entries.size()); entry_idx++) {
+      auto const comp{mirror.entries[entry_idx].component};
+      mirror.component_entry_indices.emplace(comp, entry_idx);
+      mirror.transform_entry_indices.emplace(std::addressof(comp->GetEntity()->GetTransform()), entry_idx);
+      IndexStaticMeshMirrorEntryResources(entry_idx);
+    }
 
-  window_size_event_listener_ = window_->OnWindowSize.add_listener([this](Extent2D<unsigned> const size) {
-    OnWindowSize(size);
-  });
+    mirror.structure_version += 1;
+    mirror.transform_version += 1;
+  } else {
+    // Transforms not driving a static mesh component are not found here
+    for (auto const changed_transform : tmp_changed_transforms_) {
+      auto const [indices_begin, indices_end]{mirror.transform_entry_indices.equal_range(changed_transform)};
+
+      for (auto it{indices_begin}; it != indices_end; ++it) {
+        auto const& entry{mirror.entries[it->second]};
+        auto const& local_to_world_mtx{changed_transform->GetLocalToWorldMatrix()};
+
+        for (auto i{entry.first_instance}; i < entry.first_instance + entry.instance_count; i++) {
+          auto& instance{mirror.instance_data[i]};
+          instance.local_to_world_mtx = local_to_world_mtx;
+          instance.bounds_ws = mirror.submesh_data[instance.submesh_local_idx].bounds.Transform(local_to_world_mtx);
+        }
 
-  ssao_samples_buffer_ = StructuredBuffer<Vector4>::New(*device_, *render_manager_, true);
-  RecreateSsaoSamples(ssao_params_.sample_count);
+        if (entry.occluder_idx >= 0) {
+          mirror.occluder_data[entry.occluder_idx].local_to_world_mtx = local_to_world_mtx;
+        }
 
-  ssao_noise_tex_ = device_->CreateTexture(graphics::TextureDesc{
-    graphics::TextureDimension::k2D, SSAO_NOISE_TEX_DIM, SSAO_NOISE_TEX_DIM, 1, 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1,
-    false, false, true, false
-  }, D3D12_HEAP_TYPE_DEFAULT, nullptr);
-  ssao_noise_tex_->SetDebugName(L"SSAO Noise");
+        instances_changed = true;
+      }
+    }
 
-  std::vector<Vector4> ssao_noise;
-  std::uniform_real_distribution dist{0.0f, 1.0f};
-  std::default_random_engine gen; // NOLINT(cert-msc51-cpp)
+    // Patches may have added resources and changed anything but the sizes of the arrays
+    if (patched) {
+      mirror.structure_version += 1;
+    }
 
-  for (auto i{0}; i < SSAO_NOISE_TEX_DIM * SSAO_NOISE_TEX_DIM; i++) {
-    ssao_noise.emplace_back(dist(gen) * 2 - 1, dist(gen) * 2 - 1, 0, 0);
+    if (instances_changed) {
+      mirror.transform_version += 1;
+    }
   }
 
-  render_manager_->UpdateTexture(*ssao_noise_tex_, 0, std::array{
-    D3D12_SUBRESOURCE_DATA{
-      ssao_noise.data(), SSAO_NOISE_TEX_DIM * sizeof(Vector4), SSAO_NOISE_TEX_DIM * SSAO_NOISE_TEX_DIM * sizeof(Vector4)
+  if (!instances_changed) {
+    return;
+  }
+
+  // The hierarchy only has to be rebuilt if the set of static instances changed,
+  // otherwise refitting it to the moved instances is enough.
+
+  tmp_static_instance_bounds_.clear();
+  std::ranges::transform(mirror.instance_data, std::back_inserter(tmp_static_instance_bounds_),
+    [](InstanceData const& instance) {
+      return instance.bounds_ws;
+    });
+
+  if ((rebuild || patched) && !std::ranges::equal(mirror.instance_keys, static_submesh_instance_keys_)) {
+    static_submesh_instance_keys_ = mirror.instance_keys;
+    static_submesh_instance_bvh_.Build(tmp_static_instance_bounds_);
+  } else {
+    static_submesh_instance_bvh_.Update(tmp_static_instance_bounds_);
+  }
+
+  static_submesh_instance_bvh_version_ += 1;
+}
+
+
+auto SceneRenderer::PatchStaticMeshMirrorEntry(unsigned const entry_idx) -> bool {
+  auto& mirror{static_mesh_mirror_};
+  auto const& entry{mirror.entries[entry_idx]};
+  auto const& comp{*entry.component};
+  auto const is_occluder{IsExtractingOccluder(comp)};
+
+  MeshExtractionCounts counts{};
+  CountMeshComponent(comp, counts);
+
+  if (is_occluder) {
+    CountOccluder(comp, counts);
+  }
+
+  if (counts.mesh != entry.mesh_count || counts.submesh != entry.instance_count ||
+      is_occluder != (entry.occluder_idx >= 0)) {
+    return false;
+  }
+
+  auto& job{static_mesh_patch_job_};
+  job.counts = counts;
+  job.offsets = MeshExtractionCounts{.mesh = entry.first_mesh, .submesh = entry.first_instance};
+
+  if (is_occluder) {
+    auto const& occluder{mirror.occluder_data[entry.occluder_idx]};
+
+    if (counts.occluder_vertex != occluder.vertex_count || counts.occluder_index != occluder.index_count) {
+      return false;
     }
-  });
 
+    job.offsets.occluder = static_cast<unsigned>(entry.occluder_idx);
+    job.offsets.occluder_vertex = occluder.first_vertex;
+    job.offsets.occluder_index = occluder.first_index;
+  }
 
-  white_tex_ = device_->CreateTexture(graphics::TextureDesc{
-    graphics::TextureDimension::k2D, 1, 1, 1, 1, DXGI_FORMAT_R8G8B8A8_UNORM, 1, false, false, true, false
-  }, D3D12_HEAP_TYPE_DEFAULT, nullptr);
+  ClearMeshExtractionJobResources(job);
+  auto cursor{job.offsets};
 
-  std::array<std::uint8_t, 4> constexpr white_tex_data{255, 255, 255, 255};
+  ExtractMeshComponent(comp, job, cursor, mirror, std::span{mirror.instance_keys});
 
-  render_manager_->UpdateTexture(*white_tex_, 0, std::array{
-    D3D12_SUBRESOURCE_DATA{white_tex_data.data(), sizeof(white_tex_data), sizeof(white_tex_data)}
-  });
+  if (is_occluder) {
+    ExtractOccluder(comp, cursor, mirror);
+  }
+
+  // Resources the entry no longer uses stay referenced by the mirror until the next rebuild
+
+  job.buffer_remap.clear();
+
+  for (auto const& buf : job.buffers) {
+    auto const [idx, inserted]{
+      mirror.buffer_indices.FindOrInsert(buf.get(), static_cast<unsigned>(mirror.buffers.size()))
+    };
+
+    if (inserted) {
+      mirror.buffers.emplace_back(buf);
+    }
+
+    job.buffer_remap.emplace_back(idx);
+  }
+
+  for (auto const& tex : job.textures) {
+    if (mirror.texture_indices.FindOrInsert(tex.get(), static_cast<unsigned>(mirror.textures.size())).second) {
+      mirror.textures.emplace_back(tex);
+    }
+  }
+
+  RemapExtractedBufferIndices(job, mirror.mesh_data, mirror.submesh_data, {});
+  IndexStaticMeshMirrorEntryResources(entry_idx);
+  return true;
 }
 
 
-SceneRenderer::~SceneRenderer() {
-  window_->OnWindowSize.remove_listener(window_size_event_listener_);
+auto SceneRenderer::IndexStaticMeshMirrorEntryResources(unsigned const entry_idx) -> void {
+  auto& mirror{static_mesh_mirror_};
+  auto const& comp{*mirror.entries[entry_idx].component};
+
+  auto const index_entry{
+    [entry_idx](auto& indices, auto const key) {
+      auto const [indices_begin, indices_end]{indices.equal_range(key)};
+
+      if (std::none_of(indices_begin, indices_end, [entry_idx](auto const& pair) {
+        return pair.second == entry_idx;
+      })) {
+        indices.emplace(key, entry_idx);
+      }
+    }
+  };
+
+  if (auto const mesh{comp.GetMesh()}) {
+    index_entry(mirror.mesh_entry_indices, mesh);
+  }
+
+  for (auto const mtl : comp.GetMaterials()) {
+    if (mtl) {
+      index_entry(mirror.material_entry_indices, mtl);
+    }
+  }
 }
 
 
-auto SceneRenderer::ExtractCurrentState() -> void {
-  auto& packet{frame_packets_[render_manager_->GetCurrentFrameIndex()]};
-
-  packet.buffers.clear();
-  packet.textures.clear();
-  packet.light_data.clear();
-  packet.mesh_data.clear();
-  packet.submesh_data.clear();
-  packet.instance_data.clear();
-  packet.cam_data.clear();
-  packet.render_targets.clear();
-  packet.anim_pos_keys.clear();
-  packet.anim_rot_keys.clear();
-  packet.anim_scaling_keys.clear();
-  packet.node_anim_data.clear();
-  packet.skeleton_node_data.clear();
-  packet.bone_data.clear();
-  packet.skinned_mesh_data.clear();
+auto SceneRenderer::UpdateLightMirror(bool const rebuild) -> void {
+  auto& mirror{light_mirror_};
+
+  if (rebuild) {
+    mirror.light_data.clear();
+    mirror.light_indices.clear();
+    mirror.transform_light_indices.clear();
 
-  packet.light_data.reserve(lights_.size());
+    for (auto const light : lights_) {
+      auto& transform{light->GetEntity()->GetTransform()};
+      auto const light_idx{static_cast<unsigned>(mirror.light_data.size())};
+
+      mirror.light_data.emplace_back(ExtractLightData(*light));
+      mirror.light_indices.emplace(light, light_idx);
+      mirror.transform_light_indices.emplace(std::addressof(transform), light_idx);
+    }
+
+    mirror.version += 1;
+    return;
+  }
+
+  auto changed{false};
+
+  for (auto const changed_light : tmp_changed_lights_) {
+    if (auto const it{mirror.light_indices.find(changed_light)}; it != std::end(mirror.light_indices)) {
+      mirror.light_data[it->second] = ExtractLightData(*lights_[it->second]);
+      changed = true;
+    }
+  }
+
+  for (auto const changed_transform : tmp_changed_transforms_) {
+    auto const [indices_begin, indices_end]{mirror.transform_light_indices.equal_range(changed_transform)};
+
+    for (auto it{indices_begin}; it != indices_end; ++it) {
+      auto const light{lights_[it->second]};
+      mirror.light_data[it->second] = ExtractLightData(*light);
+      changed = true;
+    }
+  }
+
+  if (changed) {
+    mirror.version += 1;
+  }
+}
 
-  for (auto const light : lights_) {
-    packet.light_data.emplace_back(light->GetColor(), light->GetIntensity(), light->GetDirection(),
-      light->GetEntity()->GetTransform().GetWorldPosition(), light->GetType(), light->GetRange(),
-      light->GetInnerAngle(),
-      light->GetOuterAngle(), light->IsCastingShadow(), light->GetShadowNearPlane(), light->GetShadowNormalBias(),
-      light->GetShadowDepthBias(), light->GetShadowExtension(),
-      light->GetEntity()->GetTransform().CalculateLocalToWorldMatrixWithoutScale());
-  }
 
-  packet.mesh_data.reserve(static_mesh_components_.size());
+auto SceneRenderer::AcquireFramePacketForExtraction() -> FramePacket& {
+  auto const extracted_count{extracted_packet_count_.load()};
 
-  auto const find_or_emplace_back_buffer{
-    [&packet](graphics::SharedDeviceChildHandle<graphics::Buffer> const& buf) -> unsigned {
-      unsigned idx;
+  // The packet that last occupied the slot has to be consumed before it can be overwritten
+  for (auto rendered_count{rendered_packet_count_.load()}; extracted_count - rendered_count >= frame_packets_.size();
+       rendered_count = rendered_packet_count_.load()) {
+    rendered_packet_count_.wait(rendered_count);
+  }
 
-      if (auto const it{std::ranges::find(packet.buffers, buf)}; it != std::ranges::end(packet.buffers)) {
-        idx = static_cast<unsigned>(it - packet.buffers.begin());
-      } else {
-        idx = static_cast<unsigned>(packet.buffers.size());
-        packet.buffers.emplace_back(buf);
-      }
+  auto& packet{frame_packets_[extracted_count % frame_packets_.size()]};
+  packet.frame_idx = static_cast<UINT>(extracted_count % frame_packets_.size());
 
-      return idx;
-    }
-  };
+  // Overwriting the packet drops its references to resources the GPU could still be using
+  if (packet.gpu_frame_count) {
+    render_manager_->WaitForFrame(*packet.gpu_frame_count);
+  }
 
-  auto const find_or_emplace_back_texture{
-    [&packet](graphics::SharedDeviceChildHandle<graphics::Texture> const& tex) -> unsigned {
-      unsigned idx;
+  return packet;
+}
 
-      if (auto const it{std::ranges::find(packet.textures, tex)}; it != std::ranges::end(packet.textures)) {
-        idx = static_cast<unsigned>(it - packet.textures.begin());
-      } else {
-        idx = static_cast<unsigned>(packet.textures.size());
-        packet.textures.emplace_back(tex);
-      }
 
-      return idx;
-    }
-  };
+auto SceneRenderer::GetFramePacketToRender() -> FramePacket& {
+  auto const rendered_count{rendered_packet_count_.load()};
+  assert(rendered_count < extracted_packet_count_.load());
 
-  auto const extract_from_mesh_comp{
-    [&find_or_emplace_back_buffer, &packet, &find_or_emplace_back_texture](MeshComponentBase const* const comp) {
-      auto const mesh{comp->GetMesh()};
+  auto& packet{frame_packets_[rendered_count % frame_packets_.size()]};
 
-      if (!mesh) {
-        return;
-      }
+  // The packet references per frame resources of its frame index, rendering it in another frame would race the GPU
+  if (packet.frame_idx != render_manager_->GetCurrentFrameIndex()) {
+    throw std::runtime_error{"Frame packet does not belong to the frame being rendered."};
+  }
 
-      auto const pos_buf_local_idx{find_or_emplace_back_buffer(mesh->GetPositionBuffer())};
-      auto const norm_buf_local_idx{find_or_emplace_back_buffer(mesh->GetNormalBuffer())};
-      auto const tan_buf_local_idx{find_or_emplace_back_buffer(mesh->GetTangentBuffer())};
-      auto const uv_buf_local_idx{find_or_emplace_back_buffer(mesh->GetUvBuffer())};
-      auto const idx_buf_local_idx{find_or_emplace_back_buffer(mesh->GetIndexBuffer())};
-      auto const idx_format{mesh->GetIndexFormat()};
-      packet.mesh_data.emplace_back(pos_buf_local_idx, norm_buf_local_idx, tan_buf_local_idx, uv_buf_local_idx,
-        idx_buf_local_idx, static_cast<unsigned>(mesh->GetVertexCount()), mesh->GetBounds(), idx_format);
+  return packet;
+}
 
-      packet.submesh_data.reserve(packet.submesh_data.size() + mesh->GetSubmeshCount());
 
-      for (auto const& submesh : mesh->GetSubMeshes()) {
-        auto const mtl{comp->GetMaterials()[submesh.material_index]};
+auto SceneRenderer::ReleaseRenderedFramePacket(FramePacket& packet) -> void {
+  packet.gpu_frame_count = render_manager_->GetCurrentFrameCount();
+  rendered_packet_count_.fetch_add(1);
+  rendered_packet_count_.notify_all();
+}
 
-        if (!mtl) {
-          continue;
-        }
 
-        auto const mtl_buf_local_idx{find_or_emplace_back_buffer(mtl->GetBuffer())};
+auto SceneRenderer::ExtractCurrentState() -> void {
+  auto& packet{AcquireFramePacketForExtraction()};
 
-        for (auto const tex : {
-               mtl->GetAlbedoMap(), mtl->GetMetallicMap(), mtl->GetRoughnessMap(), mtl->GetAoMap(), mtl->GetNormalMap(),
-               mtl->GetOpacityMask()
-             }) {
-          if (tex) {
-            find_or_emplace_back_texture(tex->GetTex());
-          }
-        }
+  {
+    std::scoped_lock const lock{bone_palette_mutex_};
 
-        packet.submesh_data.emplace_back(static_cast<unsigned>(packet.mesh_data.size() - 1), submesh.base_vertex,
-          submesh.first_index, submesh.index_count, mtl_buf_local_idx, submesh.bounds);
+    if (std::exchange(bone_palettes_published_, false)) {
+      std::swap(published_bone_palettes_, extracted_bone_palettes_);
+    }
+  }
 
-        packet.instance_data.emplace_back(static_cast<unsigned>(packet.submesh_data.size() - 1),
-          comp->GetEntity()->GetTransform().GetLocalToWorldMatrix());
-      }
+  bool rebuild_static_mesh_mirror;
+  bool rebuild_light_mirror;
+
+  {
+    std::scoped_lock const lock{change_mutex_};
+    rebuild_static_mesh_mirror = std::exchange(static_meshes_changed_, false);
+    rebuild_light_mirror = std::exchange(lights_changed_, false);
+    std::swap(changed_transforms_, tmp_changed_transforms_);
+    std::swap(changed_lights_, tmp_changed_lights_);
+    std::swap(changed_mesh_components_, tmp_changed_mesh_components_);
+    std::swap(changed_meshes_, tmp_changed_meshes_);
+    std::swap(changed_materials_, tmp_changed_materials_);
+    std::swap(destroyed_meshes_, tmp_destroyed_meshes_);
+    std::swap(destroyed_materials_, tmp_destroyed_materials_);
+
+    // Every notified transform is consumed here, even those driving nothing the mirrors track.
+    // Changes made from now on notify again and are picked up by the next extraction.
+    // Destroyed transforms have already been removed from the queue, so every pointer is valid.
+    for (auto const transform : tmp_changed_transforms_) {
+      transform->SetChanged(false);
     }
-  };
+  }
 
-  std::ranges::for_each(static_mesh_components_, extract_from_mesh_comp);
+  // Destroyed resources were removed from the change queues, so the changes all belong to live resources
+  for (auto const mesh : tmp_destroyed_meshes_) {
+    mesh_change_versions_.erase(mesh);
+  }
 
-  std::ranges::for_each(skinned_mesh_components_,
-    [&extract_from_mesh_comp, &packet, this](SkinnedMeshComponent const* const comp) {
-      auto const mesh{comp->GetMesh()};
+  for (auto const mtl : tmp_destroyed_materials_) {
+    material_change_versions_.erase(mtl);
+  }
 
-      if (!mesh) {
-        return;
-      }
+  for (auto const mesh : tmp_changed_meshes_) {
+    mesh_change_versions_[mesh] = ++resource_change_count_;
+  }
 
-      extract_from_mesh_comp(comp);
+  for (auto const mtl : tmp_changed_materials_) {
+    material_change_versions_[mtl] = ++resource_change_count_;
+  }
 
-      auto const anim{comp->GetCurrentAnimation()};
+  UpdateStaticMeshMirror(rebuild_static_mesh_mirror);
+  UpdateLightMirror(rebuild_light_mirror);
+
+  tmp_changed_transforms_.clear();
+  tmp_changed_lights_.clear();
+  tmp_changed_mesh_components_.clear();
+  tmp_changed_meshes_.clear();
+  tmp_changed_materials_.clear();
+  tmp_destroyed_meshes_.clear();
+  tmp_destroyed_materials_.clear();
+
+  // The packet only has to catch up with the mirrors if they changed since it was last used
+
+  auto const& mirror{static_mesh_mirror_};
+
+  if (packet.static_mesh_structure_version != mirror.structure_version) {
+    packet.buffers = mirror.buffers;
+    packet.textures = mirror.textures;
+    packet.mesh_data = mirror.mesh_data;
+    packet.submesh_data = mirror.submesh_data;
+    packet.instance_data = mirror.instance_data;
+    packet.occluder_data = mirror.occluder_data;
+    packet.occluder_vertices = mirror.occluder_vertices;
+    packet.occluder_indices = mirror.occluder_indices;
+    packet.static_mesh_structure_version = mirror.structure_version;
+    packet.static_mesh_transform_version = mirror.transform_version;
+  } else {
+    // Drop the skinned meshes appended during the previous use of the packet
+    packet.buffers.resize(mirror.buffers.size());
+    packet.textures.resize(mirror.textures.size());
+    packet.mesh_data.resize(mirror.mesh_data.size());
+    packet.submesh_data.resize(mirror.submesh_data.size());
+
+    if (packet.static_mesh_transform_version != mirror.transform_version) {
+      packet.instance_data = mirror.instance_data;
+      packet.occluder_data = mirror.occluder_data;
+      packet.static_mesh_transform_version = mirror.transform_version;
+    } else {
+      packet.instance_data.resize(mirror.instance_data.size());
+    }
+  }
 
-      if (!anim) {
-        return;
-      }
+  if (packet.light_data_version != light_mirror_.version) {
+    packet.light_data = light_mirror_.light_data;
+    packet.light_data_version = light_mirror_.version;
+  }
 
-      // TODO add proper skinned mesh culling with GPU culling
+  // Only copy the hierarchy if the packet's copy is outdated
+  if (packet.static_submesh_instance_bvh_version != static_submesh_instance_bvh_version_) {
+    packet.static_submesh_instance_bvh = static_submesh_instance_bvh_;
+    packet.static_submesh_instance_bvh_version = static_submesh_instance_bvh_version_;
+  }
 
-      AABB const inf_aabb{
-        Vector3{-std::numeric_limits<float>::infinity()},
-        Vector3{std::numeric_limits<float>::infinity()}
-      };
+  packet.cam_data.clear();
+  packet.render_targets.clear();
 
-      // Set mesh AABB to infinity to prevent culling
-      packet.mesh_data.back().bounds = inf_aabb;
+  buffer_indices_.Clear();
+  texture_indices_.Clear();
+  render_target_indices_.Clear();
 
-      // Set submesh AABBs to infinity to prevent culling
-      for (auto i{std::ssize(packet.submesh_data) - 1};
-           i >= 0 && packet.submesh_data[i].mesh_local_idx == std::ssize(packet.mesh_data) - 1; i--) {
-        packet.submesh_data[i].bounds = inf_aabb;
-      }
+  // Skinned meshes are extracted every frame on top of the static ones
 
-      packet.buffers.emplace_back(mesh->GetBoneWeightBuffer());
-      auto const bone_weight_buf_local_idx{static_cast<unsigned>(packet.buffers.size() - 1)};
+  auto& jobs{skinned_mesh_extraction_jobs_};
+  PrepareMeshExtractionJobs(skinned_mesh_components_.size(), jobs);
 
-      packet.buffers.emplace_back(mesh->GetBoneIndexBuffer());
-      auto const bone_index_buf_local_idx{static_cast<unsigned>(packet.buffers.size() - 1)};
+  RunMeshExtractionJobs(jobs, [this](MeshExtractionJob& job) {
+    for (auto i{job.first_comp_idx}; i < job.first_comp_idx + job.comp_count; i++) {
+      auto const comp{skinned_mesh_components_[i]};
+      CountMeshComponent(*comp, job.counts);
 
-      packet.buffers.emplace_back(comp->GetSkinnedVertexBuffers()[render_manager_->GetCurrentFrameIndex()]);
-      auto const skinned_pos_buf_local_idx{static_cast<unsigned>(packet.buffers.size() - 1)};
+      // Instances with no state playing on any of their layers are not skinned, so they need no palette space
+      if (comp->GetMesh() && !comp->GetAnimationLayers().empty()) {
+        job.counts.skinned_mesh += 1;
+        job.counts.animation_layer += static_cast<unsigned>(comp->GetAnimationLayers().size());
+        job.counts.bone += static_cast<unsigned>(comp->GetMesh()->GetBones().size());
+      }
+    }
+  });
 
-      packet.buffers.emplace_back(comp->GetSkinnedNormalBuffers()[render_manager_->GetCurrentFrameIndex()]);
-      auto const skinned_norm_buf_local_idx{static_cast<unsigned>(packet.buffers.size() - 1)};
+  MeshExtractionCounts base_offsets{};
+  base_offsets.mesh = static_cast<unsigned>(packet.mesh_data.size());
+  base_offsets.submesh = static_cast<unsigned>(packet.submesh_data.size());
 
-      packet.buffers.emplace_back(comp->GetSkinnedTangentBuffers()[render_manager_->GetCurrentFrameIndex()]);
-      auto const skinned_tan_buf_local_idx{static_cast<unsigned>(packet.buffers.size() - 1)};
+  auto const totals{CalculateMeshExtractionOffsets(jobs, base_offsets)};
 
-      packet.buffers.emplace_back(comp->GetBoneMatrixBuffers()[render_manager_->GetCurrentFrameIndex()]);
-      auto const bone_mtx_buf_local_idx{static_cast<unsigned>(packet.buffers.size() - 1)};
+  packet.mesh_data.resize(totals.mesh);
+  packet.submesh_data.resize(totals.submesh);
+  packet.instance_data.resize(totals.submesh);
+  packet.skinned_mesh_data.resize(totals.skinned_mesh);
+  packet.bone_palette_size = totals.bone;
+  packet.animation_layers.resize(totals.animation_layer);
 
-      // Switch the original and skinned buffer indices so that the renderer can treat the skinned mesh as static after
-      // the skinning is done
+  RunMeshExtractionJobs(jobs, [this, &packet](MeshExtractionJob& job) {
+    ClearMeshExtractionJobResources(job);
+    auto cursor{job.offsets};
 
-      auto const orig_pos_buf_local_idx{packet.mesh_data.back().pos_buf_local_idx};
-      auto const orig_norm_buf_local_idx{packet.mesh_data.back().norm_buf_local_idx};
-      auto const orig_tan_buf_local_idx{packet.mesh_data.back().tan_buf_local_idx};
+    for (auto i{job.first_comp_idx}; i < job.first_comp_idx + job.comp_count; i++) {
+      auto const comp{skinned_mesh_components_[i]};
 
-      packet.mesh_data.back().pos_buf_local_idx = skinned_pos_buf_local_idx;
-      packet.mesh_data.back().norm_buf_local_idx = skinned_norm_buf_local_idx;
-      packet.mesh_data.back().tan_buf_local_idx = skinned_tan_buf_local_idx;
+      if (!comp->GetMesh()) {
+        continue;
+      }
 
-      // Extract animation data
+      // Animated instances start out with the bind pose bounds, those are replaced once the pose is evaluated
+      auto const first_submesh_local_idx{cursor.submesh};
+      ExtractMeshComponent(*comp, job, cursor, packet, {});
 
-      auto const node_anim_begin_local_idx{static_cast<unsigned>(packet.node_anim_data.size())};
+      if (!comp->GetAnimationLayers().empty()) {
+        ExtractSkinnedMeshComponent(*comp, first_submesh_local_idx, job, cursor, packet);
+      }
+    }
+  });
 
-      for (auto const& [pos_keys, rot_keys, scaling_keys, node_idx] : anim->node_anims) {
-        auto const pos_key_begin_local_idx{static_cast<unsigned>(packet.anim_pos_keys.size())};
-        auto const rot_key_begin_local_idx{static_cast<unsigned>(packet.anim_rot_keys.size())};
-        auto const scaling_key_begin_local_idx{static_cast<unsigned>(packet.anim_scaling_keys.size())};
+  // Resources of the static meshes are already in the packet, the rest is appended in job order
 
-        std::ranges::copy(pos_keys, std::back_inserter(packet.anim_pos_keys));
-        std::ranges::copy(rot_keys, std::back_inserter(packet.anim_rot_keys));
-        std::ranges::copy(scaling_keys, std::back_inserter(packet.anim_scaling_keys));
+  for (auto& job : jobs) {
+    job.buffer_remap.clear();
 
-        packet.node_anim_data.emplace_back(pos_key_begin_local_idx, static_cast<unsigned>(pos_keys.size()),
-          rot_key_begin_local_idx, static_cast<unsigned>(rot_keys.size()), scaling_key_begin_local_idx,
-          static_cast<unsigned>(scaling_keys.size()), node_idx);
+    for (auto const& buf : job.buffers) {
+      if (auto const static_idx{static_mesh_mirror_.buffer_indices.Find(buf.get())}) {
+        job.buffer_remap.emplace_back(*static_idx);
+        continue;
       }
 
-      // Extract skeleton data
+      auto const [idx, inserted]{buffer_indices_.FindOrInsert(buf.get(), static_cast<unsigned>(packet.buffers.size()))};
 
-      auto const skeleton_begin_local_idx{static_cast<unsigned>(packet.skeleton_node_data.size())};
-      std::ranges::transform(mesh->GetSkeleton(), std::back_inserter(packet.skeleton_node_data),
-        [&comp](SkeletonNode const& node) {
-          return SkeletonNodeData{node.transform, node.parent_idx};
-        });
+      if (inserted) {
+        packet.buffers.emplace_back(buf);
+      }
 
-      // Extract bone data
+      job.buffer_remap.emplace_back(idx);
+    }
 
-      auto const bone_begin_local_idx{static_cast<unsigned>(packet.bone_data.size())};
-      std::ranges::transform(mesh->GetBones(), std::back_inserter(packet.bone_data),
-        [&comp](Bone const& bone) {
-          return BoneData{bone.offset_mtx, bone.skeleton_node_idx};
-        });
+    for (auto const& tex : job.textures) {
+      if (!static_mesh_mirror_.texture_indices.Find(tex.get()) && texture_indices_.FindOrInsert(tex.get(),
+            static_cast<unsigned>(packet.textures.size())).second) {
+        packet.textures.emplace_back(tex);
+      }
+    }
+  }
 
-      packet.skinned_mesh_data.emplace_back(static_cast<unsigned>(packet.mesh_data.size() - 1),
-        orig_pos_buf_local_idx, orig_norm_buf_local_idx, orig_tan_buf_local_idx, bone_weight_buf_local_idx,
-        bone_index_buf_local_idx, bone_mtx_buf_local_idx, comp->GetCurrentAnimationTime(), node_anim_begin_local_idx,
-        static_cast<unsigned>(anim->node_anims.size()), skeleton_begin_local_idx,
-        static_cast<unsigned>(mesh->GetSkeleton().size()), bone_begin_local_idx,
-        static_cast<unsigned>(mesh->GetBones().size()));
-    });
+  RunMeshExtractionJobs(jobs, [&packet](MeshExtractionJob& job) {
+    RemapExtractedBufferIndices(job, packet.mesh_data, packet.submesh_data, packet.skinned_mesh_data);
+  });
 
   auto const find_or_emplace_back_rt{
-    [&packet](std::shared_ptr<RenderTarget> const& rt) -> unsigned {
-      unsigned idx;
+    [&packet, this](std::shared_ptr<RenderTarget> const& rt) -> unsigned {
+      auto const [idx, inserted]{render_target_indices_.FindOrInsert(rt.get(),
+        static_cast<unsigned>(packet.render_targets.size()))};
 
-      if (auto const it{std::ranges::find(packet.render_targets, rt)}; it != std::ranges::end(packet.render_targets)) {
-        idx = static_cast<unsigned>(it - packet.render_targets.begin());
-      } else {
-        idx = static_cast<unsigned>(packet.render_targets.size());
+      if (inserted) {
         packet.render_targets.emplace_back(rt);
       }
 
@@ -1221,7 +2550,7 @@ auto SceneRenderer::ExtractCurrentState() -> void {
     }
   };
 
-  packet.render_targets.emplace_back(rt_override_ ? rt_override_ : main_rt_); // The global RT is always at index 0!
+  find_or_emplace_back_rt(rt_override_ ? rt_override_ : main_rt_); // The global RT is always at index 0!
 
   packet.cam_data.reserve(cameras_.size());
 
@@ -1254,6 +2583,8 @@ auto SceneRenderer::ExtractCurrentState() -> void {
 
   packet.depth_normal_pre_pass_enabled = depth_normal_pre_pass_enabled_;
   packet.ssao_enabled = ssao_enabled_;
+  packet.occlusion_culling_enabled = occlusion_culling_enabled_;
+  packet.animation_update_budget = animation_update_budget_;
 
   packet.color_buffer_format = color_buffer_format_;
 
@@ -1285,16 +2616,18 @@ auto SceneRenderer::ExtractCurrentState() -> void {
   packet.skybox_pso = skybox_pso_;
   packet.ssao_pso = ssao_pso_;
   packet.ssao_blur_pso = ssao_blur_pso_;
+
+  extracted_packet_count_.fetch_add(1);
 }
 
 
 auto SceneRenderer::Render() -> void {
-  next_per_draw_cb_idx_ = 0;
-  next_per_view_cb_idx_ = 0;
-
-  auto const frame_idx{render_manager_->GetCurrentFrameIndex()};
+  auto& frame_packet{GetFramePacketToRender()};
+  auto const frame_idx{frame_packet.frame_idx};
+  constant_buffer_ring_->BeginFrame(frame_idx);
 
-  auto& frame_packet{frame_packets_[frame_idx]};
+  // Resources updated since the previous frame are read by everything submitted below
+  render_manager_->FlushUploads();
 
   gizmo_color_buffer_.Resize(static_cast<int>(std::ssize(frame_packet.gizmo_colors)));
   std::ranges::copy(frame_packet.gizmo_colors, std::begin(gizmo_color_buffer_.GetData()));
@@ -1314,13 +2647,22 @@ auto SceneRenderer::Render() -> void {
     prepare_cmd.SetPipelineState(*vtx_skinning_pso_);
   }
 
+  // Bone palettes of all animated instances are written in parallel straight into the mapped palette buffer of the
+  // frame, which the skinning shader reads directly at the offset of the instance
+
+  auto& bone_palette_buf{bone_palette_buffers_[frame_idx]};
+  bone_palette_buf.Resize(frame_packet.bone_palette_size);
+  auto const bone_palette{bone_palette_buf.GetData()};
+
+  EvaluateSkinnedMeshPoses(frame_packet, bone_palette);
+
   for (auto& [mesh_data_local_idx, original_vertex_buf_local_idx, original_normal_buf_local_idx,
-         original_tangent_buf_local_idx, bone_weight_buf_local_idx, bone_index_buf_local_idx, bone_matrix_buf_local_idx,
-         cur_animation_time, node_anim_begin_local_idx, node_anim_count, skeleton_begin_local_idx, skeleton_size,
-         bone_begin_local_idx, bone_count] : frame_packet.skinned_mesh_data) {
-    // Skip skinning when we are sitting at 0 time.
-    // This happens for example in the editor scene view.
-    if (cur_animation_time == 0) {
+         original_tangent_buf_local_idx, bone_weight_buf_local_idx, bone_index_buf_local_idx, first_submesh_local_idx,
+         submesh_count, bone_palette_offset, first_animation_layer_idx, animation_layer_count, animation_lods,
+         pausing_animation_when_culled, bind_pose, skeleton, bones, submesh_bones, component] :
+       frame_packet.skinned_mesh_data) {
+    // Instances without a pose to evaluate keep their bind pose vertices
+    if (!bones || !bind_pose) {
       prepare_cmd.CopyBuffer(*frame_packet.buffers[frame_packet.mesh_data[mesh_data_local_idx].pos_buf_local_idx],
         *frame_packet.buffers[original_vertex_buf_local_idx]);
       prepare_cmd.CopyBuffer(*frame_packet.buffers[frame_packet.mesh_data[mesh_data_local_idx].norm_buf_local_idx],
@@ -1330,90 +2672,6 @@ auto SceneRenderer::Render() -> void {
       continue;
     }
 
-    // Compute local node transforms
-
-    for (unsigned i{0}; i < node_anim_count; i++) {
-      auto const& [pos_key_begin_local_idx, pos_key_count, rot_key_begin_local_idx, rot_key_count,
-        scaling_key_begin_local_idx, scaling_key_count, node_idx]{
-        frame_packet.node_anim_data[node_anim_begin_local_idx + i]
-      };
-
-      Vector3 pos{};
-      Quaternion rot{};
-      Vector3 scale{1};
-
-      auto const calc_interpolation_factor{
-        [](float const from_time, float const to_time, float const current_time) {
-          return (current_time - from_time) / (to_time - from_time);
-        }
-      };
-
-      if (pos_key_count == 1) {
-        pos = frame_packet.anim_pos_keys[pos_key_begin_local_idx].value;
-      } else {
-        for (unsigned j{0}; j < pos_key_count; j++) {
-          if (auto const& [timestamp, value]{frame_packet.anim_pos_keys[pos_key_begin_local_idx + j]};
-            timestamp > cur_animation_time) {
-            auto const& [prev_timestamp, prev_value]{frame_packet.anim_pos_keys[pos_key_begin_local_idx + j - 1]};
-            pos = Lerp(prev_value, value, calc_interpolation_factor(prev_timestamp, timestamp, cur_animation_time));
-            break;
-          }
-        }
-      }
-
-      if (rot_key_count == 1) {
-        rot = frame_packet.anim_rot_keys[rot_key_begin_local_idx].value;
-      } else {
-        for (unsigned j{0}; j < rot_key_count; j++) {
-          if (auto const& [timestamp, value]{frame_packet.anim_rot_keys[rot_key_begin_local_idx + j]};
-            timestamp > cur_animation_time) {
-            auto const& [prev_timestamp, prev_value]{frame_packet.anim_rot_keys[rot_key_begin_local_idx + j - 1]};
-            rot = Slerp(prev_value, value, calc_interpolation_factor(prev_timestamp, timestamp, cur_animation_time));
-            break;
-          }
-        }
-      }
-
-      if (scaling_key_count == 1) {
-        scale = frame_packet.anim_scaling_keys[scaling_key_begin_local_idx].value;
-      } else {
-        for (unsigned j{0}; j < scaling_key_count; j++) {
-          if (auto const& [timestamp, value]{frame_packet.anim_scaling_keys[scaling_key_begin_local_idx + j]};
-            timestamp > cur_animation_time) {
-            auto const& [prev_timestamp, prev_value]{
-              frame_packet.anim_scaling_keys[scaling_key_begin_local_idx + j - 1]
-            };
-            scale = Lerp(prev_value, value, calc_interpolation_factor(prev_timestamp, timestamp, cur_animation_time));
-            break;
-          }
-        }
-      }
-
-      frame_packet.skeleton_node_data[skeleton_begin_local_idx + node_idx].transform =
-        Matrix4::Scale(scale) * static_cast<Matrix4>(rot) * Matrix4::Translate(pos);
-    }
-
-    // Accumulate node transforms
-
-    for (unsigned i{0}; i < skeleton_size; i++) {
-      if (auto& [transform, parent_idx]{frame_packet.skeleton_node_data[skeleton_begin_local_idx + i]}; parent_idx) {
-        transform = transform * frame_packet.skeleton_node_data[skeleton_begin_local_idx + *parent_idx].transform;
-      }
-    }
-
-    // Update bone matrices
-
-    auto const bone_buf{frame_packet.buffers[bone_matrix_buf_local_idx]};
-    for (unsigned i{0}; i < bone_count; i++) {
-      // TODO this is horrible, update all bones at once
-      auto const bone_mtx{
-        frame_packet.bone_data[bone_begin_local_idx + i].offset_mtx * frame_packet.skeleton_node_data[
-          skeleton_begin_local_idx + frame_packet.bone_data[bone_begin_local_idx + i].skeleton_node_idx].transform
-      };
-      render_manager_->UpdateBuffer(*bone_buf, static_cast<UINT>(i * sizeof(Matrix4)),
-        as_bytes(std::span{&bone_mtx, 1}));
-    }
-
     auto const& mesh_data{frame_packet.mesh_data[mesh_data_local_idx]};
 
     prepare_cmd.SetUnorderedAccess(PIPELINE_PARAM_INDEX(VertexSkinningDrawParams, vtx_buf_idx),
@@ -1426,8 +2684,9 @@ auto SceneRenderer::Render() -> void {
       *frame_packet.buffers[bone_weight_buf_local_idx]);
     prepare_cmd.SetUnorderedAccess(PIPELINE_PARAM_INDEX(VertexSkinningDrawParams, bone_idx_buf_idx),
       *frame_packet.buffers[bone_index_buf_local_idx]);
-    prepare_cmd.SetUnorderedAccess(PIPELINE_PARAM_INDEX(VertexSkinningDrawParams, bone_buf_idx),
-      *frame_packet.buffers[bone_matrix_buf_local_idx]);
+    prepare_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(VertexSkinningDrawParams, bone_buf_idx),
+      *bone_palette_buf.GetBuffer());
+    prepare_cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(VertexSkinningDrawParams, bone_offset), bone_palette_offset);
     prepare_cmd.SetUnorderedAccess(PIPELINE_PARAM_INDEX(VertexSkinningDrawParams, skinned_vtx_buf_idx),
       *frame_packet.buffers[mesh_data.pos_buf_local_idx]);
     prepare_cmd.SetUnorderedAccess(PIPELINE_PARAM_INDEX(VertexSkinningDrawParams, skinned_norm_buf_idx),
@@ -1440,35 +2699,95 @@ auto SceneRenderer::Render() -> void {
       1, 1);
   }
 
+  // Drop the records of instances that are no longer rendered
+  if (auto const frame_count{render_manager_->GetCurrentFrameCount()};
+    animated_instances_.size() > frame_packet.skinned_mesh_data.size()) {
+    std::erase_if(animated_instances_, [frame_count](auto const& record) {
+      return record.second.last_used_frame != frame_count;
+    });
+  }
+
+  PublishBonePalettes();
+
   prepare_cmd.End();
   device_->ExecuteCommandLists(std::span{&prepare_cmd, 1});
 
-  for (auto const& cam_data : frame_packet.cam_data) {
-    auto& target_rt{*frame_packet.render_targets[cam_data.rt_local_idx]};
-    auto const& target_rt_desc{target_rt.GetDesc()};
-
-    auto const target_rt_width{target_rt_desc.width};
-    auto const target_rt_height{target_rt_desc.height};
-
-    CD3DX12_VIEWPORT const cam_viewport{
-      cam_data.viewport.left * static_cast<FLOAT>(target_rt_width),
-      cam_data.viewport.top * static_cast<float>(target_rt_height),
-      std::max(
-        cam_data.viewport.right * static_cast<float>(target_rt_width) - cam_data.viewport.left * static_cast<FLOAT>(
-          target_rt_width), 1.0f),
-      std::max(
-        cam_data.viewport.bottom * static_cast<float>(target_rt_height) - cam_data.viewport.top * static_cast<float>(
-          target_rt_height), 1.0f),
-    };
+  // Determine all views of all cameras first so that they can be culled in parallel.
+  // The punctual shadow atlas is refilled for each camera, so each camera keeps a snapshot of its state.
 
-    CD3DX12_RECT const cam_scissor{
-      static_cast<LONG>(cam_data.viewport.left * static_cast<FLOAT>(target_rt_width)),
-      static_cast<LONG>(cam_data.viewport.top * static_cast<FLOAT>(target_rt_height)),
-      std::max(static_cast<LONG>(cam_data.viewport.right * static_cast<FLOAT>(target_rt_width)), 1l),
-      std::max(static_cast<LONG>(cam_data.viewport.bottom * static_cast<FLOAT>(target_rt_height)), 1l),
-    };
+  std::vector<CameraViewData> cam_views(frame_packet.cam_data.size());
+  std::vector<CullView> cull_views;
+
+  for (std::size_t i{0}; i < frame_packet.cam_data.size(); i++) {
+    PrepareCameraView(frame_packet, frame_packet.cam_data[i], cam_views[i], cull_views);
+  }
+
+  // Rasterize the occluders for every camera so that the camera views can be occlusion culled along with the rest
+
+  if (frame_packet.occlusion_culling_enabled && !frame_packet.occluder_data.empty()) {
+    tmp_occluders_.clear();
+    std::ranges::transform(frame_packet.occluder_data, std::back_inserter(tmp_occluders_),
+      [&frame_packet](OccluderData const& occluder) {
+        return SoftwareOcclusionCuller::Occluder{
+          occluder.local_to_world_mtx,
+          std::span{frame_packet.occluder_vertices}.subspan(occluder.first_vertex, occluder.vertex_count),
+          std::span{frame_packet.occluder_indices}.subspan(occluder.first_index, occluder.index_count)
+        };
+      });
+
+    while (occlusion_cullers_.size() < cam_views.size()) {
+      occlusion_cullers_.emplace_back(
+        std::make_unique<SoftwareOcclusionCuller>(occlusion_buffer_width_, occlusion_buffer_height_));
+    }
+
+    for (std::size_t i{0}; i < cam_views.size(); i++) {
+      occlusion_cullers_[i]->Render(cam_views[i].view_proj_mtx, tmp_occluders_, App::Instance().GetJobSystem());
+      cull_views[cam_views[i].visible_list_idx].occlusion_culler = occlusion_cullers_[i].get();
+    }
+  }
+
+  auto view_count{cull_views.size()};
+
+  for (auto const& cam_view : cam_views) {
+    view_count += cam_view.max_shadow_view_count;
+  }
+
+  ReserveCullingMemory(frame_packet, view_count);
+
+  std::vector<std::pmr::vector<unsigned>> visible_lists;
+  CullViews(frame_packet, cull_views, visible_lists);
+
+  // Casters anywhere in the scene can shadow the receivers, so the cascades are extruded to the scene bounds.
+  // The shadow views are fitted to the receivers, so they are added and culled after the camera views.
+  auto scene_bounds{
+    frame_packet.instance_data.empty()
+      ? AABB{Vector3{0}, Vector3{0}}
+      : frame_packet.instance_data.front().bounds_ws
+  };
+
+  for (auto const& instance : frame_packet.instance_data) {
+    scene_bounds = AABB::Union(scene_bounds, instance.bounds_ws);
+  }
+
+  for (std::size_t i{0}; i < frame_packet.cam_data.size(); i++) {
+    PrepareShadowViews(frame_packet, frame_packet.cam_data[i], visible_lists[cam_views[i].visible_list_idx],
+      scene_bounds, cam_views[i], cull_views);
+  }
+
+  CullViews(frame_packet, cull_views, visible_lists);
+  UploadInstances(frame_packet, visible_lists, tmp_visible_list_offsets_);
+
+  auto const& instance_buf{instance_buffers_[frame_idx]};
+  auto const& instance_idx_buf{instance_idx_buffers_[frame_idx]};
+
+  for (std::size_t cam_idx{0}; cam_idx < frame_packet.cam_data.size(); cam_idx++) {
+    auto const& cam_data{frame_packet.cam_data[cam_idx]};
+    auto const& cam_view{cam_views[cam_idx]};
 
-    auto const viewport_aspect{cam_viewport.Width / cam_viewport.Height};
+    auto& target_rt{*frame_packet.render_targets[cam_data.rt_local_idx]};
+
+    auto const& cam_viewport{cam_view.viewport};
+    auto const& cam_scissor{cam_view.scissor};
 
     auto const transient_rt_width{static_cast<UINT>(cam_viewport.Width)};
     auto const transient_rt_height{static_cast<UINT>(cam_viewport.Height)};
@@ -1486,44 +2805,34 @@ auto SceneRenderer::Render() -> void {
       static_cast<UINT>(frame_packet.msaa_mode), L"Camera HDR RenderTarget", false, frame_packet.background_color, 0.0f
     };
 
-    auto& per_frame_cb{per_frame_cbs_[frame_idx]};
-    SetPerFrameConstants(per_frame_cb, static_cast<int>(transient_rt_width), static_cast<int>(transient_rt_height),
-      frame_packet.ambient_light, frame_packet.shadow_params);
-
-    auto const cam_view_mtx{
-      Camera::CalculateViewMatrix(cam_data.position, cam_data.right, cam_data.up, cam_data.forward)
-    };
-    auto const cam_proj_mtx{
-      TransformProjectionMatrixForRendering(Camera::CalculateProjectionMatrix(cam_data.type, cam_data.fov_vert_deg,
-        cam_data.size_vert, viewport_aspect, cam_data.near_plane, cam_data.far_plane))
+    auto const per_frame_cbv{
+      AllocatePerFrameConstants(static_cast<int>(transient_rt_width), static_cast<int>(transient_rt_height),
+        frame_packet.ambient_light, frame_packet.shadow_params)
     };
-    auto const cam_view_proj_mtx{cam_view_mtx * cam_proj_mtx};
-    Frustum const cam_frust_ws{cam_view_proj_mtx};
 
-    std::pmr::vector<unsigned> visible_light_indices;
-    CullLights(cam_frust_ws, frame_packet.light_data, visible_light_indices);
+    auto const& visible_light_indices{cam_view.visible_light_indices};
+    auto const& visible_static_submesh_instance_indices{visible_lists[cam_view.visible_list_idx]};
+    auto const first_visible_instance_offset{tmp_visible_list_offsets_[cam_view.visible_list_idx]};
 
     // Performs rendering of the camera
     auto& cam_cmd{render_manager_->AcquireCommandList()};
     cam_cmd.Begin(nullptr);
     cam_cmd.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-    // Shadow pass
-    std::array<Matrix4, MAX_CASCADE_COUNT> shadow_view_proj_matrices;
-    auto const shadow_cascade_boundaries{CalculateCameraShadowCascadeBoundaries(cam_data, frame_packet.shadow_params)};
-    DrawDirectionalShadowMaps(frame_packet, visible_light_indices, cam_data, viewport_aspect,
-      frame_packet.shadow_params.cascade_count, shadow_cascade_boundaries, shadow_view_proj_matrices, cam_cmd);
-
-    UpdatePunctualShadowAtlas(*punctual_shadow_atlas_, frame_packet.light_data, visible_light_indices, cam_data,
-      cam_view_proj_mtx, frame_packet.shadow_params.distance);
-    DrawPunctualShadowMaps(*punctual_shadow_atlas_, frame_packet, cam_cmd);
-
-    std::pmr::vector<unsigned> visible_static_submesh_instance_indices;
-    CullStaticSubmeshInstances(cam_frust_ws, frame_packet.mesh_data, frame_packet.submesh_data,
-      frame_packet.instance_data, visible_static_submesh_instance_indices);
+    auto& dir_shadow_map_arr{
+      cam_view.has_dir_shadow ? GetDirectionalShadowMapArray(cam_idx) : *dir_shadow_map_arrs_.front()
+    };
 
-    auto& cam_per_view_cb{AcquirePerViewConstantBuffer()};
-    SetPerViewConstants(cam_per_view_cb, cam_view_mtx, cam_proj_mtx, shadow_cascade_boundaries, cam_data.position);
+    // Shadow pass
+    DrawDirectionalShadowMaps(frame_packet, cam_view, visible_lists, tmp_visible_list_offsets_, dir_shadow_map_arr,
+      cam_cmd);
+    DrawPunctualShadowMaps(*punctual_shadow_atlas_, frame_packet, cam_view, visible_lists, tmp_visible_list_offsets_,
+      cam_cmd);
+
+    auto const cam_per_view_cbv{
+      AllocatePerViewConstants(cam_view.view_mtx, cam_view.proj_mtx, cam_view.shadow_cascade_boundaries,
+        cam_data.position)
+    };
 
     auto const hdr_rt{render_manager_->AcquireTemporaryRenderTarget(hdr_rt_desc)};
 
@@ -1557,35 +2866,34 @@ auto SceneRenderer::Render() -> void {
       cam_cmd.SetRenderTargets(std::span{actual_normal_rt->GetColorTex().get(), 1}, hdr_rt->GetDepthStencilTex().get());
       cam_cmd.ClearRenderTarget(*actual_normal_rt->GetColorTex(), std::array{0.0f, 0.0f, 0.0f, 1.0f}, {});
 
-      for (auto const instance_idx : visible_static_submesh_instance_indices) {
-        auto const& instance{frame_packet.instance_data[instance_idx]};
-        auto const& submesh{frame_packet.submesh_data[instance.submesh_local_idx]};
-        auto const& mesh{frame_packet.mesh_data[submesh.mesh_local_idx]};
-        auto const& mtl_buf{frame_packet.buffers[submesh.mtl_buf_local_idx]};
-
-        auto& per_draw_cb{AcquirePerDrawConstantBuffer()};
-        SetPerDrawConstants(per_draw_cb, instance.local_to_world_mtx);
+      cam_cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(DepthNormalDrawParams, samp_idx), samp_af16_wrap_.Get());
+      cam_cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(DepthNormalDrawParams, rt_idx), 0);
+      cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(DepthNormalDrawParams, instance_buf_idx),
+        *instance_buf.GetBuffer());
+      cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(DepthNormalDrawParams, instance_idx_buf_idx),
+        *instance_idx_buf.GetBuffer());
+      cam_cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(DepthNormalDrawParams, per_view_cb_idx), cam_per_view_cbv);
+      cam_cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(DepthNormalDrawParams, per_frame_cb_idx), per_frame_cbv);
+
+      ForEachDrawBatch(frame_packet, visible_static_submesh_instance_indices,
+        [&frame_packet, &cam_cmd, first_visible_instance_offset](SubmeshData const& submesh, UINT const first_instance,
+                                                                 UINT const instance_count) {
+          auto const& mesh{frame_packet.mesh_data[submesh.mesh_local_idx]};
 
-        cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(DepthNormalDrawParams, pos_buf_idx),
-          *frame_packet.buffers[mesh.pos_buf_local_idx]);
-        cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(DepthNormalDrawParams, norm_buf_idx),
-          *frame_packet.buffers[mesh.norm_buf_local_idx]);
-        cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(DepthNormalDrawParams, tan_buf_idx),
-          *frame_packet.buffers[mesh.tan_buf_local_idx]);
-        cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(DepthNormalDrawParams, uv_buf_idx),
-          *frame_packet.buffers[mesh.uv_buf_local_idx]);
-        cam_cmd.SetConstantBuffer(PIPELINE_PARAM_INDEX(DepthNormalDrawParams, mtl_idx), *mtl_buf);
-        cam_cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(DepthNormalDrawParams, samp_idx), samp_af16_wrap_.Get());
-        cam_cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(DepthNormalDrawParams, rt_idx), 0);
-        cam_cmd.SetConstantBuffer(PIPELINE_PARAM_INDEX(DepthNormalDrawParams, per_draw_cb_idx),
-          *per_draw_cb.GetBuffer());
-        cam_cmd.SetConstantBuffer(PIPELINE_PARAM_INDEX(DepthNormalDrawParams, per_view_cb_idx),
-          *cam_per_view_cb.GetBuffer());
-        cam_cmd.SetConstantBuffer(PIPELINE_PARAM_INDEX(DepthNormalDrawParams, per_frame_cb_idx),
-          *per_frame_cb.GetBuffer());
-        cam_cmd.SetIndexBuffer(*frame_packet.buffers[mesh.idx_buf_local_idx], mesh.idx_format);
-        cam_cmd.DrawIndexedInstanced(submesh.index_count, 1, submesh.first_index, submesh.base_vertex, 0);
-      }
+          cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(DepthNormalDrawParams, pos_buf_idx),
+            *frame_packet.buffers[mesh.pos_buf_local_idx]);
+          cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(DepthNormalDrawParams, norm_buf_idx),
+            *frame_packet.buffers[mesh.norm_buf_local_idx]);
+          cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(DepthNormalDrawParams, tan_buf_idx),
+            *frame_packet.buffers[mesh.tan_buf_local_idx]);
+          cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(DepthNormalDrawParams, uv_buf_idx),
+            *frame_packet.buffers[mesh.uv_buf_local_idx]);
+          cam_cmd.SetConstantBuffer(PIPELINE_PARAM_INDEX(DepthNormalDrawParams, mtl_idx),
+            *frame_packet.buffers[submesh.mtl_buf_local_idx]);
+          cam_cmd.SetIndexBuffer(*frame_packet.buffers[mesh.idx_buf_local_idx], mesh.idx_format);
+          cam_cmd.DrawIndexedInstanced(submesh.index_count, instance_count, submesh.first_index, submesh.base_vertex,
+            first_visible_instance_offset + first_instance);
+        });
 
       // If we have MSAA enabled, actualNormalRt is an MSAA texture that we have to resolve into normalRt
       if (frame_packet.msaa_mode != MultisamplingMode::kOff) {
@@ -1653,10 +2961,8 @@ auto SceneRenderer::Render() -> void {
         *std::bit_cast<UINT*>(&frame_packet.ssao_params.power));
       cam_cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(SsaoDrawParams, sample_count),
         frame_packet.ssao_params.sample_count);
-      cam_cmd.SetConstantBuffer(PIPELINE_PARAM_INDEX(SsaoDrawParams, per_view_cb_idx),
-        *cam_per_view_cb.GetBuffer());
-      cam_cmd.SetConstantBuffer(PIPELINE_PARAM_INDEX(SsaoDrawParams, per_frame_cb_idx),
-        *per_frame_cb.GetBuffer());
+      cam_cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(SsaoDrawParams, per_view_cb_idx), cam_per_view_cbv);
+      cam_cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(SsaoDrawParams, per_frame_cb_idx), per_frame_cbv);
       cam_cmd.SetRenderTargets(std::span{ssao_rt->GetColorTex().get(), 1}, nullptr);
       cam_cmd.ClearRenderTarget(*ssao_rt->GetColorTex(), std::array{0.0f, 0.0f, 0.0f, 1.0f}, {});
       cam_cmd.DrawInstanced(3, 1, 0, 0);
@@ -1717,14 +3023,40 @@ auto SceneRenderer::Render() -> void {
 
         for (auto cascade_idx{0}; cascade_idx < frame_packet.shadow_params.cascade_count; cascade_idx++) {
           light_buffer_data[i].sampleShadowMap[cascade_idx] = TRUE;
-          light_buffer_data[i].shadowViewProjMatrices[cascade_idx] = shadow_view_proj_matrices[cascade_idx];
+          light_buffer_data[i].shadowViewProjMatrices[cascade_idx] = cam_view.shadow_view_proj_matrices[cascade_idx];
         }
 
         break;
       }
     }
 
-    punctual_shadow_atlas_->SetLookUpInfo(light_buffer_data);
+    punctual_shadow_atlas_->SetLookUpInfo(cam_view.punctual_shadow_maps, light_buffer_data);
+
+    // Bin the visible lights into the clusters of the camera, the lists index into the light buffer
+
+    tmp_cluster_lights_.clear();
+    std::ranges::transform(visible_light_indices, std::back_inserter(tmp_cluster_lights_),
+      [&frame_packet](unsigned const light_idx) {
+        auto const& light{frame_packet.light_data[light_idx]};
+        return LightClusterGrid::Light{
+          static_cast<LightClusterGrid::LightType>(light.type), light.position, light.direction, light.range,
+          ToRadians(light.outer_angle / 2.0f)
+        };
+      });
+
+    light_cluster_grid_.Build(cam_view.view_mtx, cam_view.proj_mtx, cam_data.near_plane, cam_data.far_plane,
+      tmp_cluster_lights_, App::Instance().GetJobSystem());
+
+    auto& light_cluster_buffer{light_cluster_buffers_[frame_idx]};
+    light_cluster_buffer.Resize(static_cast<UINT>(light_cluster_grid_.GetClusters().size()));
+    std::ranges::copy(light_cluster_grid_.GetClusters(), light_cluster_buffer.GetData().begin());
+
+    auto& light_index_buffer{light_index_buffers_[frame_idx]};
+    light_index_buffer.Resize(static_cast<UINT>(light_cluster_grid_.GetLightIndices().size()));
+    std::ranges::copy(light_cluster_grid_.GetLightIndices(), light_index_buffer.GetData().begin());
+
+    auto const light_cluster_z_scale{light_cluster_grid_.GetDepthSliceScale()};
+    auto const light_cluster_z_bias{light_cluster_grid_.GetDepthSliceBias()};
 
     cam_cmd.SetPipelineState(frame_packet.depth_normal_pre_pass_enabled
                                ? *frame_packet.object_pso_depth_read
@@ -1735,49 +3067,52 @@ auto SceneRenderer::Render() -> void {
     cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(ObjectDrawParams, ssao_tex_idx), *ssao_tex);
     cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(ObjectDrawParams, light_buf_idx),
       *light_buffer.GetBuffer());
-    cam_cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(ObjectDrawParams, light_count), static_cast<UINT>(light_count));
+    cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(ObjectDrawParams, light_cluster_buf_idx),
+      *light_cluster_buffer.GetBuffer());
+    cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(ObjectDrawParams, light_idx_buf_idx),
+      *light_index_buffer.GetBuffer());
+    cam_cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(ObjectDrawParams, light_cluster_z_scale),
+      *std::bit_cast<UINT const*>(&light_cluster_z_scale));
+    cam_cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(ObjectDrawParams, light_cluster_z_bias),
+      *std::bit_cast<UINT const*>(&light_cluster_z_bias));
     cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(ObjectDrawParams, dir_shadow_arr_idx),
-      *dir_shadow_map_arr_->GetTex());
+      *dir_shadow_map_arr.GetTex());
     cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(ObjectDrawParams, punc_shadow_atlas_idx),
       *punctual_shadow_atlas_->GetTex());
-    cam_cmd.SetConstantBuffer(PIPELINE_PARAM_INDEX(ObjectDrawParams, per_view_cb_idx),
-      *cam_per_view_cb.GetBuffer());
-    cam_cmd.SetConstantBuffer(PIPELINE_PARAM_INDEX(ObjectDrawParams, per_frame_cb_idx),
-      *per_frame_cb.GetBuffer());
+    cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(ObjectDrawParams, instance_buf_idx), *instance_buf.GetBuffer());
+    cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(ObjectDrawParams, instance_idx_buf_idx),
+      *instance_idx_buf.GetBuffer());
+    cam_cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(ObjectDrawParams, per_view_cb_idx), cam_per_view_cbv);
+    cam_cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(ObjectDrawParams, per_frame_cb_idx), per_frame_cbv);
     cam_cmd.SetRenderTargets(std::span{hdr_rt->GetColorTex().get(), 1}, hdr_rt->GetDepthStencilTex().get());
     cam_cmd.ClearRenderTarget(*hdr_rt->GetColorTex(), frame_packet.background_color, {});
 
-    for (auto const instance_idx : visible_static_submesh_instance_indices) {
-      auto const& instance{frame_packet.instance_data[instance_idx]};
-      auto const& submesh{frame_packet.submesh_data[instance.submesh_local_idx]};
-      auto const& mesh{frame_packet.mesh_data[submesh.mesh_local_idx]};
-      auto const& mtl_buf{frame_packet.buffers[submesh.mtl_buf_local_idx]};
-
-      auto& per_draw_cb{AcquirePerDrawConstantBuffer()};
-      SetPerDrawConstants(per_draw_cb, instance.local_to_world_mtx);
+    ForEachDrawBatch(frame_packet, visible_static_submesh_instance_indices,
+      [&frame_packet, &cam_cmd, first_visible_instance_offset](SubmeshData const& submesh, UINT const first_instance,
+                                                               UINT const instance_count) {
+        auto const& mesh{frame_packet.mesh_data[submesh.mesh_local_idx]};
 
-      cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(ObjectDrawParams, pos_buf_idx),
-        *frame_packet.buffers[mesh.pos_buf_local_idx]);
-      cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(ObjectDrawParams, norm_buf_idx),
-        *frame_packet.buffers[mesh.norm_buf_local_idx]);
-      cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(ObjectDrawParams, tan_buf_idx),
-        *frame_packet.buffers[mesh.tan_buf_local_idx]);
-      cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(ObjectDrawParams, uv_buf_idx),
-        *frame_packet.buffers[mesh.uv_buf_local_idx]);
-      cam_cmd.SetConstantBuffer(PIPELINE_PARAM_INDEX(ObjectDrawParams, mtl_idx), *mtl_buf);
-      cam_cmd.SetConstantBuffer(PIPELINE_PARAM_INDEX(ObjectDrawParams, per_draw_cb_idx),
-        *per_draw_cb.GetBuffer());
-      cam_cmd.SetIndexBuffer(*frame_packet.buffers[mesh.idx_buf_local_idx], mesh.idx_format);
-      cam_cmd.DrawIndexedInstanced(submesh.index_count, 1, submesh.first_index, submesh.base_vertex, 0);
-    }
+        cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(ObjectDrawParams, pos_buf_idx),
+          *frame_packet.buffers[mesh.pos_buf_local_idx]);
+        cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(ObjectDrawParams, norm_buf_idx),
+          *frame_packet.buffers[mesh.norm_buf_local_idx]);
+        cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(ObjectDrawParams, tan_buf_idx),
+          *frame_packet.buffers[mesh.tan_buf_local_idx]);
+        cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(ObjectDrawParams, uv_buf_idx),
+          *frame_packet.buffers[mesh.uv_buf_local_idx]);
+        cam_cmd.SetConstantBuffer(PIPELINE_PARAM_INDEX(ObjectDrawParams, mtl_idx),
+          *frame_packet.buffers[submesh.mtl_buf_local_idx]);
+        cam_cmd.SetIndexBuffer(*frame_packet.buffers[mesh.idx_buf_local_idx], mesh.idx_format);
+        cam_cmd.DrawIndexedInstanced(submesh.index_count, instance_count, submesh.first_index, submesh.base_vertex,
+          first_visible_instance_offset + first_instance);
+      });
 
     if (frame_packet.skybox_cubemap) {
       auto const cube_mesh{App::Instance().GetResourceManager().GetCubeMesh()};
       cam_cmd.SetPipelineState(*frame_packet.skybox_pso);
       cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(SkyboxDrawParams, pos_buf_idx),
         *cube_mesh->GetPositionBuffer());
-      cam_cmd.SetConstantBuffer(PIPELINE_PARAM_INDEX(SkyboxDrawParams, per_view_cb_idx),
-        *cam_per_view_cb.GetBuffer());
+      cam_cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(SkyboxDrawParams, per_view_cb_idx), cam_per_view_cbv);
       cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(SkyboxDrawParams, cubemap_idx),
         *frame_packet.skybox_cubemap);
       cam_cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(SkyboxDrawParams, samp_idx), samp_af16_clamp_.Get());
@@ -1818,8 +3153,7 @@ auto SceneRenderer::Render() -> void {
         *line_gizmo_vertex_data_buffer_.GetBuffer());
       cam_cmd.SetShaderResource(PIPELINE_PARAM_INDEX(GizmoDrawParams, color_buf_idx),
         *gizmo_color_buffer_.GetBuffer());
-      cam_cmd.SetConstantBuffer(PIPELINE_PARAM_INDEX(GizmoDrawParams, per_view_cb_idx),
-        *cam_per_view_cb.GetBuffer());
+      cam_cmd.SetPipelineParameter(PIPELINE_PARAM_INDEX(GizmoDrawParams, per_view_cb_idx), cam_per_view_cbv);
       cam_cmd.SetRenderTargets(std::span{target_rt.GetColorTex().get(), 1}, nullptr);
       cam_cmd.SetScissorRects(std::span{static_cast<D3D12_RECT const*>(&cam_scissor), 1});
       cam_cmd.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_LINELIST);
@@ -1829,6 +3163,13 @@ auto SceneRenderer::Render() -> void {
     cam_cmd.End();
     device_->ExecuteCommandLists(std::span{&cam_cmd, 1});
   }
+
+  ReleaseRenderedFramePacket(frame_packet);
+}
+
+
+auto SceneRenderer::DiscardFrame() -> void {
+  ReleaseRenderedFramePacket(GetFramePacketToRender());
 }
 
 
@@ -1936,6 +3277,16 @@ auto SceneRenderer::SetNormalizedShadowCascadeSplit(int const idx, float const s
 }
 
 
+auto SceneRenderer::IsUsingAutomaticShadowCascadeSplits() const noexcept -> bool {
+  return shadow_params_.automatic_cascade_splits;
+}
+
+
+auto SceneRenderer::SetUseAutomaticShadowCascadeSplits(bool const automatic) noexcept -> void {
+  shadow_params_.automatic_cascade_splits = automatic;
+}
+
+
 auto SceneRenderer::IsVisualizingShadowCascades() const noexcept -> bool {
   return shadow_params_.visualize_cascades;
 }
@@ -1994,13 +3345,65 @@ auto SceneRenderer::SetGamma(f32 const gamma) noexcept -> void {
 }
 
 
+auto SceneRenderer::IsOcclusionCullingEnabled() const noexcept -> bool {
+  return occlusion_culling_enabled_;
+}
+
+
+auto SceneRenderer::SetOcclusionCullingEnabled(bool const enabled) noexcept -> void {
+  if (enabled != occlusion_culling_enabled_) {
+    occlusion_culling_enabled_ = enabled;
+
+    // Occluder geometry is part of the static mesh mirror
+    std::scoped_lock const lock{change_mutex_};
+    static_meshes_changed_ = true;
+  }
+}
+
+
+auto SceneRenderer::GetAnimationUpdateBudget() const noexcept -> int {
+  return animation_update_budget_;
+}
+
+
+auto SceneRenderer::SetAnimationUpdateBudget(int const budget) noexcept -> void {
+  animation_update_budget_ = std::max(budget, 0);
+}
+
+
+auto SceneRenderer::GetBonePalette(
+  SkinnedMeshComponent const& skinned_mesh_component) const -> std::span<Matrix4 const> {
+  if (auto const it{extracted_bone_palettes_.find(&skinned_mesh_component)}; it != std::end(extracted_bone_palettes_)) {
+    return it->second;
+  }
+
+  return {};
+}
+
+
 auto SceneRenderer::Register(StaticMeshComponent const& static_mesh_component) noexcept -> void {
   static_mesh_components_.emplace_back(std::addressof(static_mesh_component));
+
+  std::scoped_lock const lock{change_mutex_};
+  static_meshes_changed_ = true;
 }
 
 
 auto SceneRenderer::Unregister(StaticMeshComponent const& static_mesh_component) noexcept -> void {
   std::erase(static_mesh_components_, std::addressof(static_mesh_component));
+
+  {
+    std::scoped_lock const lock{change_mutex_};
+    static_meshes_changed_ = true;
+  }
+
+  // Don't let queries return the component until the hierarchy is rebuilt during the next extraction
+  if (std::ranges::find(static_submesh_instance_keys_, std::addressof(static_mesh_component),
+        &StaticSubmeshInstanceKey::component) != std::ranges::end(static_submesh_instance_keys_)) {
+    static_submesh_instance_bvh_.Clear();
+    static_submesh_instance_keys_.clear();
+    static_submesh_instance_bvh_version_ += 1;
+  }
 }
 
 
@@ -2016,11 +3419,17 @@ auto SceneRenderer::Unregister(SkinnedMeshComponent const& skinned_mesh_componen
 
 auto SceneRenderer::Register(LightComponent const& light_component) noexcept -> void {
   lights_.emplace_back(std::addressof(light_component));
+
+  std::scoped_lock const lock{change_mutex_};
+  lights_changed_ = true;
 }
 
 
 auto SceneRenderer::Unregister(LightComponent const& light_component) noexcept -> void {
   std::erase(lights_, std::addressof(light_component));
+
+  std::scoped_lock const lock{change_mutex_};
+  lights_changed_ = true;
 }
 
 
@@ -2032,4 +3441,87 @@ auto SceneRenderer::Register(Camera const& cam) noexcept -> void {
 auto SceneRenderer::Unregister(Camera const& cam) noexcept -> void {
   std::erase(cameras_, &cam);
 }
+
+
+auto SceneRenderer::OnTransformChanged(TransformComponent& transform) noexcept -> void {
+  std::scoped_lock const lock{change_mutex_};
+  changed_transforms_.emplace_back(std::addressof(transform));
+}
+
+
+auto SceneRenderer::OnTransformDestroyed(TransformComponent& transform) noexcept -> void {
+  // The queue would be left with a dangling pointer that extraction dereferences
+  std::scoped_lock const lock{change_mutex_};
+  std::erase(changed_transforms_, std::addressof(transform));
+}
+
+
+auto SceneRenderer::NotifyChanged(MeshComponentBase const& mesh_component) noexcept -> void {
+  std::scoped_lock const lock{change_mutex_};
+  changed_mesh_components_.emplace_back(std::addressof(mesh_component));
+}
+
+
+auto SceneRenderer::NotifyChanged(LightComponent const& light_component) noexcept -> void {
+  std::scoped_lock const lock{change_mutex_};
+  changed_lights_.emplace_back(std::addressof(light_component));
+}
+
+
+auto SceneRenderer::NotifyChanged(Material const& mtl) noexcept -> void {
+  // The textures of the materials are referenced by the static mesh mirror
+  std::scoped_lock const lock{change_mutex_};
+  changed_materials_.emplace_back(std::addressof(mtl));
+}
+
+
+auto SceneRenderer::NotifyChanged(Mesh const& mesh) noexcept -> void {
+  // The buffers and the occluder geometry of the meshes are referenced by the static mesh mirror
+  std::scoped_lock const lock{change_mutex_};
+  changed_meshes_.emplace_back(std::addressof(mesh));
+}
+
+
+auto SceneRenderer::NotifyDestroyed(Material const& mtl) noexcept -> void {
+  std::scoped_lock const lock{change_mutex_};
+  std::erase(changed_materials_, std::addressof(mtl));
+  destroyed_materials_.emplace_back(std::addressof(mtl));
+}
+
+
+auto SceneRenderer::NotifyDestroyed(Mesh const& mesh) noexcept -> void {
+  std::scoped_lock const lock{change_mutex_};
+  std::erase(changed_meshes_, std::addressof(mesh));
+  destroyed_meshes_.emplace_back(std::addressof(mesh));
+}
+
+
+auto SceneRenderer::GetStaticSubmeshInstanceBvh() const noexcept -> Bvh const& {
+  return static_submesh_instance_bvh_;
+}
+
+
+auto SceneRenderer::GetStaticSubmeshInstanceKeys() const noexcept -> std::span<StaticSubmeshInstanceKey const> {
+  return static_submesh_instance_keys_;
+}
+
+
+auto SceneRenderer::SetStaticSubmeshInstanceBvh(Bvh bvh, std::vector<StaticSubmeshInstanceKey> keys) -> void {
+  if (bvh.GetPrimitiveCount() != keys.size()) {
+    return;
+  }
+
+  static_submesh_instance_bvh_ = std::move(bvh);
+  static_submesh_instance_keys_ = std::move(keys);
+  static_submesh_instance_bvh_version_ += 1;
+}
+
+
+auto SceneRenderer::Raycast(Ray const& ray_ws) const -> MeshComponentBase const* {
+  if (auto const hit{static_submesh_instance_bvh_.RaycastClosest(ray_ws)}) {
+    return static_submesh_instance_keys_[hit->prim_idx].component;
+  }
+
+  return nullptr;
+}
 }
@@ -1,25 +1,41 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 #include <cstdint>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <unordered_map>
 #include <vector>
 
+#include "animation_lod_scheduler.hpp"
 #include "Camera.hpp"
-#include "constant_buffer.hpp"
+#include "constant_buffer_ring.hpp"
 #include "directional_shadow_map_array.hpp"
+#include "draw_sorter.hpp"
 #include "graphics.hpp"
+#include "light_cluster_grid.hpp"
+#include "pointer_index_table.hpp"
 #include "punctual_shadow_atlas.hpp"
 #include "render_manager.hpp"
 #include "render_target.hpp"
+#include "software_occlusion_culler.hpp"
 #include "structured_buffer.hpp"
+#include "../animation_sampler.hpp"
+#include "../bvh.hpp"
 #include "../Color.hpp"
 #include "../Math.hpp"
+#include "../MemoryAllocation.hpp"
+#include "../pose_evaluator.hpp"
 #include "../Util.hpp"
 #include "../Window.hpp"
 #include "../scene_objects/LightComponents.hpp"
 #include "../scene_objects/SkinnedMeshComponent.hpp"
 #include "../scene_objects/StaticMeshComponent.hpp"
+#include "../scene_objects/TransformComponent.hpp"
 #include "shaders/shader_interop.h"
 #include "shaders/shadow_filtering_modes.h"
 
@@ -54,6 +70,7 @@ struct SsaoParams {
 
 struct ShadowParams {
   std::array<float, MAX_CASCADE_COUNT - 1> normalized_cascade_splits;
+  bool automatic_cascade_splits; // Ignores the normalized splits and places them by the depth range of the receivers
   int cascade_count;
   bool visualize_cascades;
   float distance;
@@ -61,19 +78,34 @@ struct ShadowParams {
 };
 
 
-class SceneRenderer {
+class SceneRenderer : public TransformChangeObserver {
 public:
-  LEOPPHAPI SceneRenderer(Window& window, graphics::GraphicsDevice& device, RenderManager& render_manager);
+  // Identifies a static submesh instance independently of its position in the frame packets
+  struct StaticSubmeshInstanceKey {
+    MeshComponentBase const* component;
+    int submesh_idx;
+
+    [[nodiscard]] auto operator==(StaticSubmeshInstanceKey const& other) const -> bool = default;
+  };
+
+
+  // Headless renderers have no window, they only discard frames
+  LEOPPHAPI SceneRenderer(ObserverPtr<Window> window, graphics::GraphicsDevice& device,
+                          RenderManager& render_manager);
   SceneRenderer(SceneRenderer const&) = delete;
   SceneRenderer(SceneRenderer&&) = delete;
 
-  LEOPPHAPI ~SceneRenderer();
+  LEOPPHAPI ~SceneRenderer() override;
 
   auto operator=(SceneRenderer const&) -> void = delete;
   auto operator=(SceneRenderer&&) -> void = delete;
 
+  // Extraction and rendering run through a ring of frame packets, so the next frame can be extracted
+  // while the previous one is still being rendered. Both must be called once per frame, in the same order.
   LEOPPHAPI auto ExtractCurrentState() -> void;
   LEOPPHAPI auto Render() -> void;
+  // Consumes the next frame packet without recording any GPU work, used to run the pipeline headless
+  LEOPPHAPI auto DiscardFrame() -> void;
 
   LEOPPHAPI auto DrawLineAtNextRender(Vector3 const& from, Vector3 const& to, Color const& color) -> void;
 
@@ -103,6 +135,9 @@ public:
   [[nodiscard]] LEOPPHAPI auto GetNormalizedShadowCascadeSplits() const noexcept -> std::span<float const>;
   LEOPPHAPI auto SetNormalizedShadowCascadeSplit(int idx, float split) noexcept -> void;
 
+  [[nodiscard]] LEOPPHAPI auto IsUsingAutomaticShadowCascadeSplits() const noexcept -> bool;
+  LEOPPHAPI auto SetUseAutomaticShadowCascadeSplits(bool automatic) noexcept -> void;
+
   [[nodiscard]] LEOPPHAPI auto IsVisualizingShadowCascades() const noexcept -> bool;
   LEOPPHAPI auto VisualizeShadowCascades(bool visualize) noexcept -> void;
 
@@ -118,6 +153,22 @@ public:
   [[nodiscard]] LEOPPHAPI auto GetGamma() const noexcept -> float;
   LEOPPHAPI auto SetGamma(float gamma) noexcept -> void;
 
+  // Camera views test their visible instances against the depth of the occluder mesh components
+  [[nodiscard]] LEOPPHAPI auto IsOcclusionCullingEnabled() const noexcept -> bool;
+  LEOPPHAPI auto SetOcclusionCullingEnabled(bool enabled) noexcept -> void;
+
+  // Maximum number of skinned instances whose pose is evaluated in a frame, 0 for no limit.
+  // Instances over the budget keep interpolating their last poses and are updated in later frames.
+  [[nodiscard]] LEOPPHAPI auto GetAnimationUpdateBudget() const noexcept -> int;
+  LEOPPHAPI auto SetAnimationUpdateBudget(int budget) noexcept -> void;
+
+  // Bone palette of the last pose update of the component, empty if it has not been posed yet.
+  // Pass it to a VertexSkinner to access the animated geometry on the CPU.
+  // The palettes are handed over from rendering at extraction, so call it on the thread that calls
+  // ExtractCurrentState. The span is valid until the next ExtractCurrentState call.
+  [[nodiscard]] LEOPPHAPI auto GetBonePalette(
+    SkinnedMeshComponent const& skinned_mesh_component) const -> std::span<Matrix4 const>;
+
   LEOPPHAPI auto Register(StaticMeshComponent const& static_mesh_component) noexcept -> void;
   LEOPPHAPI auto Unregister(StaticMeshComponent const& static_mesh_component) noexcept -> void;
 
@@ -130,7 +181,33 @@ public:
   LEOPPHAPI auto Register(Camera const& cam) noexcept -> void;
   LEOPPHAPI auto Unregister(Camera const& cam) noexcept -> void;
 
+  // The renderer keeps a copy of the scene state across frames and only updates what it was notified about.
+  // Notifications are collected until the next extraction and may come from any thread.
+  // Transforms notify the renderer through TransformChangeObserver.
+  LEOPPHAPI auto NotifyChanged(MeshComponentBase const& mesh_component) noexcept -> void;
+  LEOPPHAPI auto NotifyChanged(LightComponent const& light_component) noexcept -> void;
+  LEOPPHAPI auto NotifyChanged(Material const& mtl) noexcept -> void;
+  LEOPPHAPI auto NotifyChanged(Mesh const& mesh) noexcept -> void;
+  // Resources report their destruction so that the renderer can forget them
+  LEOPPHAPI auto NotifyDestroyed(Material const& mtl) noexcept -> void;
+  LEOPPHAPI auto NotifyDestroyed(Mesh const& mesh) noexcept -> void;
+
+  // The hierarchy over the static submesh instances as of the last extraction.
+  // The keys identify the instance each primitive of the hierarchy belongs to.
+  [[nodiscard]] LEOPPHAPI auto GetStaticSubmeshInstanceBvh() const noexcept -> Bvh const&;
+  [[nodiscard]] LEOPPHAPI auto GetStaticSubmeshInstanceKeys() const noexcept -> std::span<StaticSubmeshInstanceKey
+    const>;
+  // Used to skip building the hierarchy after loading. If the keys don't match the instances during the next
+  // extraction, the hierarchy gets rebuilt anyway.
+  LEOPPHAPI auto SetStaticSubmeshInstanceBvh(Bvh bvh, std::vector<StaticSubmeshInstanceKey> keys) -> void;
+
+  // Returns the static mesh component whose submesh bounds the ray hits first
+  [[nodiscard]] LEOPPHAPI auto Raycast(Ray const& ray_ws) const -> MeshComponentBase const*;
+
 private:
+  auto OnTransformChanged(TransformComponent& transform) noexcept -> void override;
+  auto OnTransformDestroyed(TransformComponent& transform) noexcept -> void override;
+
   struct LightData {
     Vector3 color;
     float intensity;
@@ -150,6 +227,8 @@ private:
     float shadow_extension;
 
     Matrix4 local_to_world_mtx_no_scale;
+
+    LightComponent const* component; // Identifies the light across frames
   };
 
 
@@ -162,67 +241,166 @@ private:
     unsigned vtx_count;
     AABB bounds;
     DXGI_FORMAT idx_format;
+    std::uint32_t change_version; // Distinguishes updates of the mesh that keep its buffers
   };
 
 
   struct SubmeshData {
     unsigned mesh_local_idx;
+    unsigned idx_in_mesh;
     INT base_vertex;
     UINT first_index;
     UINT index_count;
     UINT mtl_buf_local_idx;
     AABB bounds;
+    std::uint32_t mtl_change_version; // Distinguishes updates of the material that keep its buffer
   };
 
 
   struct InstanceData {
     unsigned submesh_local_idx;
     Matrix4 local_to_world_mtx;
+    AABB bounds_ws; // World space bounds of the submesh instance, only recalculated when its transform changes
+    bool occluder;  // Occluders are never tested against the occlusion buffer they are rasterized into
+    bool casts_shadow;
   };
 
 
-  struct CameraData {
-    Vector3 position;
-    Vector3 right;
-    Vector3 up;
-    Vector3 forward;
+  // References the occluder geometry copied into the frame packet
+  struct OccluderData {
+    Matrix4 local_to_world_mtx;
+    unsigned first_vertex;
+    unsigned vertex_count;
+    unsigned first_index;
+    unsigned index_count;
+  };
 
-    float near_plane;
-    float far_plane;
 
-    Camera::Type type;
-    float fov_vert_deg;
-    float size_vert;
+  // The mesh, the instances and the occluder a static mesh component contributed to the static mesh mirror
+  struct StaticMeshMirrorEntry {
+    MeshComponentBase const* component;
+    unsigned first_mesh;
+    unsigned mesh_count; // Zero if the component has no mesh
+    unsigned first_instance;
+    unsigned instance_count;
+    int occluder_idx; // Negative if the component is not an occluder
+  };
 
-    NormalizedViewport viewport;
 
-    unsigned rt_local_idx;
+  // Render side copy of the static mesh components that persists across extractions.
+  // Transform changes and changes of the components, their meshes and materials are patched into the entries
+  // referencing them. Registration changes and patches that would change the size of an entry rebuild it.
+  // Frame packets start with its contents and only copy them again when their copy is outdated.
+  struct StaticMeshMirror {
+    std::vector<graphics::SharedDeviceChildHandle<graphics::Buffer>> buffers;
+    std::vector<graphics::SharedDeviceChildHandle<graphics::Texture>> textures;
+    std::vector<MeshData> mesh_data;
+    std::vector<SubmeshData> submesh_data;
+    std::vector<InstanceData> instance_data;
+    std::vector<OccluderData> occluder_data;
+    std::vector<Vector3> occluder_vertices;
+    std::vector<std::uint32_t> occluder_indices;
+    std::vector<StaticSubmeshInstanceKey> instance_keys;
+
+    PointerIndexTable<graphics::Buffer> buffer_indices;
+    PointerIndexTable<graphics::Texture> texture_indices;
+
+    std::vector<StaticMeshMirrorEntry> entries;
+    // Reverse indices into the entries so that changes find the entries they affect directly.
+    // Patches may leave pairs behind that no longer apply, those only cause redundant patches until the next rebuild.
+    std::unordered_map<MeshComponentBase const*, unsigned> component_entry_indices;
+    std::unordered_multimap<TransformComponent const*, unsigned> transform_entry_indices;
+    std::unordered_multimap<Mesh const*, unsigned> mesh_entry_indices;
+    std::unordered_multimap<Material const*, unsigned> material_entry_indices;
+
+    std::uint64_t structure_version{0};
+    std::uint64_t transform_version{0};
   };
 
 
-  struct NodeAnimationData {
-    unsigned pos_key_begin_local_idx;
-    unsigned pos_key_count;
+  // Number of outputs of a mesh extraction job, or the positions of its first outputs
+  struct MeshExtractionCounts {
+    unsigned mesh;
+    unsigned submesh; // Every extracted submesh has exactly one instance
+    unsigned occluder;
+    unsigned occluder_vertex;
+    unsigned occluder_index;
+    unsigned skinned_mesh;
+    unsigned bone; // Matrices in the bone palette of the frame
+    unsigned animation_layer;
+  };
+
 
-    unsigned rot_key_begin_local_idx;
-    unsigned rot_key_count;
+  // Mesh components are extracted by jobs over consecutive component ranges.
+  // The jobs first count their outputs, then write them into the slices reserved for them.
+  // Resources are deduplicated per job and merged afterwards in job order, so all indices are deterministic.
+  struct MeshExtractionJob {
+    unsigned first_comp_idx;
+    unsigned comp_count;
 
-    unsigned scaling_key_begin_local_idx;
-    unsigned scaling_key_count;
+    MeshExtractionCounts counts;
+    MeshExtractionCounts offsets;
 
-    unsigned node_idx; // Original index, needs to be offset with the absolute position in the array
+    std::vector<graphics::SharedDeviceChildHandle<graphics::Buffer>> buffers;
+    std::vector<graphics::SharedDeviceChildHandle<graphics::Texture>> textures;
+    PointerIndexTable<graphics::Buffer> buffer_indices;
+    PointerIndexTable<graphics::Texture> texture_indices;
+    std::vector<unsigned> buffer_remap; // Job local buffer index to merged buffer index
+  };
+
+
+  // Animation state of a skinned instance that persists across frames
+  struct AnimatedInstanceRecord {
+    std::vector<AnimationSampler> samplers; // One per animation layer
+    std::vector<Matrix4> palette_history; // Two palettes, see PoseEvaluator::Instance::history
+    AABB bounds; // Of the last update
+    AABB prev_bounds; // Of the update before the last one
+    std::vector<AABB> submesh_bounds; // Of the last update, one per submesh of the mesh
+    std::vector<AABB> prev_submesh_bounds; // Of the update before the last one
+    UINT64 last_used_frame;
+    UINT64 last_update_frame;
+    unsigned update_interval;
+    bool evaluated;
   };
 
 
-  struct SkeletonNodeData {
-    Matrix4 transform;
-    std::optional<unsigned> parent_idx; // Original index, needs to be offset with the absolute position in the array
+  // Animation detail selected for a skinned instance in the current frame, whether it is updated is decided by the
+  // animation LOD instance at the same position
+  struct PosedSkinnedMesh {
+    unsigned skinned_mesh_idx;
+    AnimatedInstanceRecord* record;
+    unsigned skipped_skeleton_level_count;
   };
 
 
-  struct BoneData {
-    Matrix4 offset_mtx;
-    unsigned skeleton_node_idx; // Original index, needs to be offset with the absolute position in the array
+  // Render side copy of the lights that persists across extractions.
+  // Parameter and transform changes are patched into it, registration changes rebuild it.
+  struct LightMirror {
+    std::vector<LightData> light_data;
+    // The indices also refer to the registered lights as those can't change without a rebuild
+    std::unordered_map<LightComponent const*, unsigned> light_indices;
+    std::unordered_multimap<TransformComponent const*, unsigned> transform_light_indices;
+
+    std::uint64_t version{0};
+  };
+
+
+  struct CameraData {
+    Vector3 position;
+    Vector3 right;
+    Vector3 up;
+    Vector3 forward;
+
+    float near_plane;
+    float far_plane;
+
+    Camera::Type type;
+    float fov_vert_deg;
+    float size_vert;
+
+    NormalizedViewport viewport;
+
+    unsigned rt_local_idx;
   };
 
 
@@ -236,16 +414,25 @@ private:
     unsigned original_tangent_buf_local_idx;
     unsigned bone_weight_buf_local_idx;
     unsigned bone_index_buf_local_idx;
-    unsigned bone_matrix_buf_local_idx;
-
-    float cur_animation_time;
-
-    unsigned node_anim_begin_local_idx;
-    unsigned node_anim_count;
-    unsigned skeleton_begin_local_idx;
-    unsigned skeleton_size;
-    unsigned bone_begin_local_idx;
-    unsigned bone_count;
+    // The bounds of the submeshes and instances in the range are replaced by the bounds of the evaluated pose
+    unsigned first_submesh_local_idx;
+    unsigned submesh_count;
+    // Position of the first bone matrix of the instance in the bone palette of the frame
+    unsigned bone_palette_offset;
+    unsigned first_animation_layer_idx;
+    unsigned animation_layer_count;
+
+    SkinnedMeshComponent::AnimationLods animation_lods;
+    bool pausing_animation_when_culled;
+
+    // Shared with the mesh instead of copied, the layers only reference the clips
+    std::shared_ptr<LocalPose const> bind_pose;
+    std::shared_ptr<std::vector<SkeletonNode> const> skeleton;
+    std::shared_ptr<std::vector<Bone> const> bones;
+    std::shared_ptr<std::vector<std::vector<std::uint32_t>> const> submesh_bones;
+
+    // Identifies the instance across frames, never dereferenced during rendering
+    SkinnedMeshComponent const* component;
   };
 
 
@@ -259,28 +446,47 @@ private:
     std::vector<CameraData> cam_data;
     std::vector<std::shared_ptr<RenderTarget>> render_targets;
 
-    std::vector<PositionKey> anim_pos_keys;
-    std::vector<RotationKey> anim_rot_keys;
-    std::vector<ScalingKey> anim_scaling_keys;
-    std::vector<NodeAnimationData> node_anim_data;
-    std::vector<SkeletonNodeData> skeleton_node_data;
-    std::vector<BoneData> bone_data;
     std::vector<SkinnedMeshData> skinned_mesh_data;
+    // Ranges of the bone palette are handed out to the skinned instances during extraction
+    unsigned bone_palette_size{0};
+    std::vector<AnimationLayer> animation_layers;
 
     std::vector<Vector4> gizmo_colors;
     std::vector<ShaderLineGizmoVertexData> line_gizmo_vertex_data;
 
+    // Vertex indices are relative to the first vertex of the occluder
+    std::vector<OccluderData> occluder_data;
+    std::vector<Vector3> occluder_vertices;
+    std::vector<std::uint32_t> occluder_indices;
+
     MultisamplingMode msaa_mode;
     SsaoParams ssao_params;
     ShadowParams shadow_params;
     float inv_gamma;
     bool depth_normal_pre_pass_enabled;
     bool ssao_enabled;
+    bool occlusion_culling_enabled;
+    int animation_update_budget;
     DXGI_FORMAT color_buffer_format;
     std::array<float, 4> background_color;
 
     graphics::SharedDeviceChildHandle<graphics::Texture> skybox_cubemap;
 
+    // Covers the first GetPrimitiveCount() instances, which are the static ones
+    Bvh static_submesh_instance_bvh;
+    std::uint64_t static_submesh_instance_bvh_version{0};
+
+    // Versions of the mirrors the packet was last synchronized with
+    std::uint64_t static_mesh_structure_version{0};
+    std::uint64_t static_mesh_transform_version{0};
+    std::uint64_t light_data_version{0};
+
+    // The frame the packet was last rendered in, its resources can't be released until the GPU finished it
+    std::optional<UINT64> gpu_frame_count;
+    // Indexes the per frame resources everywhere from extraction to rendering.
+    // Assigned from the packet slot when extraction starts and checked against the render manager when rendering.
+    UINT frame_idx{0};
+
     Vector3 ambient_light;
 
     graphics::SharedDeviceChildHandle<graphics::PipelineState> shadow_pso;
@@ -296,39 +502,215 @@ private:
   };
 
 
+  // Everything a camera needs for command recording that can be determined before it.
+  // The visible instance lists of all views are filled by parallel culling jobs, the view data only stores indices
+  // to them.
+  struct CameraViewData {
+    CD3DX12_VIEWPORT viewport;
+    CD3DX12_RECT scissor;
+
+    Matrix4 view_mtx;
+    Matrix4 proj_mtx;
+    Matrix4 view_proj_mtx;
+
+    std::pmr::vector<unsigned> visible_light_indices;
+    unsigned visible_list_idx;
+
+    ShadowCascadeBoundaries shadow_cascade_boundaries;
+    bool has_dir_shadow;
+    unsigned dir_shadow_light_idx; // Only valid if there is a directional shadow
+    std::array<Matrix4, MAX_CASCADE_COUNT> shadow_view_matrices;
+    std::array<Matrix4, MAX_CASCADE_COUNT> shadow_proj_matrices;
+    std::array<Matrix4, MAX_CASCADE_COUNT> shadow_view_proj_matrices;
+    std::array<unsigned, MAX_CASCADE_COUNT> cascade_visible_list_indices;
+
+    // Upper bound of the shadow views appended once the camera view is culled
+    std::size_t max_shadow_view_count;
+
+    // The punctual shadow atlas is shared by all cameras, so its layout is stored per camera
+    std::vector<ShadowAtlas::ShadowMap> punctual_shadow_maps;
+    std::vector<unsigned> punctual_shadow_map_visible_list_indices;
+  };
+
+
+  struct CullView {
+    Frustum frustum_ws;
+    SoftwareOcclusionCuller const* occlusion_culler; // Only set for camera views with occluders
+    bool shadow_casters_only;
+    // Only set for directional shadow views. Casters are skipped if they do not intersect it when extruded along the
+    // light, as their shadows cannot fall on anything the camera sees.
+    std::optional<Frustum> receiver_frustum_ws;
+    Vector3 caster_extrusion;
+    Vector3 draw_sort_dir; // Instances drawn with the same state are sorted front to back along it
+  };
+
+
+  // Shadow map of a visible punctual light that asks for a tile in the atlas
+  struct PunctualShadowCandidate {
+    int visible_light_idx_idx;
+    int shadow_map_idx;
+  };
+
+
+  // The receiver depths are the view space depth range of the visible instances, automatic splits are placed in it
   [[nodiscard]] static auto CalculateCameraShadowCascadeBoundaries(CameraData const& cam_data,
-                                                                   ShadowParams const& shadow_params) ->
+                                                                   ShadowParams const& shadow_params,
+                                                                   float receiver_near, float receiver_far) ->
     ShadowCascadeBoundaries;
 
 
+  // Splits the components evenly between the jobs and resets their counts
+  static auto PrepareMeshExtractionJobs(std::size_t comp_count, std::vector<MeshExtractionJob>& jobs) -> void;
+  // Runs the function for each job in parallel and waits for all of them
+  template<typename Func>
+  auto RunMeshExtractionJobs(std::span<MeshExtractionJob> jobs, Func const& func) -> void;
+  // Assigns the output slices of the jobs after the passed base offsets, returns the total counts
+  static auto CalculateMeshExtractionOffsets(std::span<MeshExtractionJob> jobs,
+                                             MeshExtractionCounts const& base) -> MeshExtractionCounts;
+  [[nodiscard]] static auto FindOrEmplaceBackJobBuffer(MeshExtractionJob& job,
+                                                       graphics::SharedDeviceChildHandle<graphics::Buffer> const& buf)
+    -> unsigned;
+  static auto FindOrEmplaceBackJobTexture(MeshExtractionJob& job,
+                                          graphics::SharedDeviceChildHandle<graphics::Texture> const& tex) -> void;
+  static auto ClearMeshExtractionJobResources(MeshExtractionJob& job) -> void;
+  // Replaces the job local buffer indices in the slices of the job with the merged ones
+  static auto RemapExtractedBufferIndices(MeshExtractionJob const& job, std::span<MeshData> mesh_data,
+                                          std::span<SubmeshData> submesh_data,
+                                          std::span<SkinnedMeshData> skinned_mesh_data) -> void;
+
+  static auto CountMeshComponent(MeshComponentBase const& comp, MeshExtractionCounts& counts) -> void;
+  // Writes the mesh, submeshes and instances of the component to the static mesh mirror or to the frame packet
+  template<typename Target>
+  auto ExtractMeshComponent(MeshComponentBase const& comp, MeshExtractionJob& job, MeshExtractionCounts& cursor,
+                            Target& target, std::span<StaticSubmeshInstanceKey> instance_keys) const -> void;
+  // Returns 0 for resources that never changed
+  template<typename T>
+  [[nodiscard]] static auto FindChangeVersion(std::unordered_map<T const*, std::uint32_t> const& versions,
+                                              T const* resource) noexcept -> std::uint32_t;
+  [[nodiscard]] auto IsExtractingOccluder(MeshComponentBase const& comp) const -> bool;
+  static auto CountOccluder(MeshComponentBase const& comp, MeshExtractionCounts& counts) -> void;
+  // Returns the index of the occluder in the mirror
+  static auto ExtractOccluder(MeshComponentBase const& comp, MeshExtractionCounts& cursor,
+                              StaticMeshMirror& mirror) -> unsigned;
+  // Writes the skinning data and animation layers of the component whose mesh was extracted last.
+  // Its submeshes were extracted starting at the passed index.
+  auto ExtractSkinnedMeshComponent(SkinnedMeshComponent const& comp, unsigned first_submesh_local_idx,
+                                   MeshExtractionJob& job, MeshExtractionCounts& cursor,
+                                   FramePacket& packet) const -> void;
+
+  [[nodiscard]] static auto ExtractLightData(LightComponent const& light) -> LightData;
+
+  // Apply the changes collected since the last extraction to the mirrors
+  auto UpdateStaticMeshMirror(bool rebuild) -> void;
+  // Extracts the component of the entry again in place.
+  // Returns false without changing anything if the component no longer fits the slices of the entry.
+  [[nodiscard]] auto PatchStaticMeshMirrorEntry(unsigned entry_idx) -> bool;
+  // Adds the pairs of the entry to the mesh and material indices of the mirror that it doesn't have yet
+  auto IndexStaticMeshMirrorEntryResources(unsigned entry_idx) -> void;
+  auto UpdateLightMirror(bool rebuild) -> void;
+
+  // Waits until the packet in the next slot is rendered and no longer used by the GPU
+  [[nodiscard]] auto AcquireFramePacketForExtraction() -> FramePacket&;
+  [[nodiscard]] auto GetFramePacketToRender() -> FramePacket&;
+  auto ReleaseRenderedFramePacket(FramePacket& packet) -> void;
+
+
   static auto CullLights(Frustum const& frustum_ws, std::span<LightData const> lights,
                          std::pmr::vector<unsigned>& visible_light_indices) -> void;
-  static auto CullStaticSubmeshInstances(Frustum const& frustum_ws, std::span<MeshData const> meshes,
-                                         std::span<SubmeshData const> submeshes,
+  static auto CullStaticSubmeshInstances(Frustum const& frustum_ws, Bvh const& static_submesh_instance_bvh,
                                          std::span<InstanceData const> instances,
                                          std::pmr::vector<unsigned>& visible_static_submesh_instance_indices) -> void;
+  // Removes the instances that do not cast shadows and the casters whose shadows miss the receivers of the view
+  static auto CullShadowCasters(CullView const& view, std::span<InstanceData const> instances,
+                                std::pmr::vector<unsigned>& visible_instance_indices) -> void;
+  // Removes the instances hidden by the occluders from the list of frustum culled instances
+  static auto CullOccludedInstances(SoftwareOcclusionCuller const& occlusion_culler,
+                                    std::span<InstanceData const> instances,
+                                    std::pmr::vector<unsigned>& visible_instance_indices) -> void;
 
 
-  static auto SetPerFrameConstants(ConstantBuffer<ShaderPerFrameConstants>& cb, int rt_width, int rt_height,
-                                   Vector3 const& ambient_light, ShadowParams const& shadow_params) -> void;
-  static auto SetPerViewConstants(ConstantBuffer<ShaderPerViewConstants>& cb, Matrix4 const& view_mtx,
-                                  Matrix4 const& proj_mtx, ShadowCascadeBoundaries const& cascade_bounds,
-                                  Vector3 const& view_pos) -> void;
-  static auto SetPerDrawConstants(ConstantBuffer<ShaderPerDrawConstants>& cb, Matrix4 const& model_mtx) -> void;
+  // These return the index of the constant buffer view the constants can be read through during the current frame
+  [[nodiscard]] auto AllocatePerFrameConstants(int rt_width, int rt_height, Vector3 const& ambient_light,
+                                               ShadowParams const& shadow_params) const -> UINT;
+  [[nodiscard]] auto AllocatePerViewConstants(Matrix4 const& view_mtx, Matrix4 const& proj_mtx,
+                                              ShadowCascadeBoundaries const& cascade_bounds,
+                                              Vector3 const& view_pos) const -> UINT;
 
 
+  // Allocates atlas tiles to the shadow maps of the visible punctual lights sized by their screen coverage.
+  // Shadow maps without any receiver in their frustum get no tile.
   auto UpdatePunctualShadowAtlas(PunctualShadowAtlas& atlas, std::span<LightData const> lights,
                                  std::span<unsigned const> visible_light_indices, CameraData const& cam_data,
-                                 Matrix4 const& cam_view_proj_mtx, float shadow_distance) -> void;
-
-
-  auto DrawDirectionalShadowMaps(FramePacket const& frame_packet, std::span<unsigned const> visible_light_indices,
-                                 CameraData const& cam_data, float rt_aspect, int cascade_count,
-                                 ShadowCascadeBoundaries const& shadow_cascade_boundaries,
-                                 std::array<Matrix4, MAX_CASCADE_COUNT>& shadow_view_proj_matrices,
+                                 Matrix4 const& cam_view_proj_mtx, float shadow_distance,
+                                 std::span<InstanceData const> instances,
+                                 std::span<unsigned const> receiver_instance_indices,
+                                 std::vector<ShadowAtlas::ShadowMap>& shadow_maps) -> void;
+
+
+  // Fits the cascades to the parts of their split frustums that contain receivers, extruded toward the light to
+  // include every caster of the scene
+  auto CalculateDirectionalShadowMatrices(FramePacket const& frame_packet, LightData const& light,
+                                          std::span<unsigned const> receiver_instance_indices,
+                                          AABB const& scene_bounds, CameraData const& cam_data, float rt_aspect,
+                                          int cascade_count, ShadowCascadeBoundaries const& shadow_cascade_boundaries,
+                                          std::array<Matrix4, MAX_CASCADE_COUNT>& shadow_view_matrices,
+                                          std::array<Matrix4, MAX_CASCADE_COUNT>& shadow_proj_matrices) const -> void;
+
+  // Selects the animation detail of the skinned instances against the cameras, then evaluates the poses due in the
+  // frame into the bone palette and replaces the bounds of the instances with the bounds of their poses
+  auto EvaluateSkinnedMeshPoses(FramePacket& frame_packet, std::span<Matrix4> bone_palette) -> void;
+  // Copies the last palette of every posed instance and hands the copies over to the next extraction
+  auto PublishBonePalettes() -> void;
+  // Amount of the last update shown in the current frame
+  [[nodiscard]] static auto CalculateAnimationHistoryBlend(AnimatedInstanceRecord const& record,
+                                                           UINT64 frame_count) noexcept -> float;
+
+  // Calculates the view data of the camera and appends its camera view to the culling queue
+  auto PrepareCameraView(FramePacket const& frame_packet, CameraData const& cam_data, CameraViewData& cam_view,
+                         std::vector<CullView>& cull_views) -> void;
+  // Fits the shadow views to what the camera sees, so it needs the visible list of the camera view.
+  // Appends the cascade and punctual shadow views to the culling queue.
+  auto PrepareShadowViews(FramePacket const& frame_packet, CameraData const& cam_data,
+                          std::span<unsigned const> cam_visible_instance_indices, AABB const& scene_bounds,
+                          CameraViewData& cam_view, std::vector<CullView>& cull_views) -> void;
+  // Makes room for the visible lists of the views of the frame and releases the lists of the previous frame
+  auto ReserveCullingMemory(FramePacket const& frame_packet, std::size_t view_count) -> void;
+  // Culls the instances against the views that do not have a visible list yet in parallel, filling the visible list
+  // with the same index. The visible lists are sorted into draw order.
+  auto CullViews(FramePacket const& frame_packet, std::span<CullView const> cull_views,
+                 std::vector<std::pmr::vector<unsigned>>& visible_lists) -> void;
+  static auto SortDraws(FramePacket const& frame_packet, Vector3 const& sort_dir, DrawSorter& sorter,
+                        std::pmr::vector<unsigned>& visible_instance_indices) -> void;
+  // Uploads the transforms of all instances and the visible lists of all views for instanced drawing, and returns
+  // the offset of each visible list in the uploaded instance indices
+  auto UploadInstances(FramePacket const& frame_packet, std::span<std::pmr::vector<unsigned> const> visible_lists,
+                       std::vector<UINT>& visible_list_offsets) -> void;
+  // True if the instances use the same geometry and material, so they can be drawn by one instanced draw
+  [[nodiscard]] static auto CanDrawInstanced(FramePacket const& frame_packet, InstanceData const& lhs,
+                                             InstanceData const& rhs) noexcept -> bool;
+  // Calls the function with the submesh, the position of the first instance in the list and the instance count of
+  // each run of the sorted visible list that can be drawn instanced
+  template<typename Func>
+  static auto ForEachDrawBatch(FramePacket const& frame_packet, std::span<unsigned const> visible_instance_indices,
+                               Func const& func) -> void;
+
+  // Draws the instances of a shadow view with the shadow pipeline and the instance buffers already set
+  static auto DrawShadowCasters(FramePacket const& frame_packet, std::span<unsigned const> visible_instance_indices,
+                                UINT first_instance_offset, graphics::CommandList& cmd) -> void;
+  // Creates the array of the camera when it first needs one
+  [[nodiscard]] auto GetDirectionalShadowMapArray(std::size_t cam_idx) -> DirectionalShadowMapArray&;
+  auto DrawDirectionalShadowMaps(FramePacket const& frame_packet, CameraViewData const& cam_view,
+                                 std::span<std::pmr::vector<unsigned> const> visible_lists,
+                                 std::span<UINT const> visible_list_offsets, DirectionalShadowMapArray& shadow_map_arr,
                                  graphics::CommandList& cmd) -> void;
-  auto DrawPunctualShadowMaps(PunctualShadowAtlas const& atlas, FramePacket const& frame_packet,
-                              graphics::CommandList& cmd) -> void;
+  // Identifies what a shadow view draws, the shadow map only has to be drawn again when this changes
+  [[nodiscard]] static auto CalculateShadowViewSignature(FramePacket const& frame_packet, Matrix4 const& view_proj_mtx,
+                                                         std::span<unsigned const> visible_instance_indices) noexcept
+    -> std::uint64_t;
+  auto DrawPunctualShadowMaps(PunctualShadowAtlas& atlas, FramePacket const& frame_packet,
+                              CameraViewData const& cam_view,
+                              std::span<std::pmr::vector<unsigned> const> visible_lists,
+                              std::span<UINT const> visible_list_offsets, graphics::CommandList& cmd) -> void;
 
   auto ClearGizmoDrawQueue() noexcept -> void;
 
@@ -336,12 +718,6 @@ private:
 
   auto RecreatePipelines() -> void;
 
-  auto CreatePerViewConstantBuffers(UINT count) -> void;
-  auto CreatePerDrawConstantBuffers(UINT count) -> void;
-
-  auto AcquirePerViewConstantBuffer() -> ConstantBuffer<ShaderPerViewConstants>&;
-  auto AcquirePerDrawConstantBuffer() -> ConstantBuffer<ShaderPerDrawConstants>&;
-
   auto OnWindowSize(Extent2D<std::uint32_t> size) -> void;
 
   static DXGI_FORMAT constexpr imprecise_color_buffer_format_{DXGI_FORMAT_R11G11B10_FLOAT};
@@ -351,15 +727,33 @@ private:
   static DXGI_FORMAT constexpr ssao_buffer_format_{DXGI_FORMAT_R8_UNORM};
   static DXGI_FORMAT constexpr normal_buffer_format_{DXGI_FORMAT_R8G8B8A8_SNORM};
 
+  constexpr static UINT dir_shadow_map_size_{4096};
+  constexpr static int occlusion_buffer_width_{256};
+  constexpr static int occlusion_buffer_height_{128};
+  // Per-view constants take 512 bytes, so this fits a couple thousand shadow maps
+  constexpr static UINT64 constant_buffer_ring_frame_size_{1 << 20};
+  // Splitting fewer components between jobs costs more than it saves
+  constexpr static std::size_t min_mesh_extraction_job_comp_count_{64};
+  // Automatic cascade splits are fully logarithmic from this ratio of the far and near receiver depth and approach
+  // uniform splits below it
+  constexpr static float log_cascade_split_depth_ratio_{1000.0f};
+  // Cascade sizes are rounded up to this many steps per doubling so that their texel size rarely changes
+  constexpr static float cascade_size_steps_per_octave_{8.0f};
+
   ObserverPtr<RenderManager> render_manager_;
   ObserverPtr<Window> window_;
 
   ObserverPtr<graphics::GraphicsDevice> device_;
 
-  std::array<ConstantBuffer<ShaderPerFrameConstants>, RenderManager::GetMaxFramesInFlight()> per_frame_cbs_;
-  std::vector<std::array<ConstantBuffer<ShaderPerViewConstants>, RenderManager::GetMaxFramesInFlight()>> per_view_cbs_;
-  std::vector<std::array<ConstantBuffer<ShaderPerDrawConstants>, RenderManager::GetMaxFramesInFlight()>> per_draw_cbs_;
+  // Holds the per-frame and per-view constants, its region is reset at the beginning of Render
+  std::unique_ptr<ConstantBufferRing> constant_buffer_ring_;
   std::array<StructuredBuffer<ShaderLight>, RenderManager::GetMaxFramesInFlight()> light_buffers_;
+  std::array<StructuredBuffer<ShaderLightCluster>, RenderManager::GetMaxFramesInFlight()> light_cluster_buffers_;
+  std::array<StructuredBuffer<unsigned>, RenderManager::GetMaxFramesInFlight()> light_index_buffers_;
+  std::array<StructuredBuffer<Matrix4>, RenderManager::GetMaxFramesInFlight()> bone_palette_buffers_;
+  std::array<StructuredBuffer<ShaderInstanceData>, RenderManager::GetMaxFramesInFlight()> instance_buffers_;
+  // The sorted visible lists of all views one after the other
+  std::array<StructuredBuffer<unsigned>, RenderManager::GetMaxFramesInFlight()> instance_idx_buffers_;
 
   graphics::SharedDeviceChildHandle<graphics::Texture> white_tex_;
   graphics::SharedDeviceChildHandle<graphics::Texture> ssao_noise_tex_;
@@ -395,13 +789,59 @@ private:
   graphics::UniqueSamplerHandle samp_bi_wrap_;
   graphics::UniqueSamplerHandle samp_point_wrap_;
 
+  // Packets are extracted and rendered in ring order, a packet is rendered in the frame whose index matches its slot
   std::array<FramePacket, RenderManager::GetMaxFramesInFlight()> frame_packets_;
-
-  UINT next_per_draw_cb_idx_{0};
-  UINT next_per_view_cb_idx_{0};
-
-  std::unique_ptr<DirectionalShadowMapArray> dir_shadow_map_arr_;
+  std::atomic<UINT64> extracted_packet_count_{0};
+  std::atomic<UINT64> rendered_packet_count_{0};
+
+  // Backs the visible instance lists of all views during Render, cleared at its beginning
+  std::unique_ptr<LinearMemoryResource> culling_memory_;
+  std::size_t culling_memory_size_{0};
+  // One per view so that the views can be sorted in parallel
+  std::vector<DrawSorter> draw_sorters_;
+  std::vector<UINT> tmp_visible_list_offsets_;
+
+  // One per camera so that their occlusion buffers stay valid until all views are culled
+  std::vector<std::unique_ptr<SoftwareOcclusionCuller>> occlusion_cullers_;
+  std::vector<SoftwareOcclusionCuller::Occluder> tmp_occluders_;
+
+  // Keep the key cursors and the last poses of the skinned instances between frames, only used during Render
+  std::unordered_map<SkinnedMeshComponent const*, AnimatedInstanceRecord> animated_instances_;
+  PoseEvaluator pose_evaluator_;
+  AnimationLodScheduler animation_lod_scheduler_;
+  std::vector<AnimationLodScheduler::View> tmp_animation_lod_views_;
+  std::vector<PosedSkinnedMesh> tmp_posed_skinned_meshes_;
+  std::vector<AnimationLodScheduler::Instance> tmp_animation_lod_instances_;
+  std::vector<PoseEvaluator::Layer> tmp_pose_layers_;
+  std::vector<PoseEvaluator::Instance> tmp_pose_instances_;
+
+  // Bone palettes pass from rendering to the main thread through three maps that are swapped, so that neither side
+  // holds the lock while copying, and the map read by GetBonePalette only changes during extraction
+  using BonePaletteMap = std::unordered_map<SkinnedMeshComponent const*, std::vector<Matrix4>>;
+  BonePaletteMap rendered_bone_palettes_; // Only used during Render
+  BonePaletteMap published_bone_palettes_;
+  bool bone_palettes_published_{false};
+  std::mutex bone_palette_mutex_;
+  BonePaletteMap extracted_bone_palettes_; // Only used during extraction and by GetBonePalette
+
+  // Map resources to their indices in the frame packet during extraction
+  PointerIndexTable<graphics::Buffer> buffer_indices_;
+  PointerIndexTable<graphics::Texture> texture_indices_;
+  PointerIndexTable<RenderTarget> render_target_indices_;
+
+  LightClusterGrid light_cluster_grid_;
+  std::vector<LightClusterGrid::Light> tmp_cluster_lights_;
+
+  // One per camera, so that each camera keeps the cascades fitted to it cached. The array of the first camera always
+  // exists and is bound for cameras without a directional shadow.
+  std::vector<std::unique_ptr<DirectionalShadowMapArray>> dir_shadow_map_arrs_;
   std::unique_ptr<PunctualShadowAtlas> punctual_shadow_atlas_;
+  std::vector<PunctualShadowCandidate> tmp_punctual_shadow_candidates_;
+  std::vector<ShadowAtlasAllocator::Request> tmp_shadow_atlas_requests_;
+  std::vector<std::optional<ShadowAtlasAllocator::Tile>> tmp_shadow_atlas_tiles_;
+  std::vector<unsigned> tmp_light_receiver_indices_;
+  std::vector<std::size_t> tmp_drawn_shadow_map_indices_;
+  std::vector<D3D12_RECT> tmp_shadow_clear_rects_;
 
   std::vector<Vector4> gizmo_colors_;
   StructuredBuffer<Vector4> gizmo_color_buffer_;
@@ -413,12 +853,15 @@ private:
 
   MultisamplingMode msaa_mode_{MultisamplingMode::kX8};
   SsaoParams ssao_params_{.radius = 0.1f, .bias = 0.025f, .power = 6.0f, .sample_count = 12};
-  ShadowParams shadow_params_{{0.1f, 0.3f, 0.6f}, 4, false, 100, ShadowFilteringMode::kPcfTent5X5};
+  ShadowParams shadow_params_{{0.1f, 0.3f, 0.6f}, true, 4, false, 100, ShadowFilteringMode::kPcfTent5X5};
 
   float inv_gamma_{1.f / 2.2f};
 
   bool depth_normal_pre_pass_enabled_{true};
   bool ssao_enabled_{true};
+  bool occlusion_culling_enabled_{true};
+
+  int animation_update_budget_{0};
 
   DXGI_FORMAT color_buffer_format_{imprecise_color_buffer_format_};
 
@@ -427,6 +870,50 @@ private:
   std::vector<LightComponent const*> lights_;
   std::vector<Camera const*> cameras_;
 
+  StaticMeshMirror static_mesh_mirror_;
+  LightMirror light_mirror_;
+
+  // Reused across extractions so that the job local storage stays allocated
+  std::vector<MeshExtractionJob> static_mesh_extraction_jobs_;
+  std::vector<MeshExtractionJob> skinned_mesh_extraction_jobs_;
+  std::vector<ObserverPtr<Job>> tmp_extraction_jobs_;
+  std::vector<StaticMeshMirrorEntry> tmp_static_mesh_entries_;
+  MeshExtractionJob static_mesh_patch_job_;
+  std::vector<unsigned> tmp_patched_static_mesh_entry_indices_;
+
+  // Changes collected since the last extraction
+  std::mutex change_mutex_;
+  std::vector<TransformComponent*> changed_transforms_;
+  std::vector<LightComponent const*> changed_lights_;
+  std::vector<MeshComponentBase const*> changed_mesh_components_;
+  std::vector<Mesh const*> changed_meshes_;
+  std::vector<Material const*> changed_materials_;
+  std::vector<Mesh const*> destroyed_meshes_;
+  std::vector<Material const*> destroyed_materials_;
+  bool static_meshes_changed_{true};
+  bool lights_changed_{true};
+  // The changes are swapped into these so that notifications can continue during extraction
+  std::vector<TransformComponent*> tmp_changed_transforms_;
+  std::vector<LightComponent const*> tmp_changed_lights_;
+  std::vector<MeshComponentBase const*> tmp_changed_mesh_components_;
+  std::vector<Mesh const*> tmp_changed_meshes_;
+  std::vector<Material const*> tmp_changed_materials_;
+  std::vector<Mesh const*> tmp_destroyed_meshes_;
+  std::vector<Material const*> tmp_destroyed_materials_;
+
+  // The version of a resource is the value of the change counter at its last notified change, only updated between
+  // extractions. Entries of destroyed resources are erased. As the counter only grows, a new resource at the same
+  // address never gets the version of the old one.
+  std::unordered_map<Mesh const*, std::uint32_t> mesh_change_versions_;
+  std::unordered_map<Material const*, std::uint32_t> material_change_versions_;
+  std::uint32_t resource_change_count_{0};
+
+  Bvh static_submesh_instance_bvh_;
+  std::vector<StaticSubmeshInstanceKey> static_submesh_instance_keys_;
+  std::uint64_t static_submesh_instance_bvh_version_{0};
+  // Temporary storage reused across extractions
+  std::vector<AABB> tmp_static_instance_bounds_;
+
   std::shared_ptr<RenderTarget> main_rt_;
   std::shared_ptr<RenderTarget> rt_override_;
 
@@ -18,26 +18,29 @@ struct VertexOut {
 };
 
 
-VertexOut VsMain(uint vertex_id : SV_VertexID) {
+VertexOut VsMain(uint vertex_id : SV_VertexID, uint instance_id : SV_InstanceID) {
   vertex_id += g_draw_call_params.base_vertex;
+  instance_id += g_draw_call_params.base_instance;
 
   const StructuredBuffer<float4> positions = ResourceDescriptorHeap[g_params.pos_buf_idx];
 
   const float4 pos_os = positions[vertex_id];
 
-  const ConstantBuffer<ShaderPerDrawConstants> per_draw_cb = ResourceDescriptorHeap[g_params.per_draw_cb_idx];
-  const float4 pos_ws = mul(pos_os, per_draw_cb.modelMtx);
+  const StructuredBuffer<uint> instance_indices = ResourceDescriptorHeap[g_params.instance_idx_buf_idx];
+  const StructuredBuffer<ShaderInstanceData> instances = ResourceDescriptorHeap[g_params.instance_buf_idx];
+  const ShaderInstanceData instance = instances[instance_indices[instance_id]];
+  const float4 pos_ws = mul(pos_os, instance.modelMtx);
 
   const ConstantBuffer<ShaderPerViewConstants> per_view_cb = ResourceDescriptorHeap[g_params.per_view_cb_idx];
   const float4 pos_cs = mul(pos_ws, per_view_cb.viewProjMtx);
 
   const StructuredBuffer<float4> normals = ResourceDescriptorHeap[g_params.norm_buf_idx];
   const float4 norm_os = normals[vertex_id];
-  const float3 norm_ws = normalize(mul(norm_os.xyz, (float3x3)per_draw_cb.invTranspModelMtx));
+  const float3 norm_ws = normalize(mul(norm_os.xyz, (float3x3)instance.invTranspModelMtx));
 
   const StructuredBuffer<float4> tangents = ResourceDescriptorHeap[g_params.tan_buf_idx];
   const float4 tan_os = tangents[vertex_id];
-  float3 tan_ws = normalize(mul(tan_os.xyz, (float3x3)per_draw_cb.modelMtx));
+  float3 tan_ws = normalize(mul(tan_os.xyz, (float3x3)instance.modelMtx));
   tan_ws = normalize(tan_ws - dot(tan_ws, norm_ws) * norm_ws);
   const float3 bitan_ws = cross(norm_ws, tan_ws);
   const float3x3 tbn_mtx_ws = float3x3(tan_ws, bitan_ws, norm_ws);
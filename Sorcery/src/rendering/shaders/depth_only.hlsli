@@ -16,14 +16,18 @@ struct VertexOut {
 };
 
 
-VertexOut VsMain(uint vertex_id : SV_VertexID) {
+VertexOut VsMain(uint vertex_id : SV_VertexID, uint instance_id : SV_InstanceID) {
   vertex_id += g_draw_call_params.base_vertex;
+  instance_id += g_draw_call_params.base_instance;
 
   const StructuredBuffer<float4> positions = ResourceDescriptorHeap[g_params.pos_buf_idx];
   const float4 pos_os = positions[vertex_id];
 
-  const ConstantBuffer<ShaderPerDrawConstants> per_draw_cb = ResourceDescriptorHeap[g_params.per_draw_cb_idx];
-  const float4 pos_ws = mul(pos_os, per_draw_cb.modelMtx);
+  // The instances of a draw are consecutive in the sorted instance indices of the view
+  const StructuredBuffer<uint> instance_indices = ResourceDescriptorHeap[g_params.instance_idx_buf_idx];
+  const StructuredBuffer<ShaderInstanceData> instances = ResourceDescriptorHeap[g_params.instance_buf_idx];
+  const ShaderInstanceData instance = instances[instance_indices[instance_id]];
+  const float4 pos_ws = mul(pos_os, instance.modelMtx);
 
   const ConstantBuffer<ShaderPerViewConstants> per_view_cb = ResourceDescriptorHeap[g_params.per_view_cb_idx];
   const float4 pos_cs = mul(pos_ws, per_view_cb.viewProjMtx);
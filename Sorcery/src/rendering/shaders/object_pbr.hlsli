@@ -27,6 +27,16 @@ int CalculateShadowCascadeIdx(const float pos_vs_z, uniform const float4 cascade
 }
 
 
+// Must match LightClusterGrid::CalculateClusterIndex
+uint CalculateLightClusterIdx(const float2 screen_uv, const float pos_vs_z, uniform const float z_scale,
+                              uniform const float z_bias) {
+  const uint2 xy = min(uint2(screen_uv * float2(LIGHT_CLUSTER_COUNT_X, LIGHT_CLUSTER_COUNT_Y)),
+                       uint2(LIGHT_CLUSTER_COUNT_X - 1, LIGHT_CLUSTER_COUNT_Y - 1));
+  const uint z = clamp(int(floor(log(max(pos_vs_z, 0.01)) * z_scale + z_bias)), 0, LIGHT_CLUSTER_COUNT_Z - 1);
+  return (z * LIGHT_CLUSTER_COUNT_Y + xy.y) * LIGHT_CLUSTER_COUNT_X + xy.x;
+}
+
+
 float3 VisualizeShadowCascades(const float pos_vs_z, uniform const float4 cascade_splits,
                                uniform const uint cascade_count) {
   const int cascade_idx = CalculateShadowCascadeIdx(pos_vs_z, cascade_splits);
@@ -207,14 +217,17 @@ float3 CalculatePointLight(const ShaderLight light, const float3 pos_ws, const f
 }
 
 
-VertexOut VsMain(uint vertex_id : SV_VertexID) {
+VertexOut VsMain(uint vertex_id : SV_VertexID, uint instance_id : SV_InstanceID) {
   vertex_id += g_draw_call_params.base_vertex;
+  instance_id += g_draw_call_params.base_instance;
 
   const StructuredBuffer<float4> positions = ResourceDescriptorHeap[g_params.pos_buf_idx];
   const float4 pos_os = positions[vertex_id];
 
-  const ConstantBuffer<ShaderPerDrawConstants> per_draw_cb = ResourceDescriptorHeap[g_params.per_draw_cb_idx];
-  const float4 pos_ws = mul(pos_os, per_draw_cb.modelMtx);
+  const StructuredBuffer<uint> instance_indices = ResourceDescriptorHeap[g_params.instance_idx_buf_idx];
+  const StructuredBuffer<ShaderInstanceData> instances = ResourceDescriptorHeap[g_params.instance_buf_idx];
+  const ShaderInstanceData instance = instances[instance_indices[instance_id]];
+  const float4 pos_ws = mul(pos_os, instance.modelMtx);
 
   const ConstantBuffer<ShaderPerViewConstants> per_view_cb = ResourceDescriptorHeap[g_params.per_view_cb_idx];
   const float4 pos_vs = mul(pos_ws, per_view_cb.viewMtx);
@@ -222,11 +235,11 @@ VertexOut VsMain(uint vertex_id : SV_VertexID) {
 
   const StructuredBuffer<float4> normals = ResourceDescriptorHeap[g_params.norm_buf_idx];
   const float4 norm_os = normals[vertex_id];
-  const float3 norm_ws = normalize(mul(norm_os.xyz, (float3x3)per_draw_cb.invTranspModelMtx));
+  const float3 norm_ws = normalize(mul(norm_os.xyz, (float3x3)instance.invTranspModelMtx));
 
   const StructuredBuffer<float4> tangents = ResourceDescriptorHeap[g_params.tan_buf_idx];
   const float4 tan_os = tangents[vertex_id];
-  float3 tan_ws = normalize(mul(tan_os.xyz, (float3x3)per_draw_cb.modelMtx));
+  float3 tan_ws = normalize(mul(tan_os.xyz, (float3x3)instance.modelMtx));
   tan_ws = normalize(tan_ws - dot(tan_ws, norm_ws) * norm_ws);
   const float3 bitan_ws = cross(norm_ws, tan_ws);
   const float3x3 tbn_mtx_ws = float3x3(tan_ws, bitan_ws, norm_ws);
@@ -312,16 +325,30 @@ float4 PsMain(const VertexOut vs_out) : SV_Target {
   const Texture2D<float> punc_light_shadow_atlas = ResourceDescriptorHeap[g_params.punc_shadow_atlas_idx];
   const SamplerComparisonState shadow_samp = SamplerDescriptorHeap[g_params.shadow_samp_idx];
 
-  for (uint i = 0; i < g_params.light_count; i++) {
-    if (lights[i].type == 0) {
-      out_color += CalculateDirLight(lights[i], vs_out.pos_ws, norm_ws, dir_to_cam_ws, vs_out.pos_vs.z, albedo,
+  const StructuredBuffer<ShaderLightCluster> light_clusters = ResourceDescriptorHeap[g_params.light_cluster_buf_idx];
+  const StructuredBuffer<uint> light_indices = ResourceDescriptorHeap[g_params.light_idx_buf_idx];
+
+  // Lights affecting every cluster are followed by the lights of the cluster the pixel falls into
+  const ShaderLightCluster global_lights = light_clusters[LIGHT_CLUSTER_GLOBAL_IDX];
+  const ShaderLightCluster cluster_lights = light_clusters[CalculateLightClusterIdx(screen_uv, vs_out.pos_vs.z,
+    g_params.light_cluster_z_scale, g_params.light_cluster_z_bias)];
+  const uint light_count = global_lights.lightCount + cluster_lights.lightCount;
+
+  for (uint i = 0; i < light_count; i++) {
+    const uint light_idx = light_indices[i < global_lights.lightCount
+                                           ? global_lights.firstLightIdx + i
+                                           : cluster_lights.firstLightIdx + i - global_lights.lightCount];
+    const ShaderLight light = lights[light_idx];
+
+    if (light.type == 0) {
+      out_color += CalculateDirLight(light, vs_out.pos_ws, norm_ws, dir_to_cam_ws, vs_out.pos_vs.z, albedo,
         metallic, roughness, dir_light_shadow_map_arr, shadow_samp, per_frame_cb.shadowFilteringMode,
         per_view_cb.shadowCascadeSplitDistances, per_frame_cb.shadowCascadeCount, per_frame_cb.visualizeShadowCascades);
-    } else if (lights[i].type == 1) {
-      out_color += CalculateSpotLight(lights[i], vs_out.pos_ws, norm_ws, dir_to_cam_ws, albedo, metallic,
+    } else if (light.type == 1) {
+      out_color += CalculateSpotLight(light, vs_out.pos_ws, norm_ws, dir_to_cam_ws, albedo, metallic,
         roughness, punc_light_shadow_atlas, shadow_samp, per_frame_cb.shadowFilteringMode);
-    } else if (lights[i].type == 2) {
-      out_color += CalculatePointLight(lights[i], vs_out.pos_ws, norm_ws, dir_to_cam_ws, albedo, metallic,
+    } else if (light.type == 2) {
+      out_color += CalculatePointLight(light, vs_out.pos_ws, norm_ws, dir_to_cam_ws, albedo, metallic,
         roughness, punc_light_shadow_atlas, shadow_samp, per_frame_cb.shadowFilteringMode);
     }
   }
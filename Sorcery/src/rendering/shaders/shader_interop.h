@@ -90,6 +90,11 @@ typedef bool BOOL;
 
 #define SKINNING_CS_THREADS 64
 
+#define LIGHT_CLUSTER_COUNT_X 16
+#define LIGHT_CLUSTER_COUNT_Y 9
+#define LIGHT_CLUSTER_COUNT_Z 24
+#define LIGHT_CLUSTER_GLOBAL_IDX (LIGHT_CLUSTER_COUNT_X * LIGHT_CLUSTER_COUNT_Y * LIGHT_CLUSTER_COUNT_Z)
+
 
 struct ShaderLight {
   row_major float4x4 shadowViewProjMatrices[MAX_PER_LIGHT_SHADOW_MAP_COUNT];
@@ -118,6 +123,13 @@ struct ShaderLight {
 };
 
 
+struct ShaderLightCluster {
+  uint firstLightIdx;
+  uint lightCount;
+  float2 pad;
+};
+
+
 struct ShaderMaterial {
   float3 albedo;
   float metallic;
@@ -166,7 +178,7 @@ struct ShaderPerViewConstants {
 };
 
 
-struct ShaderPerDrawConstants {
+struct ShaderInstanceData {
   row_major float4x4 modelMtx;
   row_major float4x4 invTranspModelMtx;
 };
@@ -180,7 +192,8 @@ struct DepthNormalDrawParams {
   uint mtl_idx;
   uint samp_idx;
   uint rt_idx;
-  uint per_draw_cb_idx;
+  uint instance_buf_idx;
+  uint instance_idx_buf_idx;
   uint per_view_cb_idx;
   uint per_frame_cb_idx;
 };
@@ -192,7 +205,8 @@ struct DepthOnlyDrawParams {
   uint mtl_idx;
   uint samp_idx;
   uint rt_idx;
-  uint per_draw_cb_idx;
+  uint instance_buf_idx;
+  uint instance_idx_buf_idx;
   uint per_view_cb_idx;
 };
 
@@ -223,13 +237,18 @@ struct ObjectDrawParams {
 
   uint ssao_tex_idx;
   uint light_buf_idx;
-  uint light_count;
-  uint dir_shadow_arr_idx;
+  uint light_cluster_buf_idx;
+  uint light_idx_buf_idx;
 
+  uint dir_shadow_arr_idx;
   uint punc_shadow_atlas_idx;
-  uint per_draw_cb_idx;
+  uint instance_buf_idx;
+  uint instance_idx_buf_idx;
+
   uint per_view_cb_idx;
   uint per_frame_cb_idx;
+  float light_cluster_z_scale;
+  float light_cluster_z_bias;
 };
 
 
@@ -283,6 +302,7 @@ struct VertexSkinningDrawParams {
 
   uint skinned_tan_buf_idx;
   uint vtx_count;
+  uint bone_offset;
 };
 
 
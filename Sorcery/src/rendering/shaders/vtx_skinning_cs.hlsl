@@ -35,7 +35,7 @@ void main(uint3 const id : SV_DispatchThreadID) {
   for (uint i = 0; i < 4; i++) {
     // We flip the multiplication order here because HLSL reads the matrices
     // in the buffer as column major whereas in C++ they are row-major
-    float4x4 const bone_mtx = bone_mtx_buf[indices[i]];
+    float4x4 const bone_mtx = bone_mtx_buf[g_params.bone_offset + indices[i]];
     skinned_vtx += mul(bone_mtx, vtx) * weights[i];
     skinned_norm += float4(mul((float3x3)bone_mtx, norm.xyz) * weights[i], 0);
     skinned_tan += float4(mul((float3x3)bone_mtx, tan.xyz) * weights[i], 0);
@@ -2,11 +2,13 @@
 
 #include "shaders/shader_interop.h"
 
+#include <algorithm>
+#include <iterator>
+
 
 namespace sorcery::rendering {
 ShadowAtlas::ShadowAtlas(graphics::GraphicsDevice* const device, DXGI_FORMAT const depth_format, UINT const size,
-                         int const subdiv_size):
-  GridLike{subdiv_size},
+                         UINT const min_tile_size, UINT const max_tile_size):
   tex_{
     device->CreateTexture(
       graphics::TextureDesc{
@@ -15,64 +17,63 @@ ShadowAtlas::ShadowAtlas(graphics::GraphicsDevice* const device, DXGI_FORMAT con
         D3D12_CLEAR_VALUE{.Format = depth_format, .DepthStencil = {0.0f, 0}}
       }.data())
   },
-  size_{size} {
-  if (!IsPowerOfTwo(size_)) {
-    throw std::runtime_error{"Shadow Atlas size must be power of 2."};
-  }
-}
+  size_{size},
+  allocator_{size, min_tile_size, max_tile_size} {}
 
 
-ShadowAtlas::Cell::Cell(int const subdiv_size):
-  GridLike{subdiv_size} {
-  subcells_.resize(GetElementCount());
-}
+ShadowAtlas::~ShadowAtlas() = default;
 
 
-auto ShadowAtlas::Cell::GetSubcell(int const idx) const -> std::optional<Subcell> const& {
-  ThrowIfIndexIsInvalid(idx);
-  return subcells_[idx];
+auto ShadowAtlas::GetTex() const noexcept -> graphics::SharedDeviceChildHandle<graphics::Texture> const& {
+  return tex_;
 }
 
 
-auto ShadowAtlas::Cell::GetSubcell(int const idx) -> std::optional<Subcell>& {
-  return const_cast<std::optional<Subcell>&>(const_cast<Cell const*>(this)->GetSubcell(idx));
+auto ShadowAtlas::GetSize() const noexcept -> UINT {
+  return size_;
 }
 
 
-auto ShadowAtlas::Cell::Resize(int const subdiv_size) -> void {
-  SetSubdivisionSize(subdiv_size);
-  subcells_.resize(GetElementCount());
+auto ShadowAtlas::GetAllocator() noexcept -> ShadowAtlasAllocator& {
+  return allocator_;
 }
 
 
-ShadowAtlas::~ShadowAtlas() = default;
+auto ShadowAtlas::SetLookUpInfo(std::span<ShadowMap const> const shadow_maps,
+                                std::span<ShaderLight> const lights) const -> void {
+  auto const size{static_cast<float>(size_)};
 
-
-auto ShadowAtlas::GetTex() const noexcept -> graphics::SharedDeviceChildHandle<graphics::Texture> const& {
-  return tex_;
+  for (auto const& shadow_map : shadow_maps) {
+    auto& light{lights[shadow_map.visible_light_idx_idx]};
+    light.isCastingShadow = TRUE;
+    light.sampleShadowMap[shadow_map.shadow_map_idx] = TRUE;
+    light.shadowViewProjMatrices[shadow_map.shadow_map_idx] = shadow_map.shadow_view_proj_mtx;
+    light.shadowAtlasCellOffsets[shadow_map.shadow_map_idx] = Vector2{
+      static_cast<float>(shadow_map.tile.offset_x) / size, static_cast<float>(shadow_map.tile.offset_y) / size
+    };
+    light.shadowAtlasCellSizes[shadow_map.shadow_map_idx] = static_cast<float>(shadow_map.tile.size) / size;
+  }
 }
 
 
-auto ShadowAtlas::GetSize() const noexcept -> UINT {
-  return size_;
-}
+auto ShadowAtlas::UpdateTileCache(ShadowAtlasAllocator::Tile const& tile, std::uint64_t const signature) -> bool {
+  if (auto const it{
+    std::ranges::find_if(cached_tiles_, [&tile](CachedTile const& cached) {
+      return cached.tile.offset_x == tile.offset_x && cached.tile.offset_y == tile.offset_y &&
+             cached.tile.size == tile.size;
+    })
+  }; it != std::end(cached_tiles_) && it->signature == signature) {
+    return true;
+  }
 
+  std::erase_if(cached_tiles_, [&tile](CachedTile const& cached) {
+    return cached.tile.offset_x < tile.offset_x + tile.size &&
+           tile.offset_x < cached.tile.offset_x + cached.tile.size &&
+           cached.tile.offset_y < tile.offset_y + tile.size &&
+           tile.offset_y < cached.tile.offset_y + cached.tile.size;
+  });
 
-auto ShadowAtlas::SetLookUpInfo(std::span<ShaderLight> lights) const -> void {
-  for (int i = 0; i < GetElementCount(); i++) {
-    auto const& cell{GetCell(i)};
-
-    for (int j = 0; j < cell.GetElementCount(); j++) {
-      if (auto const& subcell{cell.GetSubcell(j)}) {
-        lights[subcell->visibleLightIdxIdx].isCastingShadow = TRUE;
-        lights[subcell->visibleLightIdxIdx].sampleShadowMap[subcell->shadowMapIdx] = TRUE;
-        lights[subcell->visibleLightIdxIdx].shadowViewProjMatrices[subcell->shadowMapIdx] = subcell->shadowViewProjMtx;
-        lights[subcell->visibleLightIdxIdx].shadowAtlasCellOffsets[subcell->shadowMapIdx] =
-          GetNormalizedElementOffset(i) + cell.GetNormalizedElementOffset(j) * GetNormalizedElementSize();
-        lights[subcell->visibleLightIdxIdx].shadowAtlasCellSizes[subcell->shadowMapIdx] =
-          GetNormalizedElementSize() * cell.GetNormalizedElementSize();
-      }
-    }
-  }
+  cached_tiles_.emplace_back(tile, signature);
+  return false;
 }
 }
@@ -1,43 +1,33 @@
 #pragma once
 
 #include "graphics.hpp"
+#include "shadow_atlas_allocator.hpp"
 #include "ShadowCascadeBoundary.hpp"
-#include "../GridLike.hpp"
 
-#include <optional>
+#include <cstdint>
 #include <span>
 #include <vector>
 
 
 namespace sorcery::rendering {
-class ShadowAtlas : public GridLike {
+class ShadowAtlas {
 protected:
   graphics::SharedDeviceChildHandle<graphics::Texture> tex_;
   UINT size_;
+  ShadowAtlasAllocator allocator_;
 
 
-  ShadowAtlas(graphics::GraphicsDevice* device, DXGI_FORMAT depth_format, UINT size, int subdiv_size);
+  ShadowAtlas(graphics::GraphicsDevice* device, DXGI_FORMAT depth_format, UINT size, UINT min_tile_size,
+              UINT max_tile_size);
 
 public:
-  class Cell : public GridLike {
-  public:
-    struct Subcell {
-      Matrix4 shadowViewProjMtx;
-      // Index into the array of indices to the visible lights, use lights[visibleLights[visibleLightIdxIdx]] to get to the light
-      int visibleLightIdxIdx;
-      int shadowMapIdx;
-      char pad[sizeof(Matrix4) - 2 * sizeof(int)];
-    };
-
-  private:
-    std::vector<std::optional<Subcell>> subcells_;
-
-  public:
-    explicit Cell(int subdiv_size);
-
-    [[nodiscard]] auto GetSubcell(int idx) const -> std::optional<Subcell> const&;
-    [[nodiscard]] auto GetSubcell(int idx) -> std::optional<Subcell>&;
-    auto Resize(int subdiv_size) -> void;
+  struct ShadowMap {
+    Matrix4 shadow_view_proj_mtx;
+    // Index into the array of indices to the visible lights, use lights[visible_lights[visible_light_idx_idx]] to get
+    // to the light
+    int visible_light_idx_idx;
+    int shadow_map_idx;
+    ShadowAtlasAllocator::Tile tile;
   };
 
 
@@ -51,10 +41,21 @@ public:
 
   [[nodiscard]] auto GetTex() const noexcept -> graphics::SharedDeviceChildHandle<graphics::Texture> const&;
   [[nodiscard]] auto GetSize() const noexcept -> UINT;
+  [[nodiscard]] auto GetAllocator() noexcept -> ShadowAtlasAllocator&;
 
-  auto SetLookUpInfo(std::span<ShaderLight> lights) const -> void;
+  auto SetLookUpInfo(std::span<ShadowMap const> shadow_maps, std::span<ShaderLight> lights) const -> void;
 
-  [[nodiscard]] virtual auto GetCell(int idx) const -> Cell const& = 0;
-  [[nodiscard]] virtual auto GetCell(int idx) -> Cell& = 0;
+  // Returns whether the tile still holds what was drawn into it with the same signature, so drawing can be skipped.
+  // Otherwise remembers the signature for the tile and forgets the cached tiles it overlaps.
+  [[nodiscard]] auto UpdateTileCache(ShadowAtlasAllocator::Tile const& tile, std::uint64_t signature) -> bool;
+
+private:
+  struct CachedTile {
+    ShadowAtlasAllocator::Tile tile;
+    std::uint64_t signature;
+  };
+
+
+  std::vector<CachedTile> cached_tiles_;
 };
 }
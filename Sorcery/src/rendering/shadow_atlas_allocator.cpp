@@ -0,0 +1,283 @@
+#include "shadow_atlas_allocator.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <iterator>
+#include <stdexcept>
+
+
+namespace sorcery::rendering {
+ShadowAtlasAllocator::ShadowAtlasAllocator(std::uint32_t const atlas_size, std::uint32_t const min_tile_size,
+                                           std::uint32_t const max_tile_size) :
+  atlas_size_{atlas_size},
+  min_tile_size_{min_tile_size},
+  max_tile_size_{max_tile_size} {
+  if (!std::has_single_bit(atlas_size) || !std::has_single_bit(min_tile_size) ||
+      !std::has_single_bit(max_tile_size)) {
+    throw std::runtime_error{"Shadow atlas and tile sizes must be powers of 2."};
+  }
+
+  if (min_tile_size > max_tile_size || max_tile_size > atlas_size) {
+    throw std::runtime_error{"Shadow atlas tile sizes must be within the atlas size."};
+  }
+
+  min_level_ = static_cast<unsigned>(std::countr_zero(atlas_size / max_tile_size));
+  max_level_ = static_cast<unsigned>(std::countr_zero(atlas_size / min_tile_size));
+
+  std::size_t node_count{0};
+
+  for (unsigned level{0}; level <= max_level_; level++) {
+    node_count += std::size_t{1} << 2 * level;
+  }
+
+  nodes_.resize(node_count);
+}
+
+
+auto ShadowAtlasAllocator::Allocate(std::span<Request const> const requests,
+                                    std::vector<std::optional<Tile>>& tiles) -> void {
+  tiles.assign(requests.size(), std::nullopt);
+
+  tmp_levels_.clear();
+  tmp_desired_levels_.clear();
+  tmp_order_.clear();
+
+  for (std::size_t i{0}; i < requests.size(); i++) {
+    std::optional<unsigned> prev_level;
+
+    if (auto const it{prev_tiles_.find(requests[i].id)}; it != std::end(prev_tiles_)) {
+      prev_level = static_cast<unsigned>(std::countr_zero(atlas_size_ / it->second.size));
+    }
+
+    // Tiles shrunk under pressure stay shrunk until there is room to grow them again
+    auto const desired_level{CalculateLevel(requests[i].importance, prev_level)};
+    tmp_desired_levels_.emplace_back(desired_level);
+    tmp_levels_.emplace_back(prev_level ? std::max(desired_level, *prev_level) : desired_level);
+    tmp_order_.emplace_back(i);
+  }
+
+  std::ranges::stable_sort(tmp_order_, [&requests](std::size_t const lhs, std::size_t const rhs) {
+    return requests[lhs].importance > requests[rhs].importance;
+  });
+
+  // Shrink the tiles one level at a time starting from the least important until they cover at most the atlas.
+  // If everything is at the smallest size, drop the least important ones.
+  auto const capacity{CalculateArea(0)};
+  std::uint64_t total_area{0};
+
+  for (auto const level : tmp_levels_) {
+    total_area += CalculateArea(level);
+  }
+
+  while (total_area > capacity) {
+    auto shrunk{false};
+
+    for (auto it{std::rbegin(tmp_order_)}; it != std::rend(tmp_order_) && total_area > capacity; ++it) {
+      if (auto& level{tmp_levels_[*it]}; level < max_level_) {
+        total_area -= CalculateArea(level) - CalculateArea(level + 1);
+        level += 1;
+        shrunk = true;
+      }
+    }
+
+    if (!shrunk) {
+      while (total_area > capacity) {
+        total_area -= CalculateArea(tmp_levels_[tmp_order_.back()]);
+        tmp_order_.pop_back();
+      }
+    }
+  }
+
+  // Grow the shrunk tiles back one level at a time starting from the most important while they fit
+  for (auto grown{true}; grown;) {
+    grown = false;
+
+    for (auto const request_idx : tmp_order_) {
+      auto& level{tmp_levels_[request_idx]};
+
+      if (level <= tmp_desired_levels_[request_idx]) {
+        continue;
+      }
+
+      if (auto const growth{CalculateArea(level - 1) - CalculateArea(level)}; total_area + growth <= capacity) {
+        total_area += growth;
+        level -= 1;
+        grown = true;
+      }
+    }
+  }
+
+  // Keep the places of the tiles that did not change size first.
+  // These never overlap as they were placed together in the previous call.
+  ResetNodes();
+  tmp_unplaced_.clear();
+
+  for (auto const request_idx : tmp_order_) {
+    if (auto const it{prev_tiles_.find(requests[request_idx].id)};
+      it != std::end(prev_tiles_) && it->second.size == atlas_size_ >> tmp_levels_[request_idx] &&
+      ClaimTile(it->second)) {
+      tiles[request_idx] = it->second;
+    } else {
+      tmp_unplaced_.emplace_back(request_idx);
+    }
+  }
+
+  // Larger tiles first, so that the tiles always fit if nothing was kept
+  std::ranges::stable_sort(tmp_unplaced_, [this](std::size_t const lhs, std::size_t const rhs) {
+    return tmp_levels_[lhs] < tmp_levels_[rhs];
+  });
+
+  auto const all_placed{
+    std::ranges::all_of(tmp_unplaced_, [this, &tiles](std::size_t const request_idx) {
+      tiles[request_idx] = AllocateTile(tmp_levels_[request_idx]);
+      return tiles[request_idx].has_value();
+    })
+  };
+
+  // The kept tiles fragmented the atlas too much, so everything is packed again from scratch
+  if (!all_placed) {
+    ResetNodes();
+    std::ranges::fill(tiles, std::nullopt);
+
+    tmp_unplaced_ = tmp_order_;
+    std::ranges::stable_sort(tmp_unplaced_, [this](std::size_t const lhs, std::size_t const rhs) {
+      return tmp_levels_[lhs] < tmp_levels_[rhs];
+    });
+
+    for (auto const request_idx : tmp_unplaced_) {
+      tiles[request_idx] = AllocateTile(tmp_levels_[request_idx]);
+    }
+  }
+
+  cur_tiles_.clear();
+
+  for (std::size_t i{0}; i < requests.size(); i++) {
+    if (tiles[i]) {
+      cur_tiles_.insert_or_assign(requests[i].id, *tiles[i]);
+    }
+  }
+
+  std::swap(prev_tiles_, cur_tiles_);
+}
+
+
+auto ShadowAtlasAllocator::GetAtlasSize() const noexcept -> std::uint32_t {
+  return atlas_size_;
+}
+
+
+auto ShadowAtlasAllocator::GetMinTileSize() const noexcept -> std::uint32_t {
+  return min_tile_size_;
+}
+
+
+auto ShadowAtlasAllocator::GetMaxTileSize() const noexcept -> std::uint32_t {
+  return max_tile_size_;
+}
+
+
+auto ShadowAtlasAllocator::CalculateLevel(float const importance,
+                                          std::optional<unsigned> const prev_level) const noexcept -> unsigned {
+  if (!(importance > 0)) {
+    return max_level_;
+  }
+
+  // The tile edge follows the square root of the importance, the largest tile at an importance of 1
+  auto const exact_level{static_cast<float>(min_level_) - 0.5f * std::log2(importance)};
+
+  // A level is chosen for exact levels in the range (level - 1, level]
+  if (prev_level && exact_level > static_cast<float>(*prev_level) - 1 - level_hysteresis_ &&
+      exact_level <= static_cast<float>(*prev_level) + level_hysteresis_) {
+    return std::clamp(*prev_level, min_level_, max_level_);
+  }
+
+  return static_cast<unsigned>(std::clamp(std::ceil(exact_level), static_cast<float>(min_level_),
+    static_cast<float>(max_level_)));
+}
+
+
+auto ShadowAtlasAllocator::CalculateArea(unsigned const level) const noexcept -> std::uint64_t {
+  return std::uint64_t{1} << 2 * (max_level_ - level);
+}
+
+
+auto ShadowAtlasAllocator::ResetNodes() noexcept -> void {
+  // Children are only read after their parent is split, which resets them
+  nodes_.front() = NodeState::Free;
+}
+
+
+auto ShadowAtlasAllocator::SplitNode(std::size_t const node_idx) noexcept -> void {
+  nodes_[node_idx] = NodeState::Split;
+  std::fill_n(std::begin(nodes_) + static_cast<std::ptrdiff_t>(node_idx * 4 + 1), 4, NodeState::Free);
+}
+
+
+auto ShadowAtlasAllocator::AllocateTile(unsigned const level) noexcept -> std::optional<Tile> {
+  return AllocateTile(level, 0, 0, 0, 0);
+}
+
+
+auto ShadowAtlasAllocator::AllocateTile(unsigned const level, std::size_t const node_idx, unsigned const node_level,
+                                        std::uint32_t const offset_x,
+                                        std::uint32_t const offset_y) noexcept -> std::optional<Tile> {
+  if (nodes_[node_idx] == NodeState::Used) {
+    return std::nullopt;
+  }
+
+  if (node_level == level) {
+    if (nodes_[node_idx] != NodeState::Free) {
+      return std::nullopt;
+    }
+
+    nodes_[node_idx] = NodeState::Used;
+    return Tile{offset_x, offset_y, atlas_size_ >> level};
+  }
+
+  if (nodes_[node_idx] == NodeState::Free) {
+    SplitNode(node_idx);
+  }
+
+  auto const child_size{atlas_size_ >> (node_level + 1)};
+
+  for (std::uint32_t i{0}; i < 4; i++) {
+    if (auto const tile{
+      AllocateTile(level, node_idx * 4 + 1 + i, node_level + 1, offset_x + (i & 1) * child_size,
+        offset_y + (i >> 1) * child_size)
+    }) {
+      return tile;
+    }
+  }
+
+  return std::nullopt;
+}
+
+
+auto ShadowAtlasAllocator::ClaimTile(Tile const& tile) noexcept -> bool {
+  auto const level{static_cast<unsigned>(std::countr_zero(atlas_size_ / tile.size))};
+  std::size_t node_idx{0};
+
+  for (unsigned node_level{0}; node_level < level; node_level++) {
+    if (nodes_[node_idx] == NodeState::Used) {
+      return false;
+    }
+
+    if (nodes_[node_idx] == NodeState::Free) {
+      SplitNode(node_idx);
+    }
+
+    // Tile offsets are multiples of the tile size, so their bits select the quadrant on each level
+    auto const child_size{atlas_size_ >> (node_level + 1)};
+    auto const quadrant{((tile.offset_y & child_size) != 0 ? 2u : 0u) + ((tile.offset_x & child_size) != 0 ? 1u : 0u)};
+    node_idx = node_idx * 4 + 1 + quadrant;
+  }
+
+  if (nodes_[node_idx] != NodeState::Free) {
+    return false;
+  }
+
+  nodes_[node_idx] = NodeState::Used;
+  return true;
+}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "../Core.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+
+namespace sorcery::rendering {
+// Assigns power of two sized square tiles of a square shadow atlas to shadow maps with a quadtree buddy scheme.
+// Tiles are sized by the importance of their shadow maps and are shrunk, least important first, when the atlas runs
+// out of space. Shadow maps that keep their tile size also keep their place in the atlas across calls.
+// Has no dependency on the graphics device, so it can be used headless.
+class ShadowAtlasAllocator {
+public:
+  struct Request {
+    std::uint64_t id; // Identifies the shadow map across calls
+    float importance; // Fraction of the screen affected by the shadow map, 1 or more asks for the largest tile
+  };
+
+
+  // In texels
+  struct Tile {
+    std::uint32_t offset_x;
+    std::uint32_t offset_y;
+    std::uint32_t size;
+  };
+
+
+  // All sizes must be powers of two, and the tile sizes must be within the atlas size
+  LEOPPHAPI ShadowAtlasAllocator(std::uint32_t atlas_size, std::uint32_t min_tile_size, std::uint32_t max_tile_size);
+
+  // Fills one tile per request. Requests that do not fit even with the smallest tile size receive no tile.
+  LEOPPHAPI auto Allocate(std::span<Request const> requests, std::vector<std::optional<Tile>>& tiles) -> void;
+
+  [[nodiscard]] LEOPPHAPI auto GetAtlasSize() const noexcept -> std::uint32_t;
+  [[nodiscard]] LEOPPHAPI auto GetMinTileSize() const noexcept -> std::uint32_t;
+  [[nodiscard]] LEOPPHAPI auto GetMaxTileSize() const noexcept -> std::uint32_t;
+
+private:
+  enum class NodeState : std::uint8_t {
+    Free,
+    Split,
+    Used
+  };
+
+
+  // Tile size of a level is the atlas size shifted right by the level
+  [[nodiscard]] auto CalculateLevel(float importance, std::optional<unsigned> prev_level) const noexcept -> unsigned;
+  // Units are tiles of the smallest size
+  [[nodiscard]] auto CalculateArea(unsigned level) const noexcept -> std::uint64_t;
+  auto ResetNodes() noexcept -> void;
+  auto SplitNode(std::size_t node_idx) noexcept -> void;
+  // Finds the first free place for a tile of the level
+  [[nodiscard]] auto AllocateTile(unsigned level) noexcept -> std::optional<Tile>;
+  [[nodiscard]] auto AllocateTile(unsigned level, std::size_t node_idx, unsigned node_level, std::uint32_t offset_x,
+                                  std::uint32_t offset_y) noexcept -> std::optional<Tile>;
+  // Marks the place of the tile as used if it is free
+  [[nodiscard]] auto ClaimTile(Tile const& tile) noexcept -> bool;
+
+  // A tile only changes its size when the importance is this far over the boundary of its size in levels
+  constexpr static float level_hysteresis_{0.25f};
+
+  std::uint32_t atlas_size_;
+  std::uint32_t min_tile_size_;
+  std::uint32_t max_tile_size_;
+  unsigned min_level_;
+  unsigned max_level_;
+
+  // Implicit quadtree, the children of node i are at 4i + 1 to 4i + 4
+  std::vector<NodeState> nodes_;
+  std::unordered_map<std::uint64_t, Tile> prev_tiles_;
+  std::unordered_map<std::uint64_t, Tile> cur_tiles_;
+
+  std::vector<unsigned> tmp_levels_;
+  std::vector<unsigned> tmp_desired_levels_;
+  std::vector<std::size_t> tmp_order_;
+  std::vector<std::size_t> tmp_unplaced_;
+};
+}
@@ -0,0 +1,357 @@
+#include "software_occlusion_culler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <immintrin.h>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+
+namespace sorcery::rendering {
+SoftwareOcclusionCuller::SoftwareOcclusionCuller(int const width, int const height) {
+  Resize(width, height);
+}
+
+
+auto SoftwareOcclusionCuller::Resize(int const width, int const height) -> void {
+  if (width <= 0 || height <= 0) {
+    throw std::runtime_error{"Software occlusion culler dimensions must be positive."};
+  }
+
+  tile_count_x_ = (width + tile_width_ - 1) / tile_width_;
+  tile_count_y_ = (height + tile_height_ - 1) / tile_height_;
+  width_ = tile_count_x_ * tile_width_;
+  height_ = tile_count_y_ * tile_height_;
+
+  tile_bins_.resize(static_cast<std::size_t>(tile_count_x_) * tile_count_y_);
+
+  depth_levels_.clear();
+  depth_levels_.emplace_back(width_, height_, std::vector<float>(static_cast<std::size_t>(width_) * height_, 0.0f));
+
+  while (depth_levels_.back().width > 1 || depth_levels_.back().height > 1) {
+    auto const level_width{(depth_levels_.back().width + 1) / 2};
+    auto const level_height{(depth_levels_.back().height + 1) / 2};
+    depth_levels_.emplace_back(level_width, level_height,
+      std::vector<float>(static_cast<std::size_t>(level_width) * level_height, 0.0f));
+  }
+
+  has_occluders_ = false;
+}
+
+
+auto SoftwareOcclusionCuller::Render(Matrix4 const& view_proj_mtx, std::span<Occluder const> const occluders,
+                                     JobSystem& job_system) -> void {
+  view_proj_mtx_ = view_proj_mtx;
+  triangles_.clear();
+
+  for (auto& bin : tile_bins_) {
+    bin.clear();
+  }
+
+  std::ranges::fill(depth_levels_.front().depths, 0.0f);
+
+  auto const half_width{static_cast<float>(width_) * 0.5f};
+  auto const half_height{static_cast<float>(height_) * 0.5f};
+
+  // Transform, set up and bin the triangles
+
+  for (auto const& [local_to_world_mtx, positions, indices] : occluders) {
+    auto const local_to_clip_mtx{local_to_world_mtx * view_proj_mtx};
+
+    clip_positions_.clear();
+    std::ranges::transform(positions, std::back_inserter(clip_positions_), [&local_to_clip_mtx](Vector3 const& pos) {
+      return Vector4{pos, 1} * local_to_clip_mtx;
+    });
+
+    for (std::size_t i{0}; i + 2 < indices.size(); i += 3) {
+      std::array<Vector3, 3> verts;
+      auto projectable{true};
+
+      for (auto j{0}; j < 3; j++) {
+        if (indices[i + j] >= clip_positions_.size()) {
+          projectable = false;
+          break;
+        }
+
+        auto const& clip_pos{clip_positions_[indices[i + j]]};
+
+        // Triangles reaching in front of the near plane are dropped, which only weakens the occlusion
+        if (clip_pos[3] < min_clip_w_ || clip_pos[2] > clip_pos[3]) {
+          projectable = false;
+          break;
+        }
+
+        auto const inv_w{1.0f / clip_pos[3]};
+        verts[j] = Vector3{
+          (clip_pos[0] * inv_w + 1.0f) * half_width, (1.0f - clip_pos[1] * inv_w) * half_height, clip_pos[2] * inv_w
+        };
+      }
+
+      if (!projectable) {
+        continue;
+      }
+
+      // Occluders are not backface culled, only the winding is made consistent so that edge functions are positive
+      // inside
+      auto const area{
+        (verts[1][0] - verts[0][0]) * (verts[2][1] - verts[0][1]) - (verts[1][1] - verts[0][1]) * (verts[2][0] - verts[
+          0][0])
+      };
+
+      if (area == 0) {
+        continue;
+      }
+
+      if (area < 0) {
+        std::swap(verts[1], verts[2]);
+      }
+
+      auto const min_x{std::max(static_cast<int>(std::floor(std::min({verts[0][0], verts[1][0], verts[2][0]}))), 0)};
+      auto const min_y{std::max(static_cast<int>(std::floor(std::min({verts[0][1], verts[1][1], verts[2][1]}))), 0)};
+      auto const max_x{
+        std::min(static_cast<int>(std::ceil(std::max({verts[0][0], verts[1][0], verts[2][0]}))), width_ - 1)
+      };
+      auto const max_y{
+        std::min(static_cast<int>(std::ceil(std::max({verts[0][1], verts[1][1], verts[2][1]}))), height_ - 1)
+      };
+
+      if (min_x > max_x || min_y > max_y) {
+        continue;
+      }
+
+      auto const tri_idx{static_cast<unsigned>(triangles_.size())};
+      triangles_.emplace_back(verts[0], verts[1], verts[2]);
+
+      for (auto tile_y{min_y / tile_height_}; tile_y <= max_y / tile_height_; tile_y++) {
+        for (auto tile_x{min_x / tile_width_}; tile_x <= max_x / tile_width_; tile_x++) {
+          tile_bins_[tile_y * tile_count_x_ + tile_x].emplace_back(tri_idx);
+        }
+      }
+    }
+  }
+
+  has_occluders_ = !triangles_.empty();
+
+  // Rasterize the tiles in parallel, every job only touches the pixels of its own tile
+
+  std::vector<ObserverPtr<Job>> jobs;
+
+  for (auto i{0}; i < static_cast<int>(tile_bins_.size()); i++) {
+    if (tile_bins_[i].empty()) {
+      continue;
+    }
+
+    jobs.emplace_back(job_system.CreateJob([this, i] {
+      RasterizeTile(i);
+    }));
+    job_system.Run(jobs.back());
+  }
+
+  for (auto const job : jobs) {
+    job_system.Wait(job);
+  }
+
+  BuildDepthPyramid();
+}
+
+
+auto SoftwareOcclusionCuller::IsVisible(AABB const& aabb_ws) const -> bool {
+  if (!has_occluders_) {
+    return true;
+  }
+
+  auto const half_width{static_cast<float>(width_) * 0.5f};
+  auto const half_height{static_cast<float>(height_) * 0.5f};
+
+  Vector2 min{std::numeric_limits<float>::max()};
+  Vector2 max{std::numeric_limits<float>::lowest()};
+  auto nearest_depth{std::numeric_limits<float>::lowest()};
+
+  for (auto i{0}; i < 8; i++) {
+    Vector3 const corner{
+      i & 1 ? aabb_ws.max[0] : aabb_ws.min[0], i & 2 ? aabb_ws.max[1] : aabb_ws.min[1],
+      i & 4 ? aabb_ws.max[2] : aabb_ws.min[2]
+    };
+
+    auto const clip_pos{Vector4{corner, 1} * view_proj_mtx_};
+
+    // Boxes reaching behind the eye can't be projected reliably
+    if (clip_pos[3] < min_clip_w_) {
+      return true;
+    }
+
+    auto const inv_w{1.0f / clip_pos[3]};
+    Vector2 const screen_pos{(clip_pos[0] * inv_w + 1.0f) * half_width, (1.0f - clip_pos[1] * inv_w) * half_height};
+    min = Min(min, screen_pos);
+    max = Max(max, screen_pos);
+    nearest_depth = std::max(nearest_depth, clip_pos[2] * inv_w);
+  }
+
+  auto const first_x{std::max(static_cast<int>(std::floor(min[0])), 0)};
+  auto const first_y{std::max(static_cast<int>(std::floor(min[1])), 0)};
+  auto const last_x{std::min(static_cast<int>(std::floor(max[0])), width_ - 1)};
+  auto const last_y{std::min(static_cast<int>(std::floor(max[1])), height_ - 1)};
+
+  // Off-screen boxes are the business of frustum culling
+  if (first_x > last_x || first_y > last_y) {
+    return true;
+  }
+
+  // Pick the coarsest level needed for the rectangle to span at most two texels in each direction
+  std::size_t level{0};
+
+  while (level + 1 < depth_levels_.size() && ((last_x >> level) - (first_x >> level) > 1 || (last_y >> level) - (
+                                                first_y >> level) > 1)) {
+    level += 1;
+  }
+
+  auto const& [level_width, level_height, depths]{depth_levels_[level]};
+
+  for (auto y{first_y >> level}; y <= last_y >> level; y++) {
+    for (auto x{first_x >> level}; x <= last_x >> level; x++) {
+      if (nearest_depth >= depths[y * level_width + x]) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+
+auto SoftwareOcclusionCuller::GetWidth() const noexcept -> int {
+  return width_;
+}
+
+
+auto SoftwareOcclusionCuller::GetHeight() const noexcept -> int {
+  return height_;
+}
+
+
+auto SoftwareOcclusionCuller::GetDepthBuffer() const noexcept -> std::span<float const> {
+  return depth_levels_.front().depths;
+}
+
+
+auto SoftwareOcclusionCuller::DumpDepthBuffer(std::filesystem::path const& path) const -> bool {
+  std::ofstream out{path, std::ios::out | std::ios::binary};
+
+  if (!out.is_open()) {
+    return false;
+  }
+
+  out << "P5\n" << width_ << ' ' << height_ << "\n255\n";
+
+  for (auto const depth : depth_levels_.front().depths) {
+    out.put(static_cast<char>(static_cast<std::uint8_t>(std::clamp(depth, 0.0f, 1.0f) * 255.0f)));
+  }
+
+  return out.good();
+}
+
+
+auto SoftwareOcclusionCuller::RasterizeTile(int const tile_idx) -> void {
+  struct Edge {
+    float a;
+    float b;
+    float c;
+  };
+
+
+  auto const make_edge{
+    [](Vector3 const& from, Vector3 const& to) {
+      return Edge{from[1] - to[1], to[0] - from[0], from[0] * to[1] - from[1] * to[0]};
+    }
+  };
+
+  auto const tile_min_x{tile_idx % tile_count_x_ * tile_width_};
+  auto const tile_min_y{tile_idx / tile_count_x_ * tile_height_};
+  auto const depths{depth_levels_.front().depths.data()};
+
+  auto const lane_offsets{_mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f)};
+  auto const zero{_mm256_setzero_ps()};
+
+  for (auto const tri_idx : tile_bins_[tile_idx]) {
+    auto const& [v0, v1, v2]{triangles_[tri_idx]};
+
+    // Edge functions opposite to each vertex, their normalized values are the barycentric coordinates
+    std::array const edges{make_edge(v1, v2), make_edge(v2, v0), make_edge(v0, v1)};
+
+    auto const inv_area{1.0f / (edges[2].a * v2[0] + edges[2].b * v2[1] + edges[2].c)};
+    auto const depth_a{(v0[2] * edges[0].a + v1[2] * edges[1].a + v2[2] * edges[2].a) * inv_area};
+    auto const depth_b{(v0[2] * edges[0].b + v1[2] * edges[1].b + v2[2] * edges[2].b) * inv_area};
+    auto const depth_c{(v0[2] * edges[0].c + v1[2] * edges[1].c + v2[2] * edges[2].c) * inv_area};
+
+    // Tiles start at multiples of the SIMD width, so aligning the start keeps every span inside the tile
+    auto const min_x{
+      std::max(static_cast<int>(std::floor(std::min({v0[0], v1[0], v2[0]}))), tile_min_x) / simd_width_ * simd_width_
+    };
+    auto const min_y{std::max(static_cast<int>(std::floor(std::min({v0[1], v1[1], v2[1]}))), tile_min_y)};
+    auto const max_x{
+      std::min(static_cast<int>(std::ceil(std::max({v0[0], v1[0], v2[0]}))), tile_min_x + tile_width_ - 1)
+    };
+    auto const max_y{
+      std::min(static_cast<int>(std::ceil(std::max({v0[1], v1[1], v2[1]}))), tile_min_y + tile_height_ - 1)
+    };
+
+    auto const e0_a{_mm256_set1_ps(edges[0].a)};
+    auto const e1_a{_mm256_set1_ps(edges[1].a)};
+    auto const e2_a{_mm256_set1_ps(edges[2].a)};
+    auto const z_a{_mm256_set1_ps(depth_a)};
+
+    for (auto y{min_y}; y <= max_y; y++) {
+      auto const py{static_cast<float>(y) + 0.5f};
+      auto const e0_row{_mm256_set1_ps(edges[0].b * py + edges[0].c)};
+      auto const e1_row{_mm256_set1_ps(edges[1].b * py + edges[1].c)};
+      auto const e2_row{_mm256_set1_ps(edges[2].b * py + edges[2].c)};
+      auto const z_row{_mm256_set1_ps(depth_b * py + depth_c)};
+
+      for (auto x{min_x}; x <= max_x; x += simd_width_) {
+        auto const px{_mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), lane_offsets)};
+
+        auto const inside{
+          _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(_mm256_fmadd_ps(e0_a, px, e0_row), zero, _CMP_GE_OQ),
+              _mm256_cmp_ps(_mm256_fmadd_ps(e1_a, px, e1_row), zero, _CMP_GE_OQ)),
+            _mm256_cmp_ps(_mm256_fmadd_ps(e2_a, px, e2_row), zero, _CMP_GE_OQ))
+        };
+
+        if (_mm256_movemask_ps(inside) == 0) {
+          continue;
+        }
+
+        auto const dst{depths + static_cast<std::size_t>(y) * width_ + x};
+        auto const old_depth{_mm256_loadu_ps(dst)};
+        auto const new_depth{_mm256_max_ps(old_depth, _mm256_fmadd_ps(z_a, px, z_row))};
+        _mm256_storeu_ps(dst, _mm256_blendv_ps(old_depth, new_depth, inside));
+      }
+    }
+  }
+}
+
+
+auto SoftwareOcclusionCuller::BuildDepthPyramid() -> void {
+  for (std::size_t i{1}; i < depth_levels_.size(); i++) {
+    auto const& src{depth_levels_[i - 1]};
+    auto& dst{depth_levels_[i]};
+
+    for (auto y{0}; y < dst.height; y++) {
+      auto const src_y0{2 * y};
+      auto const src_y1{std::min(2 * y + 1, src.height - 1)};
+
+      for (auto x{0}; x < dst.width; x++) {
+        auto const src_x0{2 * x};
+        auto const src_x1{std::min(2 * x + 1, src.width - 1)};
+
+        dst.depths[y * dst.width + x] = std::min({
+          src.depths[src_y0 * src.width + src_x0], src.depths[src_y0 * src.width + src_x1],
+          src.depths[src_y1 * src.width + src_x0], src.depths[src_y1 * src.width + src_x1]
+        });
+      }
+    }
+  }
+}
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "../Bounds.hpp"
+#include "../Core.hpp"
+#include "../job_system.hpp"
+#include "../Math.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+
+namespace sorcery::rendering {
+// Rasterizes occluder triangles into a low resolution depth buffer on the CPU and tests bounding boxes against the
+// hierarchical depth pyramid built from it.
+// Depth follows the reversed-Z convention of the renderer, 1 is the near plane and 0 is the far plane.
+// Has no dependency on the graphics device, so it can be used headless.
+class SoftwareOcclusionCuller {
+public:
+  struct Occluder {
+    Matrix4 local_to_world_mtx;
+    std::span<Vector3 const> positions;
+    std::span<std::uint32_t const> indices; // Triangle list
+  };
+
+
+  // The dimensions are rounded up to a multiple of the tile size
+  LEOPPHAPI SoftwareOcclusionCuller(int width, int height);
+
+  LEOPPHAPI auto Resize(int width, int height) -> void;
+
+  // Clears the depth buffer, rasterizes the occluders as seen through the matrix, then rebuilds the depth pyramid.
+  // Triangles are binned into screen tiles and each tile is rasterized by a separate job.
+  LEOPPHAPI auto Render(Matrix4 const& view_proj_mtx, std::span<Occluder const> occluders,
+                        JobSystem& job_system) -> void;
+
+  // Returns false only if the bounds are certainly hidden behind the occluders of the last Render
+  [[nodiscard]] LEOPPHAPI auto IsVisible(AABB const& aabb_ws) const -> bool;
+
+  [[nodiscard]] LEOPPHAPI auto GetWidth() const noexcept -> int;
+  [[nodiscard]] LEOPPHAPI auto GetHeight() const noexcept -> int;
+  [[nodiscard]] LEOPPHAPI auto GetDepthBuffer() const noexcept -> std::span<float const>;
+
+  // Writes the depth buffer as a binary 8-bit PGM image for debugging
+  LEOPPHAPI auto DumpDepthBuffer(std::filesystem::path const& path) const -> bool;
+
+private:
+  struct ScreenTriangle {
+    Vector3 v0; // Pixel coordinates and depth
+    Vector3 v1;
+    Vector3 v2;
+  };
+
+
+  struct DepthLevel {
+    int width;
+    int height;
+    std::vector<float> depths; // Each texel holds the farthest depth of the texels it covers in the level below
+  };
+
+
+  auto RasterizeTile(int tile_idx) -> void;
+  auto BuildDepthPyramid() -> void;
+
+  constexpr static int tile_width_{32};
+  constexpr static int tile_height_{16};
+  constexpr static int simd_width_{8};
+  // Vertices closer to the eye than this in clip space are not projected
+  constexpr static float min_clip_w_{1e-4f};
+
+  int width_{0};
+  int height_{0};
+  int tile_count_x_{0};
+  int tile_count_y_{0};
+
+  Matrix4 view_proj_mtx_{Matrix4::Identity()};
+  bool has_occluders_{false};
+
+  std::vector<Vector4> clip_positions_;
+  std::vector<ScreenTriangle> triangles_;
+  std::vector<std::vector<unsigned>> tile_bins_;
+  std::vector<DepthLevel> depth_levels_; // The first level is the rasterized depth buffer
+};
+}
@@ -4,10 +4,11 @@
 #include "render_manager.hpp"
 
 #include <span>
+#include <type_traits>
 
 
 namespace sorcery::rendering {
-template<typename T> requires (sizeof(T) % 16 == 0)
+template<typename T> requires (sizeof(T) % 16 == 0 || std::is_arithmetic_v<T>)
 class StructuredBuffer {
 public:
   [[nodiscard]] static auto New(graphics::GraphicsDevice& device, RenderManager& render_manager,
@@ -2,38 +2,38 @@
 
 
 namespace sorcery::rendering {
-template<typename T> requires (sizeof(T) % 16 == 0)
+template<typename T> requires (sizeof(T) % 16 == 0 || std::is_arithmetic_v<T>)
 auto StructuredBuffer<T>::New(graphics::GraphicsDevice& device, RenderManager& render_manager,
                               bool const cpu_accessible) -> StructuredBuffer {
   return StructuredBuffer{device, render_manager, cpu_accessible};
 }
 
 
-template<typename T> requires (sizeof(T) % 16 == 0)
+template<typename T> requires (sizeof(T) % 16 == 0 || std::is_arithmetic_v<T>)
 auto StructuredBuffer<T>::GetBuffer() const noexcept -> graphics::SharedDeviceChildHandle<graphics::Buffer> const& {
   return buffer_;
 }
 
 
-template<typename T> requires (sizeof(T) % 16 == 0)
+template<typename T> requires (sizeof(T) % 16 == 0 || std::is_arithmetic_v<T>)
 auto StructuredBuffer<T>::GetData() const noexcept -> std::span<T> {
   return std::span<T>{mapped_ptr_, size_};
 }
 
 
-template<typename T> requires (sizeof(T) % 16 == 0)
+template<typename T> requires (sizeof(T) % 16 == 0 || std::is_arithmetic_v<T>)
 auto StructuredBuffer<T>::GetSize() const -> UINT {
   return size_;
 }
 
 
-template<typename T> requires (sizeof(T) % 16 == 0)
+template<typename T> requires (sizeof(T) % 16 == 0 || std::is_arithmetic_v<T>)
 auto StructuredBuffer<T>::GetCapacity() const -> UINT {
   return capacity_;
 }
 
 
-template<typename T> requires (sizeof(T) % 16 == 0)
+template<typename T> requires (sizeof(T) % 16 == 0 || std::is_arithmetic_v<T>)
 auto StructuredBuffer<T>::Resize(UINT const new_size) -> void {
   auto new_capacity = capacity_;
 
@@ -51,7 +51,7 @@ auto StructuredBuffer<T>::Resize(UINT const new_size) -> void {
 }
 
 
-template<typename T> requires (sizeof(T) % 16 == 0)
+template<typename T> requires (sizeof(T) % 16 == 0 || std::is_arithmetic_v<T>)
 StructuredBuffer<T>::StructuredBuffer(graphics::GraphicsDevice& device, RenderManager& render_manager,
                                       bool const cpu_accessible) :
   device_{&device},
@@ -61,7 +61,7 @@ StructuredBuffer<T>::StructuredBuffer(graphics::GraphicsDevice& device, RenderMa
 }
 
 
-template<typename T> requires (sizeof(T) % 16 == 0)
+template<typename T> requires (sizeof(T) % 16 == 0 || std::is_arithmetic_v<T>)
 auto StructuredBuffer<T>::RecreateBuffer() -> void {
   if (buffer_) {
     render_manager_->KeepAliveWhileInUse(buffer_);
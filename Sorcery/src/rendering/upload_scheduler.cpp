@@ -0,0 +1,204 @@
+#include "upload_scheduler.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+
+namespace sorcery::rendering {
+UploadScheduler::UploadScheduler(std::uint64_t const capacity) :
+  capacity_{capacity} {
+  if (capacity == 0) {
+    throw std::runtime_error{"Upload scheduler capacity must not be 0."};
+  }
+}
+
+
+auto UploadScheduler::AllocateStaging(std::uint64_t const size,
+                                      std::uint64_t const alignment) -> std::optional<std::uint64_t> {
+  assert(std::has_single_bit(alignment) && capacity_ % alignment == 0);
+
+  if (size > capacity_) {
+    return std::nullopt;
+  }
+
+  // An empty ring restarts from its beginning so that everything up to the capacity fits
+  if (head_ == tail_) {
+    head_ = (head_ + capacity_ - 1) / capacity_ * capacity_;
+    tail_ = head_;
+  }
+
+  auto start{(head_ + alignment - 1) & ~(alignment - 1)};
+
+  // Allocations are contiguous, so those that would wrap around start at the beginning of the ring instead
+  if (start / capacity_ != (start + size - 1) / capacity_) {
+    start = (start / capacity_ + 1) * capacity_;
+  }
+
+  if (start + size - tail_ > capacity_) {
+    return std::nullopt;
+  }
+
+  head_ = start + size;
+  return start % capacity_;
+}
+
+
+auto UploadScheduler::ScheduleBufferWrite(std::shared_ptr<void const> dst, std::uint64_t const dst_offset,
+                                          std::span<std::byte const> const data) -> void {
+  buffer_writes_.emplace_back(std::move(dst), dst_offset, buffer_write_data_.size(), data.size(), 0);
+  buffer_write_data_.insert(buffer_write_data_.end(), data.begin(), data.end());
+}
+
+
+auto UploadScheduler::ScheduleTextureCopy(TextureCopy copy) -> void {
+  texture_copies_.emplace_back(std::move(copy));
+}
+
+
+auto UploadScheduler::GetScheduledBufferWriteSize() const noexcept -> std::uint64_t {
+  return buffer_write_data_.size();
+}
+
+
+auto UploadScheduler::HasScheduledWrites() const noexcept -> bool {
+  return !buffer_writes_.empty() || !texture_copies_.empty();
+}
+
+
+auto UploadScheduler::CoalesceWrites() -> void {
+  tmp_order_.resize(buffer_writes_.size());
+  std::iota(tmp_order_.begin(), tmp_order_.end(), std::size_t{0});
+
+  std::ranges::sort(tmp_order_, [this](std::size_t const lhs, std::size_t const rhs) {
+    auto const& left{buffer_writes_[lhs]};
+    auto const& right{buffer_writes_[rhs]};
+
+    if (left.dst != right.dst) {
+      return std::less{}(left.dst.get(), right.dst.get());
+    }
+
+    return left.dst_offset < right.dst_offset;
+  });
+
+  buffer_copies_.clear();
+  coalesced_buffer_data_size_ = 0;
+
+  // The copies are laid out one after the other in the coalesced data, each write taking the place of its range
+  for (auto const idx : tmp_order_) {
+    auto& write{buffer_writes_[idx]};
+
+    if (buffer_copies_.empty() || buffer_copies_.back().dst != write.dst ||
+        buffer_copies_.back().dst_offset + buffer_copies_.back().size < write.dst_offset) {
+      buffer_copies_.emplace_back(write.dst, write.dst_offset, coalesced_buffer_data_size_, 0);
+    }
+
+    auto& copy{buffer_copies_.back()};
+    copy.size = std::max(copy.size, write.dst_offset + write.size - copy.dst_offset);
+    write.coalesced_data_offset = copy.src_offset + write.dst_offset - copy.dst_offset;
+    coalesced_buffer_data_size_ = copy.src_offset + copy.size;
+  }
+
+  tmp_order_.resize(texture_copies_.size());
+  std::iota(tmp_order_.begin(), tmp_order_.end(), std::size_t{0});
+
+  std::ranges::sort(tmp_order_, [this](std::size_t const lhs, std::size_t const rhs) {
+    auto const& left{texture_copies_[lhs]};
+    auto const& right{texture_copies_[rhs]};
+
+    if (left.dst != right.dst) {
+      return std::less{}(left.dst.get(), right.dst.get());
+    }
+
+    if (left.dst_subresource_index != right.dst_subresource_index) {
+      return left.dst_subresource_index < right.dst_subresource_index;
+    }
+
+    return lhs < rhs;
+  });
+
+  tmp_texture_copies_.clear();
+
+  for (std::size_t i{0}; i < tmp_order_.size(); i++) {
+    auto& copy{texture_copies_[tmp_order_[i]]};
+
+    // Only the last copy to a subresource survives
+    if (i + 1 < tmp_order_.size()) {
+      if (auto const& next{texture_copies_[tmp_order_[i + 1]]};
+        next.dst == copy.dst && next.dst_subresource_index == copy.dst_subresource_index) {
+        continue;
+      }
+    }
+
+    tmp_texture_copies_.emplace_back(std::move(copy));
+  }
+
+  std::swap(texture_copies_, tmp_texture_copies_);
+  // The scratch vector must not keep the destinations alive
+  tmp_texture_copies_.clear();
+}
+
+
+auto UploadScheduler::GetCoalescedBufferCopies() const noexcept -> std::span<BufferCopy const> {
+  return buffer_copies_;
+}
+
+
+auto UploadScheduler::GetCoalescedBufferDataSize() const noexcept -> std::uint64_t {
+  return coalesced_buffer_data_size_;
+}
+
+
+auto UploadScheduler::WriteCoalescedBufferData(std::span<std::byte> const dst) const -> void {
+  assert(dst.size() >= coalesced_buffer_data_size_);
+
+  // Writing in the order of scheduling lets later writes overwrite the ranges of earlier ones
+  for (auto const& write : buffer_writes_) {
+    std::memcpy(dst.data() + write.coalesced_data_offset, buffer_write_data_.data() + write.data_offset, write.size);
+  }
+}
+
+
+auto UploadScheduler::GetCoalescedTextureCopies() const noexcept -> std::span<TextureCopy const> {
+  return texture_copies_;
+}
+
+
+auto UploadScheduler::EndBatch(std::uint64_t const batch_id) -> void {
+  assert(batches_.empty() || batches_.back().id < batch_id);
+  batches_.emplace_back(batch_id, head_);
+  buffer_writes_.clear();
+  buffer_write_data_.clear();
+  buffer_copies_.clear();
+  coalesced_buffer_data_size_ = 0;
+  texture_copies_.clear();
+}
+
+
+auto UploadScheduler::ReleaseBatches(std::uint64_t const completed_batch_id) -> void {
+  while (!batches_.empty() && batches_.front().id <= completed_batch_id) {
+    // Batches without staging memory can end before the restarted tail
+    tail_ = std::max(tail_, batches_.front().end);
+    batches_.pop_front();
+  }
+}
+
+
+auto UploadScheduler::GetOldestBatch() const noexcept -> std::optional<std::uint64_t> {
+  if (batches_.empty()) {
+    return std::nullopt;
+  }
+
+  return batches_.front().id;
+}
+
+
+auto UploadScheduler::GetCapacity() const noexcept -> std::uint64_t {
+  return capacity_;
+}
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "../Core.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+
+namespace sorcery::rendering {
+// Collects the writes of uploads until they are submitted together as a batch.
+// Buffer writes are kept in CPU memory and coalesced per destination at submission, so that writes to the same buffer
+// become as few copies as possible regardless of what was written in between. Texture data is placed in a ring of
+// staging memory right away. The staging memory of a batch is reused once the batch completed.
+// Has no dependency on the graphics device, so it can be used headless.
+class UploadScheduler {
+public:
+  struct BufferCopy {
+    std::shared_ptr<void const> dst; // Kept alive until the copy is submitted, otherwise only compared
+    std::uint64_t dst_offset;
+    std::uint64_t src_offset; // Into the coalesced buffer data
+    std::uint64_t size;
+  };
+
+
+  // Layout of the subresource data in the staging memory, only passed through
+  struct TextureFootprint {
+    std::uint32_t format;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t depth;
+    std::uint32_t row_pitch;
+  };
+
+
+  // Copies whole subresources
+  struct TextureCopy {
+    std::shared_ptr<void const> dst; // Kept alive until the copy is submitted, otherwise only compared
+    std::uint32_t dst_subresource_index;
+    std::uint64_t src_offset;
+    TextureFootprint src_footprint;
+  };
+
+
+  // The capacity must be a multiple of every alignment requested from the ring
+  LEOPPHAPI explicit UploadScheduler(std::uint64_t capacity);
+
+  // Returns the offset of the staging memory, or nullopt if it only fits after earlier batches complete.
+  // The alignment must be a power of 2.
+  [[nodiscard]] LEOPPHAPI auto AllocateStaging(std::uint64_t size,
+                                               std::uint64_t alignment) -> std::optional<std::uint64_t>;
+
+  // The data is copied
+  LEOPPHAPI auto ScheduleBufferWrite(std::shared_ptr<void const> dst, std::uint64_t dst_offset,
+                                     std::span<std::byte const> data) -> void;
+  LEOPPHAPI auto ScheduleTextureCopy(TextureCopy copy) -> void;
+  // Size of the data of the buffer writes scheduled in the current batch
+  [[nodiscard]] LEOPPHAPI auto GetScheduledBufferWriteSize() const noexcept -> std::uint64_t;
+  [[nodiscard]] LEOPPHAPI auto HasScheduledWrites() const noexcept -> bool;
+
+  // Merges the buffer writes of each destination that overlap or touch into single copies, and drops the texture
+  // copies to subresources that are written again later. Where writes overlap, the later one wins.
+  LEOPPHAPI auto CoalesceWrites() -> void;
+  // These are valid after coalescing
+  [[nodiscard]] LEOPPHAPI auto GetCoalescedBufferCopies() const noexcept -> std::span<BufferCopy const>;
+  [[nodiscard]] LEOPPHAPI auto GetCoalescedBufferDataSize() const noexcept -> std::uint64_t;
+  // Lays out the data that the coalesced buffer copies read, the destination must be as large as the data
+  LEOPPHAPI auto WriteCoalescedBufferData(std::span<std::byte> dst) const -> void;
+  [[nodiscard]] LEOPPHAPI auto GetCoalescedTextureCopies() const noexcept -> std::span<TextureCopy const>;
+
+  // Hands the scheduled writes and the staging memory allocated since the previous batch to the batch with the id.
+  // Ids must increase from batch to batch.
+  LEOPPHAPI auto EndBatch(std::uint64_t batch_id) -> void;
+  // Frees the staging memory of the batches with ids up to the completed one
+  LEOPPHAPI auto ReleaseBatches(std::uint64_t completed_batch_id) -> void;
+  // The batch whose completion frees staging memory first
+  [[nodiscard]] LEOPPHAPI auto GetOldestBatch() const noexcept -> std::optional<std::uint64_t>;
+
+  [[nodiscard]] LEOPPHAPI auto GetCapacity() const noexcept -> std::uint64_t;
+
+private:
+  struct Batch {
+    std::uint64_t id;
+    std::uint64_t end;
+  };
+
+
+  struct BufferWrite {
+    std::shared_ptr<void const> dst;
+    std::uint64_t dst_offset;
+    std::uint64_t data_offset;
+    std::uint64_t size;
+    std::uint64_t coalesced_data_offset;
+  };
+
+
+  std::uint64_t capacity_;
+  // Positions increase monotonically, the offset in the ring is their remainder by the capacity
+  std::uint64_t head_{0};
+  std::uint64_t tail_{0};
+  std::deque<Batch> batches_;
+
+  std::vector<BufferWrite> buffer_writes_;
+  std::vector<std::byte> buffer_write_data_;
+  std::vector<BufferCopy> buffer_copies_;
+  std::uint64_t coalesced_buffer_data_size_{0};
+  std::vector<TextureCopy> texture_copies_;
+
+  std::vector<std::size_t> tmp_order_;
+  std::vector<TextureCopy> tmp_texture_copies_;
+};
+}
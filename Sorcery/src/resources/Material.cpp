@@ -25,7 +25,8 @@ RTTR_REGISTRATION {
       &sorcery::Material::GetMetallicMap, &sorcery::Material::SetMetallicMap).property("roughnessMap",
       &sorcery::Material::GetRoughnessMap, &sorcery::Material::SetRoughnessMap).property("aoMap",
       &sorcery::Material::GetAoMap, &sorcery::Material::SetAoMap).property("normalMap",
-      &sorcery::Material::GetNormalMap, &sorcery::Material::SetNormalMap);
+      &sorcery::Material::GetNormalMap, &sorcery::Material::SetNormalMap).property("castsShadow",
+      &sorcery::Material::IsCastingShadow, &sorcery::Material::SetCastingShadow);
 }
 
 
@@ -38,6 +39,7 @@ Material::Material() :
 
 Material::~Material() {
   App::Instance().GetRenderManager().KeepAliveWhileInUse(cb_.GetBuffer());
+  App::Instance().GetSceneRenderer().NotifyDestroyed(*this);
 }
 
 
@@ -195,10 +197,24 @@ auto Material::SetOpacityMask(Texture2D* const opacityMask) noexcept -> void {
 }
 
 
+auto Material::IsCastingShadow() const noexcept -> bool {
+  return casts_shadow_;
+}
+
+
+auto Material::SetCastingShadow(bool const castShadow) noexcept -> void {
+  casts_shadow_ = castShadow;
+  App::Instance().GetSceneRenderer().NotifyChanged(*this);
+}
+
+
 auto Material::Update() const -> void {
-  App::Instance().GetRenderManager().UpdateBuffer(*cb_.GetBuffer(), 0, std::span{
+  App::Instance().GetRenderManager().UpdateBuffer(cb_.GetBuffer(), 0, std::span{
     std::bit_cast<std::byte const*>(&mShaderMtl), sizeof(mShaderMtl)
   });
+
+  // Cached shadow maps are only drawn again for changed materials
+  App::Instance().GetSceneRenderer().NotifyChanged(*this);
 }
 
 
@@ -216,6 +232,7 @@ auto Material::Serialize() const noexcept -> YAML::Node {
   ret["ao"] = GetAo();
   ret["blendMode"] = static_cast<int>(GetBlendMode());
   ret["alphaThresh"] = GetAlphaThreshold();
+  ret["castsShadow"] = IsCastingShadow();
 
   auto const albedoMap{GetAlbedoMap()};
   ret["albedoMap"] = albedoMap ? albedoMap->GetGuid() : Guid::Invalid();
@@ -246,6 +263,7 @@ auto Material::Deserialize(YAML::Node const& yamlNode) noexcept -> void {
   SetAo(yamlNode["ao"].as<float>(GetAo()));
   SetBlendMode(static_cast<BlendMode>(yamlNode["blendMode"].as<int>(static_cast<int>(GetBlendMode()))));
   SetAlphaThreshold(yamlNode["alphaThresh"].as<float>(GetAlphaThreshold()));
+  SetCastingShadow(yamlNode["castsShadow"].as<bool>(IsCastingShadow()));
 
   struct JobData {
     Guid guid;
@@ -420,6 +438,14 @@ auto Material::OnDrawProperties(bool& changed) -> void {
       changed = true;
     }
 
+    ImGui::TableNextColumn();
+    ImGui::Text("%s", "Cast Shadow");
+    ImGui::TableNextColumn();
+    if (bool castsShadow{IsCastingShadow()}; ImGui::Checkbox("##matCastsShadow", &castsShadow)) {
+      SetCastingShadow(castsShadow);
+      changed = true;
+    }
+
     ImGui::TableNextColumn();
     ImGui::Text("%s", "Blend Mode");
     ImGui::TableNextColumn();
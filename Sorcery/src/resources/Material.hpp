@@ -36,6 +36,8 @@ private:
   Texture2D* normal_map_{nullptr};
   Texture2D* opacity_mask_{nullptr};
 
+  bool casts_shadow_{true};
+
 public:
   LEOPPHAPI auto OnDrawProperties(bool& changed) -> void override;
 
@@ -90,6 +92,10 @@ public:
   [[nodiscard]] LEOPPHAPI auto GetOpacityMask() const noexcept -> Texture2D*;
   LEOPPHAPI auto SetOpacityMask(Texture2D* opacityMask) noexcept -> void;
 
+  // Submeshes using materials that do not cast shadows are skipped by all shadow passes
+  [[nodiscard]] LEOPPHAPI auto IsCastingShadow() const noexcept -> bool;
+  LEOPPHAPI auto SetCastingShadow(bool castShadow) noexcept -> void;
+
   LEOPPHAPI auto Update() const -> void;
 
   [[nodiscard]] LEOPPHAPI auto GetBuffer() const noexcept -> graphics::SharedDeviceChildHandle<graphics::Buffer> const&;
@@ -28,7 +28,7 @@ auto Mesh::UploadToGpu() noexcept -> void {
   }, D3D12_HEAP_TYPE_DEFAULT);
   assert(pos_buf_);
 
-  App::Instance().GetRenderManager().UpdateBuffer(*pos_buf_, 0, as_bytes(std::span{positions4}));
+  App::Instance().GetRenderManager().UpdateBuffer(pos_buf_, 0, as_bytes(std::span{positions4}));
 
   std::vector<Vector4> normals4{m_cpu_data_->normals.size()};
   std::ranges::transform(m_cpu_data_->normals, normals4.begin(), [](Vector3 const& n) {
@@ -40,7 +40,7 @@ auto Mesh::UploadToGpu() noexcept -> void {
   }, D3D12_HEAP_TYPE_DEFAULT);
   assert(norm_buf_);
 
-  App::Instance().GetRenderManager().UpdateBuffer(*norm_buf_, 0, as_bytes(std::span{normals4}));
+  App::Instance().GetRenderManager().UpdateBuffer(norm_buf_, 0, as_bytes(std::span{normals4}));
 
   std::vector<Vector4> tangents4{m_cpu_data_->tangents.size()};
   std::ranges::transform(m_cpu_data_->tangents, tangents4.begin(), [](Vector3 const& t) {
@@ -52,14 +52,14 @@ auto Mesh::UploadToGpu() noexcept -> void {
   }, D3D12_HEAP_TYPE_DEFAULT);
   assert(norm_buf_);
 
-  App::Instance().GetRenderManager().UpdateBuffer(*tan_buf_, 0, as_bytes(std::span{tangents4}));
+  App::Instance().GetRenderManager().UpdateBuffer(tan_buf_, 0, as_bytes(std::span{tangents4}));
 
   uv_buf_ = App::Instance().GetGraphicsDevice().CreateBuffer(graphics::BufferDesc{
     static_cast<UINT>(m_cpu_data_->uvs.size() * sizeof(Vector2)), sizeof(Vector2), false, true, false
   }, D3D12_HEAP_TYPE_DEFAULT);
   assert(uv_buf_);
 
-  App::Instance().GetRenderManager().UpdateBuffer(*uv_buf_, 0, as_bytes(std::span{m_cpu_data_->uvs}));
+  App::Instance().GetRenderManager().UpdateBuffer(uv_buf_, 0, as_bytes(std::span{m_cpu_data_->uvs}));
 
   if (!m_cpu_data_->bone_weights.empty()) {
     bone_weight_buf_ = App::Instance().GetGraphicsDevice().CreateBuffer(graphics::BufferDesc{
@@ -67,7 +67,7 @@ auto Mesh::UploadToGpu() noexcept -> void {
     }, D3D12_HEAP_TYPE_DEFAULT);
     assert(bone_weight_buf_);
 
-    App::Instance().GetRenderManager().UpdateBuffer(*bone_weight_buf_, 0,
+    App::Instance().GetRenderManager().UpdateBuffer(bone_weight_buf_, 0,
       as_bytes(std::span{m_cpu_data_->bone_weights}));
   } else {
     bone_weight_buf_ = nullptr;
@@ -80,7 +80,7 @@ auto Mesh::UploadToGpu() noexcept -> void {
     }, D3D12_HEAP_TYPE_DEFAULT);
     assert(bone_idx_buf_);
 
-    App::Instance().GetRenderManager().UpdateBuffer(*bone_idx_buf_, 0, as_bytes(std::span{m_cpu_data_->bone_indices}));
+    App::Instance().GetRenderManager().UpdateBuffer(bone_idx_buf_, 0, as_bytes(std::span{m_cpu_data_->bone_indices}));
   } else {
     bone_idx_buf_ = nullptr;
   }
@@ -112,7 +112,7 @@ auto Mesh::UploadToGpu() noexcept -> void {
     D3D12_HEAP_TYPE_DEFAULT);
   assert(idx_buf_);
 
-  App::Instance().GetRenderManager().UpdateBuffer(*idx_buf_, 0, std::span{
+  App::Instance().GetRenderManager().UpdateBuffer(idx_buf_, 0, std::span{
     std::bit_cast<std::byte const*>(idxBufDataPtr), idxBufSize
   });
 }
@@ -149,6 +149,44 @@ auto Mesh::CalculateBounds() noexcept -> void {
 }
 
 
+auto Mesh::CalculateSubmeshBones() -> void {
+  auto const& bone_weights{m_cpu_data_->bone_weights};
+  auto const& bone_indices{m_cpu_data_->bone_indices};
+
+  if (bone_indices.empty() || bone_weights.size() != bone_indices.size()) {
+    submesh_bones_ = nullptr;
+    return;
+  }
+
+  std::vector<std::vector<std::uint32_t>> submesh_bones;
+
+  for (auto const& submeshInfo : m_submeshes_) {
+    auto& bones{submesh_bones.emplace_back()};
+
+    for (auto i{0}; i < submeshInfo.index_count; i++) {
+      std::uint32_t const idx{
+        m_idx_format_ == DXGI_FORMAT_R16_UINT
+          ? m_cpu_data_->indices16[i + submeshInfo.first_index]
+          : m_cpu_data_->indices32[i + submeshInfo.first_index]
+      };
+      auto const vertex_idx{idx + submeshInfo.base_vertex};
+
+      for (auto j{0}; j < 4; j++) {
+        if (bone_weights[vertex_idx][j] > 0) {
+          bones.emplace_back(bone_indices[vertex_idx][j]);
+        }
+      }
+    }
+
+    std::ranges::sort(bones);
+    auto const [unique_end, bones_end]{std::ranges::unique(bones)};
+    bones.erase(unique_end, bones_end);
+  }
+
+  submesh_bones_ = std::make_shared<std::vector<std::vector<std::uint32_t>> const>(std::move(submesh_bones));
+}
+
+
 auto Mesh::EnsureCpuMemory() noexcept -> void {
   if (!m_cpu_data_) {
     m_cpu_data_ = std::make_unique<GeometryData>();
@@ -182,6 +220,7 @@ Mesh::~Mesh() {
   App::Instance().GetRenderManager().KeepAliveWhileInUse(bone_weight_buf_);
   App::Instance().GetRenderManager().KeepAliveWhileInUse(bone_idx_buf_);
   App::Instance().GetRenderManager().KeepAliveWhileInUse(idx_buf_);
+  App::Instance().GetSceneRenderer().NotifyDestroyed(*this);
 }
 
 
@@ -370,48 +409,79 @@ auto Mesh::SetSubmeshes(std::vector<SubMeshInfo>&& submeshes) noexcept -> void {
 }
 
 
-auto Mesh::GetAnimations() const noexcept -> std::span<Animation const> {
+auto Mesh::GetAnimations() const noexcept -> std::span<std::shared_ptr<Animation const> const> {
   return animations_;
 }
 
 
 auto Mesh::SetAnimations(std::span<Animation const> const animations) noexcept -> void {
-  animations_.assign(std::begin(animations), std::end(animations));
+  animations_.clear();
+
+  for (auto const& animation : animations) {
+    animations_.emplace_back(std::make_shared<Animation const>(animation));
+  }
 }
 
 
 auto Mesh::SetAnimations(std::vector<Animation>&& animations) noexcept -> void {
-  animations_ = std::move(animations);
+  animations_.clear();
+
+  for (auto& animation : animations) {
+    animations_.emplace_back(std::make_shared<Animation const>(std::move(animation)));
+  }
 }
 
 
 auto Mesh::GetSkeleton() const noexcept -> std::span<SkeletonNode const> {
+  return skeleton_ ? std::span{*skeleton_} : std::span<SkeletonNode const>{};
+}
+
+
+auto Mesh::GetSharedSkeleton() const noexcept -> std::shared_ptr<std::vector<SkeletonNode> const> const& {
   return skeleton_;
 }
 
 
 auto Mesh::SetSkeleton(std::span<SkeletonNode const> const skeleton) noexcept -> void {
-  skeleton_.assign(std::begin(skeleton), std::end(skeleton));
+  skeleton_ = std::make_shared<std::vector<SkeletonNode> const>(std::begin(skeleton), std::end(skeleton));
+  bind_pose_ = std::make_shared<LocalPose const>(CalculateBindPose(*skeleton_));
 }
 
 
 auto Mesh::SetSkeleton(std::vector<SkeletonNode>&& skeleton) noexcept -> void {
-  skeleton_ = std::move(skeleton);
+  skeleton_ = std::make_shared<std::vector<SkeletonNode> const>(std::move(skeleton));
+  bind_pose_ = std::make_shared<LocalPose const>(CalculateBindPose(*skeleton_));
+}
+
+
+auto Mesh::GetSharedBindPose() const noexcept -> std::shared_ptr<LocalPose const> const& {
+  return bind_pose_;
 }
 
 
 auto Mesh::GetBones() const noexcept -> std::span<Bone const> {
+  return bones_ ? std::span{*bones_} : std::span<Bone const>{};
+}
+
+
+auto Mesh::GetSharedBones() const noexcept -> std::shared_ptr<std::vector<Bone> const> const& {
   return bones_;
 }
 
 
 auto Mesh::SetBones(std::span<Bone const> bones) noexcept -> void {
-  bones_.assign(std::begin(bones), std::end(bones));
+  bones_ = std::make_shared<std::vector<Bone> const>(std::begin(bones), std::end(bones));
 }
 
 
 auto Mesh::SetBones(std::vector<Bone>&& bones) noexcept -> void {
-  bones_ = std::move(bones);
+  bones_ = std::make_shared<std::vector<Bone> const>(std::move(bones));
+}
+
+
+auto Mesh::GetSharedSubmeshBones() const noexcept -> std::shared_ptr<std::vector<std::vector<std::uint32_t>> const>
+  const& {
+  return submesh_bones_;
 }
 
 
@@ -505,7 +575,9 @@ auto Mesh::ValidateAndUpdate(bool const keep_data_in_cpu_memory) noexcept -> boo
   m_submesh_count_ = static_cast<int>(std::ssize(m_submeshes_));
 
   CalculateBounds();
+  CalculateSubmeshBones();
   UploadToGpu();
+  App::Instance().GetSceneRenderer().NotifyChanged(*this);
 
   if (!keep_data_in_cpu_memory) {
     ReleaseCpuMemory();
@@ -9,53 +9,13 @@
 #include <vector>
 
 #include "Resource.hpp"
+#include "../animation.hpp"
 #include "../Bounds.hpp"
 #include "../Math.hpp"
 #include "../rendering/graphics.hpp"
 
 
 namespace sorcery {
-struct SkeletonNode {
-  std::string name;
-  Matrix4 transform;
-  std::optional<std::uint32_t> parent_idx;
-};
-
-
-struct Bone {
-  Matrix4 offset_mtx;
-  std::uint32_t skeleton_node_idx;
-};
-
-
-template<typename T>
-struct AnimationKey {
-  float timestamp;
-  T value;
-};
-
-
-using PositionKey = AnimationKey<Vector3>;
-using RotationKey = AnimationKey<Quaternion>;
-using ScalingKey = AnimationKey<Vector3>;
-
-
-struct NodeAnimation {
-  std::vector<PositionKey> position_keys;
-  std::vector<RotationKey> rotation_keys;
-  std::vector<ScalingKey> scaling_keys;
-  std::uint32_t node_idx;
-};
-
-
-struct Animation {
-  std::string name;
-  float duration;
-  float ticks_per_second;
-  std::vector<NodeAnimation> node_anims;
-};
-
-
 class Mesh final : public Resource {
   RTTR_ENABLE(Resource)
   struct GeometryData {
@@ -103,9 +63,14 @@ private:
   std::unique_ptr<GeometryData> m_cpu_data_{nullptr};
   std::vector<SubMeshInfo> m_submeshes_;
   std::vector<MaterialSlotInfo> m_mtl_slots_;
-  std::vector<Animation> animations_;
-  std::vector<SkeletonNode> skeleton_;
-  std::vector<Bone> bones_;
+  // Animation data is immutable once set so that it can be shared with the renderer without copying
+  std::vector<std::shared_ptr<Animation const>> animations_;
+  std::shared_ptr<std::vector<SkeletonNode> const> skeleton_;
+  // Decomposed once so that animation layers can be blended onto it
+  std::shared_ptr<LocalPose const> bind_pose_;
+  std::shared_ptr<std::vector<Bone> const> bones_;
+  // Sorted indices of the bones the vertices of each submesh are weighted to, null if the mesh is not skinned
+  std::shared_ptr<std::vector<std::vector<std::uint32_t>> const> submesh_bones_;
   AABB m_bounds_{};
   graphics::SharedDeviceChildHandle<graphics::Buffer> pos_buf_;
   graphics::SharedDeviceChildHandle<graphics::Buffer> norm_buf_;
@@ -121,6 +86,7 @@ private:
 
   auto UploadToGpu() noexcept -> void;
   auto CalculateBounds() noexcept -> void;
+  auto CalculateSubmeshBones() -> void;
   auto EnsureCpuMemory() noexcept -> void;
   auto Set16BitIndicesFrom32BitBuffer(std::span<std::uint32_t const> indices) noexcept -> void;
 
@@ -175,17 +141,24 @@ public:
   LEOPPHAPI auto SetSubMeshes(std::span<SubMeshInfo const> submeshes) noexcept -> void;
   LEOPPHAPI auto SetSubmeshes(std::vector<SubMeshInfo>&& submeshes) noexcept -> void;
 
-  [[nodiscard]] LEOPPHAPI auto GetAnimations() const noexcept -> std::span<Animation const>;
+  [[nodiscard]] LEOPPHAPI auto GetAnimations() const noexcept -> std::span<std::shared_ptr<Animation const> const>;
   LEOPPHAPI auto SetAnimations(std::span<Animation const> animations) noexcept -> void;
   LEOPPHAPI auto SetAnimations(std::vector<Animation>&& animations) noexcept -> void;
 
   [[nodiscard]] LEOPPHAPI auto GetSkeleton() const noexcept -> std::span<SkeletonNode const>;
+  [[nodiscard]] LEOPPHAPI auto GetSharedSkeleton() const noexcept -> std::shared_ptr<std::vector<SkeletonNode> const>
+    const&;
   LEOPPHAPI auto SetSkeleton(std::span<SkeletonNode const> skeleton) noexcept -> void;
   LEOPPHAPI auto SetSkeleton(std::vector<SkeletonNode>&& skeleton) noexcept -> void;
+  [[nodiscard]] LEOPPHAPI auto GetSharedBindPose() const noexcept -> std::shared_ptr<LocalPose const> const&;
 
   [[nodiscard]] LEOPPHAPI auto GetBones() const noexcept -> std::span<Bone const>;
+  [[nodiscard]] LEOPPHAPI auto GetSharedBones() const noexcept -> std::shared_ptr<std::vector<Bone> const> const&;
   LEOPPHAPI auto SetBones(std::span<Bone const> bones) noexcept -> void;
   LEOPPHAPI auto SetBones(std::vector<Bone>&& bones) noexcept -> void;
+  // Calculated from the bone weights and indices when the data is validated
+  [[nodiscard]] LEOPPHAPI auto GetSharedSubmeshBones() const noexcept -> std::shared_ptr<std::vector<
+    std::vector<std::uint32_t>> const> const&;
 
   [[nodiscard]] LEOPPHAPI auto GetBounds() const noexcept -> AABB const&;
 
@@ -1,6 +1,7 @@
 #include "Scene.hpp"
 
 #include "../app.hpp"
+#include "../bvh.hpp"
 #include "../Platform.hpp"
 #include "../Serialization.hpp"
 #include "../scene_objects/SceneObject.hpp"
@@ -140,6 +141,28 @@ auto Scene::Save() -> void {
     sceneObjNode["properties"] = ReflectionSerializeToYaml(*sceneObj, extensionFunc);
     yaml_data_["sceneObjects"].push_back(sceneObjNode);
   }
+
+  // Store the hierarchy over the static submesh instances so that it doesn't have to be built after loading.
+  // It is only usable if all of its instances belong to this scene.
+
+  auto const& scene_renderer{App::Instance().GetSceneRenderer()};
+
+  if (auto const bvh_keys{scene_renderer.GetStaticSubmeshInstanceKeys()}; !bvh_keys.empty() && std::ranges::all_of(
+        bvh_keys, [](rendering::SceneRenderer::StaticSubmeshInstanceKey const& key) {
+          return ptrFixUp.contains(static_cast<SceneObject const*>(key.component));
+        })) {
+    auto bvh_node{scene_renderer.GetStaticSubmeshInstanceBvh().Serialize()};
+
+    for (auto const& [component, submesh_idx] : bvh_keys) {
+      YAML::Node key_node;
+      key_node.SetStyle(YAML::EmitterStyle::Flow);
+      key_node.push_back(ptrFixUp[static_cast<SceneObject const*>(component)]);
+      key_node.push_back(submesh_idx);
+      bvh_node["keys"].push_back(key_node);
+    }
+
+    yaml_data_["staticSubmeshInstanceBvh"] = bvh_node;
+  }
 }
 
 
@@ -300,6 +323,28 @@ auto Scene::Load() -> void {
       AddEntity(std::unique_ptr<Entity>{entity});
     }
   }
+
+  // Pass the stored static submesh instance hierarchy to the renderer, which validates it during extraction
+
+  if (auto const bvh_node{yaml_data_["staticSubmeshInstanceBvh"]}) {
+    if (Bvh bvh; bvh.Deserialize(bvh_node)) {
+      std::vector<rendering::SceneRenderer::StaticSubmeshInstanceKey> bvh_keys;
+
+      for (auto const& key_node : bvh_node["keys"]) {
+        if (!key_node.IsSequence() || key_node.size() != 2) {
+          break;
+        }
+
+        if (auto const it{ptr_fix_up.find(key_node[0].as<int>(0))}; it != std::end(ptr_fix_up)) {
+          bvh_keys.emplace_back(rttr::rttr_cast<MeshComponentBase*>(it->second), key_node[1].as<int>(0));
+        }
+      }
+
+      if (bvh_keys.size() == bvh.GetPrimitiveCount()) {
+        App::Instance().GetSceneRenderer().SetStaticSubmeshInstanceBvh(std::move(bvh), std::move(bvh_keys));
+      }
+    }
+  }
 }
 
 
@@ -24,6 +24,11 @@ auto CameraControllerComponent::Clone() -> std::unique_ptr<SceneObject> {
 
 
 auto CameraControllerComponent::Start() -> void {
+  // There is no cursor to capture without a window
+  if (App::Instance().IsHeadless()) {
+    return;
+  }
+
   auto& window{App::Instance().GetWindow()};
   window.SetCursorLock(GetCursorPosition());
   window.SetCursorHiding(true);
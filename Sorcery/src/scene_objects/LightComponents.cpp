@@ -203,6 +203,7 @@ auto LightComponent::GetColor() const -> Vector3 const& {
 
 auto LightComponent::SetColor(Vector3 const& color) -> void {
   mColor = Clamp(color, 0.0f, 1.0f);
+  App::Instance().GetSceneRenderer().NotifyChanged(*this);
 }
 
 
@@ -213,6 +214,7 @@ auto LightComponent::GetIntensity() const -> f32 {
 
 auto LightComponent::SetIntensity(f32 const intensity) -> void {
   mIntensity = std::max(intensity, MIN_INTENSITY);
+  App::Instance().GetSceneRenderer().NotifyChanged(*this);
 }
 
 
@@ -223,6 +225,7 @@ auto LightComponent::IsCastingShadow() const -> bool {
 
 auto LightComponent::SetCastingShadow(bool const castShadow) -> void {
   mCastsShadow = castShadow;
+  App::Instance().GetSceneRenderer().NotifyChanged(*this);
 }
 
 
@@ -233,6 +236,7 @@ auto LightComponent::GetType() const noexcept -> Type {
 
 auto LightComponent::SetType(Type const type) noexcept -> void {
   mType = type;
+  App::Instance().GetSceneRenderer().NotifyChanged(*this);
 }
 
 
@@ -248,6 +252,7 @@ auto LightComponent::GetShadowNearPlane() const -> f32 {
 
 auto LightComponent::SetShadowNearPlane(f32 const nearPlane) -> void {
   mShadowNear = std::max(nearPlane, MIN_SHADOW_NEAR_PLANE);
+  App::Instance().GetSceneRenderer().NotifyChanged(*this);
 }
 
 
@@ -258,6 +263,7 @@ auto LightComponent::GetRange() const -> f32 {
 
 auto LightComponent::SetRange(f32 const range) -> void {
   mRange = std::max(range, MIN_RANGE);
+  App::Instance().GetSceneRenderer().NotifyChanged(*this);
 }
 
 
@@ -268,6 +274,7 @@ auto LightComponent::GetInnerAngle() const -> f32 {
 
 auto LightComponent::SetInnerAngle(f32 const degrees) -> void {
   mInnerAngle = std::clamp(degrees, MIN_ANGLE_DEG, GetOuterAngle());
+  App::Instance().GetSceneRenderer().NotifyChanged(*this);
 }
 
 
@@ -278,6 +285,7 @@ auto LightComponent::GetOuterAngle() const -> f32 {
 
 auto LightComponent::SetOuterAngle(f32 const degrees) -> void {
   mOuterAngle = std::clamp(degrees, GetInnerAngle(), MAX_ANGLE_DEG);
+  App::Instance().GetSceneRenderer().NotifyChanged(*this);
 }
 
 
@@ -288,6 +296,7 @@ auto LightComponent::GetShadowNormalBias() const noexcept -> float {
 
 auto LightComponent::SetShadowNormalBias(float const bias) noexcept -> void {
   mShadowNormalBias = std::max(bias, 0.0f);
+  App::Instance().GetSceneRenderer().NotifyChanged(*this);
 }
 
 
@@ -298,6 +307,7 @@ auto LightComponent::GetShadowDepthBias() const noexcept -> float {
 
 auto LightComponent::SetShadowDepthBias(float const bias) noexcept -> void {
   mShadowDepthBias = bias;
+  App::Instance().GetSceneRenderer().NotifyChanged(*this);
 }
 
 
@@ -308,6 +318,7 @@ auto LightComponent::GetShadowExtension() const noexcept -> float {
 
 auto LightComponent::SetShadowExtension(float const shadowExtension) noexcept -> void {
   mShadowExtension = std::max(shadowExtension, MIN_SHADOW_EXTENSION);
+  App::Instance().GetSceneRenderer().NotifyChanged(*this);
 }
 
 
@@ -12,7 +12,8 @@
 RTTR_REGISTRATION {
   rttr::registration::class_<sorcery::MeshComponentBase>{"Mesh Component Base"}
     .property("mesh", &sorcery::MeshComponentBase::GetMesh, &sorcery::MeshComponentBase::SetMesh)
-    .property("materials", &sorcery::MeshComponentBase::GetMaterials, &sorcery::MeshComponentBase::SetMaterials);
+    .property("materials", &sorcery::MeshComponentBase::GetMaterials, &sorcery::MeshComponentBase::SetMaterials)
+    .property("occluder", &sorcery::MeshComponentBase::IsOccluder, &sorcery::MeshComponentBase::SetOccluder);
 }
 
 
@@ -52,6 +53,14 @@ auto MeshComponentBase::OnDrawProperties(bool& changed) -> void {
     }
   }
 
+  ImGui::TableNextColumn();
+  ImGui::Text("Occluder");
+  ImGui::TableNextColumn();
+
+  if (auto occluder{IsOccluder()}; ImGui::Checkbox("##occluderCheckbox", &occluder)) {
+    SetOccluder(occluder);
+  }
+
   ImGui::TableNextColumn();
   ImGui::Text("Show bounding boxes");
   ImGui::TableNextColumn();
@@ -126,6 +135,7 @@ auto MeshComponentBase::GetMesh() const noexcept -> Mesh* {
 auto MeshComponentBase::SetMesh(Mesh* const mesh) noexcept -> void {
   mesh_ = mesh;
   ResizeMaterialListToSubmeshCount();
+  App::Instance().GetSceneRenderer().NotifyChanged(*this);
 }
 
 
@@ -137,6 +147,7 @@ auto MeshComponentBase::GetMaterials() const noexcept -> std::vector<Material*>
 auto MeshComponentBase::SetMaterials(std::vector<Material*> const& materials) -> void {
   materials_ = materials;
   ResizeMaterialListToSubmeshCount();
+  App::Instance().GetSceneRenderer().NotifyChanged(*this);
 }
 
 
@@ -148,6 +159,18 @@ auto MeshComponentBase::SetMaterial(int const idx, Material* const mtl) -> void
   }
 
   materials_[idx] = mtl;
+  App::Instance().GetSceneRenderer().NotifyChanged(*this);
+}
+
+
+auto MeshComponentBase::IsOccluder() const noexcept -> bool {
+  return occluder_;
+}
+
+
+auto MeshComponentBase::SetOccluder(bool const occluder) noexcept -> void {
+  occluder_ = occluder;
+  App::Instance().GetSceneRenderer().NotifyChanged(*this);
 }
 
 
@@ -27,11 +27,17 @@ public:
   LEOPPHAPI auto SetMaterials(std::vector<Material*> const& materials) -> void;
   LEOPPHAPI auto SetMaterial(int idx, Material* mtl) -> void;
 
+  // Occluders are rasterized for software occlusion culling.
+  // Only meshes that keep their geometry in CPU memory, like the built-in primitives, can occlude.
+  [[nodiscard]] LEOPPHAPI auto IsOccluder() const noexcept -> bool;
+  LEOPPHAPI auto SetOccluder(bool occluder) noexcept -> void;
+
 private:
   auto ResizeMaterialListToSubmeshCount() -> void;
 
   std::vector<Material*> materials_;
   Mesh* mesh_;
+  bool occluder_{false};
 
   static bool show_bounding_boxes_; // TODO this should be stripped when not compiling for Mage
 };
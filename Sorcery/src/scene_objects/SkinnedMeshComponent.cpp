@@ -1,8 +1,9 @@
 #include "SkinnedMeshComponent.hpp"
 
-#include <cmath>
 #include <imgui.h>
 
+#include <utility>
+
 #include "../app.hpp"
 #include "../Timing.hpp"
 
@@ -24,14 +25,21 @@ auto SkinnedMeshComponent::OnDrawProperties(bool& changed) -> void {
   items.emplace_back("None");
 
   if (auto const mesh{GetMesh()}) {
-    for (auto const& [name, duration, ticks_per_second, node_anims] : mesh->GetAnimations()) {
-      items.emplace_back(name.c_str());
+    for (auto const& animation : mesh->GetAnimations()) {
+      items.emplace_back(animation->name.c_str());
     }
   }
 
-  if (auto combo_idx{static_cast<int>(cur_animation_idx_ ? *cur_animation_idx_ + 1 : 0)};
+  auto& base_state_machine{animation_layer_states_.front().state_machine};
+  auto const cur_state_idx{base_state_machine.GetCurrentStateIdx()};
+
+  if (auto combo_idx{static_cast<int>(cur_state_idx ? *cur_state_idx + 1 : 0)};
     ImGui::Combo("##animCombo", &combo_idx, items.data(), static_cast<int>(items.size()))) {
-    cur_animation_idx_ = combo_idx == 0 ? std::nullopt : std::make_optional(combo_idx - 1);
+    if (combo_idx == 0) {
+      base_state_machine.Stop();
+    } else {
+      base_state_machine.CrossFade(static_cast<std::size_t>(combo_idx - 1), default_cross_fade_duration_);
+    }
   }
 }
 
@@ -74,37 +82,44 @@ auto SkinnedMeshComponent::SetMesh(Mesh* const mesh) noexcept -> void {
       skinned_tangent_buffers_[i] = App::Instance().GetGraphicsDevice().CreateBuffer(
         graphics::BufferDesc{mesh->GetVertexCount() * sizeof(Vector4), sizeof(Vector4), false, true, true},
         D3D12_HEAP_TYPE_DEFAULT);
+    }
+  }
+
+  // The base layer plays the clips of the mesh, the other layers are set up by their users
+  auto& base_state_machine{animation_layer_states_.front().state_machine};
+  base_state_machine.Clear();
 
-      if (auto const bones{mesh->GetBones()}; !bones.empty()) {
-        bone_matrix_buffers_[i] = App::Instance().GetGraphicsDevice().CreateBuffer(
-          graphics::BufferDesc{mesh->GetBones().size() * sizeof(Matrix4), sizeof(Matrix4), false, false, true},
-          D3D12_HEAP_TYPE_DEFAULT);
-      }
+  if (mesh) {
+    for (auto const& animation : mesh->GetAnimations()) {
+      base_state_machine.AddState(AnimationStateMachine::State{animation});
     }
 
-    cur_animation_time_ticks_ = 0;
-    cur_anim_delta_time_ = 0;
-    cur_animation_idx_ = mesh->GetAnimations().empty() ? std::nullopt : std::make_optional(0);
-  } else {
-    cur_animation_idx_.reset();
+    base_state_machine.SetState(0);
   }
+
+  UpdateAnimationLayers();
 }
 
 
 auto SkinnedMeshComponent::Start() -> void {
   MeshComponentBase::Start();
-  cur_animation_time_ticks_ = 0;
-  cur_anim_delta_time_ = 0;
+
+  for (auto& layer_state : animation_layer_states_) {
+    if (auto const state_idx{layer_state.state_machine.GetCurrentStateIdx()}) {
+      layer_state.state_machine.SetState(*state_idx);
+    }
+  }
+
+  UpdateAnimationLayers();
 }
 
 
 auto SkinnedMeshComponent::Update() -> void {
-  if (auto const mesh{GetMesh()}; mesh && cur_animation_idx_ && *cur_animation_idx_ < mesh->GetAnimations().size()) {
-    auto const& [name, duration, ticks_per_second, node_anims]{mesh->GetAnimations()[*cur_animation_idx_]};
-    auto const actual_ticks_per_second{ticks_per_second == 0 ? 25.0f : ticks_per_second};
-    cur_anim_delta_time_ += timing::GetFrameTime();
-    cur_animation_time_ticks_ = std::fmod(cur_anim_delta_time_ * actual_ticks_per_second, duration);
+  for (auto& layer_state : animation_layer_states_) {
+    layer_state.state_machine.Update(timing::GetFrameTime());
   }
+
+  UpdateAnimationLayers();
 }
 
 
@@ -131,18 +146,70 @@ auto SkinnedMeshComponent::GetSkinnedTangentBuffers() const noexcept -> std::spa
 }
 
 
-auto SkinnedMeshComponent::GetBoneMatrixBuffers() const noexcept -> std::span<
-  graphics::SharedDeviceChildHandle<graphics::Buffer> const, rendering::RenderManager::GetMaxFramesInFlight()> {
-  return bone_matrix_buffers_;
+auto SkinnedMeshComponent::GetCurrentAnimation() const -> std::shared_ptr<Animation const> {
+  auto const& base_state_machine{animation_layer_states_.front().state_machine};
+  auto const state_idx{base_state_machine.GetCurrentStateIdx()};
+  return state_idx ? base_state_machine.GetStates()[*state_idx].animation : nullptr;
 }
 
 
-auto SkinnedMeshComponent::GetCurrentAnimation() const -> std::optional<Animation> {
-  return cur_animation_idx_ ? std::make_optional(GetMesh()->GetAnimations()[*cur_animation_idx_]) : std::nullopt;
+auto SkinnedMeshComponent::GetCurrentAnimationTime() const noexcept -> float {
+  return animation_layer_states_.front().state_machine.GetCurrentTime();
 }
 
 
-auto SkinnedMeshComponent::GetCurrentAnimationTime() const noexcept -> float {
-  return cur_animation_time_ticks_;
+auto SkinnedMeshComponent::AddAnimationLayer(float const weight, AnimationBlendMode const blend_mode,
+                                             std::shared_ptr<std::vector<float> const> node_mask) -> std::size_t {
+  animation_layer_states_.emplace_back(AnimationStateMachine{}, weight, blend_mode, std::move(node_mask));
+  return animation_layer_states_.size() - 1;
+}
+
+
+auto SkinnedMeshComponent::GetAnimationLayerCount() const noexcept -> std::size_t {
+  return animation_layer_states_.size();
+}
+
+
+auto SkinnedMeshComponent::GetAnimationStateMachine(std::size_t const layer_idx) -> AnimationStateMachine& {
+  return animation_layer_states_[layer_idx].state_machine;
+}
+
+
+auto SkinnedMeshComponent::SetAnimationLayerWeight(std::size_t const layer_idx, float const weight) -> void {
+  animation_layer_states_[layer_idx].weight = weight;
+}
+
+
+auto SkinnedMeshComponent::GetAnimationLayers() const noexcept -> std::span<AnimationLayer const> {
+  return animation_layers_;
+}
+
+
+auto SkinnedMeshComponent::GetAnimationLods() const noexcept -> AnimationLods const& {
+  return animation_lods_;
+}
+
+
+auto SkinnedMeshComponent::SetAnimationLods(AnimationLods const& lods) noexcept -> void {
+  animation_lods_ = lods;
+}
+
+
+auto SkinnedMeshComponent::IsPausingAnimationWhenCulled() const noexcept -> bool {
+  return pausing_animation_when_culled_;
+}
+
+
+auto SkinnedMeshComponent::SetPausingAnimationWhenCulled(bool const pause) noexcept -> void {
+  pausing_animation_when_culled_ = pause;
+}
+
+
+auto SkinnedMeshComponent::UpdateAnimationLayers() -> void {
+  animation_layers_.clear();
+
+  for (auto const& [state_machine, weight, blend_mode, node_mask] : animation_layer_states_) {
+    state_machine.ExtractLayers(weight, blend_mode, node_mask, animation_layers_);
+  }
 }
 }
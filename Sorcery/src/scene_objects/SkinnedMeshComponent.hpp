@@ -2,10 +2,14 @@
 
 #include <array>
 #include <cstddef>
-#include <optional>
+#include <memory>
 #include <span>
+#include <vector>
 
 #include "MeshComponentBase.hpp"
+#include "../animation.hpp"
+#include "../animation_state_machine.hpp"
+#include "../rendering/animation_lod_scheduler.hpp"
 #include "../rendering/graphics.hpp"
 #include "../rendering/render_manager.hpp"
 
@@ -15,6 +19,12 @@ class SkinnedMeshComponent final : public MeshComponentBase {
   RTTR_ENABLE(MeshComponentBase)
 
 public:
+  using AnimationLod = rendering::AnimationLod;
+
+
+  constexpr static std::size_t animation_lod_count{3};
+  using AnimationLods = std::array<AnimationLod, animation_lod_count>;
+
   LEOPPHAPI auto OnDrawProperties(bool& changed) -> void override;
   LEOPPHAPI auto OnDrawGizmosSelected() -> void override;
   [[nodiscard]] LEOPPHAPI auto Clone() -> std::unique_ptr<SceneObject> override;
@@ -34,12 +44,32 @@ public:
     graphics::SharedDeviceChildHandle<graphics::Buffer> const, rendering::RenderManager::GetMaxFramesInFlight()>;
   [[nodiscard]] LEOPPHAPI auto GetSkinnedTangentBuffers() const noexcept -> std::span<
     graphics::SharedDeviceChildHandle<graphics::Buffer> const, rendering::RenderManager::GetMaxFramesInFlight()>;
-  [[nodiscard]] LEOPPHAPI auto GetBoneMatrixBuffers() const noexcept -> std::span<
-    graphics::SharedDeviceChildHandle<graphics::Buffer> const, rendering::RenderManager::GetMaxFramesInFlight()>;
 
-  [[nodiscard]] LEOPPHAPI auto GetCurrentAnimation() const -> std::optional<Animation>;
+  // Returns the animation of the current state of the base layer, or null if there is no animation playing
+  [[nodiscard]] LEOPPHAPI auto GetCurrentAnimation() const -> std::shared_ptr<Animation const>;
   [[nodiscard]] LEOPPHAPI auto GetCurrentAnimationTime() const noexcept -> float;
 
+  // Layers are blended in order onto the bind pose. The base layer at index 0 always exists, it gets one state per
+  // animation of the mesh whenever the mesh is set.
+  // The node mask holds a weight per skeleton node, or is null to affect all nodes fully.
+  LEOPPHAPI auto AddAnimationLayer(float weight, AnimationBlendMode blend_mode,
+                                   std::shared_ptr<std::vector<float> const> node_mask = nullptr) -> std::size_t;
+  [[nodiscard]] LEOPPHAPI auto GetAnimationLayerCount() const noexcept -> std::size_t;
+  [[nodiscard]] LEOPPHAPI auto GetAnimationStateMachine(std::size_t layer_idx) -> AnimationStateMachine&;
+  LEOPPHAPI auto SetAnimationLayerWeight(std::size_t layer_idx, float weight) -> void;
+
+  // Clip layers to evaluate for the current frame, updated by Update
+  [[nodiscard]] LEOPPHAPI auto GetAnimationLayers() const noexcept -> std::span<AnimationLayer const>;
+
+  // Levels are ordered from the most detailed, the first one whose screen height is reached is used.
+  // If none is reached, the last one is used.
+  [[nodiscard]] LEOPPHAPI auto GetAnimationLods() const noexcept -> AnimationLods const&;
+  LEOPPHAPI auto SetAnimationLods(AnimationLods const& lods) noexcept -> void;
+
+  // Paused instances keep their last pose while they are outside of all camera frustums
+  [[nodiscard]] LEOPPHAPI auto IsPausingAnimationWhenCulled() const noexcept -> bool;
+  LEOPPHAPI auto SetPausingAnimationWhenCulled(bool pause) noexcept -> void;
+
 private:
   std::array<graphics::SharedDeviceChildHandle<graphics::Buffer>, rendering::RenderManager::GetMaxFramesInFlight()>
   skinned_vertex_buffers_;
@@ -47,11 +77,28 @@ private:
   skinned_normal_buffers_;
   std::array<graphics::SharedDeviceChildHandle<graphics::Buffer>, rendering::RenderManager::GetMaxFramesInFlight()>
   skinned_tangent_buffers_;
-  std::array<graphics::SharedDeviceChildHandle<graphics::Buffer>, rendering::RenderManager::GetMaxFramesInFlight()>
-  bone_matrix_buffers_;
 
-  std::optional<std::size_t> cur_animation_idx_;
-  float cur_animation_time_ticks_{0};
-  float cur_anim_delta_time_{0};
+  struct AnimationLayerState {
+    AnimationStateMachine state_machine;
+    float weight;
+    AnimationBlendMode blend_mode;
+    std::shared_ptr<std::vector<float> const> node_mask;
+  };
+
+
+  auto UpdateAnimationLayers() -> void;
+
+  // Fade duration in seconds when the animation is changed in the editor
+  constexpr static float default_cross_fade_duration_{0.2f};
+
+  std::vector<AnimationLayerState> animation_layer_states_{
+    AnimationLayerState{{}, 1, AnimationBlendMode::Override, nullptr}
+  };
+  std::vector<AnimationLayer> animation_layers_;
+
+  AnimationLods animation_lods_{
+    AnimationLod{0.25f, 1, 0}, AnimationLod{0.08f, 2, 1}, AnimationLod{0, 4, 2}
+  };
+  bool pausing_animation_when_culled_{true};
 };
 }
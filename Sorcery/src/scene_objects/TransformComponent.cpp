@@ -114,8 +114,20 @@ TransformComponent::TransformComponent(TransformComponent&& other) noexcept :
 }
 
 
+TransformComponent::~TransformComponent() {
+  // Only changed transforms are known to the observer
+  if (HasChanged() && change_observer_) {
+    change_observer_->OnTransformDestroyed(*this);
+  }
+}
+
+
 auto TransformComponent::UpdateWorldDataRecursive() -> void {
-  SetChanged(true);
+  // The observer resets the flag once it consumed the change, until then it doesn't need to be notified again
+  if (!HasChanged() && change_observer_) {
+    SetChanged(true);
+    change_observer_->OnTransformChanged(*this);
+  }
 
   mWorldPosition = mParent != nullptr
                      ? mParent->mWorldPosition + mParent->mWorldRotation.Rotate(mLocalPosition)
@@ -339,4 +351,12 @@ auto TransformComponent::HasChanged() const noexcept -> bool {
 auto TransformComponent::SetChanged(bool const changed) noexcept -> void {
   mChanged = changed;
 }
+
+
+auto TransformComponent::SetChangeObserver(ObserverPtr<TransformChangeObserver> const observer) noexcept -> void {
+  change_observer_ = observer;
+}
+
+
+ObserverPtr<TransformChangeObserver> TransformComponent::change_observer_;
 }
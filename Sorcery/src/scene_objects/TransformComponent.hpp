@@ -2,6 +2,7 @@
 
 #include "Component.hpp"
 #include "../Math.hpp"
+#include "../observer_ptr.hpp"
 
 
 namespace sorcery {
@@ -11,6 +12,19 @@ enum class Space : int {
 };
 
 
+class TransformComponent;
+
+
+// Receives the transforms whose world data changed, and resets their changed flag once it consumed the change.
+// Changed transforms that are destroyed before that are reported so that the observer can forget them.
+class TransformChangeObserver {
+public:
+  virtual ~TransformChangeObserver() = default;
+  virtual auto OnTransformChanged(TransformComponent& transform) noexcept -> void = 0;
+  virtual auto OnTransformDestroyed(TransformComponent& transform) noexcept -> void = 0;
+};
+
+
 class TransformComponent : public Component {
   RTTR_ENABLE(Component)
   RTTR_REGISTRATION_FRIEND
@@ -27,7 +41,7 @@ public:
   LEOPPHAPI TransformComponent(TransformComponent const& other);
   LEOPPHAPI TransformComponent(TransformComponent&& other) noexcept;
 
-  ~TransformComponent() override = default;
+  LEOPPHAPI ~TransformComponent() override;
 
   auto operator=(TransformComponent const& other) -> void = delete;
   auto operator=(TransformComponent&& other) -> void = delete;
@@ -74,9 +88,13 @@ public:
   [[nodiscard]] LEOPPHAPI auto GetLocalToWorldMatrix() const noexcept -> Matrix4 const&;
   [[nodiscard]] LEOPPHAPI auto CalculateLocalToWorldMatrixWithoutScale() const noexcept -> Matrix4;
 
+  // A changed transform notifies the change observer once, then stays changed until the observer resets the flag.
+  // Without an observer the flag is never set.
   [[nodiscard]] LEOPPHAPI auto HasChanged() const noexcept -> bool;
   LEOPPHAPI auto SetChanged(bool changed) noexcept -> void;
 
+  LEOPPHAPI static auto SetChangeObserver(ObserverPtr<TransformChangeObserver> observer) noexcept -> void;
+
 private:
   auto UpdateWorldDataRecursive() -> void;
 
@@ -99,5 +117,7 @@ private:
   Matrix4 mLocalToWorldMtx{Matrix4::Identity()};
 
   bool mChanged{false};
+
+  static ObserverPtr<TransformChangeObserver> change_observer_;
 };
 }
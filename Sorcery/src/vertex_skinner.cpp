@@ -0,0 +1,177 @@
+#include "vertex_skinner.hpp"
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <thread>
+
+
+namespace sorcery {
+namespace {
+// The position goes in the low lane, the normal in the high lane
+[[nodiscard]] auto BroadcastPair(float const low, float const high) noexcept -> __m256 {
+  return _mm256_set_m128(_mm_set1_ps(high), _mm_set1_ps(low));
+}
+
+
+[[nodiscard]] auto LoadRow(Matrix4 const& mtx, int const row_idx) noexcept -> __m128 {
+  return _mm_loadu_ps(mtx.GetData() + row_idx * 4);
+}
+
+
+// Sums the squares in the same order as the scalar implementation so that the results are identical
+[[nodiscard]] auto Normalize3(__m128 const vec) noexcept -> __m128 {
+  auto const sq{_mm_mul_ps(vec, vec)};
+  auto len_sq{_mm_add_ss(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(1, 1, 1, 1)))};
+  len_sq = _mm_add_ss(len_sq, _mm_movehl_ps(sq, sq));
+  return _mm_div_ps(vec, _mm_set1_ps(_mm_cvtss_f32(_mm_sqrt_ss(len_sq))));
+}
+
+
+auto Store3(__m128 const vec, Vector3& out) noexcept -> void {
+  alignas(16) std::array<float, 4> data;
+  _mm_store_ps(data.data(), vec);
+  out = Vector3{data[0], data[1], data[2]};
+}
+
+
+[[nodiscard]] auto Normalize3(Vector3 const& vec) noexcept -> Vector3 {
+  auto const len{std::sqrt(vec[0] * vec[0] + vec[1] * vec[1] + vec[2] * vec[2])};
+  return Vector3{vec[0] / len, vec[1] / len, vec[2] / len};
+}
+}
+
+
+auto VertexSkinner::Skin(Input const& input, Output const& output, JobSystem& job_system) -> void {
+  auto const vertex_count{input.positions.size()};
+  auto const job_count{
+    std::min<std::size_t>((vertex_count + min_job_vertex_count_ - 1) / min_job_vertex_count_,
+      std::max(std::jthread::hardware_concurrency(), 1u))
+  };
+
+  if (job_count <= 1) {
+    SkinRange(input, output, 0, vertex_count);
+    return;
+  }
+
+  jobs_.clear();
+
+  for (std::size_t i{0}; i < job_count; i++) {
+    jobs_.emplace_back(job_system.CreateJob([&input, &output, i, job_count, vertex_count] {
+      auto const first_vertex_idx{i * vertex_count / job_count};
+      SkinRange(input, output, first_vertex_idx, (i + 1) * vertex_count / job_count - first_vertex_idx);
+    }));
+    job_system.Run(jobs_.back());
+  }
+
+  for (auto const job : jobs_) {
+    job_system.Wait(job);
+  }
+}
+
+
+auto VertexSkinner::SkinRange(Input const& input, Output const& output, std::size_t const first_vertex_idx,
+                              std::size_t const vertex_count) noexcept -> void {
+  auto const has_normals{!input.normals.empty()};
+  auto const has_tangents{!input.tangents.empty()};
+
+  for (auto i{first_vertex_idx}; i < first_vertex_idx + vertex_count; i++) {
+    auto const& pos{input.positions[i]};
+    auto const norm{has_normals ? input.normals[i] : Vector3{0}};
+    auto const tan{has_tangents ? input.tangents[i] : Vector3{0}};
+    auto const& weights{input.bone_weights[i]};
+    auto const& indices{input.bone_indices[i]};
+
+    auto const pos_norm_x{BroadcastPair(pos[0], norm[0])};
+    auto const pos_norm_y{BroadcastPair(pos[1], norm[1])};
+    auto const pos_norm_z{BroadcastPair(pos[2], norm[2])};
+    auto const tan_x{_mm_set1_ps(tan[0])};
+    auto const tan_y{_mm_set1_ps(tan[1])};
+    auto const tan_z{_mm_set1_ps(tan[2])};
+
+    auto skinned_pos_norm{_mm256_setzero_ps()};
+    auto skinned_tan{_mm_setzero_ps()};
+
+    for (auto j{0}; j < 4; j++) {
+      auto const& mtx{input.bone_palette[indices[j]]};
+      auto const row0{LoadRow(mtx, 0)};
+      auto const row1{LoadRow(mtx, 1)};
+      auto const row2{LoadRow(mtx, 2)};
+      auto const row3{LoadRow(mtx, 3)};
+
+      // Row vectors, the translation only applies to the position
+      auto pos_norm{_mm256_mul_ps(pos_norm_x, _mm256_set_m128(row0, row0))};
+      pos_norm = _mm256_add_ps(pos_norm, _mm256_mul_ps(pos_norm_y, _mm256_set_m128(row1, row1)));
+      pos_norm = _mm256_add_ps(pos_norm, _mm256_mul_ps(pos_norm_z, _mm256_set_m128(row2, row2)));
+      pos_norm = _mm256_blend_ps(_mm256_add_ps(pos_norm, _mm256_castps128_ps256(row3)), pos_norm, 0xF0);
+
+      // No fused multiply-add, the shader rounds the products separately too
+      auto const weight{_mm256_set1_ps(weights[j])};
+      skinned_pos_norm = _mm256_add_ps(skinned_pos_norm, _mm256_mul_ps(pos_norm, weight));
+
+      if (has_tangents) {
+        auto tan_skinned{_mm_mul_ps(tan_x, row0)};
+        tan_skinned = _mm_add_ps(tan_skinned, _mm_mul_ps(tan_y, row1));
+        tan_skinned = _mm_add_ps(tan_skinned, _mm_mul_ps(tan_z, row2));
+        skinned_tan = _mm_add_ps(skinned_tan, _mm_mul_ps(tan_skinned, _mm256_castps256_ps128(weight)));
+      }
+    }
+
+    Store3(_mm256_castps256_ps128(skinned_pos_norm), output.positions[i]);
+
+    if (has_normals) {
+      Store3(Normalize3(_mm256_extractf128_ps(skinned_pos_norm, 1)), output.normals[i]);
+    }
+
+    if (has_tangents) {
+      Store3(Normalize3(skinned_tan), output.tangents[i]);
+    }
+  }
+}
+
+
+auto VertexSkinner::SkinRangeReference(Input const& input, Output const& output, std::size_t const first_vertex_idx,
+                                       std::size_t const vertex_count) noexcept -> void {
+  auto const has_normals{!input.normals.empty()};
+  auto const has_tangents{!input.tangents.empty()};
+
+  for (auto i{first_vertex_idx}; i < first_vertex_idx + vertex_count; i++) {
+    Vector3 skinned_pos{0};
+    Vector3 skinned_norm{0};
+    Vector3 skinned_tan{0};
+
+    for (auto j{0}; j < 4; j++) {
+      auto const& mtx{input.bone_palette[input.bone_indices[i][j]]};
+      auto const weight{input.bone_weights[i][j]};
+
+      for (auto col{0}; col < 3; col++) {
+        auto const& pos{input.positions[i]};
+        skinned_pos[col] += (pos[0] * mtx[0][col] + pos[1] * mtx[1][col] + pos[2] * mtx[2][col] + mtx[3][col]) *
+          weight;
+
+        if (has_normals) {
+          auto const& norm{input.normals[i]};
+          skinned_norm[col] += (norm[0] * mtx[0][col] + norm[1] * mtx[1][col] + norm[2] * mtx[2][col]) * weight;
+        }
+
+        if (has_tangents) {
+          auto const& tan{input.tangents[i]};
+          skinned_tan[col] += (tan[0] * mtx[0][col] + tan[1] * mtx[1][col] + tan[2] * mtx[2][col]) * weight;
+        }
+      }
+    }
+
+    output.positions[i] = skinned_pos;
+
+    if (has_normals) {
+      output.normals[i] = Normalize3(skinned_norm);
+    }
+
+    if (has_tangents) {
+      output.tangents[i] = Normalize3(skinned_tan);
+    }
+  }
+}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Core.hpp"
+#include "job_system.hpp"
+#include "Math.hpp"
+#include "observer_ptr.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+
+namespace sorcery {
+// Skins vertices on the CPU for consumers that need the animated geometry, like raycasts, bounds or physics.
+// The math follows the vertex skinning compute shader operation by operation, so the results match the rendered
+// geometry up to the floating point precision of the GPU.
+// The vectorized path transforms the position and the normal of a vertex together in AVX registers and produces the
+// same bits as the scalar implementation.
+// Has no dependency on the graphics device, so it can be used headless.
+class VertexSkinner {
+public:
+  struct Input {
+    std::span<Vector3 const> positions;
+    std::span<Vector3 const> normals; // Either empty or one per position
+    std::span<Vector3 const> tangents; // Either empty or one per position
+    std::span<Vector4 const> bone_weights;
+    std::span<Vector<std::uint32_t, 4> const> bone_indices; // Must be valid indices into the palette
+    std::span<Matrix4 const> bone_palette;
+  };
+
+
+  // Outputs are written for the attributes present in the input, and must hold one element per position
+  struct Output {
+    std::span<Vector3> positions;
+    std::span<Vector3> normals;
+    std::span<Vector3> tangents;
+  };
+
+
+  // Splits the vertices into ranges skinned in parallel jobs
+  LEOPPHAPI auto Skin(Input const& input, Output const& output, JobSystem& job_system) -> void;
+
+  LEOPPHAPI static auto SkinRange(Input const& input, Output const& output, std::size_t first_vertex_idx,
+                                  std::size_t vertex_count) noexcept -> void;
+  // Scalar implementation that the vectorized path is validated against
+  LEOPPHAPI static auto SkinRangeReference(Input const& input, Output const& output, std::size_t first_vertex_idx,
+                                           std::size_t vertex_count) noexcept -> void;
+
+private:
+  constexpr static std::size_t min_job_vertex_count_{4096};
+
+  std::vector<ObserverPtr<Job>> jobs_;
+};
+}